@@ -89,6 +89,12 @@ int dstrealloc(dstring_t *strptr, size_t bytes) {
       return dstrnalloc(strptr, bytes);
    }
 
+   /* a pool's strings are carved out of its memory and can't be resized */
+   if (DSTRREF(*strptr)->flags & DSTR_FLAG_POOLED) {
+      _setdstrerrno(DSTR_READONLY);
+      return DSTR_READONLY;
+   }
+
    /* if a value of 0 is given, we must free the string */
    if (0 == bytes) {
       return dstrfree(strptr);
@@ -115,6 +121,7 @@ int dstrealloc(dstring_t *strptr, size_t bytes) {
    /* update the buf and buflen members and return success */
    DSTRBUF(*strptr) = tmpbuf;
    DSTRBUFLEN(*strptr) = bytes;
+   DSTRDIRTY(*strptr);
    _setdstrerrno(DSTR_SUCCESS);
    return DSTR_SUCCESS;
 }
@@ -129,7 +136,14 @@ int dstrfree(dstring_t *strptr) {
       return DSTR_UNINITIALIZED;
    }
 
+   /* a pool's strings are freed along with the pool */
+   if (DSTRREF(*strptr)->flags & DSTR_FLAG_POOLED) {
+      _setdstrerrno(DSTR_READONLY);
+      return DSTR_READONLY;
+   }
+
    /* free allocated memory */
+   free(DSTRREF(*strptr)->cpindex);
    free(DSTRBUF(*strptr));
    free(DSTRREF(*strptr));
 
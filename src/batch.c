@@ -0,0 +1,632 @@
+
+/* ************************************************************************* *\
+   * File: batch.c                                                         *
+   * Purpose:                                                              *
+   *    Provides facilities for reading many files into dstring_t objects  *
+   *    at once                                                            *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/* maximum number of reads we'll have in flight at once with io_uring */
+#define URING_DEPTH 128
+
+/* number of worker threads used when io_uring isn't available */
+#define POOL_THREADS 8
+
+/* everything we need to know about a batch of files while reading it */
+struct batch {
+   dstring_t      *dests;       /* where each file's contents will go */
+   const char    **paths;       /* the files to read */
+   size_t          n;           /* number of files in the batch */
+   dstrreadcb_t    callback;    /* called as each file is finished */
+   void           *arg;         /* passed through to callback */
+   size_t          next;        /* next file for a worker thread to read */
+   size_t          successes;   /* number of files read successfully */
+#ifdef DSTR_PTHREAD
+   pthread_mutex_t lock;        /* protects next, successes and callback */
+#endif
+};
+
+static int  openfile(struct batch *b, size_t i, int *fdptr, size_t *sizeptr);
+static void readfile(struct batch *b, size_t i);
+static void finishfile(struct batch *b, size_t i, int status);
+
+#ifdef HAVE_LINUX_IO_URING_H
+static int  uringread(struct batch *b);
+#endif
+
+#ifdef DSTR_PTHREAD
+static void  poolread(struct batch *b);
+static void *poolworker(void *bptr);
+#endif
+
+/* ************************************************************************* */
+
+size_t dstrfreadfiles(dstring_t *dests, const char **paths, size_t n,
+   dstrreadcb_t callback, void *arg) {
+
+   struct batch b;
+#ifndef DSTR_PTHREAD
+   size_t i;
+#endif
+
+   /* make sure we were given arrays to work with */
+   if (NULL == dests || NULL == paths) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   /* nothing to do */
+   if (0 == n) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   b.dests = dests;
+   b.paths = paths;
+   b.n = n;
+   b.callback = callback;
+   b.arg = arg;
+   b.next = 0;
+   b.successes = 0;
+
+#ifdef DSTR_PTHREAD
+   if (0 != pthread_mutex_init(&b.lock, NULL)) {
+      _setdstrerrno(DSTR_NOMEM);
+      return 0;
+   }
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+   /* if the kernel won't give us a ring, fall back on one of the others */
+   if (0 != uringread(&b)) {
+#endif
+
+#ifdef DSTR_PTHREAD
+      poolread(&b);
+#else
+      for (i = 0; i < n; i++) {
+         readfile(&b, i);
+      }
+#endif
+
+#ifdef HAVE_LINUX_IO_URING_H
+   }
+#endif
+
+#ifdef DSTR_PTHREAD
+   pthread_mutex_destroy(&b.lock);
+#endif
+
+   /* the callback has the details about each file that failed */
+   _setdstrerrno(b.successes == n ? DSTR_SUCCESS : DSTR_FILE_ERROR);
+   return b.successes;
+}
+
+/* ************************************************************************* */
+
+/* opens the ith file in a batch and makes dests[i] big enough to hold all
+   of it; returns a status code - FOR INTERNAL USE ONLY! */
+static int openfile(struct batch *b, size_t i, int *fdptr, size_t *sizeptr) {
+
+   struct stat st;
+   int status;
+
+   /* make sure this file has somewhere to go */
+   if (NULL == b->dests[i]) {
+      return DSTR_UNINITIALIZED;
+   }
+
+   if (NULL == b->paths[i]) {
+      return DSTR_NULL_CPTR;
+   }
+
+   /* a pool's strings can't be read into */
+   if (DSTRREF(b->dests[i])->flags & DSTR_FLAG_POOLED) {
+      return DSTR_READONLY;
+   }
+
+   if ((*fdptr = open(b->paths[i], O_RDONLY | O_CLOEXEC)) < 0) {
+      return DSTR_UNOPENED_FILE;
+   }
+
+   if (0 != fstat(*fdptr, &st)) {
+      close(*fdptr);
+      return DSTR_FILE_ERROR;
+   }
+
+   /* some files (in /proc, for example) don't know how big they are */
+   *sizeptr = S_ISREG(st.st_mode) ? (size_t)st.st_size : 0;
+
+   /* pre-size the string so the whole file can be read in one go, with one
+      extra character so that readfile() can detect EOF without growing */
+   DSTRDIRTY(b->dests[i]);
+   DSTRBUF(b->dests[i])[0] = '\0';
+   if (DSTRBUFLEN(b->dests[i]) < *sizeptr + 2) {
+      if (DSTR_SUCCESS != (status = dstrealloc(&b->dests[i], *sizeptr + 2))) {
+         close(*fdptr);
+         return status;
+      }
+   }
+
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* reads the ith file in a batch with ordinary blocking reads - FOR INTERNAL
+   USE ONLY! */
+static void readfile(struct batch *b, size_t i) {
+
+   int fd;
+   int status;
+   size_t size;
+
+   if (DSTR_SUCCESS != (status = openfile(b, i, &fd, &size))) {
+      finishfile(b, i, status);
+      return;
+   }
+
+   /* we ask for one more character than we expect, so that we find out
+      about EOF without the buffer having to grow */
+   if (size > 0) {
+      dstrfdcatn(b->dests[i], fd, size + 1);
+   } else {
+      dstrfdcat(b->dests[i], fd);
+   }
+
+   /* reaching EOF is what we were hoping for */
+   status = DSTR_EOF == dstrerrno ? DSTR_SUCCESS : dstrerrno;
+
+   close(fd);
+   finishfile(b, i, status);
+   return;
+}
+
+/* ************************************************************************* */
+
+/* records the outcome for the ith file in a batch and lets the caller know;
+   callbacks are never run concurrently - FOR INTERNAL USE ONLY! */
+static void finishfile(struct batch *b, size_t i, int status) {
+
+#ifdef DSTR_PTHREAD
+   pthread_mutex_lock(&b->lock);
+#endif
+
+   if (DSTR_SUCCESS == status) {
+      b->successes++;
+   }
+
+   if (NULL != b->callback) {
+      b->callback(b->dests[i], b->paths[i], status, b->arg);
+   }
+
+#ifdef DSTR_PTHREAD
+   pthread_mutex_unlock(&b->lock);
+#endif
+
+   return;
+}
+
+/* ************************************************************************* */
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* a minimal io_uring, mapped straight from the kernel's interface */
+struct uring {
+   int                  fd;
+   unsigned            *sqhead, *sqtail, *sqmask, *sqarray;
+   unsigned            *cqhead, *cqtail, *cqmask;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   void                *sqring, *cqring;
+   size_t               sqringsize, cqringsize, sqessize;
+};
+
+/* a read that has been handed to the kernel */
+struct uringjob {
+   int          fd;
+   size_t       index;         /* which file in the batch this is */
+   size_t       size;          /* how much we expect to read */
+   size_t       done;          /* how much we've read so far */
+   struct iovec iov;           /* must stay put until the read completes */
+};
+
+/* ************************************************************************* */
+
+/* sets up a ring with room for depth submissions; returns 0 on success or
+   -1 if the kernel doesn't support io_uring - FOR INTERNAL USE ONLY! */
+static int uringsetup(struct uring *r, unsigned depth) {
+
+   struct io_uring_params p;
+
+   memset(&p, 0, sizeof(p));
+   if ((r->fd = syscall(__NR_io_uring_setup, depth, &p)) < 0) {
+      return -1;
+   }
+
+   r->sqringsize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   r->cqringsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+   r->sqessize = p.sq_entries * sizeof(struct io_uring_sqe);
+
+   /* newer kernels let both rings share a single mapping */
+   if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      if (r->cqringsize > r->sqringsize) {
+         r->sqringsize = r->cqringsize;
+      }
+      r->cqringsize = r->sqringsize;
+   }
+
+   r->sqring = mmap(NULL, r->sqringsize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+   if (MAP_FAILED == r->sqring) {
+      close(r->fd);
+      return -1;
+   }
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      r->cqring = r->sqring;
+   } else {
+      r->cqring = mmap(NULL, r->cqringsize, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+      if (MAP_FAILED == r->cqring) {
+         munmap(r->sqring, r->sqringsize);
+         close(r->fd);
+         return -1;
+      }
+   }
+
+   r->sqes = mmap(NULL, r->sqessize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+   if (MAP_FAILED == r->sqes) {
+      if (r->cqring != r->sqring) {
+         munmap(r->cqring, r->cqringsize);
+      }
+      munmap(r->sqring, r->sqringsize);
+      close(r->fd);
+      return -1;
+   }
+
+   r->sqhead  = (unsigned *)((char *)r->sqring + p.sq_off.head);
+   r->sqtail  = (unsigned *)((char *)r->sqring + p.sq_off.tail);
+   r->sqmask  = (unsigned *)((char *)r->sqring + p.sq_off.ring_mask);
+   r->sqarray = (unsigned *)((char *)r->sqring + p.sq_off.array);
+   r->cqhead  = (unsigned *)((char *)r->cqring + p.cq_off.head);
+   r->cqtail  = (unsigned *)((char *)r->cqring + p.cq_off.tail);
+   r->cqmask  = (unsigned *)((char *)r->cqring + p.cq_off.ring_mask);
+   r->cqes = (struct io_uring_cqe *)((char *)r->cqring + p.cq_off.cqes);
+
+   return 0;
+}
+
+/* ************************************************************************* */
+
+/* tears down a ring created by uringsetup() - FOR INTERNAL USE ONLY! */
+static void uringteardown(struct uring *r) {
+
+   munmap(r->sqes, r->sqessize);
+   if (r->cqring != r->sqring) {
+      munmap(r->cqring, r->cqringsize);
+   }
+   munmap(r->sqring, r->sqringsize);
+   close(r->fd);
+   return;
+}
+
+/* ************************************************************************* */
+
+/* queues a read of whatever's left of a job; the caller must make sure there
+   is room in the submission queue - FOR INTERNAL USE ONLY! */
+static void uringqueue(struct uring *r, struct uringjob *job, size_t slot) {
+
+   struct io_uring_sqe *sqe;
+   unsigned tail;
+   unsigned index;
+
+   /* we're the only ones who write the tail, so no barrier is needed here */
+   tail = *r->sqtail;
+   index = tail & *r->sqmask;
+   sqe = &r->sqes[index];
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode = IORING_OP_READV;
+   sqe->fd = job->fd;
+   sqe->addr = (unsigned long)&job->iov;
+   sqe->len = 1;
+   sqe->off = job->done;
+   sqe->user_data = slot;
+
+   r->sqarray[index] = index;
+
+   /* the kernel mustn't see the new tail before it can see the entry */
+   __atomic_store_n(r->sqtail, tail + 1, __ATOMIC_RELEASE);
+   return;
+}
+
+/* ************************************************************************* */
+
+/* reads a whole batch using io_uring; returns -1 without having touched
+   anything if io_uring isn't available - FOR INTERNAL USE ONLY! */
+static int uringread(struct batch *b) {
+
+   struct uring     r;
+   struct uringjob  jobs[URING_DEPTH];
+   size_t           freeslots[URING_DEPTH];
+   size_t           nfree;
+   size_t           slot;
+   size_t           next = 0;       /* next file in the batch to start */
+   size_t           inflight = 0;   /* reads the kernel hasn't finished */
+   unsigned         pending = 0;    /* entries queued but not yet submitted */
+   unsigned         depth;
+   unsigned         head;
+   unsigned         tail;
+   long             ret;
+   int              broken = 0;     /* io_uring_enter() failed outright */
+   int              status;
+   int              fd;
+   size_t           size;
+   struct uringjob *job;
+   struct io_uring_cqe *cqe;
+
+   depth = b->n < URING_DEPTH ? (unsigned)b->n : URING_DEPTH;
+   if (0 != uringsetup(&r, depth)) {
+      return -1;
+   }
+
+   for (nfree = 0; nfree < depth; nfree++) {
+      freeslots[nfree] = nfree;
+   }
+
+   while (next < b->n || inflight > 0) {
+
+      /* keep the ring as full as we can */
+      while (!broken && inflight < depth && next < b->n) {
+
+         if (DSTR_SUCCESS != (status = openfile(b, next, &fd, &size))) {
+            finishfile(b, next++, status);
+            continue;
+         }
+
+         /* files that don't know their size are read the ordinary way */
+         if (0 == size) {
+            close(fd);
+            readfile(b, next++);
+            continue;
+         }
+
+         slot = freeslots[--nfree];
+         job = &jobs[slot];
+         job->fd = fd;
+         job->index = next++;
+         job->size = size;
+         job->done = 0;
+         job->iov.iov_base = DSTRBUF(b->dests[job->index]);
+         job->iov.iov_len = size;
+
+         uringqueue(&r, job, slot);
+         inflight++, pending++;
+      }
+
+      if (0 == inflight) {
+         break;
+      }
+
+      /* submit everything we've queued and wait for at least one read */
+      ret = syscall(__NR_io_uring_enter, r.fd, pending, 1,
+         IORING_ENTER_GETEVENTS, NULL, 0);
+
+      if (ret >= 0) {
+         pending -= (unsigned)ret < pending ? (unsigned)ret : pending;
+      }
+
+      /* If the ring is broken, the kernel may still be reading into some of
+         our strings, so we can't just give up on them.  Whatever it never
+         picked up is taken back and read the ordinary way, and everything
+         else is waited for below before the ring is torn down. */
+      else if (!broken && EINTR != errno && EAGAIN != errno &&
+      EBUSY != errno) {
+
+         broken = 1;
+         head = __atomic_load_n(r.sqhead, __ATOMIC_ACQUIRE);
+
+         for (tail = *r.sqtail; head != tail; head++) {
+            slot = (size_t)r.sqes[r.sqarray[head & *r.sqmask]].user_data;
+            close(jobs[slot].fd);
+            readfile(b, jobs[slot].index);
+            freeslots[nfree++] = slot;
+            inflight--;
+         }
+
+         __atomic_store_n(r.sqtail, head, __ATOMIC_RELEASE);
+         pending = 0;
+      }
+
+      /* reap every completion that's available */
+      head = *r.cqhead;
+      tail = __atomic_load_n(r.cqtail, __ATOMIC_ACQUIRE);
+
+      /* the kernel still posts completions without being asked, so if it
+         can't be waited on any more, give it a chance to */
+      if (ret < 0 && head == tail) {
+         sched_yield();
+      }
+
+      for (; head != tail; head++) {
+
+         cqe = &r.cqes[head & *r.cqmask];
+         slot = (size_t)cqe->user_data;
+         job = &jobs[slot];
+
+         /* a read the broken ring would have to finish is started over */
+         if (broken && (cqe->res < 0 || (cqe->res > 0 &&
+         job->done + cqe->res < job->size))) {
+            close(job->fd);
+            readfile(b, job->index);
+            freeslots[nfree++] = slot;
+            inflight--;
+            continue;
+         }
+
+         /* a read can come up short, in which case we ask for the rest */
+         if (cqe->res > 0) {
+            job->done += cqe->res;
+            if (job->done < job->size) {
+               job->iov.iov_base = DSTRBUF(b->dests[job->index]) + job->done;
+               job->iov.iov_len = job->size - job->done;
+               uringqueue(&r, job, slot);
+               pending++;
+               continue;
+            }
+            status = DSTR_SUCCESS;
+         }
+
+         /* the file got shorter since we looked at it */
+         else if (0 == cqe->res) {
+            status = DSTR_SUCCESS;
+         }
+
+         else if (-EINTR == cqe->res || -EAGAIN == cqe->res) {
+            uringqueue(&r, job, slot);
+            pending++;
+            continue;
+         }
+
+         else {
+            status = DSTR_FILE_ERROR;
+         }
+
+         DSTRBUF(b->dests[job->index])[job->done] = '\0';
+         close(job->fd);
+         finishfile(b, job->index, status);
+         freeslots[nfree++] = slot;
+         inflight--;
+      }
+
+      /* let the kernel know it can reuse those completion entries */
+      __atomic_store_n(r.cqhead, head, __ATOMIC_RELEASE);
+   }
+
+   /* nothing is in flight any more, so the ring can safely go */
+   uringteardown(&r);
+
+   /* anything we never got to is read the ordinary way */
+   for (; next < b->n; next++) {
+      readfile(b, next);
+   }
+
+   return 0;
+}
+
+#endif
+
+/* ************************************************************************* */
+
+#ifdef DSTR_PTHREAD
+
+/* reads a whole batch with a pool of worker threads - FOR INTERNAL USE
+   ONLY! */
+static void poolread(struct batch *b) {
+
+   pthread_t threads[POOL_THREADS];
+   size_t nthreads;
+   size_t i;
+
+   nthreads = b->n < POOL_THREADS ? b->n : POOL_THREADS;
+
+   /* make do with however many threads we're able to start */
+   for (i = 0; i < nthreads; i++) {
+      if (0 != pthread_create(&threads[i], NULL, poolworker, b)) {
+         break;
+      }
+   }
+   nthreads = i;
+
+   /* if we couldn't start any threads at all, do the work ourselves */
+   if (0 == nthreads) {
+      poolworker(b);
+   }
+
+   for (i = 0; i < nthreads; i++) {
+      pthread_join(threads[i], NULL);
+   }
+
+   return;
+}
+
+/* ************************************************************************* */
+
+/* keeps reading files from a batch until there are none left - FOR
+   INTERNAL USE ONLY! */
+static void *poolworker(void *bptr) {
+
+   struct batch *b = (struct batch *)bptr;
+   size_t i;
+
+   while (1) {
+
+      pthread_mutex_lock(&b->lock);
+      i = b->next++;
+      pthread_mutex_unlock(&b->lock);
+
+      if (i >= b->n) {
+         break;
+      }
+
+      readfile(b, i);
+   }
+
+   return NULL;
+}
+
+#endif
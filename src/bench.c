@@ -0,0 +1,2533 @@
+
+/* ************************************************************************* *\
+   * File: bench.c                                                         *
+   * Purpose:                                                              *
+   *    Benchmarks for the performance-sensitive parts of the DString      *
+   *    library, usually measured against the standard library.           *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* Build with "make bench", then run "./bench" for a list of benchmarks, or
+   "./bench <name> [arguments]" to run one of them. */
+
+#include <stdio.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <locale.h>
+#include <iconv.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+#endif
+
+#include "dstring.h"
+
+/* a single benchmark that can be selected from the command line */
+typedef struct {
+   const char *name;
+   const char *usage;
+   int (*run)(int argc, char *argv[]);
+} BENCHMARK;
+
+static int benchreadfiles(int argc, char *argv[]);
+static int benchsprintf(int argc, char *argv[]);
+static int benchfloat(int argc, char *argv[]);
+static int benchint(int argc, char *argv[]);
+static int benchjson(int argc, char *argv[]);
+static int benchnumbers(int argc, char *argv[]);
+static int benchsplit(int argc, char *argv[]);
+static int benchcsv(int argc, char *argv[]);
+static int benchbase64(int argc, char *argv[]);
+static int benchurl(int argc, char *argv[]);
+static int benchutf8(int argc, char *argv[]);
+static int benchcase(int argc, char *argv[]);
+static int benchtranscode(int argc, char *argv[]);
+static int benchhash(int argc, char *argv[]);
+static int benchmap(int argc, char *argv[]);
+static int benchcmap(int argc, char *argv[]);
+static int benchintern(int argc, char *argv[]);
+
+static BENCHMARK benchmarks[] = {
+   {"readfiles", "[directory]", benchreadfiles},
+   {"sprintf",   "[iterations]", benchsprintf},
+   {"float",     "[count]", benchfloat},
+   {"int",       "[count]", benchint},
+   {"json",      "[records]", benchjson},
+   {"numbers",   "[rows]", benchnumbers},
+   {"split",     "[records]", benchsplit},
+   {"csv",       "[megabytes | file]", benchcsv},
+   {"base64",    "[megabytes]", benchbase64},
+   {"url",       "[file of URLs]", benchurl},
+   {"utf8",      "[megabytes]", benchutf8},
+   {"case",      "[megabytes]", benchcase},
+   {"transcode", "[megabytes]", benchtranscode},
+   {"hash",      "[lookups]", benchhash},
+   {"map",       "[entries]", benchmap},
+   {"cmap",      "[threads]", benchcmap},
+   {"intern",    "[values]", benchintern},
+   {NULL, NULL, NULL}
+};
+
+/* ************************************************************************* */
+
+/* returns the current time in seconds */
+static double now(void) {
+
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ************************************************************************* */
+
+/* prints one line of results in a consistent format */
+static void report(const char *what, double seconds, double units,
+   const char *unitname) {
+
+   printf("   %-32s %10.4f s %14.0f %s/s\n", what, seconds, units / seconds,
+      unitname);
+}
+
+/* ************************************************************************* */
+
+int main(int argc, char *argv[]) {
+
+   int i;
+
+   if (argc < 2) {
+      printf("usage: %s <benchmark> [arguments]\n\n", argv[0]);
+      printf("available benchmarks:\n");
+      for (i = 0; NULL != benchmarks[i].name; i++) {
+         printf("   %s %s\n", benchmarks[i].name, benchmarks[i].usage);
+      }
+      return EXIT_FAILURE;
+   }
+
+   for (i = 0; NULL != benchmarks[i].name; i++) {
+      if (0 == strcmp(argv[1], benchmarks[i].name)) {
+         return benchmarks[i].run(argc - 2, argv + 2);
+      }
+   }
+
+   fprintf(stderr, "%s: unknown benchmark '%s'\n", argv[0], argv[1]);
+   return EXIT_FAILURE;
+}
+
+/**************************************************************************\
+ * readfiles: dstrfreadfiles() vs. one dstrfreadn() per file              *
+\**************************************************************************/
+
+#define READFILES_COUNT 20000     /* files created if no directory is given */
+#define READFILES_SIZE  2048      /* average size of each created file */
+
+static void countbytes(dstring_t dest, const char *path, int status,
+   void *arg) {
+
+   (void)path;
+
+   if (DSTR_SUCCESS == status) {
+      *(size_t *)arg += dstrlen(dest);
+   }
+}
+
+static int benchreadfiles(int argc, char *argv[]) {
+
+   char          tmpdir[] = "/tmp/dstrbench.XXXXXX";
+   char          path[4096];
+   const char   *dir;
+   char        **paths = NULL;
+   dstring_t    *dests = NULL;
+   size_t        n = 0, i, bytes;
+   double        start;
+   DIR          *dp;
+   FILE         *fp;
+   struct dirent *entry;
+   struct stat   st;
+
+   /* if we weren't given a directory of files to read, make one */
+   if (argc > 0) {
+      dir = argv[0];
+   } else {
+      if (NULL == (dir = mkdtemp(tmpdir))) {
+         perror("mkdtemp");
+         return EXIT_FAILURE;
+      }
+      for (i = 0; i < READFILES_COUNT; i++) {
+         sprintf(path, "%s/%lu", dir, (unsigned long)i);
+         if (NULL == (fp = fopen(path, "w"))) {
+            perror(path);
+            return EXIT_FAILURE;
+         }
+         for (bytes = 0; bytes < READFILES_SIZE / 2 + i % READFILES_SIZE;
+            bytes++) {
+            fputc('a' + bytes % 26, fp);
+         }
+         fclose(fp);
+      }
+   }
+
+   if (NULL == (dp = opendir(dir))) {
+      perror(dir);
+      return EXIT_FAILURE;
+   }
+
+   /* collect every regular file in the directory */
+   while (NULL != (entry = readdir(dp))) {
+      sprintf(path, "%s/%s", dir, entry->d_name);
+      if (0 != stat(path, &st) || !S_ISREG(st.st_mode)) {
+         continue;
+      }
+      paths = realloc(paths, (n + 1) * sizeof(char *));
+      dests = realloc(dests, (n + 1) * sizeof(dstring_t));
+      paths[n] = strdup(path);
+      dests[n] = NULL;
+      if (DSTR_SUCCESS != dstralloc(&dests[n])) {
+         fprintf(stderr, "out of memory\n");
+         return EXIT_FAILURE;
+      }
+      n++;
+   }
+   closedir(dp);
+
+   printf("readfiles: %lu files in %s\n", (unsigned long)n, dir);
+   printf("   (run as root after \"echo 3 > /proc/sys/vm/drop_caches\" to\n");
+   printf("    measure a cold cache)\n\n");
+
+   /* one file at a time, the way it had to be done before */
+   bytes = 0;
+   start = now();
+   for (i = 0; i < n; i++) {
+      if (NULL != (fp = fopen(paths[i], "r"))) {
+         fstat(fileno(fp), &st);
+         bytes += dstrfreadn(dests[i], fp, st.st_size);
+         fclose(fp);
+      }
+   }
+   report("fopen + dstrfreadn", now() - start, n, "files");
+
+   bytes = 0;
+   start = now();
+   dstrfreadfiles(dests, (const char **)paths, n, countbytes, &bytes);
+   report("dstrfreadfiles", now() - start, n, "files");
+   printf("   (%lu bytes read)\n", (unsigned long)bytes);
+
+   for (i = 0; i < n; i++) {
+      if (argc == 0) {
+         unlink(paths[i]);
+      }
+      free(paths[i]);
+      dstrfree(&dests[i]);
+   }
+   if (argc == 0) {
+      rmdir(dir);
+   }
+   free(paths);
+   free(dests);
+
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * sprintf: dstrsprintf() vs. vsnprintf() for typical log lines           *
+\**************************************************************************/
+
+#define SPRINTF_ITERATIONS 2000000
+
+/* roughly what a line in an access log looks like (about 200 bytes) */
+#define SPRINTF_FORMAT "%s %s [%05d] %-8s client=%s:%u method=%s " \
+   "path=%s status=%d bytes=%lu time=%ldus upstream=%s:%u cache=%s " \
+   "request_id=%08lx user=%s\n"
+
+#define SPRINTF_ARGS(I) "2026-10-18", "12:34:56.789", (int)((I) % 100000), \
+   "INFO", "192.168.100.200", 50000 + (unsigned)((I) % 10000), "GET", \
+   "/api/v1/widgets/search", 200 + (int)((I) % 4), \
+   (unsigned long)(I) * 37, (long)((I) % 5000), "10.0.0.17", 8080u, \
+   "MISS", (unsigned long)(I), "anonymous"
+
+/* the same sort of line, but where nearly every field has flags, a width or a
+   precision, so that parsing the conversion specifiers dominates */
+#define SPRINTF_HEAVY "%-10.10s %12.3s [%+06d] %-8.5s %#010lx %-5hu %3.3s " \
+   "%-24.24s %#5o %+-8ld %08lu %-#6x %.2s %5.1s %-4c %08.3d %ld\n"
+
+#define SPRINTF_HEAVY_ARGS(I) "2026-10-18", "12:34:56.789", \
+   (int)((I) % 100000), "INFO", (unsigned long)(I), \
+   (unsigned short)((I) % 65536), "GET", "/api/v1/widgets/search", \
+   (unsigned)((I) % 512), (long)(I) - 5000, (unsigned long)(I) * 37, \
+   (unsigned)(I), "MISS", "anonymous", 'x', (int)((I) % 1000), (long)(I)
+
+/* the first line, split into three pieces */
+#define SPRINTF_PIECE1 "%s %s [%05d] %-8s "
+#define SPRINTF_PIECE1_ARGS(I) "2026-10-18", "12:34:56.789", \
+   (int)((I) % 100000), "INFO"
+#define SPRINTF_PIECE2 "client=%s:%u method=%s path=%s status=%d "
+#define SPRINTF_PIECE2_ARGS(I) "192.168.100.200", \
+   50000 + (unsigned)((I) % 10000), "GET", "/api/v1/widgets/search", \
+   200 + (int)((I) % 4)
+#define SPRINTF_PIECE3 "bytes=%lu time=%ldus request_id=%08lx\n"
+#define SPRINTF_PIECE3_ARGS(I) (unsigned long)(I) * 37, \
+   (long)((I) % 5000), (unsigned long)(I)
+
+/* vsnprintf() into a fixed buffer, the best case for the standard library */
+static int cformat(char *buf, size_t size, const char *format, ...) {
+
+   va_list args;
+   int chars;
+
+   va_start(args, format);
+   chars = vsnprintf(buf, size, format, args);
+   va_end(args);
+
+   return chars;
+}
+
+static int benchsprintf(int argc, char *argv[]) {
+
+   char          buf[1024];
+   unsigned long iterations = SPRINTF_ITERATIONS, i;
+   double        start, bytes;
+   dstring_t     str = NULL, piece = NULL;
+   dstrfmt_t     fmt = NULL;
+
+   if (argc > 0) {
+      iterations = strtoul(argv[0], NULL, 10);
+   }
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   cformat(buf, sizeof(buf), SPRINTF_FORMAT, SPRINTF_ARGS(1UL));
+   printf("sprintf: %lu lines like:\n   %s\n", iterations, buf);
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += cformat(buf, sizeof(buf), SPRINTF_FORMAT, SPRINTF_ARGS(i));
+   }
+   report("vsnprintf", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrsprintf(str, SPRINTF_FORMAT, SPRINTF_ARGS(i));
+   }
+   report("dstrsprintf (reused dstring_t)", now() - start, iterations,
+      "lines");
+
+   dstrfmtcompile(&fmt, SPRINTF_FORMAT);
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrfmtprintf(str, fmt, SPRINTF_ARGS(i));
+   }
+   report("dstrfmtprintf", now() - start, iterations, "lines");
+   dstrfmtfree(&fmt);
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrcsprintf(str, SPRINTF_FORMAT, SPRINTF_ARGS(i));
+   }
+   report("dstrcsprintf", now() - start, iterations, "lines");
+
+   /* a fresh string every time, so the buffer has to grow on every call */
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      dstrfree(&str);
+      dstralloc(&str);
+      bytes += dstrsprintf(str, SPRINTF_FORMAT, SPRINTF_ARGS(i));
+   }
+   report("dstrsprintf (new dstring_t)", now() - start, iterations,
+      "lines");
+
+   cformat(buf, sizeof(buf), SPRINTF_HEAVY, SPRINTF_HEAVY_ARGS(1UL));
+   printf("\nsprintf: %lu format-heavy lines like:\n   %s\n", iterations,
+      buf);
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += cformat(buf, sizeof(buf), SPRINTF_HEAVY,
+         SPRINTF_HEAVY_ARGS(i));
+   }
+   report("vsnprintf", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrsprintf(str, SPRINTF_HEAVY, SPRINTF_HEAVY_ARGS(i));
+   }
+   report("dstrsprintf (reused dstring_t)", now() - start, iterations,
+      "lines");
+
+   dstrfmtcompile(&fmt, SPRINTF_HEAVY);
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrfmtprintf(str, fmt, SPRINTF_HEAVY_ARGS(i));
+   }
+   report("dstrfmtprintf", now() - start, iterations, "lines");
+   dstrfmtfree(&fmt);
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrcsprintf(str, SPRINTF_HEAVY, SPRINTF_HEAVY_ARGS(i));
+   }
+   report("dstrcsprintf", now() - start, iterations, "lines");
+
+   /* building the first line out of three pieces, the way it had to be
+      done before there was an appending printf */
+   printf("\nsprintf: %lu lines built from three formatted pieces\n\n",
+      iterations);
+
+   if (DSTR_SUCCESS != dstralloc(&piece)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      dstrsprintf(str, SPRINTF_PIECE1, SPRINTF_PIECE1_ARGS(i));
+      dstrsprintf(piece, SPRINTF_PIECE2, SPRINTF_PIECE2_ARGS(i));
+      dstrcat(str, piece);
+      dstrsprintf(piece, SPRINTF_PIECE3, SPRINTF_PIECE3_ARGS(i));
+      dstrcat(str, piece);
+   }
+   report("dstrsprintf + dstrcat", now() - start, iterations, "lines");
+
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      dstrsprintf(str, SPRINTF_PIECE1, SPRINTF_PIECE1_ARGS(i));
+      dstrcatprintf(str, SPRINTF_PIECE2, SPRINTF_PIECE2_ARGS(i));
+      dstrcatprintf(str, SPRINTF_PIECE3, SPRINTF_PIECE3_ARGS(i));
+   }
+   report("dstrcatprintf", now() - start, iterations, "lines");
+
+   dstrfree(&piece);
+   dstrfree(&str);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * float: dstrsprintf() vs. snprintf() for %f, %e, %g and round trips     *
+\**************************************************************************/
+
+#define FLOAT_COUNT 2000000
+
+static int benchfloat(int argc, char *argv[]) {
+
+   static const char *formats[] = {"%f", "%.2f", "%e", "%g", "%.17g", NULL};
+
+   char          buf[512];
+   unsigned long count = FLOAT_COUNT, i, seed = 12345;
+   double       *values, start;
+   dstring_t     str = NULL;
+   int           f;
+
+   if (argc > 0) {
+      count = strtoul(argv[0], NULL, 10);
+   }
+
+   if (NULL == (values = malloc(count * sizeof(double))) ||
+   DSTR_SUCCESS != dstralloc(&str)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* a mix of metric-like values and doubles spread over a wide range */
+   for (i = 0; i < count; i++) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      if (i % 2) {
+         values[i] = (double)(seed >> 40) / 1000.0;
+      } else {
+         values[i] = (double)(seed >> 11) / (double)(1UL << 53) *
+            ((seed >> 3) % 2 ? 1e-5 : 1e12);
+      }
+   }
+
+   printf("float: %lu doubles\n\n", count);
+
+   for (f = 0; NULL != formats[f]; f++) {
+
+      start = now();
+      for (i = 0; i < count; i++) {
+         snprintf(buf, sizeof(buf), formats[f], values[i]);
+      }
+      sprintf(buf, "snprintf %s", formats[f]);
+      report(buf, now() - start, count, "doubles");
+
+      start = now();
+      for (i = 0; i < count; i++) {
+         dstrsprintf(str, formats[f], values[i]);
+      }
+      sprintf(buf, "dstrsprintf %s", formats[f]);
+      report(buf, now() - start, count, "doubles");
+   }
+
+   /* %.17g is how printf guarantees a round trip; %r does it in fewer
+      digits */
+   start = now();
+   for (i = 0; i < count; i++) {
+      dstrsprintf(str, "%r", values[i]);
+   }
+   report("dstrsprintf %r", now() - start, count, "doubles");
+
+   dstrfree(&str);
+   free(values);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * int: dstrcatint() vs. snprintf() + dstrcatcs() for integers            *
+\**************************************************************************/
+
+#define INT_COUNT 10000000
+
+static int benchint(int argc, char *argv[]) {
+
+   char          buf[64];
+   unsigned long count = INT_COUNT, i, seed = 12345;
+   long         *values;
+   double        start;
+   dstring_t     str = NULL;
+
+   if (argc > 0) {
+      count = strtoul(argv[0], NULL, 10);
+   }
+
+   if (NULL == (values = malloc(count * sizeof(long))) ||
+   DSTR_SUCCESS != dstralloc(&str)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* integers of every length, about half of them negative */
+   for (i = 0; i < count; i++) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      values[i] = (long)(seed >> (seed >> 58));
+   }
+
+   printf("int: %lu integers, appended 16 at a time\n\n", count);
+
+   start = now();
+   for (i = 0; i < count; i++) {
+      if (0 == i % 16) {
+         dstrtrunc(str, 0);
+      }
+      snprintf(buf, sizeof(buf), "%ld", values[i]);
+      dstrcatcs(str, buf);
+   }
+   report("snprintf + dstrcatcs", now() - start, count, "ints");
+
+   start = now();
+   for (i = 0; i < count; i++) {
+      if (0 == i % 16) {
+         dstrtrunc(str, 0);
+      }
+      dstrcatint(str, values[i]);
+   }
+   report("dstrcatint", now() - start, count, "ints");
+
+   start = now();
+   for (i = 0; i < count; i++) {
+      dstrsprintf(str, "%ld", values[i]);
+   }
+   report("dstrsprintf %ld", now() - start, count, "ints");
+
+   start = now();
+   for (i = 0; i < count; i++) {
+      dstrsprintf(str, "%lx", values[i]);
+   }
+   report("dstrsprintf %lx", now() - start, count, "ints");
+
+   dstrfree(&str);
+   free(values);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * json: dstrjson_t vs. escaping by hand and appending with dstrcatcs()   *
+\**************************************************************************/
+
+#define JSON_RECORDS 500000
+
+/* the free-text parts of a log record, which make up most of its size */
+#define JSON_MESSAGE "upstream request failed after 3 retries: " \
+   "connect() to 10.0.0.17:8080 timed out while reading the response " \
+   "header from upstream, client: 192.168.100.200, server: api.example.com, " \
+   "request: \"GET /api/v1/widgets/search?q=blue%20widgets&page=2 " \
+   "HTTP/1.1\", upstream: \"http://10.0.0.17:8080/api/v1/widgets/search\", " \
+   "host: \"api.example.com\"\n\tat WidgetService.search(WidgetService" \
+   ".java:212)\n\tat WidgetController.get(WidgetController.java:87)\n" \
+   "\tat RequestDispatcher.dispatch(RequestDispatcher.java:1024)\n\tat " \
+   "Worker.run(Worker.java:311)\n\tat java.lang.Thread.run(Thread.java:" \
+   "829)\ncaused by: java.net.SocketTimeoutException: Read timed out " \
+   "(after 30000 ms) on C:\\services\\widgets\\pool-7"
+
+#define JSON_AGENT "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 " \
+   "(KHTML, like Gecko) Chrome/118.0.5993.88 Safari/537.36 " \
+   "WidgetClient/4.2.1 (build 20261018; +https://example.com/bot)"
+
+/* the usual way: escape into a buffer one character at a time, then append
+   each piece with dstrcatcs() */
+static void handescape(dstring_t dest, const char *src) {
+
+   char  buf[4096], *p = buf;
+
+   *p++ = '"';
+   for (; *src; src++) {
+      switch (*src) {
+         case '"':  *p++ = '\\'; *p++ = '"'; break;
+         case '\\': *p++ = '\\'; *p++ = '\\'; break;
+         case '\n': *p++ = '\\'; *p++ = 'n'; break;
+         case '\r': *p++ = '\\'; *p++ = 'r'; break;
+         case '\t': *p++ = '\\'; *p++ = 't'; break;
+         default:
+            if ((unsigned char)*src < 0x20) {
+               p += sprintf(p, "\\u%04x", (unsigned char)*src);
+            } else {
+               *p++ = *src;
+            }
+      }
+   }
+   *p++ = '"';
+   *p = '\0';
+
+   dstrcatcs(dest, buf);
+}
+
+static void handrecord(dstring_t str, unsigned long i) {
+
+   char buf[64];
+
+   dstrcatcs(str, "{\"ts\":");
+   handescape(str, "2026-10-18T12:34:56.789Z");
+   dstrcatcs(str, ",\"level\":");
+   handescape(str, "ERROR");
+   dstrcatcs(str, ",\"logger\":");
+   handescape(str, "com.example.widgets.UpstreamClient");
+   dstrcatcs(str, ",\"msg\":");
+   handescape(str, JSON_MESSAGE);
+   dstrcatcs(str, ",\"request\":{\"method\":");
+   handescape(str, "GET");
+   dstrcatcs(str, ",\"path\":");
+   handescape(str, "/api/v1/widgets/search");
+   sprintf(buf, ",\"status\":%d,\"bytes\":%lu,\"duration_ms\":%.17g}",
+      502, i * 37, (double)(i % 30000) / 7.0);
+   dstrcatcs(str, buf);
+   dstrcatcs(str, ",\"user_agent\":");
+   handescape(str, JSON_AGENT);
+   dstrcatcs(str, ",\"tags\":[");
+   handescape(str, "prod");
+   dstrcatcs(str, ",");
+   handescape(str, "us-west-2");
+   dstrcatcs(str, ",");
+   handescape(str, "widgets");
+   sprintf(buf, "],\"retry\":%d,\"sampled\":%s}\n", 3,
+      i % 2 ? "true" : "false");
+   dstrcatcs(str, buf);
+}
+
+static void builderrecord(dstrjson_t json, unsigned long i) {
+
+   dstrjsonobject(json, NULL);
+   dstrjsonstring(json, "ts", "2026-10-18T12:34:56.789Z");
+   dstrjsonstring(json, "level", "ERROR");
+   dstrjsonstring(json, "logger", "com.example.widgets.UpstreamClient");
+   dstrjsonstring(json, "msg", JSON_MESSAGE);
+   dstrjsonobject(json, "request");
+   dstrjsonstring(json, "method", "GET");
+   dstrjsonstring(json, "path", "/api/v1/widgets/search");
+   dstrjsonint(json, "status", 502);
+   dstrjsonuint(json, "bytes", i * 37);
+   dstrjsondouble(json, "duration_ms", (double)(i % 30000) / 7.0);
+   dstrjsonend(json);
+   dstrjsonstring(json, "user_agent", JSON_AGENT);
+   dstrjsonarray(json, "tags");
+   dstrjsonstring(json, NULL, "prod");
+   dstrjsonstring(json, NULL, "us-west-2");
+   dstrjsonstring(json, NULL, "widgets");
+   dstrjsonend(json);
+   dstrjsonint(json, "retry", 3);
+   dstrjsonbool(json, "sampled", i % 2);
+   dstrjsonend(json);
+}
+
+static int benchjson(int argc, char *argv[]) {
+
+   unsigned long records = JSON_RECORDS, i;
+   double        start, bytes;
+   dstring_t     str = NULL;
+   dstrjson_t    json = NULL;
+
+   if (argc > 0) {
+      records = strtoul(argv[0], NULL, 10);
+   }
+
+   if (DSTR_SUCCESS != dstralloc(&str) ||
+   DSTR_SUCCESS != dstrjsonopen(&json, str)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   builderrecord(json, 1);
+   printf("json: %lu records like:\n   %s\n", records, dstrview(str));
+
+   /* each record is written out (or not) and the string is emptied */
+   bytes = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrtrunc(str, 0);
+      handrecord(str, i);
+      bytes += dstrlen(str);
+   }
+   report("escape by hand + dstrcatcs", now() - start, records, "records");
+   report("", now() - start, bytes, "bytes");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrtrunc(str, 0);
+      dstrjsonsync(json);
+      builderrecord(json, i);
+      bytes += dstrlen(str);
+   }
+   report("dstrjson_t", now() - start, records, "records");
+   report("", now() - start, bytes, "bytes");
+
+   /* just the escaping, on the long message */
+   printf("\njson: escaping a %lu byte message\n\n",
+      (unsigned long)strlen(JSON_MESSAGE));
+
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrtrunc(str, 0);
+      handescape(str, JSON_MESSAGE);
+   }
+   report("escape by hand + dstrcatcs", now() - start,
+      (double)records * strlen(JSON_MESSAGE), "bytes");
+
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrtrunc(str, 0);
+      dstrcatjson(str, JSON_MESSAGE);
+   }
+   report("dstrcatjson", now() - start,
+      (double)records * strlen(JSON_MESSAGE), "bytes");
+
+   dstrjsonclose(&json);
+   dstrfree(&str);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * numbers: dstrtoi64()/dstrtod() vs. strtoll()/strtod() on CSV columns   *
+\**************************************************************************/
+
+#define NUMBERS_ROWS 1000000
+
+static int benchnumbers(int argc, char *argv[]) {
+
+   unsigned long rows = NUMBERS_ROWS, i, seed = 12345;
+   double        start, d, dsum;
+   int64_t       n, isum;
+   size_t        index, len, consumed;
+   const char   *p;
+   char         *end, *text;
+   dstring_t     csv = NULL;
+   int           col;
+
+   if (argc > 0) {
+      rows = strtoul(argv[0], NULL, 10);
+   }
+
+   /* every row is less than 100 characters */
+   if (NULL == (text = malloc(rows * 100 + 1)) ||
+   DSTR_SUCCESS != dstralloc(&csv)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* id, two integer columns and three columns of doubles, the way they
+      usually come out of a database export */
+   for (len = 0, i = 0; i < rows; i++) {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      len += sprintf(text + len, "%lu,%ld,%lu,%.2f,%.6g,%.17g\n",
+         1000000 + i, (long)(seed >> 44) - 500000, (seed >> 20) % 1000,
+         (double)((seed >> 30) % 10000000) / 100.0,
+         (double)(seed >> 11) / 9007199254740992.0,
+         (double)(seed >> 11) / 9007199254740992.0 * 1e6);
+   }
+
+   text[len] = '\0';
+   cstrtodstr(csv, text);
+   free(text);
+   printf("numbers: %lu rows (%lu bytes) like:\n   %.*s\n", rows,
+      (unsigned long)len, (int)(strchr(dstrview(csv), '\n') -
+      dstrview(csv)), dstrview(csv));
+
+   /* strtoll() and strtod() straight out of the buffer */
+   isum = 0;
+   dsum = 0;
+   p = dstrview(csv);
+   start = now();
+   while ('\0' != *p) {
+      for (col = 0; col < 6; col++) {
+         if (col < 3) {
+            isum += strtoll(p, &end, 10);
+         } else {
+            dsum += strtod(p, &end);
+         }
+         p = end + 1;
+      }
+   }
+   report("strtoll + strtod", now() - start, rows * 6.0, "fields");
+   report("", now() - start, len, "bytes");
+   printf("   (sums %lld %.17g)\n", (long long)isum, dsum);
+
+   isum = 0;
+   dsum = 0;
+   index = 0;
+   start = now();
+   while (index < len) {
+      for (col = 0; col < 6; col++) {
+         if (col < 3) {
+            consumed = dstrtoi64(csv, index, &n);
+            isum += n;
+         } else {
+            consumed = dstrtod(csv, index, &d);
+            dsum += d;
+         }
+         index += consumed + 1;
+      }
+   }
+   report("dstrtoi64 + dstrtod", now() - start, rows * 6.0, "fields");
+   report("", now() - start, len, "bytes");
+   printf("   (sums %lld %.17g)\n", (long long)isum, dsum);
+
+   dstrfree(&csv);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * split: dstrsplit() vs. strchr() and a copy of every field              *
+\**************************************************************************/
+
+#define SPLIT_RECORDS 1000000
+#define SPLIT_FIELDS  50
+
+static int benchsplit(int argc, char *argv[]) {
+
+   unsigned long records = SPLIT_RECORDS, i, total;
+   double        start;
+   dstring_t     record = NULL, field = NULL;
+   dstrfield_t   fields[SPLIT_FIELDS], f;
+   const char   *p, *q;
+   dstrsplit_t   split;
+   int           j;
+
+   if (argc > 0) {
+      records = strtoul(argv[0], NULL, 10);
+   }
+
+   if (DSTR_SUCCESS != dstralloc(&record) ||
+   DSTR_SUCCESS != dstralloc(&field)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* a record of 50 fields of different lengths, some of them empty */
+   for (j = 0; j < SPLIT_FIELDS; j++) {
+      if (j > 0) {
+         dstrcatcs(record, "|");
+      }
+      if (j % 7 != 3) {
+         dstrcatprintf(record, "%.*s", 1 + (j * 13) % 23,
+            "field-value-with-some-length");
+      }
+   }
+
+   printf("split: %lu records of %d fields (%lu bytes each)\n\n", records,
+      SPLIT_FIELDS, (unsigned long)dstrlen(record));
+
+   /* the usual way: find each delimiter, then copy the field out */
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      for (p = dstrview(record); ; p = q + 1) {
+         q = strchr(p, '|');
+         dstrtrunc(field, 0);
+         dstrncatcs(field, p, NULL == q ? strlen(p) : (size_t)(q - p));
+         total += dstrlen(field);
+         if (NULL == q) {
+            break;
+         }
+      }
+   }
+   report("strchr + dstrncatcs", now() - start, records, "records");
+
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      for (p = dstrview(record); ; p = q + 1) {
+         q = strchr(p, '|');
+         total += NULL == q ? strlen(p) : (size_t)(q - p);
+         if (NULL == q) {
+            break;
+         }
+      }
+   }
+   report("strchr alone", now() - start, records, "records");
+
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrsplit(record, "|", fields, SPLIT_FIELDS);
+      total += fields[SPLIT_FIELDS - 1].length;
+   }
+   report("dstrsplit", now() - start, records, "records");
+
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrsplitbegin(&split, "|");
+      while (dstrsplitnext(record, &split, &f)) {
+         total += f.length;
+      }
+   }
+   report("dstrsplitnext", now() - start, records, "records");
+
+   /* a set of delimiters, which strchr() can't do */
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrsplit(record, "|,;", fields, SPLIT_FIELDS);
+      total += fields[SPLIT_FIELDS - 1].length;
+   }
+   report("dstrsplit (3 delimiters)", now() - start, records, "records");
+
+   /* too many to compare one at a time, so they're looked up in a table */
+   total = 0;
+   start = now();
+   for (i = 0; i < records; i++) {
+      dstrsplitbegin(&split, "|,;:\t ");
+      while (dstrsplitnext(record, &split, &f)) {
+         total += f.length;
+      }
+   }
+   report("dstrsplitnext (6 delimiters)", now() - start, records, "records");
+
+   dstrfree(&field);
+   dstrfree(&record);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * csv: dstrrreadcsv() vs. reading lines and splitting them by hand       *
+\**************************************************************************/
+
+#define CSV_MEGABYTES 256
+#define CSV_FIELDS    64
+
+/* a byte at a time, the way a CSV parser is usually written */
+static size_t csvbytes(FILE *fp, size_t *fieldcount) {
+
+   static char buf[65536];
+   size_t      n, i, records = 0, fields = 0, len = 0, size = 0;
+   char       *rec = NULL;
+   int         quoted = 0;
+
+   while (0 < (n = fread(buf, 1, sizeof(buf), fp))) {
+      for (i = 0; i < n; i++) {
+         if (len + 1 >= size) {
+            size = size ? size * 2 : 256;
+            rec = realloc(rec, size);
+         }
+         if ('"' == buf[i]) {
+            if (quoted && i + 1 < n && '"' == buf[i + 1]) {
+               rec[len++] = '"';
+               i++;
+            } else {
+               quoted = !quoted;
+            }
+         } else if (!quoted && ',' == buf[i]) {
+            rec[len++] = '\0';
+            fields++;
+         } else if (!quoted && '\n' == buf[i]) {
+            rec[len] = '\0';
+            len = 0;
+            fields++;
+            records++;
+         } else {
+            rec[len++] = buf[i];
+         }
+      }
+   }
+
+   free(rec);
+   *fieldcount = fields;
+   return records;
+}
+
+static int benchcsv(int argc, char *argv[]) {
+
+   char          path[] = "/tmp/dstrbench.XXXXXX";
+   const char   *file = path;
+   unsigned long megabytes = CSV_MEGABYTES, i;
+   size_t        records, fields, n, bytes;
+   double        start;
+   dstring_t     record = NULL;
+   dstrreader_t  r;
+   dstrfield_t   f[CSV_FIELDS];
+   struct stat   st;
+   FILE         *fp;
+   int           fd;
+
+   if (argc > 0 && 0 == stat(argv[0], &st)) {
+      file = argv[0];
+   }
+
+   else {
+
+      if (argc > 0) {
+         megabytes = strtoul(argv[0], NULL, 10);
+      }
+
+      if (-1 == (fd = mkstemp(path)) || NULL == (fp = fdopen(fd, "w"))) {
+         perror("mkstemp");
+         return EXIT_FAILURE;
+      }
+
+      /* orders, with a quoted description that sometimes contains commas,
+         quotes or a line break */
+      fprintf(fp, "id,customer,sku,quantity,price,date,status,note\n");
+      for (i = 0, bytes = 0; bytes < megabytes * 1048576UL; i++) {
+         bytes += fprintf(fp, "%lu,customer%lu,SKU-%05lu,%lu,%lu.%02lu,"
+            "2026-%02lu-%02lu,%s,%s\n", i, i % 9973, i % 100000, 1 + i % 9,
+            i % 500, i % 100, 1 + i % 12, 1 + i % 28,
+            i % 3 ? "shipped" : "pending",
+            0 == i % 10 ? "\"gift wrap, \"\"fragile\"\"\"" :
+            0 == i % 25 ? "\"leave at the door\nring twice\"" :
+            "standard delivery");
+      }
+      fclose(fp);
+   }
+
+   stat(file, &st);
+   printf("csv: %s (%.1f MB)\n\n", file, st.st_size / 1048576.0);
+
+   if (DSTR_SUCCESS != dstralloc(&record)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* what we used to do; this gets quoted fields wrong */
+   fp = fopen(file, "r");
+   dstrreaderopen(&r, fp, DSTR_COMPRESS_AUTO);
+   records = fields = 0;
+   start = now();
+   while (0 < dstrrreadl(record, r)) {
+      fields += dstrsplit(record, ",", f, CSV_FIELDS);
+      records++;
+   }
+   report("dstrrreadl + dstrsplit", now() - start, st.st_size / 1048576.0,
+      "MB");
+   printf("   (%lu lines, %lu fields; quotes ignored)\n",
+      (unsigned long)records, (unsigned long)fields);
+   dstrreaderclose(&r);
+   fclose(fp);
+
+   fp = fopen(file, "r");
+   start = now();
+   records = csvbytes(fp, &fields);
+   report("a byte at a time", now() - start, st.st_size / 1048576.0, "MB");
+   fclose(fp);
+
+   fp = fopen(file, "r");
+   dstrreaderopen(&r, fp, DSTR_COMPRESS_AUTO);
+   records = fields = 0;
+   start = now();
+   while (0 < (n = dstrrreadcsv(record, r, ',', f, CSV_FIELDS))) {
+      fields += n;
+      records++;
+   }
+   report("dstrrreadcsv", now() - start, st.st_size / 1048576.0, "MB");
+   printf("   (%lu records, %lu fields)\n", (unsigned long)records,
+      (unsigned long)fields);
+   dstrreaderclose(&r);
+   fclose(fp);
+
+   if (file == path) {
+      unlink(path);
+   }
+
+   dstrfree(&record);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * base64: dstrcatbase64() and dstrcathex() vs. encoding into a buffer    *
+\**************************************************************************/
+
+#define BASE64_MEGABYTES 1024
+#define BASE64_CHUNK     1048576
+
+static int benchbase64(int argc, char *argv[]) {
+
+   static const char chars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+   unsigned long  megabytes = BASE64_MEGABYTES, i;
+   unsigned char *data;
+   char          *buf;
+   size_t         j, k;
+   unsigned long  x;
+   double         start;
+   dstring_t      encoded = NULL, hex = NULL, decoded = NULL;
+
+   if (argc > 0) {
+      megabytes = strtoul(argv[0], NULL, 10);
+   }
+
+   data = malloc(BASE64_CHUNK);
+   buf = malloc(BASE64_CHUNK * 2 + 1);
+
+   if (NULL == data || NULL == buf || DSTR_SUCCESS != dstralloc(&encoded) ||
+   DSTR_SUCCESS != dstralloc(&hex) || DSTR_SUCCESS != dstralloc(&decoded)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   for (j = 0, x = 1; j < BASE64_CHUNK; j++) {
+      x = x * 1103515245 + 12345;
+      data[j] = x >> 16;
+   }
+
+   printf("base64: %lu MB, 1 MB at a time\n\n", megabytes);
+
+   /* a byte at a time into a buffer, then into a dstring_t */
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      for (j = 0, k = 0; j + 3 <= BASE64_CHUNK; j += 3) {
+         x = (unsigned long)data[j] << 16 | data[j + 1] << 8 | data[j + 2];
+         buf[k++] = chars[x >> 18];
+         buf[k++] = chars[x >> 12 & 63];
+         buf[k++] = chars[x >> 6 & 63];
+         buf[k++] = chars[x & 63];
+      }
+      buf[k] = '\0';
+      cstrtodstr(encoded, buf);
+   }
+   report("encode by hand + cstrtodstr", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(encoded, 0);
+      dstrcatbase64(encoded, data, BASE64_CHUNK, 0);
+   }
+   report("dstrcatbase64", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(decoded, 0);
+      dstrcatunbase64(decoded, dstrview(encoded), dstrlen(encoded), 0);
+   }
+   report("dstrcatunbase64", now() - start, megabytes, "MB");
+
+   if (0 != memcmp(dstrview(decoded), data, BASE64_CHUNK)) {
+      fprintf(stderr, "base64 didn't decode to the original data\n");
+      return EXIT_FAILURE;
+   }
+
+   /* this is slow enough that 1/16 of the data will do */
+   start = now();
+   for (i = 0; i < megabytes / 16 + 1; i++) {
+      for (j = 0; j < BASE64_CHUNK; j++) {
+         sprintf(buf + j * 2, "%02x", data[j]);
+      }
+      cstrtodstr(hex, buf);
+   }
+   report("sprintf %02x + cstrtodstr", now() - start, megabytes / 16 + 1,
+      "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(hex, 0);
+      dstrcathex(hex, data, BASE64_CHUNK, 0);
+   }
+   report("dstrcathex", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(decoded, 0);
+      dstrcatunhex(decoded, dstrview(hex), dstrlen(hex));
+   }
+   report("dstrcatunhex", now() - start, megabytes, "MB");
+
+   if (0 != memcmp(dstrview(decoded), data, BASE64_CHUNK)) {
+      fprintf(stderr, "hex didn't decode to the original data\n");
+      return EXIT_FAILURE;
+   }
+
+   dstrfree(&decoded);
+   dstrfree(&hex);
+   dstrfree(&encoded);
+   free(buf);
+   free(data);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * url: dstrurldecode() and dstrquerynext() vs. dstrinsertc()            *
+\**************************************************************************/
+
+#define URL_COUNT  200000
+#define URL_PASSES 10
+
+/* decodes src into dest one character at a time, the way it used to be */
+static void decodebyhand(dstring_t dest, const char *src, size_t n) {
+
+   size_t i;
+   char   hex[3] = {0, 0, 0};
+
+   dstrtrunc(dest, 0);
+   for (i = 0; i < n; i++) {
+      if ('%' == src[i] && i + 2 < n) {
+         hex[0] = src[i + 1];
+         hex[1] = src[i + 2];
+         dstrinsertc(dest, dstrlen(dest), (char)strtol(hex, NULL, 16));
+         i += 2;
+      } else {
+         dstrinsertc(dest, dstrlen(dest), '+' == src[i] ? ' ' : src[i]);
+      }
+   }
+}
+
+static int benchurl(int argc, char *argv[]) {
+
+   static const char *words[] = {"shoes", "caf\xc3\xa9", "new york",
+      "50% off", "a&b", "rock'n'roll", "\xe6\x9d\xb1\xe4\xba\xac", "c++",
+      "size=10", "blue"};
+
+   char         **urls = NULL;
+   size_t         n = 0, i, j, index, bytes = 0;
+   double         start;
+   dstring_t      url = NULL, key = NULL, value = NULL;
+   dstrfield_t    k, v;
+   const char    *p, *amp, *eq, *end;
+   FILE          *fp;
+
+   if (DSTR_SUCCESS != dstralloc(&url) || DSTR_SUCCESS != dstralloc(&key) ||
+   DSTR_SUCCESS != dstralloc(&value)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* one URL per line */
+   if (argc > 0) {
+      if (NULL == (fp = fopen(argv[0], "r"))) {
+         perror(argv[0]);
+         return EXIT_FAILURE;
+      }
+      while (0 < dstrfreadl(url, fp)) {
+         dstrtrim(url);
+         urls = realloc(urls, (n + 1) * sizeof(char *));
+         urls[n++] = strdup(dstrview(url));
+      }
+      fclose(fp);
+   }
+
+   /* search and tracking URLs, with escaped paths and UTF-8 */
+   else {
+      urls = malloc(URL_COUNT * sizeof(char *));
+      for (n = 0; n < URL_COUNT; n++) {
+         dstrsprintf(url, "https://shop.example.com/search/");
+         dstrcaturlencode(url, words[n % 10], 0);
+         dstrcatcs(url, "?q=");
+         dstrcaturlencode(url, words[(n / 10) % 10], DSTR_URL_FORM);
+         dstrcatprintf(url, "&page=%lu&sort=price_asc&utm_source=newsletter"
+            "&utm_medium=email&utm_campaign=spring-%lu&ref=", n % 20 + 1,
+            n % 7);
+         dstrcaturlencode(url, "https://www.example.org/landing?id=42", 0);
+         urls[n] = strdup(dstrview(url));
+      }
+   }
+
+   for (i = 0; i < n; i++) {
+      bytes += strlen(urls[i]);
+   }
+
+   printf("url: %lu URLs (%lu bytes) like:\n   %s\n", (unsigned long)n,
+      (unsigned long)bytes, urls[0]);
+   printf("   (one pass the old way, which is slow, and %d passes with the "
+      "library)\n\n", URL_PASSES);
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      decodebyhand(value, urls[i], strlen(urls[i]));
+   }
+   report("decode with dstrinsertc", now() - start, n, "URLs");
+
+   start = now();
+   for (j = 0; j < URL_PASSES; j++) {
+      for (i = 0; i < n; i++) {
+         cstrtodstr(url, urls[i]);
+         dstrurldecode(url, DSTR_URL_FORM);
+      }
+   }
+   report("cstrtodstr + dstrurldecode", now() - start,
+      (double)n * URL_PASSES, "URLs");
+
+   /* every parameter of the query string, decoded */
+   start = now();
+   for (i = 0; i < n; i++) {
+      if (NULL == (p = strchr(urls[i], '?'))) {
+         continue;
+      }
+      for (p++; '\0' != *p; p = '&' == *end ? end + 1 : end) {
+         if (NULL == (amp = strchr(p, '&'))) {
+            amp = p + strlen(p);
+         }
+         end = amp;
+         if (NULL == (eq = memchr(p, '=', amp - p))) {
+            eq = amp;
+         }
+         decodebyhand(key, p, eq - p);
+         decodebyhand(value, eq < amp ? eq + 1 : amp,
+            eq < amp ? amp - eq - 1 : 0);
+      }
+   }
+   report("query by hand + dstrinsertc", now() - start, n, "URLs");
+
+   start = now();
+   for (j = 0; j < URL_PASSES; j++) {
+      for (i = 0; i < n; i++) {
+         if (NULL == (p = strchr(urls[i], '?'))) {
+            continue;
+         }
+         cstrtodstr(url, urls[i]);
+         index = p - urls[i] + 1;
+         while (dstrquerynext(url, &index, &k, &v)) {
+            dstrurldecodefield(url, &k, DSTR_URL_FORM);
+            dstrurldecodefield(url, &v, DSTR_URL_FORM);
+         }
+      }
+   }
+   report("dstrquerynext + decodefield", now() - start,
+      (double)n * URL_PASSES, "URLs");
+
+   /* and back again */
+   start = now();
+   for (i = 0; i < n; i++) {
+      dstrtrunc(value, 0);
+      for (p = urls[i]; '\0' != *p; p++) {
+         if (isalnum((unsigned char)*p) || NULL != strchr("-._~", *p)) {
+            dstrinsertc(value, dstrlen(value), *p);
+         } else {
+            dstrcatprintf(value, "%%%02X", (unsigned char)*p);
+         }
+      }
+   }
+   report("encode with dstrinsertc", now() - start, n, "URLs");
+
+   start = now();
+   for (j = 0; j < URL_PASSES; j++) {
+      for (i = 0; i < n; i++) {
+         dstrtrunc(value, 0);
+         dstrcaturlencode(value, urls[i], 0);
+      }
+   }
+   report("dstrcaturlencode", now() - start, (double)n * URL_PASSES, "URLs");
+
+   for (i = 0; i < n; i++) {
+      free(urls[i]);
+   }
+   free(urls);
+   dstrfree(&value);
+   dstrfree(&key);
+   dstrfree(&url);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * utf8: dstrisutf8() vs. checking one byte at a time                     *
+\**************************************************************************/
+
+#define UTF8_MEGABYTES 1024
+#define UTF8_CHUNK     1048576
+#define UTF8_REPEATS   10000000
+
+/* returns 1 if s is UTF-8, checking and decoding one byte at a time */
+static int utf8byhand(const unsigned char *s, size_t len, size_t *count) {
+
+   size_t        i = 0, n = 0, k, need;
+   unsigned long cp, min;
+
+   while (i < len) {
+
+      if (s[i] < 0x80) {
+         i++, n++;
+         continue;
+      } else if (0xc0 == (s[i] & 0xe0)) {
+         need = 1, cp = s[i] & 0x1f, min = 0x80;
+      } else if (0xe0 == (s[i] & 0xf0)) {
+         need = 2, cp = s[i] & 0x0f, min = 0x800;
+      } else if (0xf0 == (s[i] & 0xf8)) {
+         need = 3, cp = s[i] & 0x07, min = 0x10000;
+      } else {
+         return 0;
+      }
+
+      if (i + need >= len) {
+         return 0;
+      }
+
+      for (k = 1; k <= need; k++) {
+         if (0x80 != (s[i + k] & 0xc0)) {
+            return 0;
+         }
+         cp = cp << 6 | (s[i + k] & 0x3f);
+      }
+
+      if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+         return 0;
+      }
+
+      i += need + 1, n++;
+   }
+
+   *count = n;
+   return 1;
+}
+
+/* roughly what a multilingual web page looks like: mostly ASCII
+   markup, with runs of 2, 3 and 4 byte characters */
+static const char *mixedlines[] = {
+   "<p class=\"intro\">The quick brown fox jumps over the lazy dog.</p>\n",
+   "<p lang=\"de\">Falsches \xc3\x9c" "ben von Xylophonmusik qu\xc3\xa4lt "
+      "jeden gr\xc3\xb6\xc3\x9f" "eren Zwerg.</p>\n",
+   "<p lang=\"el\">\xce\x93\xce\xb1\xce\xb6\xce\xad\xce\xb5\xcf\x82 "
+      "\xce\xba\xce\xb1\xe1\xbd\xb6 \xce\xbc\xcf\x85\xcf\x81\xcf\x84\xce"
+      "\xb9\xe1\xbd\xb2\xcf\x82</p>\n",
+   "<p lang=\"ja\">\xe3\x81\x84\xe3\x82\x8d\xe3\x81\xaf\xe3\x81\xab\xe3"
+      "\x81\xbb\xe3\x81\xb8\xe3\x81\xa8\xe3\x81\xa1\xe3\x82\x8a\xe3\x81"
+      "\xac\xe3\x82\x8b\xe3\x82\x92</p>\n",
+   "<p lang=\"zh\">\xe6\x88\x91\xe8\x83\xbd\xe5\x90\x9e\xe4\xb8\x8b\xe7"
+      "\x8e\xbb\xe7\x92\x83\xe8\x80\x8c\xe4\xb8\x8d\xe4\xbc\xa4\xe8\xba"
+      "\xab\xe4\xbd\x93\xe3\x80\x82</p>\n",
+   "<p>Reactions: \xf0\x9f\x91\x8d 12 \xf0\x9f\x8e\x89 3 \xf0\x9f\x98"
+      "\x82 7</p>\n"
+};
+
+/* fills text with whole lines of mixedlines[], up to size bytes, and
+   returns the number of lines */
+static size_t mixedtext(dstring_t text, size_t size) {
+
+   size_t line, n = sizeof(mixedlines) / sizeof(mixedlines[0]);
+
+   dstrtrunc(text, 0);
+
+   for (line = 0; dstrlen(text) + strlen(mixedlines[line % n]) <= size;
+   line++) {
+      dstrcatcs(text, mixedlines[line % n]);
+   }
+
+   return line;
+}
+
+static int benchutf8(int argc, char *argv[]) {
+
+   unsigned long megabytes = UTF8_MEGABYTES, i;
+   size_t        len, count = 0, line;
+   double        start;
+   dstring_t     text = NULL;
+
+   if (argc > 0) {
+      megabytes = strtoul(argv[0], NULL, 10);
+   }
+
+   if (DSTR_SUCCESS != dstrnalloc(&text, UTF8_CHUNK + 1)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   line = mixedtext(text, UTF8_CHUNK);
+   len = dstrlen(text);
+   printf("utf8: %lu MB, 1 MB (%lu lines of mixed languages) at a time\n\n",
+      megabytes, (unsigned long)line);
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      if (!utf8byhand((const unsigned char *)dstrview(text), len, &count)) {
+         fprintf(stderr, "the text isn't UTF-8\n");
+         return EXIT_FAILURE;
+      }
+   }
+   report("one byte at a time", now() - start, megabytes, "MB");
+
+   /* dstrtrunc() changes nothing here, but makes dstrisutf8() forget */
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(text, len);
+      if (!dstrisutf8(text)) {
+         fprintf(stderr, "dstrisutf8 says the text isn't UTF-8\n");
+         return EXIT_FAILURE;
+      }
+   }
+   report("dstrtrunc + dstrisutf8", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(text, len);
+   }
+   report("dstrtrunc alone", now() - start, megabytes, "MB");
+
+   if (dstrutf8len(text) != count) {
+      fprintf(stderr, "dstrutf8len counted %lu code points, not %lu\n",
+         (unsigned long)dstrutf8len(text), (unsigned long)count);
+      return EXIT_FAILURE;
+   }
+
+   start = now();
+   for (i = 0; i < UTF8_REPEATS; i++) {
+      count += dstrisutf8(text);
+   }
+   report("dstrisutf8, unchanged", now() - start, UTF8_REPEATS, "calls");
+
+   dstrfree(&text);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * case: dstrutf8toupper() vs. towupper() and toupper()                   *
+\**************************************************************************/
+
+#define CASE_MEGABYTES 256
+#define CASE_CHUNK     1048576
+
+/* converts src to uppercase (or lowercase) the way the C library would,
+   one wide character at a time, and copies the result into dest */
+static void casebyhand(dstring_t dest, char *buf, const char *src,
+int upper) {
+
+   mbstate_t in, out;
+   wchar_t   wc;
+   size_t    n, k = 0;
+
+   memset(&in, 0, sizeof(in));
+   memset(&out, 0, sizeof(out));
+
+   while ((n = mbrtowc(&wc, src, MB_CUR_MAX, &in)) > 0 && n < (size_t)-2) {
+      src += n;
+      k += wcrtomb(buf + k, upper ? (wchar_t)towupper(wc) :
+         (wchar_t)towlower(wc), &out);
+   }
+
+   buf[k] = '\0';
+   cstrtodstr(dest, buf);
+}
+
+static int benchcase(int argc, char *argv[]) {
+
+   unsigned long megabytes = CASE_MEGABYTES, i;
+   size_t        line;
+   char         *buf;
+   double        start;
+   dstring_t     text = NULL, ascii = NULL;
+
+   if (argc > 0) {
+      megabytes = strtoul(argv[0], NULL, 10);
+   }
+
+   if (NULL == setlocale(LC_CTYPE, "C.UTF-8")) {
+      fprintf(stderr, "the C.UTF-8 locale isn't available\n");
+      return EXIT_FAILURE;
+   }
+
+   buf = malloc(CASE_CHUNK * 2);
+
+   if (NULL == buf || DSTR_SUCCESS != dstrnalloc(&text, CASE_CHUNK + 1) ||
+   DSTR_SUCCESS != dstrnalloc(&ascii, CASE_CHUNK + 1)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   line = mixedtext(text, CASE_CHUNK);
+   while (dstrlen(ascii) + strlen(mixedlines[0]) <= CASE_CHUNK) {
+      dstrcatcs(ascii, mixedlines[0]);
+   }
+
+   printf("case: %lu MB, 1 MB (%lu lines of mixed languages) at a time, "
+      "alternating\nbetween upper and lower case\n\n", megabytes,
+      (unsigned long)line);
+
+   /* this is slow enough that 1/16 of the data will do */
+   start = now();
+   for (i = 0; i < megabytes / 16 + 1; i++) {
+      casebyhand(text, buf, dstrview(text), !(i & 1));
+   }
+   report("mbrtowc + towupper + wcrtomb", now() - start, megabytes / 16 + 1,
+      "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      if (i & 1) {
+         dstrutf8tolower(text);
+      } else {
+         dstrutf8toupper(text);
+      }
+   }
+   report("dstrutf8toupper/tolower", now() - start, megabytes, "MB");
+
+   if (DSTR_SUCCESS != dstrerrno) {
+      fprintf(stderr, "%s\n", dstrerrormsg(dstrerrno));
+      return EXIT_FAILURE;
+   }
+
+   printf("\nthe same, with only ASCII:\n\n");
+
+   /* dstrtoupper() is only right for ASCII, so this is all it gets */
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      if (i & 1) {
+         dstrtolower(ascii, 0);
+      } else {
+         dstrtoupper(ascii, 0);
+      }
+   }
+   report("dstrtoupper/tolower", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      if (i & 1) {
+         dstrutf8tolower(ascii);
+      } else {
+         dstrutf8toupper(ascii);
+      }
+   }
+   report("dstrutf8toupper/tolower", now() - start, megabytes, "MB");
+
+   dstrfree(&ascii);
+   dstrfree(&text);
+   free(buf);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * transcode: dstrcatutf16() and friends vs. iconv()                      *
+\**************************************************************************/
+
+#define TRANSCODE_MEGABYTES 256
+#define TRANSCODE_CHUNK     1048576
+
+/* converts len bytes of src from one encoding to another with iconv() and
+   returns the number of bytes written to out */
+static size_t iconvbyhand(iconv_t cd, char *out, size_t size,
+const char *src, size_t len) {
+
+   char  *in = (char *)src, *start = out;
+
+   iconv(cd, NULL, NULL, NULL, NULL);
+   iconv(cd, &in, &len, &out, &size);
+   return out - start;
+}
+
+static int benchtranscode(int argc, char *argv[]) {
+
+   unsigned long megabytes = TRANSCODE_MEGABYTES, i;
+   size_t        line, len, utf16len, latin1len, n;
+   char         *buf, *utf16, *latin1;
+   double        start;
+   iconv_t       fromutf16, toutf16, fromlatin1, tolatin1;
+   dstring_t     text = NULL, western = NULL, dest = NULL;
+
+   if (argc > 0) {
+      megabytes = strtoul(argv[0], NULL, 10);
+   }
+
+   fromutf16 = iconv_open("UTF-8", "UTF-16LE");
+   toutf16 = iconv_open("UTF-16LE", "UTF-8");
+   fromlatin1 = iconv_open("UTF-8", "ISO-8859-1");
+   tolatin1 = iconv_open("ISO-8859-1", "UTF-8");
+
+   if ((iconv_t)-1 == fromutf16 || (iconv_t)-1 == toutf16 ||
+   (iconv_t)-1 == fromlatin1 || (iconv_t)-1 == tolatin1) {
+      fprintf(stderr, "iconv doesn't support UTF-16LE or ISO-8859-1\n");
+      return EXIT_FAILURE;
+   }
+
+   buf = malloc(TRANSCODE_CHUNK * 4 + 1);
+   utf16 = malloc(TRANSCODE_CHUNK * 4);
+   latin1 = malloc(TRANSCODE_CHUNK);
+
+   if (NULL == buf || NULL == utf16 || NULL == latin1 ||
+   DSTR_SUCCESS != dstrnalloc(&text, TRANSCODE_CHUNK + 1) ||
+   DSTR_SUCCESS != dstrnalloc(&western, TRANSCODE_CHUNK + 1) ||
+   DSTR_SUCCESS != dstralloc(&dest)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   line = mixedtext(text, TRANSCODE_CHUNK);
+   len = dstrlen(text);
+   utf16len = dstrtoutf16(utf16, text, TRANSCODE_CHUNK * 4, 0);
+
+   /* the lines that Latin-1 can hold: English and German */
+   while (dstrlen(western) + strlen(mixedlines[0]) + strlen(mixedlines[1]) <=
+   TRANSCODE_CHUNK) {
+      dstrcatcs(western, mixedlines[0]);
+      dstrcatcs(western, mixedlines[1]);
+   }
+   latin1len = dstrtolatin1(latin1, western, TRANSCODE_CHUNK, 0);
+
+   printf("transcode: %lu MB of UTF-8, 1 MB (%lu lines of mixed languages) "
+      "at a time\n\n", megabytes, (unsigned long)line);
+
+   /* iconv() can't write into a dstring_t, so it writes into a buffer
+      that's then copied, which is what we're trying to avoid */
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      n = iconvbyhand(fromutf16, buf, TRANSCODE_CHUNK * 4, utf16, utf16len);
+      buf[n] = '\0';
+      cstrtodstr(dest, buf);
+   }
+   report("UTF-16: iconv + cstrtodstr", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(dest, 0);
+      dstrcatutf16(dest, utf16, utf16len, 0);
+   }
+   report("UTF-16: dstrcatutf16", now() - start, megabytes, "MB");
+
+   if (0 != strcmp(dstrview(dest), dstrview(text))) {
+      fprintf(stderr, "dstrcatutf16 and dstrtoutf16 don't agree\n");
+      return EXIT_FAILURE;
+   }
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      iconvbyhand(toutf16, utf16, TRANSCODE_CHUNK * 4, dstrview(text), len);
+   }
+   report("to UTF-16: iconv", now() - start, megabytes, "MB");
+
+   /* dstrtrunc() makes dstrisutf8() forget, so the text is checked again
+      each time, just as a string that had changed would be */
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(text, len);
+      dstrtoutf16(utf16, text, TRANSCODE_CHUNK * 4, 0);
+   }
+   report("to UTF-16: dstrtoutf16", now() - start, megabytes, "MB");
+
+   printf("\nthe same, with %lu bytes of Latin-1 (English and German):\n\n",
+      (unsigned long)latin1len);
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      n = iconvbyhand(fromlatin1, buf, TRANSCODE_CHUNK * 4, latin1,
+         latin1len);
+      buf[n] = '\0';
+      cstrtodstr(dest, buf);
+   }
+   report("Latin-1: iconv + cstrtodstr", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(dest, 0);
+      dstrcatlatin1(dest, latin1, latin1len);
+   }
+   report("Latin-1: dstrcatlatin1", now() - start, megabytes, "MB");
+
+   if (0 != strcmp(dstrview(dest), dstrview(western))) {
+      fprintf(stderr, "dstrcatlatin1 and dstrtolatin1 don't agree\n");
+      return EXIT_FAILURE;
+   }
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      iconvbyhand(tolatin1, latin1, TRANSCODE_CHUNK, dstrview(western),
+         dstrlen(western));
+   }
+   report("to Latin-1: iconv", now() - start, megabytes, "MB");
+
+   start = now();
+   for (i = 0; i < megabytes; i++) {
+      dstrtrunc(western, dstrlen(western));
+      dstrtolatin1(latin1, western, TRANSCODE_CHUNK, 0);
+   }
+   report("to Latin-1: dstrtolatin1", now() - start, megabytes, "MB");
+
+   iconv_close(fromutf16);
+   iconv_close(toutf16);
+   iconv_close(fromlatin1);
+   iconv_close(tolatin1);
+   dstrfree(&dest);
+   dstrfree(&western);
+   dstrfree(&text);
+   free(latin1);
+   free(utf16);
+   free(buf);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * hash: dstrhash() vs. rehashing dstrview() on every lookup              *
+\**************************************************************************/
+
+#define HASH_LOOKUPS 100000000
+#define HASH_KEYS    4096
+#define HASH_SEED    0x2545f4914f6cdd1dULL
+
+/* FNV-1a, the usual hand-rolled string hash */
+static uint64_t fnv1a(const char *s) {
+
+   uint64_t h = 0xcbf29ce484222325ULL;
+
+   for (; *s; s++) {
+      h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+   }
+
+   return h;
+}
+
+static int benchhash(int argc, char *argv[]) {
+
+   unsigned long lookups = HASH_LOOKUPS, i;
+   uint64_t      sum;
+   double        start;
+   dstring_t     keys[HASH_KEYS], big = NULL;
+   size_t        k, length;
+
+   if (argc > 0) {
+      lookups = strtoul(argv[0], NULL, 10);
+   }
+
+   for (k = 0; k < HASH_KEYS; k++) {
+      keys[k] = NULL;
+      if (DSTR_SUCCESS != dstralloc(&keys[k])) {
+         fprintf(stderr, "out of memory\n");
+         return EXIT_FAILURE;
+      }
+      dstrsprintf(keys[k], "/api/v1/users/%lu/sessions?region=eu-west-%lu",
+         (unsigned long)k * 7919, (unsigned long)k % 3);
+   }
+
+   length = dstrlen(keys[0]);
+   printf("hash: %lu lookups of %d keys of about %lu bytes\n\n", lookups,
+      HASH_KEYS, (unsigned long)length);
+
+   sum = 0;
+   start = now();
+   for (i = 0; i < lookups; i++) {
+      sum += fnv1a(dstrview(keys[i % HASH_KEYS]));
+   }
+   report("FNV-1a of dstrview()", now() - start, lookups, "lookups");
+
+   start = now();
+   for (i = 0; i < lookups; i++) {
+      sum += dstrhashcs(dstrview(keys[i % HASH_KEYS]), HASH_SEED);
+   }
+   report("dstrhashcs of dstrview()", now() - start, lookups, "lookups");
+
+   start = now();
+   for (i = 0; i < lookups; i++) {
+      sum += dstrhash(keys[i % HASH_KEYS], HASH_SEED);
+   }
+   report("dstrhash (remembered)", now() - start, lookups, "lookups");
+
+   /* a 1 MB string, hashed from scratch each time */
+   if (DSTR_SUCCESS != dstrnalloc(&big, UTF8_CHUNK + 1)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   mixedtext(big, UTF8_CHUNK);
+   length = dstrlen(big);
+   printf("\nthe same, for a %lu byte string that changes every time:\n\n",
+      (unsigned long)length);
+
+   start = now();
+   for (i = 0; i < 1000; i++) {
+      dstrtrunc(big, length);
+      sum += fnv1a(dstrview(big));
+   }
+   report("FNV-1a", now() - start, 1000.0 * length / 1048576, "MB");
+
+   start = now();
+   for (i = 0; i < 1000; i++) {
+      dstrtrunc(big, length);
+      sum += dstrhash(big, HASH_SEED);
+   }
+   report("dstrhash", now() - start, 1000.0 * length / 1048576, "MB");
+
+   /* so the compiler can't skip any of it */
+   printf("\n(checksum %016llx)\n", (unsigned long long)sum);
+
+   for (k = 0; k < HASH_KEYS; k++) {
+      dstrfree(&keys[k]);
+   }
+   dstrfree(&big);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * map: dstrmap_t vs. a hand-rolled chained hash table                    *
+\**************************************************************************/
+
+#define MAP_KEYLEN 15              /* bytes per key, not counting the '\0' */
+#define MAP_SIZES  {1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 0UL}
+
+/* the usual hand-rolled table: a bucket array of linked lists, each node
+   with its own copy of the key, that doubles once it's as full as it is
+   long */
+typedef struct chainnode {
+   struct chainnode *next;
+   uint64_t          hash;
+   char             *key;
+   void             *value;
+} chainnode;
+
+typedef struct {
+   chainnode   **buckets;
+   size_t        nbuckets;
+   size_t        size;
+} chaintable;
+
+static uint64_t fnv1an(const char *s, size_t n) {
+
+   uint64_t h = 0xcbf29ce484222325ULL;
+
+   while (n--) {
+      h = (h ^ (unsigned char)*s++) * 0x100000001b3ULL;
+   }
+
+   return h;
+}
+
+static int chainset(chaintable *t, const char *key, size_t n, void *value) {
+
+   chainnode **newbuckets, *node, *next;
+   uint64_t    hash = fnv1an(key, n);
+   size_t      i;
+
+   for (node = t->buckets[hash & (t->nbuckets - 1)]; node;
+   node = node->next) {
+      if (node->hash == hash && 0 == memcmp(node->key, key, n) &&
+      '\0' == node->key[n]) {
+         node->value = value;
+         return 1;
+      }
+   }
+
+   if (t->size >= t->nbuckets) {
+      newbuckets = calloc(t->nbuckets * 2, sizeof(chainnode *));
+      if (NULL == newbuckets) {
+         return 0;
+      }
+      for (i = 0; i < t->nbuckets; i++) {
+         for (node = t->buckets[i]; node; node = next) {
+            next = node->next;
+            node->next = newbuckets[node->hash & (t->nbuckets * 2 - 1)];
+            newbuckets[node->hash & (t->nbuckets * 2 - 1)] = node;
+         }
+      }
+      free(t->buckets);
+      t->buckets = newbuckets;
+      t->nbuckets *= 2;
+   }
+
+   if (NULL == (node = malloc(sizeof(chainnode))) ||
+   NULL == (node->key = malloc(n + 1))) {
+      free(node);
+      return 0;
+   }
+
+   memcpy(node->key, key, n);
+   node->key[n] = '\0';
+   node->hash = hash;
+   node->value = value;
+   node->next = t->buckets[hash & (t->nbuckets - 1)];
+   t->buckets[hash & (t->nbuckets - 1)] = node;
+   t->size++;
+   return 1;
+}
+
+static chainnode **chainfind(chaintable *t, const char *key, size_t n) {
+
+   chainnode **link;
+   uint64_t    hash = fnv1an(key, n);
+
+   for (link = &t->buckets[hash & (t->nbuckets - 1)]; *link;
+   link = &(*link)->next) {
+      if ((*link)->hash == hash && 0 == memcmp((*link)->key, key, n) &&
+      '\0' == (*link)->key[n]) {
+         break;
+      }
+   }
+
+   return link;
+}
+
+static int chaindel(chaintable *t, const char *key, size_t n) {
+
+   chainnode **link = chainfind(t, key, n), *node = *link;
+
+   if (NULL == node) {
+      return 0;
+   }
+
+   *link = node->next;
+   free(node->key);
+   free(node);
+   t->size--;
+   return 1;
+}
+
+/* the nth key: keys are MAP_KEYLEN bytes each, every MAP_KEYLEN + 1 bytes */
+#define MAPKEYAT(KEYS, N) ((KEYS) + (N) * (MAP_KEYLEN + 1))
+
+/* lookups and erases visit the keys in a different order than they were
+   inserted in (the ith is key i * step % n, with step about 0.618 n and
+   relatively prime to n), since the chained table's nodes are allocated in
+   insertion order, and visiting them in anything like that order would hide
+   its cache misses */
+#define MAPSTEP(I, N) ((I) * step % (N))
+
+static unsigned long gcd(unsigned long a, unsigned long b) {
+
+   unsigned long t;
+
+   while (b) {
+      t = a % b;
+      a = b;
+      b = t;
+   }
+
+   return a;
+}
+
+/* runs insert, lookup (hits, then misses) and erase over n keys, with misses
+   being the same keys with a different first byte */
+static int mapsweep(char *keys, char *misses, unsigned long n) {
+
+   dstrmap_t      map = NULL;
+   chaintable     chain;
+   unsigned long  i, found, step = (unsigned long)(n * 0.6180339887) + 1;
+   double         start;
+   char          *key;
+
+   while (gcd(step, n) != 1) {
+      step++;
+   }
+
+   if (DSTR_SUCCESS != dstrmapalloc(&map, 0)) {
+      fprintf(stderr, "out of memory\n");
+      return 0;
+   }
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, i);
+      if (DSTR_SUCCESS != dstrmapnset(map, key, MAP_KEYLEN, key)) {
+         fprintf(stderr, "out of memory\n");
+         dstrmapfree(&map);
+         return 0;
+      }
+   }
+   report("dstrmapnset (insert)", now() - start, n, "ops");
+
+   found = 0;
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, MAPSTEP(i, n));
+      found += dstrmapnget(map, key, MAP_KEYLEN, NULL);
+   }
+   report("dstrmapnget (hits)", now() - start, n, "ops");
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(misses, MAPSTEP(i, n));
+      found += dstrmapnget(map, key, MAP_KEYLEN, NULL);
+   }
+   report("dstrmapnget (misses)", now() - start, n, "ops");
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, MAPSTEP(i, n));
+      found += dstrmapndel(map, key, MAP_KEYLEN, NULL);
+   }
+   report("dstrmapndel (erase)", now() - start, n, "ops");
+
+   dstrmapfree(&map);
+
+   if (found != 2 * n) {
+      fprintf(stderr, "dstrmap found %lu keys instead of %lu\n", found, 2 * n);
+      return 0;
+   }
+
+   chain.nbuckets = 16;
+   chain.size = 0;
+   if (NULL == (chain.buckets = calloc(chain.nbuckets, sizeof(chainnode *)))) {
+      fprintf(stderr, "out of memory\n");
+      return 0;
+   }
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, i);
+      if (!chainset(&chain, key, MAP_KEYLEN, key)) {
+         fprintf(stderr, "out of memory\n");
+         return 0;
+      }
+   }
+   report("chained table (insert)", now() - start, n, "ops");
+
+   found = 0;
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, MAPSTEP(i, n));
+      found += NULL != *chainfind(&chain, key, MAP_KEYLEN);
+   }
+   report("chained table (hits)", now() - start, n, "ops");
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(misses, MAPSTEP(i, n));
+      found += NULL != *chainfind(&chain, key, MAP_KEYLEN);
+   }
+   report("chained table (misses)", now() - start, n, "ops");
+
+   start = now();
+   for (i = 0; i < n; i++) {
+      key = MAPKEYAT(keys, MAPSTEP(i, n));
+      found += chaindel(&chain, key, MAP_KEYLEN);
+   }
+   report("chained table (erase)", now() - start, n, "ops");
+
+   free(chain.buckets);
+
+   if (found != 2 * n) {
+      fprintf(stderr, "chained table found %lu keys instead of %lu\n", found,
+         2 * n);
+      return 0;
+   }
+
+   return 1;
+}
+
+static int benchmap(int argc, char *argv[]) {
+
+   unsigned long  sizes[] = MAP_SIZES, largest = 0, i;
+   char          *keys, *misses;
+   int            s;
+
+   /* a single size can be given instead of the usual sweep (100000000 needs
+      about 8 GB) */
+   if (argc > 0) {
+      sizes[0] = strtoul(argv[0], NULL, 10);
+      sizes[1] = 0;
+   }
+
+   for (s = 0; sizes[s]; s++) {
+      if (sizes[s] > largest) {
+         largest = sizes[s];
+      }
+   }
+
+   keys = malloc(largest * (MAP_KEYLEN + 1));
+   misses = malloc(largest * (MAP_KEYLEN + 1));
+   if (NULL == keys || NULL == misses) {
+      fprintf(stderr, "out of memory\n");
+      free(keys);
+      free(misses);
+      return EXIT_FAILURE;
+   }
+
+   /* scattered rather than sequential, like real ids */
+   for (i = 0; i < largest; i++) {
+      sprintf(MAPKEYAT(keys, i), "user:%010llu",
+         (unsigned long long)((uint64_t)i * 2654435761ULL % 10000000000ULL));
+      memcpy(MAPKEYAT(misses, i), MAPKEYAT(keys, i), MAP_KEYLEN + 1);
+      *MAPKEYAT(misses, i) = 'U';
+   }
+
+   for (s = 0; sizes[s]; s++) {
+      printf("%smap: %lu keys of %d bytes\n\n", s ? "\n" : "", sizes[s],
+         MAP_KEYLEN);
+      if (!mapsweep(keys, misses, sizes[s])) {
+         free(keys);
+         free(misses);
+         return EXIT_FAILURE;
+      }
+   }
+
+   free(keys);
+   free(misses);
+   return EXIT_SUCCESS;
+}
+
+/**************************************************************************\
+ * cmap: dstrcmap_t vs. a dstrmap_t behind one mutex, across threads      *
+\**************************************************************************/
+
+#define CMAP_KEYS    1000000       /* keys in the map */
+#define CMAP_OPS     1000000       /* operations per thread */
+#define CMAP_WRITES  5             /* percent of them that set or delete */
+#define CMAP_THREADS 32            /* the most threads tried by default */
+
+#ifdef DSTR_PTHREAD
+
+/* what each thread is given */
+typedef struct {
+   dstrcmap_t       cmap;          /* the map to use, if it's a dstrcmap_t */
+   dstrmap_t        map;           /* ...or a dstrmap_t, behind lock */
+   pthread_mutex_t *lock;
+   const char      *keys;
+   unsigned         seed;          /* for this thread's choice of keys */
+   unsigned long    found;
+} cmapthread;
+
+/* a small, fast random number generator, so that threads don't share
+   rand()'s state */
+static unsigned cmaprand(unsigned *state) {
+
+   *state = *state * 1103515245 + 12345;
+   return *state >> 8;
+}
+
+static void *cmapworker(void *arg) {
+
+   cmapthread   *t = arg;
+   unsigned long i;
+   unsigned      r;
+   const char   *key;
+
+   for (i = 0; i < CMAP_OPS; i++) {
+
+      r = cmaprand(&t->seed);
+      key = MAPKEYAT(t->keys, r % CMAP_KEYS);
+
+      /* writes put back whatever they take out, so the map stays full */
+      if (NULL != t->cmap) {
+         if (r / CMAP_KEYS % 100 < CMAP_WRITES) {
+            t->found += dstrcmapndel(t->cmap, key, MAP_KEYLEN, NULL);
+            dstrcmapnset(t->cmap, key, MAP_KEYLEN, (void *)key, NULL);
+         } else {
+            t->found += dstrcmapnget(t->cmap, key, MAP_KEYLEN, NULL);
+         }
+      }
+
+      else {
+         pthread_mutex_lock(t->lock);
+         if (r / CMAP_KEYS % 100 < CMAP_WRITES) {
+            t->found += dstrmapndel(t->map, key, MAP_KEYLEN, NULL);
+            dstrmapnset(t->map, key, MAP_KEYLEN, (void *)key);
+         } else {
+            t->found += dstrmapnget(t->map, key, MAP_KEYLEN, NULL);
+         }
+         pthread_mutex_unlock(t->lock);
+      }
+   }
+
+   return NULL;
+}
+
+/* runs nthreads threads against either cmap or map, and returns the time
+   they took, or a negative number if they couldn't be started */
+static double cmaprun(dstrcmap_t cmap, dstrmap_t map, pthread_mutex_t *lock,
+   const char *keys, int nthreads) {
+
+   pthread_t     threads[CMAP_THREADS];
+   cmapthread    args[CMAP_THREADS];
+   unsigned long found = 0;
+   double        start;
+   int           i;
+
+   start = now();
+
+   for (i = 0; i < nthreads; i++) {
+      args[i].cmap = cmap;
+      args[i].map = map;
+      args[i].lock = lock;
+      args[i].keys = keys;
+      args[i].seed = 2654435761U * (i + 1);
+      args[i].found = 0;
+      if (0 != pthread_create(&threads[i], NULL, cmapworker, &args[i])) {
+         fprintf(stderr, "couldn't start thread %d\n", i + 1);
+         nthreads = i;
+         start = -1;
+      }
+   }
+
+   for (i = 0; i < nthreads; i++) {
+      pthread_join(threads[i], NULL);
+      found += args[i].found;
+   }
+
+   if (start < 0) {
+      return -1;
+   }
+
+   /* every lookup and delete is of a key that's there, unless another
+      thread has just deleted it and hasn't put it back yet */
+   if (1 == nthreads && found != CMAP_OPS) {
+      fprintf(stderr, "found %lu keys instead of %d\n", found, CMAP_OPS);
+   }
+
+   return now() - start;
+}
+
+#endif
+
+static int benchcmap(int argc, char *argv[]) {
+
+#ifdef DSTR_PTHREAD
+
+   int              maxthreads = CMAP_THREADS, nthreads;
+   dstrcmap_t       cmap = NULL;
+   dstrmap_t        map = NULL;
+   pthread_mutex_t  lock = PTHREAD_MUTEX_INITIALIZER;
+   char            *keys;
+   char             what[64];
+   double           seconds;
+   unsigned long    i;
+
+   if (argc > 0) {
+      maxthreads = atoi(argv[0]);
+      if (maxthreads < 1 || maxthreads > CMAP_THREADS) {
+         fprintf(stderr, "threads must be from 1 to %d\n", CMAP_THREADS);
+         return EXIT_FAILURE;
+      }
+   }
+
+   if (NULL == (keys = malloc(CMAP_KEYS * (MAP_KEYLEN + 1))) ||
+   DSTR_SUCCESS != dstrcmapalloc(&cmap, CMAP_KEYS) ||
+   DSTR_SUCCESS != dstrmapalloc(&map, CMAP_KEYS)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   for (i = 0; i < CMAP_KEYS; i++) {
+      sprintf(MAPKEYAT(keys, i), "user:%010llu",
+         (unsigned long long)((uint64_t)i * 2654435761ULL % 10000000000ULL));
+      dstrcmapnset(cmap, MAPKEYAT(keys, i), MAP_KEYLEN, MAPKEYAT(keys, i),
+         NULL);
+      dstrmapnset(map, MAPKEYAT(keys, i), MAP_KEYLEN, MAPKEYAT(keys, i));
+   }
+
+   printf("cmap: %d keys, %d%% writes, %d operations per thread\n\n",
+      CMAP_KEYS, CMAP_WRITES, CMAP_OPS);
+
+   for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+
+      if (nthreads > 1) {
+         printf("\n");
+      }
+
+      if ((seconds = cmaprun(NULL, map, &lock, keys, nthreads)) < 0) {
+         break;
+      }
+      sprintf(what, "dstrmap + mutex, %d thread%s", nthreads,
+         nthreads > 1 ? "s" : "");
+      report(what, seconds, (double)nthreads * CMAP_OPS, "ops");
+
+      if ((seconds = cmaprun(cmap, NULL, NULL, keys, nthreads)) < 0) {
+         break;
+      }
+      sprintf(what, "dstrcmap, %d thread%s", nthreads,
+         nthreads > 1 ? "s" : "");
+      report(what, seconds, (double)nthreads * CMAP_OPS, "ops");
+   }
+
+   dstrcmapfree(&cmap, NULL);
+   dstrmapfree(&map);
+   free(keys);
+   return EXIT_SUCCESS;
+
+#else
+
+   (void)argc;
+   (void)argv;
+
+   fprintf(stderr, "the library wasn't built with --enable-pthreads\n");
+   return EXIT_FAILURE;
+
+#endif
+}
+
+/**************************************************************************\
+ * intern: a dstrpool_t vs. a separate dstring_t for every value           *
+\**************************************************************************/
+
+#define INTERN_VALUES  2000000     /* values read, by default */
+#define INTERN_WORDS   5000        /* distinct values among them */
+
+/* bytes the C library has handed out, where it'll say */
+static size_t heapbytes(void) {
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+   return mallinfo2().uordblks;
+#else
+   return 0;
+#endif
+}
+
+static int benchintern(int argc, char *argv[]) {
+
+   unsigned long   values = INTERN_VALUES, i, same;
+   char            words[INTERN_WORDS][48];
+   unsigned       *picks;
+   dstring_t      *strs;
+   dstrpool_t      pool = NULL;
+   dstrpoolstats_t stats;
+   size_t          before;
+   double          start;
+   unsigned        r = 1;
+   int             threadsafe;
+
+   if (argc > 0) {
+      values = strtoul(argv[0], NULL, 10);
+   }
+
+   if (NULL == (picks = malloc(values * sizeof(unsigned))) ||
+   NULL == (strs = malloc(values * sizeof(dstring_t)))) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   /* field names and enum-like values, a few of them very common */
+   for (i = 0; i < INTERN_WORDS; i++) {
+      if (i % 2) {
+         sprintf(words[i], "STATUS_%s_%lu", i % 3 ? "ACTIVE" : "PENDING", i);
+      } else {
+         sprintf(words[i], "customer.address.field_%lu", i);
+      }
+   }
+
+   for (i = 0; i < values; i++) {
+      r = r * 1103515245 + 12345;
+      picks[i] = (unsigned)((uint64_t)(r >> 16) * (r >> 16) * INTERN_WORDS
+         >> 32);
+   }
+
+   printf("intern: %lu values, %d of them distinct\n\n", values,
+      INTERN_WORDS);
+
+   /* the usual way: a string of its own for every value */
+   before = heapbytes();
+   start = now();
+   for (i = 0; i < values; i++) {
+      strs[i] = NULL;
+      if (DSTR_SUCCESS != dstralloc(&strs[i]) ||
+      DSTR_SUCCESS != cstrtodstr(strs[i], words[picks[i]])) {
+         fprintf(stderr, "out of memory\n");
+         return EXIT_FAILURE;
+      }
+   }
+   report("dstralloc + cstrtodstr", now() - start, values, "values");
+   if (heapbytes()) {
+      printf("   %-32s %12lu bytes\n", "(memory)",
+         (unsigned long)(heapbytes() - before));
+   }
+
+   same = 0;
+   start = now();
+   for (i = 1; i < values; i++) {
+      same += 0 == strcmp(dstrview(strs[i - 1]), dstrview(strs[i]));
+   }
+   report("strcmp for equality", now() - start, values, "values");
+
+   for (i = 0; i < values; i++) {
+      dstrfree(&strs[i]);
+   }
+
+   /* one copy of each, shared (a thread-safe pool needs pthreads) */
+   for (threadsafe = 0; threadsafe <= 1; threadsafe++) {
+
+#ifndef DSTR_PTHREAD
+      if (threadsafe) {
+         break;
+      }
+#endif
+
+      printf("\n");
+
+      if (DSTR_SUCCESS != dstrpoolalloc(&pool,
+      threadsafe ? DSTR_POOL_THREADSAFE : 0)) {
+         fprintf(stderr, "out of memory\n");
+         return EXIT_FAILURE;
+      }
+
+      start = now();
+      for (i = 0; i < values; i++) {
+         if (NULL == (strs[i] = dstrinterncs(pool, words[picks[i]]))) {
+            fprintf(stderr, "out of memory\n");
+            return EXIT_FAILURE;
+         }
+      }
+      report(threadsafe ? "dstrinterncs (thread-safe pool)" :
+         "dstrinterncs", now() - start, values, "values");
+
+      dstrpoolstats(pool, &stats);
+      printf("   %-32s %12lu bytes\n", "(memory, with the pointers)",
+         (unsigned long)(stats.memory + values * sizeof(dstring_t)));
+
+      if (!threadsafe) {
+         start = now();
+         for (i = 1; i < values; i++) {
+            same -= strs[i - 1] == strs[i];
+         }
+         report("pointer compare for equality", now() - start, values,
+            "values");
+      }
+
+      dstrpoolfree(&pool);
+   }
+
+   /* so the compiler can't skip any of it, and to show they agree */
+   printf("\n(%lu mismatches)\n", same);
+
+   free(picks);
+   free(strs);
+   return EXIT_SUCCESS;
+}
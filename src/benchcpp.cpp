@@ -0,0 +1,169 @@
+
+/* ************************************************************************* *\
+   * File: benchcpp.cpp                                                    *
+   * Purpose:                                                              *
+   *    Benchmarks for the C++ front end in dstring.hpp, measured against  *
+   *    dstrsprintf() and snprintf().                                      *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* Build with "make benchcpp", then run "./benchcpp [iterations]". */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "dstring.hpp"
+
+#define FORMAT_ITERATIONS 2000000
+
+/* the access log line from "bench sprintf", without the field widths */
+#define LOG_PRINTF "%s %s [%d] %s client=%s:%u method=%s path=%s " \
+   "status=%d bytes=%lu time=%ldus upstream=%s:%u cache=%s " \
+   "request_id=%lu user=%s\n"
+
+#define LOG_FORMAT "{} {} [{}] {} client={}:{} method={} path={} " \
+   "status={} bytes={} time={}us upstream={}:{} cache={} " \
+   "request_id={} user={}\n"
+
+#define LOG_ARGS(I) "2026-10-18", "12:34:56.789", (int)((I) % 100000), \
+   "INFO", "192.168.100.200", 50000 + (unsigned)((I) % 10000), "GET", \
+   "/api/v1/widgets/search", 200 + (int)((I) % 4), \
+   (unsigned long)(I) * 37, (long)((I) % 5000), "10.0.0.17", 8080u, \
+   "MISS", (unsigned long)(I), "anonymous"
+
+/* a line of metrics, mostly numbers; doubles are written so that they read
+   back exactly, which printf can only promise with %.17g */
+#define METRIC_PRINTF "%s count=%ld min=%.17g max=%.17g mean=%.17g " \
+   "p99=%.17g\n"
+#define METRIC_SPRINTF "%s count=%ld min=%r max=%r mean=%r p99=%r\n"
+#define METRIC_FORMAT "{} count={} min={} max={} mean={} p99={}\n"
+
+#define METRIC_ARGS(I) "http.request.latency", (long)(I), \
+   (double)((I) % 1000) / 1000.0, (double)(I) * 0.37, \
+   (double)(I) / 3.0, 1e-3 * (double)((I) % 977)
+
+/* ************************************************************************* */
+
+/* returns the current time in seconds */
+static double now(void) {
+
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ************************************************************************* */
+
+/* prints one line of results in a consistent format */
+static void report(const char *what, double seconds, double units,
+   const char *unitname) {
+
+   printf("   %-32s %10.4f s %14.0f %s/s\n", what, seconds, units / seconds,
+      unitname);
+}
+
+/* ************************************************************************* */
+
+int main(int argc, char *argv[]) {
+
+   char          buf[1024];
+   unsigned long iterations = FORMAT_ITERATIONS, i;
+   double        start, bytes;
+   dstring_t     str = NULL;
+
+   if (argc > 1) {
+      iterations = strtoul(argv[1], NULL, 10);
+   }
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+   }
+
+   dstring::format(str, LOG_FORMAT, LOG_ARGS(1UL));
+   printf("format: %lu lines like:\n   %s\n", iterations, dstrview(str));
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += snprintf(buf, sizeof(buf), LOG_PRINTF, LOG_ARGS(i));
+   }
+   report("snprintf", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrsprintf(str, LOG_PRINTF, LOG_ARGS(i));
+   }
+   report("dstrsprintf", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrcsprintf(str, LOG_PRINTF, LOG_ARGS(i));
+   }
+   report("dstrcsprintf", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstring::format(str, LOG_FORMAT, LOG_ARGS(i));
+   }
+   report("dstring::format", now() - start, iterations, "lines");
+
+   dstring::format(str, METRIC_FORMAT, METRIC_ARGS(7UL));
+   printf("\nformat: %lu lines like:\n   %s\n", iterations, dstrview(str));
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += snprintf(buf, sizeof(buf), METRIC_PRINTF, METRIC_ARGS(i));
+   }
+   report("snprintf (%.17g)", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstrsprintf(str, METRIC_SPRINTF, METRIC_ARGS(i));
+   }
+   report("dstrsprintf (%r)", now() - start, iterations, "lines");
+
+   bytes = 0;
+   start = now();
+   for (i = 0; i < iterations; i++) {
+      bytes += dstring::format(str, METRIC_FORMAT, METRIC_ARGS(i));
+   }
+   report("dstring::format", now() - start, iterations, "lines");
+
+   dstrfree(&str);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,1398 @@
+
+/* ************************************************************************* *\
+   * File: case.c                                                          *
+   * Purpose:                                                              *
+   *    Provides functions that map the case of the UTF-8 in a dstring_t   *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* no code point from here up has a simple case mapping (as of Unicode
+   14.0), so the tables stop here */
+#define CASE_LIMIT  0x1e980
+#define CASE_BLOCKS (CASE_LIMIT >> 6)
+
+/* for spotting anything that isn't ASCII and converting ASCII letters
+   eight bytes at a time */
+#define SWAR_ONES  ((uint64_t)0x0101010101010101ULL)
+#define SWAR_HIGHS ((uint64_t)0x8080808080808080ULL)
+
+/* The tables below hold the simple (one code point to one code point)
+   uppercase and lowercase mappings from the Unicode Character Database.
+   Code points are split into blocks of 64: xxxblocks[] says which of the
+   distinct blocks in xxxmap[] each one uses, and xxxmap[] says, for each
+   code point in the block, which entry of xxxdeltas[] to add to it.  Most
+   blocks have no mappings at all and share block 0, which adds 0. */
+
+/* uppercase: the block of upper mappings for each 64 code points */
+static const unsigned char upperblocks[CASE_BLOCKS] = {
+     0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,   0,   0,  11,
+    12,  13,  14,  15,  16,  17,  18,  19,  20,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  21,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,  22,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,  23,   0,   0,  24,  25,   0,  26,  26,  27,  26,  28,  29,
+    30,  31,   0,   0,   0,   0,   0,  32,  33,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,  34,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,  35,  36,  26,  37,  38,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,  39,  40,   0,  41,  42,  43,  44,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  45,
+    46,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  47,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,  48,  49,   0,  50,   0,   0,  51,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  52,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,  53,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,  54,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  55,  56
+};
+
+/* ...which index upperdeltas[] for each code point in the block */
+static const unsigned char uppermap[][64] = {
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  0,  1,  1,  1,  1,  1,  1,  1,  3
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  5,  0,  4,  0,  4,  0,  4,  0,  0,  4,  0,  4,  0,  4,  0
+   },
+   {
+       4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  0,  4,  0,  4,  0,  4,  6
+   },
+   {
+       7,  0,  0,  4,  0,  4,  0,  0,  4,  0,  0,  0,  4,  0,  0,  0,
+       0,  0,  4,  0,  0,  8,  0,  0,  0,  4,  9,  0,  0,  0, 10,  0,
+       0,  4,  0,  4,  0,  4,  0,  0,  4,  0,  0,  0,  0,  4,  0,  0,
+       4,  0,  0,  0,  4,  0,  4,  0,  0,  4,  0,  0,  0,  4,  0, 11
+   },
+   {
+       0,  0,  0,  0,  0,  4, 12,  0,  4, 12,  0,  4, 12,  0,  4,  0,
+       4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4, 13,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  0,  4, 12,  0,  4,  0,  0,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  0, 14
+   },
+   {
+      14,  0,  4,  0,  0,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+      15, 16, 17, 18, 19,  0, 20, 20,  0, 21,  0, 22, 23,  0,  0,  0,
+      20, 24,  0, 25,  0, 26, 27,  0, 28, 29, 27, 30, 31,  0,  0, 29,
+       0, 32, 33,  0,  0, 34,  0,  0,  0,  0,  0,  0,  0, 35,  0,  0
+   },
+   {
+      36,  0, 37, 36,  0,  0,  0, 38, 36, 39, 40, 40, 41,  0,  0,  0,
+       0,  0, 42,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 43, 44,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0, 45,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  4,  0,  4,  0,  0,  0,  4,  0,  0,  0, 10, 10, 10,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 46, 47, 47, 47,
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1
+   },
+   {
+       1,  1, 48,  1,  1,  1,  1,  1,  1,  1,  1,  1, 49, 50, 50,  0,
+      51, 52,  0,  0,  0, 53, 54, 55,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+      56, 57, 58, 59,  0, 60,  0,  0,  4,  0,  0,  4,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1
+   },
+   {
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+      57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4, 61,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62,
+      62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62
+   },
+   {
+      62, 62, 62, 62, 62, 62, 62,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+      63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+      63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,  0,  0, 63, 63, 63
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 55, 55, 55, 55, 55, 55,  0,  0
+   },
+   {
+      64, 65, 66, 67, 67, 68, 69, 70, 71,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0, 72,  0,  0,  0, 73,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 74,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  0,  0,  0,  0, 75,  0,  0,  0,  0,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+      76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0, 76,  0, 76,  0, 76,  0, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      77, 77, 78, 78, 78, 78, 79, 79, 80, 80, 81, 81, 82, 82,  0,  0
+   },
+   {
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76, 76, 76, 76, 76, 76, 76,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76,  0, 83,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 84,  0
+   },
+   {
+       0,  0,  0, 83,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      76, 76,  0,  0,  0, 58,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0, 83,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 85,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86, 86
+   },
+   {
+       0,  0,  0,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87, 87,
+      87, 87, 87, 87, 87, 87, 87, 87, 87, 87,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62
+   },
+   {
+      62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62,
+      62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62, 62,
+       0,  4,  0,  0,  0, 88, 89,  0,  4,  0,  4,  0,  4,  0,  0,  0,
+       0,  0,  0,  4,  0,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  4,  0,
+       0,  0,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+      90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90,
+      90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90, 90,
+      90, 90, 90, 90, 90, 90,  0, 90,  0,  0,  0,  0,  0, 90,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  4,  0,  4,  0,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  0,  0,  0,  4,  0,  0,  0,
+       0,  4,  0,  4, 91,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,
+       0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4,  0,  4
+   },
+   {
+       0,  4,  0,  4,  0,  0,  0,  0,  4,  0,  4,  0,  0,  0,  0,  0,
+       0,  4,  0,  0,  0,  0,  0,  4,  0,  4,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0, 92,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93
+   },
+   {
+      93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93,
+      93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93,
+      93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93,
+      93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93, 93
+   },
+   {
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 94, 94, 94, 94, 94, 94, 94, 94,
+      94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94
+   },
+   {
+      94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 94, 94, 94, 94, 94, 94, 94, 94,
+      94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94,
+      94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94, 94,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+      95, 95,  0, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95, 95,
+      95, 95,  0, 95, 95, 95, 95, 95, 95, 95,  0, 95, 95,  0,  0,  0
+   },
+   {
+      49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+      49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+      49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+      49, 49, 49,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96,
+      96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96, 96
+   },
+   {
+      96, 96, 96, 96,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   }
+};
+
+/* what to add to a code point to map it */
+static const long upperdeltas[] = {
+        0,    -32,    743,    121,     -1,   -232,   -300,    195,
+       97,    163,    130,     56,     -2,    -79,  10815,  10783,
+    10780,  10782,   -210,   -206,   -205,   -202,   -203,  42319,
+    42315,   -207,  42280,  42308,   -209,   -211,  10743,  42305,
+    10749,   -213,   -214,  10727,   -218,  42307,  42282,    -69,
+     -217,    -71,   -219,  42261,  42258,     84,    -38,    -37,
+      -31,    -64,    -63,    -62,    -57,    -47,    -54,     -8,
+      -86,    -80,      7,   -116,    -96,    -15,    -48,   3008,
+    -6254,  -6253,  -6244,  -6242,  -6243,  -6236,  -6181,  35266,
+    35332,   3814,  35384,    -59,      8,     74,     86,    100,
+      128,    112,    126,      9,  -7205,    -28,    -16,    -26,
+   -10795, -10792,  -7264,     48,   -928, -38864,    -40,    -39,
+      -34
+};
+
+/* lowercase: the block of lower mappings for each 64 code points */
+static const unsigned char lowerblocks[CASE_BLOCKS] = {
+     0,   1,   0,   2,   3,   4,   5,   6,   7,   8,   0,   0,   0,   9,
+    10,  11,  12,  13,  14,  15,  16,  17,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  18,  19,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,  20,  21,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,  22,   0,   0,   0,   0,   0,  23,  23,  24,  23,  25,  26,
+    27,  28,   0,   0,   0,   0,  29,  30,  31,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,  32,  33,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,  34,  35,  23,  36,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,  37,  38,   0,  39,  40,  41,  42,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  43,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,  44,   0,  45,  46,   0,  47,  48,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  49,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,  50,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,  51,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,  52,   0
+};
+
+/* ...which index lowerdeltas[] for each code point in the block */
+static const unsigned char lowermap[][64] = {
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  0,  1,  1,  1,  1,  1,  1,  1,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       3,  0,  2,  0,  2,  0,  2,  0,  0,  2,  0,  2,  0,  2,  0,  2
+   },
+   {
+       0,  2,  0,  2,  0,  2,  0,  2,  0,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  4,  2,  0,  2,  0,  2,  0,  0
+   },
+   {
+       0,  5,  2,  0,  2,  0,  6,  2,  0,  7,  7,  2,  0,  0,  8,  9,
+      10,  2,  0,  7, 11,  0, 12, 13,  2,  0,  0,  0, 12, 14,  0, 15,
+       2,  0,  2,  0,  2,  0, 16,  2,  0, 16,  0,  0,  2,  0, 16,  2,
+       0, 17, 17,  2,  0,  2,  0, 18,  2,  0,  0,  0,  2,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0, 19,  2,  0, 19,  2,  0, 19,  2,  0,  2,  0,  2,
+       0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0, 19,  2,  0,  2,  0, 20, 21,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+      22,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  0,  0,  0,  0,  0,  0, 23,  2,  0, 24, 25,  0
+   },
+   {
+       0,  2,  0, 26, 27, 28,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       2,  0,  2,  0,  0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0, 29
+   },
+   {
+       0,  0,  0,  0,  0,  0, 30,  0, 31, 31, 31,  0, 32,  0, 33, 33,
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 34,
+       0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0,  0,  0,  0, 35,  0,  0,  2,  0, 36,  2,  0,  0, 22, 22, 22
+   },
+   {
+      37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37, 37,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+      38,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39
+   },
+   {
+      39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+      39, 39, 39, 39, 39, 39, 39,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40,
+      40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40, 40
+   },
+   {
+      40, 40, 40, 40, 40, 40,  0, 40,  0,  0,  0,  0,  0, 40,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+      41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41
+   },
+   {
+      41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+      41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+      41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41, 41,
+      34, 34, 34, 34, 34, 34,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+      42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+      42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,  0,  0, 42, 42, 42
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0, 43,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0, 44,  0, 44,  0, 44,  0, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 44, 44, 44, 44, 44, 44,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 45, 45, 46,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0, 47, 47, 47, 47, 46,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 48, 48,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 44, 44, 49, 49, 36,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0, 50, 50, 51, 51, 46,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0, 52,  0,  0,  0, 53, 54,  0,  0,  0,  0,
+       0,  0, 55,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56, 56,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57
+   },
+   {
+      57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+      39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+      39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+      39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       2,  0, 58, 59, 60,  0,  0,  2,  0,  2,  0,  2,  0, 61, 62, 63,
+      64,  0,  2,  0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0, 65, 65
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  2,  0,  0,
+       0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  2,  0, 66,  2,  0
+   },
+   {
+       2,  0,  2,  0,  2,  0,  2,  0,  0,  0,  0,  2,  0, 67,  0,  0,
+       2,  0,  2,  0,  0,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,
+       2,  0,  2,  0,  2,  0,  2,  0,  2,  0, 68, 69, 70, 71, 68,  0,
+      72, 73, 74, 75,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0,  2,  0
+   },
+   {
+       2,  0,  2,  0, 76, 77, 78,  2,  0,  2,  0,  0,  0,  0,  0,  0,
+       2,  0,  0,  0,  0,  0,  2,  0,  2,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  0,  0,  0,  0,  0
+   },
+   {
+      79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+      79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+      79, 79, 79, 79, 79, 79, 79, 79,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79
+   },
+   {
+      79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79, 79,
+      79, 79, 79, 79,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      80, 80, 80, 80, 80, 80, 80, 80, 80, 80, 80,  0, 80, 80, 80, 80
+   },
+   {
+      80, 80, 80, 80, 80, 80, 80, 80, 80, 80, 80,  0, 80, 80, 80, 80,
+      80, 80, 80,  0, 80, 80,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+      32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+      32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+      32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+      32, 32, 32,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1
+   },
+   {
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   },
+   {
+      81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81,
+      81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81, 81,
+      81, 81,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+   }
+};
+
+/* what to add to a code point to map it */
+static const long lowerdeltas[] = {
+        0,     32,      1,   -199,   -121,    210,    206,    205,
+       79,    202,    203,    207,    211,    209,    213,    214,
+      218,    217,    219,      2,    -97,    -56,   -130,  10795,
+     -163,  10792,   -195,     69,     71,    116,     38,     37,
+       64,     63,      8,    -60,     -7,     80,     15,     48,
+     7264,  38864,  -3008,  -7615,     -8,    -74,     -9,    -86,
+     -100,   -112,   -128,   -126,  -7517,  -8383,  -8262,     28,
+       16,     26, -10743,  -3814, -10727, -10780, -10749, -10783,
+   -10782, -10815, -35332, -42280, -42308, -42319, -42315, -42305,
+   -42258, -42282, -42261,    928,    -48, -42307, -35384,     40,
+       39,     34
+};
+
+/* everything needed to map one way or the other */
+typedef struct {
+   const unsigned char *blocks;
+   const unsigned char (*map)[64];
+   const long          *deltas;
+   char                 first, last;       /* the ASCII letters it maps */
+
+   /* the first bytes of every code point with a mapping: a range of those
+      that begin 2 byte sequences, and up to CASE_MAXLEADS others */
+   unsigned char        twofirst, twolast;
+   const char          *leads;
+
+   /* the first bytes of the code points whose mappings are a different
+      length in UTF-8 (no more than CASE_MAXLEADS of them) */
+   const char          *resizeleads;
+} casetable;
+
+#define CASE_MAXLEADS 8
+
+static const casetable uppercase = {
+   upperblocks, uppermap, upperdeltas, 'a', 'z',
+   0xc2, 0xd6, "\xe1\xe2\xea\xef\xf0",
+   "\xc4\xc5\xc8\xc9\xca\xe1\xe2"
+};
+
+static const casetable lowercase = {
+   lowerblocks, lowermap, lowerdeltas, 'A', 'Z',
+   0xc3, 0xd5, "\xe1\xe2\xea\xef\xf0",
+   "\xc4\xc8\xe1\xe2\xea"
+};
+
+/* maps code point CP using casetable T */
+#define CASEMAP(T, CP) ((CP) >= CASE_LIMIT ? (CP) : \
+   (CP) + (T)->deltas[(T)->map[(T)->blocks[(CP) >> 6]][(CP) & 63]])
+
+/* the length of CP in UTF-8 */
+#define CPLENGTH(CP) ((CP) < 0x80 ? 1 : (CP) < 0x800 ? 2 : \
+   (CP) < 0x10000 ? 3 : 4)
+
+static int    casemapstr(dstring_t str, const casetable *t);
+static size_t casesize(const unsigned char *s, size_t len,
+   const casetable *t, size_t *growth);
+static void   caseconvert(unsigned char *out, const unsigned char *in,
+   size_t len, const casetable *t);
+static long   casedecode(const unsigned char *s, size_t *length);
+
+/* ************************************************************************* */
+
+int dstrutf8toupper(dstring_t str) {
+
+   return casemapstr(str, &uppercase);
+}
+
+/* ************************************************************************* */
+
+int dstrutf8tolower(dstring_t str) {
+
+   return casemapstr(str, &lowercase);
+}
+
+/* ************************************************************************* */
+
+/* maps the case of every code point in str; returns a status code - FOR
+   INTERNAL USE ONLY! */
+static int casemapstr(dstring_t str, const casetable *t) {
+
+   unsigned char *s;
+   size_t         len, newlen, growth, codepoints, newsize;
+   int            status;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   /* a pool's strings can't be changed (checked here rather than with
+      DSTRWRITABLE, which would throw away the cached answer dstrisutf8()
+      is about to use) */
+   if (DSTRREF(str)->flags & DSTR_FLAG_POOLED) {
+      _setdstrerrno(DSTR_READONLY);
+      return DSTR_READONLY;
+   }
+
+   if (!dstrisutf8(str)) {
+      _setdstrerrno(DSTR_INVALID_UTF8);
+      return DSTR_INVALID_UTF8;
+   }
+
+   codepoints = DSTRREF(str)->codepoints;
+   len = strlen(DSTRBUF(str));
+
+   /* a few mappings change the length of a code point's UTF-8, so the new
+      length (and how far ahead of the old string the new one ever gets)
+      has to be known before anything is written */
+   newlen = casesize((const unsigned char *)DSTRBUF(str), len, t, &growth);
+
+   if (DSTRBUFLEN(str) < len + growth + 1) {
+      newsize = DSTRBUFLEN(str) * 2;
+      if (newsize < len + growth + 1) {
+         newsize = len + growth + 1;
+      }
+      if (DSTR_SUCCESS != (status = dstrealloc(&str, newsize))) {
+         return status;
+      }
+   }
+
+   /* if the new string gets ahead of the old one, the old one is moved out
+      of the way first, so that nothing is overwritten before it's read */
+   s = (unsigned char *)DSTRBUF(str);
+   if (growth > 0) {
+      memmove(s + growth, s, len + 1);
+   }
+
+   caseconvert(s, s + growth, len, t);
+   s[newlen] = '\0';
+
+   /* the string is still UTF-8, with the same number of code points */
+   DSTRDIRTY(str);
+   DSTRREF(str)->codepoints = codepoints;
+   DSTRREF(str)->cached = DSTR_CACHE_UTF8CHECKED | DSTR_CACHE_UTF8;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* returns the length of the (valid UTF-8) string s once it's mapped, and
+   stores in *growth the most the mapped string is ever ahead of s; only
+   the code points that begin with one of t->resizeleads can change it */
+static size_t casesize(const unsigned char *s, size_t len,
+const casetable *t, size_t *growth) {
+
+   size_t i = 0, n, k, nleads = strlen(t->resizeleads);
+   size_t grown = 0, shrunk = 0;
+   long   cp;
+
+#ifdef __SSE2__
+   __m128i leads[CASE_MAXLEADS], v, m;
+   int     mask;
+#endif
+
+   *growth = 0;
+
+#ifdef __SSE2__
+
+   for (k = 0; k < nleads; k++) {
+      leads[k] = _mm_set1_epi8(t->resizeleads[k]);
+   }
+
+   for (; i + 16 <= len; i += 16) {
+
+      v = _mm_loadu_si128((const __m128i *)(s + i));
+      if (0 == _mm_movemask_epi8(v)) {
+         continue;
+      }
+
+      m = _mm_setzero_si128();
+      for (k = 0; k < nleads; k++) {
+         m = _mm_or_si128(m, _mm_cmpeq_epi8(v, leads[k]));
+      }
+
+      for (mask = _mm_movemask_epi8(m); 0 != mask; mask &= mask - 1) {
+
+         cp = casedecode(s + i + __builtin_ctz(mask), &n);
+         cp = CASEMAP(t, cp);
+
+         if (CPLENGTH(cp) > n) {
+            grown += CPLENGTH(cp) - n;
+            if (grown > shrunk && grown - shrunk > *growth) {
+               *growth = grown - shrunk;
+            }
+         } else {
+            shrunk += n - CPLENGTH(cp);
+         }
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+
+      if (s[i] < 0xc0 || NULL == memchr(t->resizeleads, s[i], nleads)) {
+         continue;
+      }
+
+      cp = casedecode(s + i, &n);
+      cp = CASEMAP(t, cp);
+
+      if (CPLENGTH(cp) > n) {
+         grown += CPLENGTH(cp) - n;
+         if (grown > shrunk && grown - shrunk > *growth) {
+            *growth = grown - shrunk;
+         }
+      } else {
+         shrunk += n - CPLENGTH(cp);
+      }
+   }
+
+   return len + grown - shrunk;
+}
+
+/* ************************************************************************* */
+
+/* maps the case of len bytes of (valid UTF-8) at in, writing the result to
+   out; out may overlap in, so long as it's never ahead of it */
+static void caseconvert(unsigned char *out, const unsigned char *in,
+size_t len, const casetable *t) {
+
+   size_t i = 0, o = 0, j, k, n;
+   long   cp;
+
+#ifdef __SSE2__
+   const __m128i first = _mm_set1_epi8((char)(t->first - 1));
+   const __m128i last = _mm_set1_epi8((char)(t->last + 1));
+   const __m128i flip = _mm_set1_epi8(0x20);
+   const __m128i twofirst = _mm_set1_epi8((char)t->twofirst);
+   const __m128i tworange = _mm_set1_epi8((char)(t->twolast - t->twofirst));
+   __m128i       leads[CASE_MAXLEADS], v, x, m;
+   size_t        nleads = strlen(t->leads);
+
+   for (k = 0; k < nleads; k++) {
+      leads[k] = _mm_set1_epi8(t->leads[k]);
+   }
+#else
+   uint64_t      w;
+#endif
+
+   while (i < len) {
+
+#ifdef __SSE2__
+
+      /* a block without the first byte of any code point that has a
+         mapping only needs its ASCII letters flipped, which can be done all
+         at once; this covers ASCII, and most scripts without case (CJK,
+         for instance) */
+      for (; i + 16 <= len; i += 16, o += 16) {
+
+         v = _mm_loadu_si128((const __m128i *)(in + i));
+
+         if (0 != _mm_movemask_epi8(v)) {
+
+            /* (unsigned) twofirst <= v <= twolast */
+            x = _mm_sub_epi8(v, twofirst);
+            m = _mm_cmpeq_epi8(_mm_min_epu8(x, tworange), x);
+            for (k = 0; k < nleads; k++) {
+               m = _mm_or_si128(m, _mm_cmpeq_epi8(v, leads[k]));
+            }
+
+            if (0 != _mm_movemask_epi8(m)) {
+               break;
+            }
+         }
+
+         /* bytes above 0x7f are negative, so they're never flipped */
+         v = _mm_xor_si128(v, _mm_and_si128(flip, _mm_and_si128(
+            _mm_cmpgt_epi8(v, first), _mm_cmplt_epi8(v, last))));
+         _mm_storeu_si128((__m128i *)(out + o), v);
+      }
+
+      /* the last block skipped may have ended partway through a sequence
+         (one without a mapping) */
+      while (i < len && 0x80 == (in[i] & 0xc0)) {
+         out[o++] = in[i++];
+      }
+
+#else
+
+      /* a block of ASCII has its letters flipped all at once */
+      for (; i + 8 <= len; i += 8, o += 8) {
+         memcpy(&w, in + i, 8);
+         if (w & SWAR_HIGHS) {
+            break;
+         }
+         /* the high bit of each byte is set if it's >= first, and then if
+            it's > last; with only ASCII, nothing carries between bytes */
+         w ^= ((w + SWAR_ONES * (0x80 - t->first)) &
+            ~(w + SWAR_ONES * (0x80 - t->last - 1)) & SWAR_HIGHS) >> 2;
+         memcpy(out + o, &w, 8);
+      }
+
+#endif
+
+      for (k = i + 16; i < len && i < k; ) {
+
+         if (in[i] < 0x80) {
+            out[o++] = in[i] >= t->first && in[i] <= t->last ?
+               in[i] ^ 0x20 : in[i];
+            i++;
+            continue;
+         }
+
+         cp = casedecode(in + i, &n);
+         i += n;
+
+         /* code points in blocks without mappings are copied as they are */
+         if (cp >= CASE_LIMIT || 0 == t->blocks[cp >> 6]) {
+            for (j = i - n; j < i; j++) {
+               out[o++] = in[j];
+            }
+            continue;
+         }
+
+         cp = CASEMAP(t, cp);
+
+         if (cp < 0x80) {
+            out[o++] = (unsigned char)cp;
+         } else if (cp < 0x800) {
+            out[o++] = (unsigned char)(0xc0 | cp >> 6);
+            out[o++] = (unsigned char)(0x80 | (cp & 0x3f));
+         } else if (cp < 0x10000) {
+            out[o++] = (unsigned char)(0xe0 | cp >> 12);
+            out[o++] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+            out[o++] = (unsigned char)(0x80 | (cp & 0x3f));
+         } else {
+            out[o++] = (unsigned char)(0xf0 | cp >> 18);
+            out[o++] = (unsigned char)(0x80 | (cp >> 12 & 0x3f));
+            out[o++] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+            out[o++] = (unsigned char)(0x80 | (cp & 0x3f));
+         }
+      }
+   }
+}
+
+/* ************************************************************************* */
+
+/* decodes the (known to be valid) sequence at s and stores its length */
+static long casedecode(const unsigned char *s, size_t *length) {
+
+   if (s[0] < 0x80) {
+      *length = 1;
+      return s[0];
+   } else if (s[0] < 0xe0) {
+      *length = 2;
+      return (long)(s[0] & 0x1f) << 6 | (s[1] & 0x3f);
+   } else if (s[0] < 0xf0) {
+      *length = 3;
+      return (long)(s[0] & 0x0f) << 12 | (long)(s[1] & 0x3f) << 6 |
+         (s[2] & 0x3f);
+   } else {
+      *length = 4;
+      return (long)(s[0] & 0x07) << 18 | (long)(s[1] & 0x3f) << 12 |
+         (long)(s[2] & 0x3f) << 6 | (s[3] & 0x3f);
+   }
+}
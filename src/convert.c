@@ -83,6 +83,10 @@ int cstrtodstr(dstring_t dest, const char *src) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return DSTR_READONLY;
+   }
+
    /* make sure src is not a NULL pointer, which would cause a crash */
    if (NULL == src) {
       _setdstrerrno(DSTR_NULL_CPTR);
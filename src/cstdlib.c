@@ -83,6 +83,10 @@ int dstrcat(dstring_t dest, const dstring_t src) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* nothing to do if the source string is empty */
    if (0 == dstrlen(src)) {
       _setdstrerrno(DSTR_SUCCESS);
@@ -128,6 +132,10 @@ int dstrncat(dstring_t dest, const dstring_t src, size_t n) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* nothing to do if the source string is empty or if n is 0 */
    if (0 == dstrlen(src) || 0 == n) {
       _setdstrerrno(DSTR_SUCCESS);
@@ -175,6 +183,10 @@ int dstrcatcs(dstring_t dest, const char *src) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* make sure src is not a NULL pointer */
    if (NULL == src) {
       _setdstrerrno(DSTR_NULL_CPTR);
@@ -223,6 +235,10 @@ int dstrncatcs(dstring_t dest, const char *src, size_t n) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* make sure src is not a NULL pointer */
    if (NULL == src) {
       _setdstrerrno(DSTR_NULL_CPTR);
@@ -279,6 +295,10 @@ int dstrcpy(dstring_t dest, const dstring_t src) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* nothing to do */
    if (0 == dstrlen(src)) {
       _setdstrerrno(DSTR_SUCCESS);
@@ -324,6 +344,10 @@ int dstrncpy(dstring_t dest, const dstring_t src, size_t n) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* if n is larger than the size of src, just append all of src */
    if (n > dstrlen(src)) {
       n = dstrlen(src);
@@ -51,9 +51,19 @@ static const char *errormsgs[] = {
    "invalid argument",
    "pointer to char is NULL",
    "expected non-empty dstring object",
-   "unknown error"
+   "error writing file",
+   "operation would block",
+   "not supported by this build",
+   "number out of range",
+   "invalid UTF-8",
+   "string is read-only"
 };
 
+/* number of known status codes; anything beyond this is an unknown error */
+#define NUM_ERRORMSGS (sizeof(errormsgs) / sizeof(errormsgs[0]))
+
+static const char *unknownerror = "unknown error";
+
 /* Win32 version of our thread-safe dstrerrno */
 #ifdef DSTR_WIN32THREAD
    /* etc */
@@ -62,7 +72,9 @@ static const char *errormsgs[] = {
 /* Pthreads version of our thread-safe dstrerrno */
 #ifdef DSTR_PTHREAD
    pthread_key_t _dstrerrno_key;                      /* key value for TLS */
+   static pthread_once_t _dstrerrno_once = PTHREAD_ONCE_INIT;
    static void _dstrfree_dstrerrno(void *dstrptr);    /* pthread destructor */
+   static void _dstrcreate_dstrerrno_key(void);       /* creates the key */
 #endif
 
 /* dstrerrno for non-Win32 and non-pthreads systems (not thread-safe) */
@@ -76,8 +88,8 @@ static const char *errormsgs[] = {
 
 const char * const dstrerrormsg(int code) {
 
-   if (abs(code) > 10) {
-      return errormsgs[11];
+   if ((size_t)abs(code) >= NUM_ERRORMSGS) {
+      return unknownerror;
    } else {
       return errormsgs[abs(code)];
    }
@@ -93,6 +105,10 @@ int dstrbuildinfo(dstring_t str) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    dstrcatcs(str, "Version: " "#VERSION" "\nBuild time: " __DATE__
       ", " __TIME__);
 
@@ -116,6 +132,13 @@ int dstrbuildinfo(dstring_t str) {
 
 /* ************************************************************************* */
 
+void dstrseterrno(int status) {
+
+   _setdstrerrno(status);
+}
+
+/* ************************************************************************* */
+
 /* FOR LIBRARY'S INTERNAL USE ONLY! */
 void _setdstrerrno(int status) {
 
@@ -125,21 +148,19 @@ void _setdstrerrno(int status) {
    #endif
 
    #ifdef DSTR_PTHREAD
-      /* if we're using threads, once the key is set, this will be 1 */
-      static int iskeyset = 0;
-
-      int   keystatus;
       int  *errvalptr;
 
-      if (0 == iskeyset) {
+      /* the key is created exactly once, no matter how many threads race to
+         be the first to get here */
+      if (0 != pthread_once(&_dstrerrno_once, _dstrcreate_dstrerrno_key)) {
+         fprintf(stderr, "__FILE__: __LINE__: error: could not allocate");
+         fprintf(stderr, " dstrerrno\n");
+         exit(EXIT_FAILURE);
+      }
 
-         /* allocate space for a key and make sure it was successful */
-         keystatus = pthread_key_create(&_dstrerrno_key, _dstrfree_dstrerrno);
-         if (0 != keystatus) {
-            fprintf(stderr, "__FILE__: __LINE__: error: could not allocate");
-            fprintf(stderr, " dstrerrno\n");
-            exit(EXIT_FAILURE);
-         }
+      /* each thread gets its own copy of dstrerrno the first time it calls a
+         dstring function */
+      if (NULL == (errvalptr = (int *)pthread_getspecific(_dstrerrno_key))) {
 
          /* allocate space for dstrerrno itself */
          if (NULL == (errvalptr = calloc(1, sizeof(int)))) {
@@ -154,11 +175,8 @@ void _setdstrerrno(int status) {
             fprintf(stderr, " dstrerrno\n");
             exit(EXIT_FAILURE);
          }
-
-         iskeyset = 1;
       }
 
-      errvalptr = (int *)pthread_getspecific(_dstrerrno_key);
       *errvalptr = status;
    #endif
 
@@ -174,6 +192,21 @@ void _setdstrerrno(int status) {
 /* ************************************************************************* */
 
 #ifdef DSTR_PTHREAD
+/* creates the TLS key for dstrerrno - FOR INTERNAL USE ONLY! */
+static void _dstrcreate_dstrerrno_key(void) {
+
+   /* allocate space for a key and make sure it was successful */
+   if (0 != pthread_key_create(&_dstrerrno_key, _dstrfree_dstrerrno)) {
+      fprintf(stderr, "__FILE__: __LINE__: error: could not allocate");
+      fprintf(stderr, " dstrerrno\n");
+      exit(EXIT_FAILURE);
+   }
+
+   return;
+}
+
+/* ************************************************************************* */
+
 /* pthread destructor for dstrerrno - FOR INTERNAL USE ONLY! */
 static void _dstrfree_dstrerrno(void *dstrptr) {
 
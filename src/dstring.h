@@ -33,6 +33,11 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /* HINT: it's a VERY good idea to set newly declared and uninitialized
    dstring_t variables to NULL.  If you do so, and you later accidentally
@@ -67,6 +72,14 @@
 /* dstring_t is actually a "black-box" type */
 typedef void * dstring_t;
 
+/* a field found in a dstring_t: dstrview() + offset, length characters long
+   (unlike dstring_t, this isn't a "black-box" type, so that arrays of them
+   can be declared without allocating anything) */
+typedef struct {
+   size_t offset;
+   size_t length;
+} dstrfield_t;
+
 
 
 /* ************************************************************************* */
@@ -134,7 +147,26 @@ enum STATUS_CODES {
    DSTR_NULL_CPTR = -9,
 
    /* when a dstring_t object is empty, but a non-empty string is expected */
-   DSTR_EMPTY_STRING = -10
+   DSTR_EMPTY_STRING = -10,
+
+   /* returned if there was an error writing to a file or file descriptor */
+   DSTR_WRITE_ERROR = -11,
+
+   /* returned when a non-blocking file descriptor has no data (or space) */
+   DSTR_WOULDBLOCK = -12,
+
+   /* returned when a feature was not built into the library */
+   DSTR_UNSUPPORTED = -13,
+
+   /* returned when a number is too large for the type it's parsed into */
+   DSTR_OUT_OF_RANGE = -14,
+
+   /* returned when a string that should be UTF-8 isn't */
+   DSTR_INVALID_UTF8 = -15,
+
+   /* returned when a string that can't be changed is passed to a function
+      that would change, free or resize it (see dstrintern()) */
+   DSTR_READONLY = -16
 };
 
 
@@ -209,7 +241,8 @@ int dstrnalloc(dstring_t *dstrptr, size_t bytes);
    invoke dstrfree() to free the object and set it to NULL.  If an
    uninitialized dstring_t is passed to dstrealloc, it will be passed to
    dstralloc instead, where it will be initialized with the specified number
-   of bytes.
+   of bytes.  A string that belongs to a dstrpool_t can't be resized, and
+   dstrerrno will be set to DSTR_READONLY.
 
    In addition to the return value, dstrerrno will be set to indicate
    success or failure.
@@ -233,7 +266,8 @@ int dstrealloc(dstring_t *dstrptr, size_t bytes);
 
    This function frees all memory dynamically allocated to an object of type
    dstring_t and sets the variable to NULL (denoting an uninitialized
-   state.)
+   state.)  A string that belongs to a dstrpool_t is freed with the pool,
+   not by this function, and dstrerrno will be set to DSTR_READONLY.
 
    In addition to the return value, dstrerrno will be set to indicate
    success or failure.
@@ -429,383 +463,2972 @@ size_t dstrfreadn(dstring_t dest, FILE *fp, size_t n);
 
    *************************************************************************
 
-   Input:
-      dstring_t (our dstring_t object)
-      FILE * (our input stream)
+   Input:
+      dstring_t (our dstring_t object)
+      FILE * (our input stream)
+
+   Output:
+      Number of characters successfully read (0 on error or EOF - check
+      dstrerrno)
+
+   ************************************************************************* */
+size_t dstrfcatl(dstring_t dest, FILE *fp);
+
+
+/* **** dstrcatl **********************************************************
+
+   Implemented as a macro, this call wraps around dstrfcatl, using stdin
+   as the input file.
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+
+   Output:
+      Number of characters successfully read (0 on error or EOF - check
+      dstrerrno)
+
+   ************************************************************************* */
+#define dstrcatl(DEST) dstrfcatl(DEST, stdin)
+
+
+/* **** dstrfcatn **********************************************************
+
+   This function reads up to one less than n characters (not including the
+   NULL terminating character), including \n's, from FILE *fp and appends
+   them to the buffer of a dstring_t object.
+
+   If size is 0, nothing will be done and dstrerrno will be set to
+   DSTR_SUCCESS.
+
+   New data is appended to anything previously stored in the buffer.  In
+   the event of a DSTR_NOMEM error, the buffer will be unmodified.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      FILE (our input stream)
+      size_t (the number of characters to read)
+
+   Output:
+      Number of characters successfully read (0 on error or EOF - check
+      dstrerrno)
+
+   ************************************************************************* */
+size_t dstrfcatn(dstring_t dest, FILE *fp, size_t n);
+
+
+/* **** dstrcatn ***********************************************************
+
+   Implemented as a macro, this wraps around dstrcatn, using stdin as the
+   input file.
+
+   If size is 0, nothing will be done and DSTR_SUCCESS will be returned.
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      size_t (the number of characters to read)
+
+   Output:
+      Number of characters successfully read (0 on error or EOF - check
+      dstrerrno)
+
+   ************************************************************************* */
+#define dstrcatn(DEST, SIZE) dstrfcatn(DEST, stdin, SIZE)
+
+
+/* **** dstrfwrite *********************************************************
+
+   This function writes the string stored in a dstring_t object to FILE *fp
+   with a single call to fwrite(), rather than one character at a time.
+   The '\0' terminating character is not written.
+
+   dstrerrno will be set to indicate success or failure.  If only part of
+   the string could be written, dstrerrno will be set to DSTR_WRITE_ERROR.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (our dstring_t object)
+      FILE * (our output stream)
+
+   Output:
+      Number of characters successfully written (check dstrerrno if this is
+      less than the length of the string)
+
+   ************************************************************************* */
+size_t dstrfwrite(const dstring_t src, FILE *fp);
+
+
+/* **** dstrwrite **********************************************************
+
+   Implemented as a macro, this call wraps around dstrfwrite, using stdout
+   as the output file.
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (our dstring_t object)
+
+   Output:
+      Number of characters successfully written (check dstrerrno if this is
+      less than the length of the string)
+
+   ************************************************************************* */
+#define dstrwrite(SRC) dstrfwrite(SRC, stdout)
+
+
+/* **** dstrfdwrite ********************************************************
+
+   This function writes the string stored in a dstring_t object directly to
+   a file descriptor, bypassing stdio.  Partial writes are continued and
+   calls interrupted by a signal are restarted until the whole string has
+   been written or an error occurs.
+
+   dstrerrno will be set to indicate success or failure.  A negative file
+   descriptor results in DSTR_UNOPENED_FILE.  If a non-blocking descriptor
+   fills up first, dstrerrno will be set to DSTR_WOULDBLOCK, and the rest
+   can be written later with dstrfdwritefrom().  If write() accepts nothing
+   without reporting an error, dstrerrno will be set to DSTR_WRITE_ERROR
+   rather than trying forever.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (our dstring_t object)
+      int (our output file descriptor)
+
+   Output:
+      Number of characters successfully written (check dstrerrno if this is
+      less than the length of the string)
+
+   ************************************************************************* */
+size_t dstrfdwrite(const dstring_t src, int fd);
+
+
+/* **** dstrfdwritev *******************************************************
+
+   This function writes an array of n dstring_t objects, one after the
+   other, to a file descriptor without first concatenating them.  Where
+   writev() is available, all of the strings are normally handed to the
+   kernel with a single system call (more than one call is only needed if
+   the kernel accepts a partial write, or if n exceeds IOV_MAX.)
+
+   Every object in the array must be initialized, or nothing will be
+   written and dstrerrno will be set to DSTR_UNINITIALIZED.  Empty strings
+   are skipped.
+
+   dstrerrno will be set to indicate success or failure, just as in
+   dstrfdwrite(), including DSTR_WOULDBLOCK if a non-blocking descriptor
+   fills up before everything has been written.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t * (array of dstring_t objects to write)
+      size_t (number of objects in the array)
+      int (our output file descriptor)
+
+   Output:
+      Total number of characters successfully written (check dstrerrno if
+      this is less than the combined length of the strings)
+
+   ************************************************************************* */
+size_t dstrfdwritev(const dstring_t *srcs, size_t n, int fd);
+
+
+/* **** dstrfdcat **********************************************************
+
+   This function appends everything that can currently be read from a file
+   descriptor to the buffer of a dstring_t object, reading directly into
+   the object's spare capacity and doubling the allocation whenever it
+   fills up.  It is meant for non-blocking sockets and pipes driven by an
+   event loop such as poll() or epoll(): reading continues until the
+   descriptor reports EAGAIN/EWOULDBLOCK or end-of-file, so it is also safe
+   to use with edge-triggered notification.  Calls interrupted by a signal
+   are restarted.  On a blocking descriptor, this reads until end-of-file.
+
+   If the peer closed the connection (read() returned 0), dstrerrno will be
+   set to DSTR_EOF, even if data was read first; anything that was read is
+   still appended and counted.  If no data was available at all,
+   dstrerrno will be set to DSTR_WOULDBLOCK.  If memory runs out, whatever
+   was read so far is kept and dstrerrno will be set to DSTR_NOMEM.
+
+   WARNING: dstring_t objects are '\0' terminated, so data containing '\0'
+   characters will appear truncated at the first one.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      int (our input file descriptor)
+
+   Output:
+      Number of characters successfully read (check dstrerrno)
+
+   ************************************************************************* */
+size_t dstrfdcat(dstring_t dest, int fd);
+
+
+/* **** dstrfdcatn *********************************************************
+
+   This function behaves like dstrfdcat(), except that no more than n
+   characters will be read from the file descriptor, which keeps a single
+   call from growing the buffer without bound.  The buffer is grown at most
+   once, to fit n more characters.
+
+   If n is 0, nothing will be done and dstrerrno will be set to
+   DSTR_SUCCESS.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      int (our input file descriptor)
+      size_t (the maximum number of characters to read)
+
+   Output:
+      Number of characters successfully read (check dstrerrno)
+
+   ************************************************************************* */
+size_t dstrfdcatn(dstring_t dest, int fd, size_t n);
+
+
+/* **** dstrfdwritefrom ****************************************************
+
+   This function writes as much of a dstring_t object as the file
+   descriptor will accept, starting at the specified 0-based index.  Unlike
+   dstrfdwrite(), it returns as soon as a non-blocking descriptor reports
+   EAGAIN/EWOULDBLOCK, so the caller can remember index + the return value
+   and resume when the descriptor becomes writable again.
+
+   An index equal to the length of the string is allowed and writes
+   nothing.  If nothing could be written because the descriptor would
+   block, dstrerrno will be set to DSTR_WOULDBLOCK.  If write() accepts
+   nothing without reporting an error, dstrerrno will be set to
+   DSTR_WRITE_ERROR.
+
+   Found in io.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (our dstring_t object)
+      size_t (index of the first character to write)
+      int (our output file descriptor)
+
+   Output:
+      Number of characters successfully written (check dstrerrno)
+
+   ************************************************************************* */
+size_t dstrfdwritefrom(const dstring_t src, size_t index, int fd);
+
+
+/***********************\
+ * batch I/O functions *
+\***********************/
+
+
+/* **** dstrreadcb_t *******************************************************
+
+   The type of the callback passed to dstrfreadfiles().  It is called once
+   for each file, as soon as that file has been read (or has failed), with
+   the dstring_t object the file was read into, the file's path, a status
+   code (see enum above) and the arg pointer given to dstrfreadfiles().
+
+   ************************************************************************* */
+typedef void (*dstrreadcb_t)(dstring_t dest, const char *path, int status,
+   void *arg);
+
+
+/* **** dstrfreadfiles *****************************************************
+
+   This function reads n whole files at once, the contents of paths[i]
+   replacing whatever was stored in dests[i].  Every dstring_t object is
+   first grown to the size of its file, so that each file is read with a
+   single request.
+
+   On Linux, reads are submitted to the kernel in large groups through
+   io_uring, so that many of them are in flight at the same time.  If
+   io_uring isn't available and the library was built with POSIX thread
+   support, the files are divided among a pool of worker threads instead.
+   Otherwise, the files are simply read one after the other.
+
+   The callback (which may be NULL) is called once for each file as it
+   finishes, in no particular order and possibly from a worker thread, but
+   never from two threads at the same time.  Files whose size can't be
+   determined in advance (such as those in /proc) are read until EOF.
+
+   dstrerrno will be set to DSTR_SUCCESS if every file was read, or to
+   DSTR_FILE_ERROR if any of them failed (the status passed to the callback
+   will tell you why.)
+
+   WARNING: dstring_t objects are '\0' terminated, so files containing '\0'
+   characters will appear truncated at the first one.
+
+   Found in batch.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t * (array of n initialized dstring_t objects)
+      const char ** (array of n paths)
+      size_t (number of files)
+      dstrreadcb_t (called as each file finishes, or NULL)
+      void * (passed to the callback)
+
+   Output:
+      Number of files successfully read
+
+   ************************************************************************* */
+size_t dstrfreadfiles(dstring_t *dests, const char **paths, size_t n,
+   dstrreadcb_t callback, void *arg);
+
+
+/****************************\
+ * stream reader functions *
+\****************************/
+
+
+/* dstrreader_t is also a "black-box" type */
+typedef void * dstrreader_t;
+
+/* kinds of compression a dstrreader_t object can decode */
+enum DSTR_COMPRESSION {
+
+   /* figure it out from the first few bytes of the stream */
+   DSTR_COMPRESS_AUTO = 0,
+
+   /* the stream isn't compressed */
+   DSTR_COMPRESS_NONE = 1,
+
+   /* gzip (or zlib) format; requires the library to be built with zlib */
+   DSTR_COMPRESS_GZIP = 2,
+
+   /* zstd format; requires the library to be built with libzstd */
+   DSTR_COMPRESS_ZSTD = 3
+};
+
+
+/* **** dstrreaderopen *****************************************************
+
+   This function initializes a variable of type dstrreader_t, which reads
+   (and if necessary, decompresses) data from FILE *fp as it is needed,
+   through a small fixed-size buffer.  Lines can then be read from it with
+   dstrrreadl() and dstrrcatl() exactly as they would be read from an
+   uncompressed file with dstrfreadl(), without ever decompressing the
+   whole stream to memory or to a temporary file.
+
+   If compression is DSTR_COMPRESS_AUTO, the format is detected from the
+   first few bytes of the stream, and anything that isn't recognized as
+   gzip or zstd is read as-is.  Concatenated gzip members and zstd frames
+   are read as a single stream.
+
+   If the requested format wasn't built into the library (see the
+   --with-zlib and --with-zstd configure options), dstrerrno will be set to
+   DSTR_UNSUPPORTED.  fp is not closed by dstrreaderclose(); that's still
+   up to the caller.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in reader.c
+
+   *************************************************************************
+
+   Input:
+      dstrreader_t * (points to the object to be initialized)
+      FILE * (our input stream)
+      int (one of the DSTR_COMPRESS_* values above)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrreaderopen(dstrreader_t *rptr, FILE *fp, int compression);
+
+
+/* **** dstrreaderclose ****************************************************
+
+   This function frees all memory allocated to an object of type
+   dstrreader_t and sets the variable to NULL.  The underlying file is left
+   open.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in reader.c
+
+   *************************************************************************
+
+   Input:
+      dstrreader_t * (points to the object to be freed)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrreaderclose(dstrreader_t *rptr);
+
+
+/* **** dstrrreadl *********************************************************
+
+   This function reads an entire line of input from a dstrreader_t object,
+   terminated by the '\n' character (the newline is included as part of
+   the string), and stores it in the buffer of a dstring_t object.  Each
+   piece of the line is copied straight from the reader's decompression
+   buffer into dest, so reusing the same dstring_t for every line means the
+   buffer will rarely need to grow.
+
+   New data overwrites anything previously stored in the buffer.  If EOF is
+   encountered before any data can be read, the previous string will remain
+   untouched and dstrerrno will be set to DSTR_EOF.  A compressed stream
+   that is corrupt or ends in the middle will result in DSTR_FILE_ERROR.
+
+   WARNING: lines containing '\0' characters will appear truncated at the
+   first one.
+
+   Found in reader.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      dstrreader_t (our input stream)
+
+   Output:
+      number of characters successfully read (0 on EOF or error - check
+      dstrerrno)
+
+   ************************************************************************* */
+size_t dstrrreadl(dstring_t dest, dstrreader_t r);
+
+
+/* **** dstrrcatl **********************************************************
+
+   This function behaves like dstrrreadl(), except that the line is
+   appended to whatever is already stored in the dstring_t object.
+
+   Found in reader.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+      dstrreader_t (our input stream)
+
+   Output:
+      number of characters successfully read (0 on EOF or error - check
+      dstrerrno)
+
+   ************************************************************************* */
+size_t dstrrcatl(dstring_t dest, dstrreader_t r);
+
+
+/* **** dstrrreadcsv *******************************************************
+
+   This function reads one CSV record from a dstrreader_t object into dest
+   and stores the offset and length of each of its fields in the caller's
+   array.  Fields are separated by delim (',' for CSV, '\t' for TSV), and
+   records by '\n' or "\r\n".  A field may be enclosed in double quotes,
+   in which case it can contain delimiters, newlines and quotes (written
+   as ""), so a record can span several lines.
+
+   The quotes are removed and each "" becomes a single quote in place, and
+   every field is terminated with '\0', so each one can be used as an
+   ordinary C string at dstrview(dest) + offset without copying it.  Note
+   that this means dstrlen(dest) is only the length of the first field.
+
+   Quotes, delimiters and newlines are found 64 bytes at a time with bit
+   masks, and a record is copied out of the reader's buffer in as few
+   pieces as possible.  Quotes are not otherwise checked for errors: a
+   quote in the middle of a field starts or ends a quoted section just the
+   same.
+
+   If the record has more than max fields, only the first max are stored,
+   but all of them are counted.  If EOF is encountered before any data can
+   be read, 0 is returned and dstrerrno will be set to DSTR_EOF.  If the
+   stream ends inside a quoted field, the record is returned as far as it
+   goes, but dstrerrno will also be set to DSTR_EOF rather than
+   DSTR_SUCCESS, since the record was probably cut short.
+
+   Found in reader.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (where the record is stored)
+      dstrreader_t (our input stream)
+      char (the delimiter; not '"', '\r', '\n' or '\0')
+      dstrfield_t * (array to store the fields in; may be NULL if max is 0)
+      size_t (number of elements in the array)
+
+   Output:
+      number of fields in the record (0 on EOF or error - check dstrerrno)
+
+   ************************************************************************* */
+size_t dstrrreadcsv(dstring_t dest, dstrreader_t r, char delim,
+   dstrfield_t *fields, size_t max);
+
+
+/************************\
+ * conversion functions *
+\************************/
+
+
+/* **** dstrtocstr **********************************************************
+
+   This function copies the string stored in a dstring_t buffer into an
+   ordinary character array, up to one less than size characters (the last
+   space being reserved for \0).
+
+   If size is 0, an empty string (just a single '\0') will be created and
+   DSTR_SUCCESS will be returned.
+
+   dstrerrno will be set to indicate success or failure, matching the return
+   value.
+
+   If dest is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+
+   Found in convert.c
+
+   *************************************************************************
+
+   Input:
+      char * (destination string)
+      const dstring_t (source string)
+      size_t (number of characters to copy minus one)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrtocstr(char *dest, const dstring_t src, size_t size);
+
+
+/* **** cstrtodstr **********************************************************
+
+   This function copies the string stored in an ordinary character array into
+   the buffer of a dstring_t object.
+
+   The source string overwrites any previous data stored in the dstring_t
+   buffer.
+
+   dstrerrno will be set to indicate success or failure, matching the return
+   value.
+
+   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+
+   Found in convert.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination string)
+      const char * (source string)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int cstrtodstr(dstring_t dest, const char *src);
+
+
+/* **** dstrtoi64 **********************************************************
+
+   Parses a decimal integer starting at str[index], with an optional sign,
+   and stores it in *value.  Parsing stops at the first character that
+   isn't a digit, which doesn't have to be the end of the string, so a
+   field can be parsed straight out of the middle of a line.  Leading
+   whitespace isn't skipped, nothing depends on the locale, and digits are
+   read 8 at a time where possible.
+
+   If there's no number at index, 0 is returned, *value is set to 0 and
+   dstrerrno is set to DSTR_INVALID_ARGUMENT.  If the number doesn't fit,
+   it's consumed anyway, *value is set to INT64_MIN or INT64_MAX and
+   dstrerrno is set to DSTR_OUT_OF_RANGE.  The index is only checked
+   against the size of the buffer (measuring the string would cost more
+   than parsing the number), so it must not be past the end of the string.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in number.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to parse)
+      size_t (where the number begins)
+      int64_t * (where to store the result)
+
+   Output:
+      number of characters consumed
+
+   ************************************************************************* */
+size_t dstrtoi64(const dstring_t str, size_t index, int64_t *value);
+
+
+/* **** dstrtou64 **********************************************************
+
+   Just like dstrtoi64(), except that the result is unsigned, and a minus
+   sign isn't accepted.  On overflow, *value is set to UINT64_MAX.
+
+   Found in number.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to parse)
+      size_t (where the number begins)
+      uint64_t * (where to store the result)
+
+   Output:
+      number of characters consumed
+
+   ************************************************************************* */
+size_t dstrtou64(const dstring_t str, size_t index, uint64_t *value);
+
+
+/* **** dstrtod ************************************************************
+
+   Parses a decimal floating point number starting at str[index], like
+   strtod() in the C locale: an optional sign, digits with an optional
+   decimal point and an optional exponent, or inf, infinity or nan in any
+   case.  Hexadecimal floats aren't accepted.  The result is always the
+   correctly rounded double, and usually only takes a multiplication or
+   two to find.
+
+   Errors are reported as with dstrtoi64().  If the number is too large for
+   a double, *value is set to HUGE_VAL (or -HUGE_VAL) and dstrerrno is set
+   to DSTR_OUT_OF_RANGE; numbers too small to be represented become 0 or a
+   subnormal, just like any other rounding.
+
+   Found in number.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to parse)
+      size_t (where the number begins)
+      double * (where to store the result)
+
+   Output:
+      number of characters consumed
+
+   ************************************************************************* */
+size_t dstrtod(const dstring_t str, size_t index, double *value);
+
+
+/**************************\
+ * C Library Replacements *
+\**************************/
+
+
+/* **** dstrlen ************************************************************
+
+   This function takes as an argument a dstring_t object and returns the
+   length of the string.  This is the dstring_t equivalent of strlen in the
+   standard library.
+
+   dstrerrno will be set to indicate success or type of error.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (our dstring_t object)
+
+   Output:
+      The length of the string
+      (BE CAREFUL! A size of 0 is an ambiguous case; since size_t is
+       unsigned, we can't return a status code.  Thus, 0 could indicate a
+       size of 0 OR the fact that the dstring_t object is uninitialized - 
+       on a return of 0, checking dstrerrno is a good idea ;)
+
+   ************************************************************************* */
+size_t dstrlen(const dstring_t str);
+
+
+/* **** dstrcat ************************************************************
+
+   This function emulates the behavior of the C standard library function
+   strcat() by appending one dstring_t object to another.
+
+   dstrcat() is safe, unlike strcat(), because the destination buffer will
+   grow to accomodate the required size.
+
+   dstrerrno will be set to indicate success or the type of error.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstring_t (source)
+
+   Output:
+      number of characters concatenated to src
+
+   ************************************************************************* */
+int dstrcat(dstring_t dest, const dstring_t src);
+
+
+/* **** dstrncat ***********************************************************
+
+   This function emulates the behavior of the C standard library function
+   strncat() by appending one dstring_t object to another, up to n chars.
+
+   dstrerrno will be set to indicate success or the type of error.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstring_t (source)
+      size_t (number of characters to concatenate in source)
+
+   Output:
+      number of characters appended to dest (could be less than n if src has
+      less than n characters)
+
+   ************************************************************************* */
+int dstrncat(dstring_t dest, const dstring_t src, size_t n);
+
+
+/* **** dstrcatcs **********************************************************
+
+   This function emulates the behavior of the C standard library function
+   strcat() by appending an ordinary C string to a dstring_t object.
+
+   dstrerrno will be set to indicate success or the type of error.
+
+   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (source)
+
+   Output:
+      number of characters successfully appended to dest
+
+   ************************************************************************* */
+int dstrcatcs(dstring_t dest, const char *src);
+
+
+/* **** dstrncatcs *********************************************************
+
+   This function emulates the behavior of the C standard library function
+   strncat() by appending a C string to a dstring_t object, up to n chars.
+
+   dstrerrno will be set to indicate success or the type of error.
+
+   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (source)
+      size_t (number of characters to concatenate in source)
+
+   Output:
+      number of characters successfully appended to dest (up to one less
+      than n)
+
+   ************************************************************************* */
+int dstrncatcs(dstring_t dest, const char *src, size_t n);
+
+
+/* **** dstrcpy ************************************************************
+
+   This function emulates the behavior of the C standard library function
+   strcpy() by copying the contents of one initialized dstring_t object to
+   another.  Both dstring_t objects must be initialized.
+
+   Unlike strcpy(), dstrcpy() is safe, because the destination buffer will
+   grow to accomodate the required size.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstring_t (source)
+
+   Output:
+      number of characters copied to dest
+
+   ************************************************************************* */
+int dstrcpy(dstring_t dest, const dstring_t src);
+
+
+/* **** dstrncpy ************************************************************
+
+   This function emulates the behavior of the C standard library function
+   strncpy() by copying the contents of one initialized dstring_t object to
+   another, up to n characters.  Both dstring_t objects must be initialized.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in cstdlib.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstring_t (source)
+      size_t (number of characters to copy)
+
+   Output:
+      number of characters successfully copied to dest
+
+   ************************************************************************* */
+int dstrncpy(dstring_t dest, const dstring_t src, size_t n);
+
+
+/* **** dstrsprintf ********************************************************
+
+   An implementation of sprintf() that supports writing to dstring_t
+   objects.  This function supports every aspect of the standard library
+   function it aims to replace, and like its counterpart, returns the
+   number of characters written to the dstring_t object on success, or
+   a negative value on error (in the case of an error, the return value
+   will match the value of dstrerrno.)
+
+   In addition to the standard conversions, %S prints a dstring_t, and %r
+   prints a double using the fewest digits that will read back as exactly
+   the same value (choosing between %f and %e style like %g does.)
+   Floating point output is correctly rounded, with ties rounded to even.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string)
+      possible variable list of arguments
+
+   Output:
+      number of characters successfully copied to dest or a status code
+      on error
+
+   ************************************************************************* */
+int dstrsprintf(dstring_t str, const char *format, ...);
+
+
+/* **** dstrvsprintf *******************************************************
+
+   An implementation of vsprintf() that supports writing to dstring_t
+   objects.  This function supports every aspect of the standard library
+   function it aims to replace, and like its counterpart, returns the
+   number of characters written to the dstring_t object on success, or
+   a negative value on error (in the case of an error, the return value
+   will match the value of dstrerrno.)
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string)
+      va_list containing possible additional arguments
+
+   Output:
+      number of characters successfully copied to dest or a status code
+      on error
+
+   ************************************************************************* */
+int dstrvsprintf(dstring_t str, const char *format, va_list args);
+
+
+/* **** dstrcatprintf ******************************************************
+
+   Works like dstrsprintf(), except that the formatted output is appended
+   to whatever is already in str instead of replacing it.  This makes it
+   possible to build a message out of several formatted pieces without a
+   temporary dstring_t.  If an error occurs, str is left as it was.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string)
+      possible variable list of arguments
+
+   Output:
+      number of characters appended to dest or a negative value on error
+
+   ************************************************************************* */
+int dstrcatprintf(dstring_t str, const char *format, ...);
+
+
+/* **** dstrvcatprintf *****************************************************
+
+   The va_list version of dstrcatprintf().
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string)
+      va_list containing possible additional arguments
+
+   Output:
+      number of characters appended to dest or a negative value on error
+
+   ************************************************************************* */
+int dstrvcatprintf(dstring_t str, const char *format, va_list args);
+
+
+/* **** dstrcatint *********************************************************
+
+   Appends the decimal representation of a signed integer to a dstring_t
+   object.  This is equivalent to appending the output of "%ld", but
+   without parsing a format string or making a temporary copy.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      long int (the integer to append)
+
+   Output:
+      number of characters appended to dest
+
+   ************************************************************************* */
+int dstrcatint(dstring_t dest, long int value);
+
+
+/* **** dstrcatuint ********************************************************
+
+   Same as dstrcatint(), but for unsigned integers ("%lu").
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      unsigned long int (the integer to append)
+
+   Output:
+      number of characters appended to dest
+
+   ************************************************************************* */
+int dstrcatuint(dstring_t dest, unsigned long int value);
+
+
+/*********************************\
+ * precompiled format functions *
+\*********************************/
+
+
+/* dstrfmt_t is also a "black-box" type, holding a format string that has
+   already been parsed */
+typedef void * dstrfmt_t;
+
+
+/* **** dstrfmtcompile *****************************************************
+
+   This function parses a printf-style format string once and stores the
+   result in a dstrfmt_t object, which can then be used any number of times
+   with dstrfmtprintf() without the format being parsed again.  The format
+   string is copied, so it doesn't have to outlive the object.
+
+   dstrfmt_t variables should be set to NULL when declared, just like
+   dstring_t variables.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstrfmt_t * (points to the object to be initialized)
+      const char * (format string)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrfmtcompile(dstrfmt_t *fmtptr, const char *format);
+
+
+/* **** dstrfmtfree ********************************************************
+
+   This function frees all memory allocated to a dstrfmt_t object and sets
+   the variable to NULL.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstrfmt_t * (points to the object to be freed)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrfmtfree(dstrfmt_t *fmtptr);
+
+
+/* **** dstrfmtprintf ******************************************************
+
+   Works exactly like dstrsprintf(), except that the format comes from a
+   dstrfmt_t object compiled by dstrfmtcompile().
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstrfmt_t (compiled format)
+      possible variable list of arguments
+
+   Output:
+      number of characters successfully copied to dest or a negative value
+      on error
+
+   ************************************************************************* */
+int dstrfmtprintf(dstring_t str, const dstrfmt_t fmt, ...);
+
+
+/* **** dstrvfmtprintf *****************************************************
+
+   Works exactly like dstrvsprintf(), except that the format comes from a
+   dstrfmt_t object compiled by dstrfmtcompile().
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const dstrfmt_t (compiled format)
+      va_list containing possible additional arguments
+
+   Output:
+      number of characters successfully copied to dest or a negative value
+      on error
+
+   ************************************************************************* */
+int dstrvfmtprintf(dstring_t str, const dstrfmt_t fmt, va_list args);
+
+
+/* **** dstrcsprintf *******************************************************
+
+   Works exactly like dstrsprintf(), except that the format is compiled the
+   first time it's seen, and the compiled version is kept in an internal
+   cache keyed by the format's address.  Later calls with the same format
+   skip parsing altogether.
+
+   Because the cache only looks at the pointer, this should only be used
+   with format strings that never change, such as string literals.  If the
+   cache is full, the format is simply parsed as it would be by
+   dstrsprintf().  The cache is safe to use from multiple threads when the
+   library is built with --enable-pthreads.
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string, which must never change)
+      possible variable list of arguments
+
+   Output:
+      number of characters successfully copied to dest or a negative value
+      on error
+
+   ************************************************************************* */
+int dstrcsprintf(dstring_t str, const char *format, ...);
+
+
+/* **** dstrvcsprintf ******************************************************
+
+   The va_list version of dstrcsprintf().
+
+   dstrerrno will be set to indicate status or the type of error.
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (destination)
+      const char * (format string, which must never change)
+      va_list containing possible additional arguments
+
+   Output:
+      number of characters successfully copied to dest or a negative value
+      on error
+
+   ************************************************************************* */
+int dstrvcsprintf(dstring_t str, const char *format, va_list args);
+
+
+/* **** dstrfmtcacheclear **************************************************
+
+   Frees every format in the cache used by dstrcsprintf().  This must not
+   be called while another thread might be using dstrcsprintf().
+
+   Found in fmt.c
+
+   *************************************************************************
+
+   Input:
+      (none)
+
+   Output:
+      (none)
+
+   ************************************************************************* */
+void dstrfmtcacheclear(void);
+
+
+/***********************\
+ * splitting functions *
+\***********************/
+
+
+/* **** dstrsplit **********************************************************
+
+   Splits str into fields separated by any of the characters in delims,
+   storing the offset and length of each field in the caller's array, so
+   that nothing is copied or allocated.  The fields can be read through
+   dstrview(str) + offset.  Adjacent delimiters make an empty field, as do
+   delimiters at the beginning or end, and an empty string is one empty
+   field.
+
+   If there are more than max fields, the last one stored holds the rest of
+   the string, delimiters and all.  Sets of up to 4 delimiters are searched
+   for 16 bytes at a time; larger sets are searched for one byte at a time.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in split.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to split)
+      const char * (delimiters)
+      dstrfield_t * (array to store the fields in)
+      size_t (number of elements in the array)
+
+   Output:
+      number of fields stored
+
+   ************************************************************************* */
+size_t dstrsplit(const dstring_t str, const char *delims, dstrfield_t *fields,
+   size_t max);
+
+
+/* where a dstrsplitnext() loop is, and its delimiters, ready to be searched
+   for (like dstrfield_t, this isn't a "black-box" type, so that it can be
+   declared without allocating anything; only index is meant to be used) */
+typedef struct {
+   size_t index;                        /* where the next field begins */
+   const char *delims;
+   size_t ndelims;
+   unsigned char table[256];            /* which bytes are delimiters, if
+                                           there are too many to compare
+                                           one at a time */
+} dstrsplit_t;
+
+
+/* **** dstrsplitbegin *****************************************************
+
+   Gets a dstrsplit_t ready for a dstrsplitnext() loop over fields
+   separated by any of the characters in delims, starting at the beginning
+   of the string.  The work of preparing the delimiters is done here, once,
+   rather than for every field.  delims isn't copied, so it must not change
+   or be freed while the dstrsplit_t is in use.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in split.c
+
+   *************************************************************************
+
+   Input:
+      dstrsplit_t * (the state to initialize)
+      const char * (delimiters)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrsplitbegin(dstrsplit_t *split, const char *delims);
+
+
+/* **** dstrsplitnext ******************************************************
+
+   Finds one field at a time, for when there's no telling how many there
+   will be.  Call dstrsplitbegin() first; each call stores the next field
+   in *field, advances split->index past it and returns 1.  Once the last
+   field has been returned, it returns 0 and sets dstrerrno to DSTR_EOF.
+   Fields are found exactly as by dstrsplit().  To start over (or to skip
+   ahead), set split->index to the offset of a field.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in split.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to split)
+      dstrsplit_t * (from dstrsplitbegin())
+      dstrfield_t * (where to store the field)
+
+   Output:
+      1 if a field was found, 0 if not
+
+   ************************************************************************* */
+int dstrsplitnext(const dstring_t str, dstrsplit_t *split,
+   dstrfield_t *field);
+
+
+/**************************\
+ * base64 and hex functions *
+\**************************/
+
+
+/* flags for dstrcatbase64(), dstrcatunbase64() and dstrcathex() */
+enum DSTR_ENCODING {
+
+   /* use '-' and '_' instead of '+' and '/' (RFC 4648's base64url) */
+   DSTR_BASE64_URL = 1,
+
+   /* don't pad the output to a multiple of 4 characters with '=' */
+   DSTR_BASE64_NOPAD = 2,
+
+   /* write hex digits above 9 as A-F instead of a-f */
+   DSTR_HEX_UPPER = 4
+};
+
+
+/* **** dstrcatbase64 ******************************************************
+
+   Appends len bytes of src to dest, encoded as base64.  The output is
+   measured first, so dest is grown (at most) once.  flags may combine
+   DSTR_BASE64_URL and DSTR_BASE64_NOPAD (see enum above); 0 gives standard,
+   padded base64.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in encode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const void * (data to encode)
+      size_t (number of bytes)
+      int (flags)
+
+   Output:
+      number of characters appended
+
+   ************************************************************************* */
+size_t dstrcatbase64(dstring_t dest, const void *src, size_t len, int flags);
+
+
+/* **** dstrcatunbase64 ****************************************************
+
+   Decodes len characters of base64 and appends the bytes to dest.  Padding
+   is optional, but must be correct if it's there; whitespace and any other
+   characters outside the alphabet make the whole input invalid, as does a
+   last character with bits set beyond the last whole byte ("QR==" rather
+   than "QQ=="), in which case dest is left untouched and dstrerrno is set
+   to DSTR_INVALID_ARGUMENT.  Only the alphabet selected by DSTR_BASE64_URL in
+   flags is accepted.
+
+   The decoded data may contain '\0' bytes, so use the return value
+   instead of dstrlen() to find out how much was appended.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in encode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const char * (base64 to decode)
+      size_t (number of characters)
+      int (flags)
+
+   Output:
+      number of bytes appended
+
+   ************************************************************************* */
+size_t dstrcatunbase64(dstring_t dest, const char *src, size_t len,
+   int flags);
+
+
+/* **** dstrcathex *********************************************************
+
+   Appends len bytes of src to dest as pairs of hex digits, lowercase
+   unless flags includes DSTR_HEX_UPPER.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in encode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const void * (data to encode)
+      size_t (number of bytes)
+      int (flags)
+
+   Output:
+      number of characters appended
+
+   ************************************************************************* */
+size_t dstrcathex(dstring_t dest, const void *src, size_t len, int flags);
+
+
+/* **** dstrcatunhex *******************************************************
+
+   Decodes len hex digits (in either case) and appends the bytes to dest.
+   An odd number of digits or anything that isn't a hex digit makes the
+   input invalid, in which case dest is left untouched and dstrerrno is set
+   to DSTR_INVALID_ARGUMENT.  As with dstrcatunbase64(), the result may
+   contain '\0' bytes.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in encode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const char * (hex digits to decode)
+      size_t (number of characters)
+
+   Output:
+      number of bytes appended
+
+   ************************************************************************* */
+size_t dstrcatunhex(dstring_t dest, const char *src, size_t len);
+
+
+/*****************\
+ * URL functions *
+\*****************/
+
+
+/* flags for dstrcaturlencode(), dstrurldecode() and dstrurldecodefield() */
+enum DSTR_URL {
+
+   /* application/x-www-form-urlencoded: ' ' is written as '+', and '+'
+      decodes to ' ' */
+   DSTR_URL_FORM = 1,
+
+   /* leave '/' alone when encoding, for paths */
+   DSTR_URL_PATH = 2
+};
+
+
+/* **** dstrcaturlencode ***************************************************
+
+   Appends src to dest with every character other than letters, digits
+   and "-._~" written as %XX, so that it can be used as part of a URL (for
+   instance, a query string parameter).  The output is measured in a first
+   pass, so dest is grown (at most) once.  flags may combine DSTR_URL_FORM
+   and DSTR_URL_PATH (see enum above).
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in url.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const char * (text to encode)
+      int (flags)
+
+   Output:
+      number of characters appended
+
+   ************************************************************************* */
+size_t dstrcaturlencode(dstring_t dest, const char *src, int flags);
+
+
+/* **** dstrurldecode ******************************************************
+
+   Decodes every %XX in str in place (and every '+', if flags includes
+   DSTR_URL_FORM).  The decoded string is never longer than the original,
+   so no memory is allocated.  A '%' that isn't followed by two hex digits
+   is left as it is, and so is %00, since a dstring_t can't contain '\0'.
+
+   dstrerrno will be set to indicate success or failure.
+
+   Found in url.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to decode)
+      int (flags)
+
+   Output:
+      length of the decoded string
+
+   ************************************************************************* */
+size_t dstrurldecode(dstring_t str, int flags);
+
+
+/* **** dstrurldecodefield *************************************************
+
+   Like dstrurldecode(), but decodes only the characters described by
+   field (as found by dstrquerynext() or dstrsplit()), and sets its length
+   to the decoded length.  Whatever follows the field in str is not moved,
+   so fields after it stay valid.
+
+   dstrerrno will be set to indicate success or failure.
+
+   Found in url.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string containing the field)
+      dstrfield_t * (field to decode)
+      int (flags)
+
+   Output:
+      length of the decoded field
+
+   ************************************************************************* */
+size_t dstrurldecodefield(dstring_t str, dstrfield_t *field, int flags);
+
+
+/* **** dstrquerynext ******************************************************
+
+   Finds one parameter of a query string at a time, without copying or
+   decoding anything.  Set *index to the beginning of the query string
+   (just after the '?' in a whole URL) before the first call; each call
+   stores the next parameter's name in *key and its value in *value,
+   advances *index past it and returns 1.  Parameters are separated by
+   '&', the query string ends at a '#' or the end of str, empty parameters
+   are skipped, and a parameter without an '=' has an empty value.  Once
+   the last parameter has been returned, it returns 0 and sets dstrerrno to
+   DSTR_EOF.
+
+   Keys and values can be decoded in place afterwards with
+   dstrurldecodefield() and DSTR_URL_FORM.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in url.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string containing the query)
+      size_t * (index of the next parameter)
+      dstrfield_t * (where to store the name)
+      dstrfield_t * (where to store the value)
+
+   Output:
+      1 if a parameter was found, 0 if not
+
+   ************************************************************************* */
+int dstrquerynext(const dstring_t str, size_t *index, dstrfield_t *key,
+   dstrfield_t *value);
+
+
+/*******************\
+ * UTF-8 functions *
+\*******************/
+
+
+/* **** dstrisutf8 *********************************************************
+
+   Returns 1 if str is well-formed UTF-8 (RFC 3629: no overlong forms, no
+   surrogates and nothing beyond U+10FFFF) and 0 if it isn't.  The string
+   is checked 16 bytes at a time, and the answer is remembered, so asking
+   again about a string that hasn't changed costs nothing.  Every function
+   in the library that changes a string forgets what it remembered.
+
+   dstrerrno will be set to indicate success or failure.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to check)
+
+   Output:
+      1 if str is UTF-8, 0 if not
+
+   ************************************************************************* */
+int dstrisutf8(const dstring_t str);
+
+
+/* **** dstrutf8len ********************************************************
+
+   Returns the number of code points (rather than bytes) in str.  This is
+   worked out along with dstrisutf8(), and remembered in the same way.  If
+   str isn't UTF-8, 0 is returned and dstrerrno is set to
+   DSTR_INVALID_UTF8.
+
+   dstrerrno will be set to indicate success or failure.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t (string to count)
+
+   Output:
+      number of code points in str
+
+   ************************************************************************* */
+size_t dstrutf8len(const dstring_t str);
+
+
+/* **** dstrcpoffset *******************************************************
+
+   Returns the byte offset at which code point n (counting from 0) begins
+   in str, or the length of str if n is the number of code points in it.
+   The first time this (or any function below) is called on a string of
+   more than a few dozen code points, an index of where every 64th code
+   point begins is built, so that finding any of them afterwards means
+   stepping over 63 at most.  Like dstrisutf8()'s answer, the index is
+   remembered until the string changes.
+
+   Since 0 is a valid offset, dstrerrno must be checked for errors.  If
+   str isn't UTF-8, dstrerrno is set to DSTR_INVALID_UTF8.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t
+      size_t (index of the code point)
+
+   Output:
+      byte offset of the code point
+
+   ************************************************************************* */
+size_t dstrcpoffset(const dstring_t str, size_t n);
+
+
+/* **** dstrgetcp **********************************************************
+
+   Returns code point n (counting from 0) of str, like dstrgetc() does for
+   bytes.  As with dstrgetc(), the index of the '\0' is out of bounds.
+
+   dstrerrno will be set to indicate success or type of error.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t
+      size_t (index of the code point)
+
+   Output:
+      >= 0: a code point
+        -1: an error occurred (dstrerrno will be set)
+
+   ************************************************************************* */
+long dstrgetcp(const dstring_t str, size_t n);
+
+
+/* **** dstrinsertcp *******************************************************
+
+   Inserts code point cp, encoded as UTF-8, before code point n of dest
+   (or at the end, if n is the number of code points in dest), like
+   dstrinsertc() does for bytes.  cp must be a Unicode scalar value other
+   than 0 (that is, not a surrogate and no more than U+10FFFF).
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t
+      size_t (index of the code point to insert before)
+      long (code point to insert)
+
+   Output:
+      a status code (see enum above)
+
+   ************************************************************************* */
+int dstrinsertcp(dstring_t dest, size_t n, long cp);
+
+
+/* **** dstrdelcp **********************************************************
+
+   Deletes code point n (counting from 0) of str, like dstrdel() does for
+   bytes, and returns it.
+
+   dstrerrno will be set to indicate success or type of error.
+
+   Found in utf8.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t
+      size_t (index of the code point)
+
+   Output:
+      >= 0: the code point that was deleted
+        -1: an error occurred (dstrerrno will be set)
+
+   ************************************************************************* */
+long dstrdelcp(dstring_t str, size_t n);
+
+
+/* **** dstrutf8toupper ****************************************************
+
+   Converts every code point in str that has a simple uppercase mapping in
+   Unicode (one code point to one code point, so U+00DF, sharp s, stays as
+   it is) to uppercase.  Runs of ASCII are converted 16 bytes at a time,
+   and everything else is looked up in a pair of small tables.  A few
+   mappings change the length of a code point's UTF-8 (U+0131, dotless i,
+   becomes 'I', for instance), so the new length is worked out first and
+   str is grown at most once.  If str isn't UTF-8, it's left alone and
+   DSTR_INVALID_UTF8 is returned.
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in case.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t
+
+   Output:
+      a status code (see enum above)
+
+   ************************************************************************* */
+int dstrutf8toupper(dstring_t str);
+
+
+/* **** dstrutf8tolower ****************************************************
+
+   Like dstrutf8toupper(), but converts to lowercase.
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in case.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t
+
+   Output:
+      a status code (see enum above)
+
+   ************************************************************************* */
+int dstrutf8tolower(dstring_t str);
+
+
+/**************************************************\
+ * UTF-16, UTF-32 and Latin-1 conversion functions *
+\**************************************************/
+
+
+/* flags for dstrcatutf16(), dstrcatutf32(), dstrtoutf16(), dstrtoutf32()
+   and dstrtolatin1() */
+enum DSTR_TRANSCODING {
+
+   /* UTF-16 and UTF-32 are big-endian (the default is little-endian) */
+   DSTR_UTF_BE = 1,
+
+   /* when reading, a byte order mark at the start is skipped and decides
+      the byte order (flags only matter if there isn't one); when writing,
+      the output starts with one */
+   DSTR_UTF_BOM = 2,
+
+   /* write U+FFFD for unpaired surrogates and anything else that isn't a
+      code point, or '?' for code points that Latin-1 doesn't have, instead
+      of failing */
+   DSTR_UTF_REPLACE = 4
+};
+
+
+/* **** dstrcatutf16 *******************************************************
+
+   Appends len bytes of UTF-16 to dest as UTF-8.  The input stops early at
+   a 0 code unit, so a terminated string can be passed with its buffer's
+   size.  It's measured first, 8 code units at a time, so dest is grown
+   (at most) once, and runs of ASCII are then converted 8 code units at a
+   time.  flags may combine DSTR_UTF_BE, DSTR_UTF_BOM and DSTR_UTF_REPLACE
+   (see enum above).
+
+   An odd number of bytes, or an unpaired surrogate without
+   DSTR_UTF_REPLACE, makes the input invalid, in which case dest is left
+   untouched and dstrerrno is set to DSTR_INVALID_ARGUMENT.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const void * (UTF-16 to convert)
+      size_t (number of bytes)
+      int (flags)
+
+   Output:
+      number of bytes appended
+
+   ************************************************************************* */
+size_t dstrcatutf16(dstring_t dest, const void *src, size_t len, int flags);
+
+
+/* **** dstrcatutf32 *******************************************************
+
+   Like dstrcatutf16(), but for UTF-32.  len must be a multiple of 4, and
+   surrogates and anything beyond U+10FFFF are invalid unless flags
+   includes DSTR_UTF_REPLACE.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const void * (UTF-32 to convert)
+      size_t (number of bytes)
+      int (flags)
+
+   Output:
+      number of bytes appended
+
+   ************************************************************************* */
+size_t dstrcatutf32(dstring_t dest, const void *src, size_t len, int flags);
+
+
+/* **** dstrcatlatin1 ******************************************************
+
+   Appends len bytes of Latin-1 (ISO 8859-1) to dest as UTF-8, stopping
+   early at a '\0'.  Every byte is a valid character, so this only fails
+   if dest can't be grown.  Note that Windows-1252, which is often labeled
+   Latin-1, has other characters in 0x80-0x9f; those bytes become the C1
+   control characters U+0080-U+009F here.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      const char * (Latin-1 to convert)
+      size_t (number of bytes)
+
+   Output:
+      number of bytes appended
+
+   ************************************************************************* */
+size_t dstrcatlatin1(dstring_t dest, const char *src, size_t len);
+
+
+/* **** dstrtoutf16 ********************************************************
+
+   Writes src, which must be UTF-8, to dest as UTF-16, with no terminator.
+   The size of the result is worked out first, from the number of code
+   points that dstrisutf8() remembers and the number of 4 byte sequences
+   (16 bytes at a time), and returned whether or not it fits; if dest is
+   NULL, nothing else is done, so that a buffer of the right size can be
+   allocated.  If the result is larger than size, nothing is written and
+   dstrerrno is set to DSTR_INVALID_BUFLEN.  flags may combine DSTR_UTF_BE
+   and DSTR_UTF_BOM.
+
+   If src isn't UTF-8, 0 is returned and dstrerrno is set to
+   DSTR_INVALID_UTF8.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      void * (where to write the UTF-16, or NULL)
+      const dstring_t (string to convert)
+      size_t (size of dest in bytes)
+      int (flags)
+
+   Output:
+      size of the result in bytes
+
+   ************************************************************************* */
+size_t dstrtoutf16(void *dest, const dstring_t src, size_t size, int flags);
+
+
+/* **** dstrtoutf32 ********************************************************
+
+   Like dstrtoutf16(), but writes UTF-32, which takes exactly 4 bytes per
+   code point.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      void * (where to write the UTF-32, or NULL)
+      const dstring_t (string to convert)
+      size_t (size of dest in bytes)
+      int (flags)
+
+   Output:
+      size of the result in bytes
+
+   ************************************************************************* */
+size_t dstrtoutf32(void *dest, const dstring_t src, size_t size, int flags);
+
+
+/* **** dstrtolatin1 *******************************************************
+
+   Like dstrtoutf16(), but writes Latin-1, one byte per code point.  If src
+   has code points beyond U+00FF, 0 is returned and dstrerrno is set to
+   DSTR_OUT_OF_RANGE, unless flags includes DSTR_UTF_REPLACE, in which
+   case they're written as '?'.  No '\0' is added; the return value is the
+   length of the result.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in transcode.c
+
+   *************************************************************************
+
+   Input:
+      char * (where to write the Latin-1, or NULL)
+      const dstring_t (string to convert)
+      size_t (size of dest)
+      int (flags)
+
+   Output:
+      length of the result
+
+   ************************************************************************* */
+size_t dstrtolatin1(char *dest, const dstring_t src, size_t size, int flags);
+
+
+/******************\
+ * Hash functions *
+\******************/
+
+
+/* **** dstrhash ***********************************************************
+
+   Returns a 64-bit hash of str for use in hash tables.  The hash is
+   wyhash, which takes one multiply for strings of up to 16 bytes and
+   three independent ones for every 48 bytes after that.  It isn't
+   cryptographic, but if seed is random and kept secret, nobody can choose
+   keys that collide.  Hashes depend on the machine's byte order, so don't
+   store them or send them elsewhere.
+
+   The hash is remembered along with seed, so hashing str again with the
+   same seed costs nothing until str is changed by a dstring function.
+   (Writing to the buffer through a pointer from dstrview() isn't allowed,
+   and wouldn't be noticed.)  A pool's string (see dstrintern()) only
+   remembers the hash it was interned with, since it may be shared between
+   threads.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in hash.c
+
+   *************************************************************************
+
+   Input:
+      const dstring_t
+      uint64_t (seed)
+
+   Output:
+      the hash, or 0 on error
+
+   ************************************************************************* */
+uint64_t dstrhash(const dstring_t str, uint64_t seed);
+
+
+/* **** dstrhashcs *********************************************************
+
+   Returns the same hash as dstrhash() would for a dstring_t holding src,
+   so that a table of dstring_t keys can be searched with a C string.
+   Nothing is remembered.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in hash.c
+
+   *************************************************************************
+
+   Input:
+      const char * (string to hash)
+      uint64_t (seed)
+
+   Output:
+      the hash, or 0 on error
+
+   ************************************************************************* */
+uint64_t dstrhashcs(const char *src, uint64_t seed);
+
+
+/* **** dstrnhashcs ********************************************************
+
+   Like dstrhashcs(), but hashes exactly n bytes of src, which don't have to
+   be terminated (a field found by dstrsplit(), for instance).
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in hash.c
+
+   *************************************************************************
+
+   Input:
+      const char * (bytes to hash)
+      size_t (number of bytes)
+      uint64_t (seed)
+
+   Output:
+      the hash, or 0 on error
+
+   ************************************************************************* */
+uint64_t dstrnhashcs(const char *src, size_t n, uint64_t seed);
+
+
+/*****************\
+ * Map functions *
+\*****************/
+
+
+/* dstrmap_t is also a "black-box" type: a hash map from strings to
+   pointers */
+typedef void * dstrmap_t;
+
+
+/* **** dstrmapalloc *******************************************************
+
+   This function initializes a variable of type dstrmap_t, with room for
+   capacity keys before it has to grow (0 is fine; it grows as needed).
+
+   The map is a "Swiss table": keys are kept in one flat array (open
+   addressing), alongside an array of one byte per slot holding 7 bits of
+   the key's hash.  A lookup compares 16 of those bytes at a time with SSE2
+   and only looks at the slots that match, so it almost never touches more
+   than one key, and it never allocates anything.  Keys shorter than 16
+   bytes are stored in the slot itself; longer ones are copied once, when
+   they're added.  Each map hashes with its own random seed (see
+   dstrhash()).
+
+   dstrmap_t variables should be set to NULL when declared, just like
+   dstring_t variables.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t * (points to the object to be initialized)
+      size_t (number of keys to make room for)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrmapalloc(dstrmap_t *mapptr, size_t capacity);
+
+
+/* **** dstrmapfree ********************************************************
+
+   Frees a map (and its copies of the keys) and sets it to NULL.  The values
+   are the caller's, and aren't touched; free them first if they need it
+   (see dstrmapnext()).
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t * (points to the object to be freed)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrmapfree(dstrmap_t *mapptr);
+
+
+/* **** dstrmapsize ********************************************************
+
+   Returns the number of keys in map.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrmap_t
+
+   Output:
+      number of keys
+
+   ************************************************************************* */
+size_t dstrmapsize(const dstrmap_t map);
+
+
+/* **** dstrmapset *********************************************************
+
+   Maps key to value, replacing whatever value key had before.  The map
+   keeps its own copy of key, so key can be changed or freed afterwards.
+   key's hash is remembered in key (see dstrhash()), so using the same
+   dstring_t again for another lookup doesn't hash it again.
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t
+      const dstring_t (key)
+      void * (value)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrmapset(dstrmap_t map, const dstring_t key, void *value);
+
+
+/* **** dstrmapnset ********************************************************
+
+   Like dstrmapset(), but the key is n bytes at key, which don't have to be
+   terminated and may include '\0'.  A dstring_t and n bytes of a C string
+   with the same contents are the same key.
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t
+      const char * (key)
+      size_t (length of key)
+      void * (value)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrmapnset(dstrmap_t map, const char *key, size_t n, void *value);
+
+
+/* **** dstrmapget *********************************************************
+
+   Looks up key.  If it's there, its value is stored in *value (unless
+   value is NULL) and 1 is returned; if not, 0 is returned.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrmap_t
+      const dstring_t (key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was found, 0 if not
+
+   ************************************************************************* */
+int dstrmapget(const dstrmap_t map, const dstring_t key, void **value);
+
+
+/* **** dstrmapnget ********************************************************
+
+   Like dstrmapget(), but the key is n bytes at key, as in dstrmapnset().
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrmap_t
+      const char * (key)
+      size_t (length of key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was found, 0 if not
+
+   ************************************************************************* */
+int dstrmapnget(const dstrmap_t map, const char *key, size_t n,
+   void **value);
+
+
+/* **** dstrmapdel *********************************************************
+
+   Removes key from map.  If it was there, its value is stored in *value
+   (unless value is NULL), so that it can be freed, and 1 is returned; if
+   not, 0 is returned.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t
+      const dstring_t (key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was removed, 0 if it wasn't there
+
+   ************************************************************************* */
+int dstrmapdel(dstrmap_t map, const dstring_t key, void **value);
+
+
+/* **** dstrmapndel ********************************************************
+
+   Like dstrmapdel(), but the key is n bytes at key, as in dstrmapnset().
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrmap_t
+      const char * (key)
+      size_t (length of key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was removed, 0 if it wasn't there
+
+   ************************************************************************* */
+int dstrmapndel(dstrmap_t map, const char *key, size_t n, void **value);
+
+
+/* **** dstrmapnext ********************************************************
+
+   Visits every key in map, in no particular order.  Set *index to 0 before
+   the first call; each call stores the next key (terminated, and owned by
+   the map), its length and its value in *key, *n and *value (any of which
+   may be NULL), advances *index and returns 1.  Once every key has been
+   visited, it returns 0 and sets dstrerrno to DSTR_EOF.  Adding keys while
+   visiting may cause some to be skipped or seen twice; deleting the key
+   that was just returned is fine.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrmap_t
+      size_t * (where the next key is looked for)
+      const char ** (where to store the key, or NULL)
+      size_t * (where to store its length, or NULL)
+      void ** (where to store its value, or NULL)
+
+   Output:
+      1 if a key was found, 0 if not
+
+   ************************************************************************* */
+int dstrmapnext(const dstrmap_t map, size_t *index, const char **key,
+   size_t *n, void **value);
+
+
+/* dstrcmap_t is a dstrmap_t that threads can share (see dstrcmapalloc()) */
+typedef void * dstrcmap_t;
+
+
+/* **** dstrcmapalloc ******************************************************
+
+   This function initializes a variable of type dstrcmap_t, a map that
+   works like a dstrmap_t, except that any number of threads can look up,
+   add and remove keys at the same time.  capacity is the number of keys
+   to make room for before it has to grow (0 is fine).  If the library
+   wasn't built with --enable-pthreads, dstrerrno will be set to
+   DSTR_UNSUPPORTED.
+
+   Instead of one table behind one lock, the keys are split between 64
+   tables ("shards"), each with its own read-write lock, according to
+   their hashes.  Lookups only share their lock with other lookups, and a
+   thread changing the map only holds up threads that need the same shard
+   at the same time, so threads mostly run without waiting for each other.
+
+   dstrcmap_t variables should be set to NULL when declared, just like
+   dstring_t variables.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t * (points to the object to be initialized)
+      size_t (number of keys to make room for)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrcmapalloc(dstrcmap_t *mapptr, size_t capacity);
+
+
+/* **** dstrcmapfree *******************************************************
+
+   Frees a map and sets it to NULL.  If release isn't NULL, it's called
+   with the value of each key that's still in the map, so that they can
+   be freed too.  No other thread may be using the map.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t * (points to the object to be freed)
+      void (*)(void *) (called with each value, or NULL)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrcmapfree(dstrcmap_t *mapptr, void (*release)(void *value));
+
+
+/* **** dstrcmapsize *******************************************************
+
+   Returns the number of keys in map.  While other threads are changing
+   the map, this is only a snapshot, and may already be out of date.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrcmap_t
+
+   Output:
+      number of keys
+
+   ************************************************************************* */
+size_t dstrcmapsize(const dstrcmap_t map);
+
+
+/* **** dstrcmapset ********************************************************
+
+   Maps key to value, like dstrmapset().  If key already had a value, it's
+   replaced, and the value it had is stored in *old; otherwise NULL is
+   (unless old is NULL).  Since another thread may have set the key just
+   before, this is the only reliable way to find out which value needs to
+   be freed.
+
+   The map only reads key (unlike dstrmapset(), it doesn't remember key's
+   hash in it), so several threads can use the same dstring_t as a key at
+   once, as long as none of them changes it.
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t
+      const dstring_t (key)
+      void * (value)
+      void ** (where to store the value that was replaced, or NULL)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrcmapset(dstrcmap_t map, const dstring_t key, void *value,
+   void **old);
+
+
+/* **** dstrcmapnset *******************************************************
+
+   Like dstrcmapset(), but the key is n bytes at key, as in dstrmapnset().
+
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t
+      const char * (key)
+      size_t (length of key)
+      void * (value)
+      void ** (where to store the value that was replaced, or NULL)
+
+   Output:
+      An integer status (see enum above)
+
+   ************************************************************************* */
+int dstrcmapnset(dstrcmap_t map, const char *key, size_t n, void *value,
+   void **old);
+
+
+/* **** dstrcmapget ********************************************************
+
+   Looks up key, like dstrmapget().  The map itself never hands out
+   anything that another thread could free, but the value belongs to the
+   caller: if other threads can remove key and free its value, the value
+   needs some way (such as a reference count) to stay alive while it's
+   being used.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrcmap_t
+      const dstring_t (key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was found, 0 if not
+
+   ************************************************************************* */
+int dstrcmapget(const dstrcmap_t map, const dstring_t key, void **value);
+
+
+/* **** dstrcmapnget *******************************************************
+
+   Like dstrcmapget(), but the key is n bytes at key, as in dstrmapnset().
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      const dstrcmap_t
+      const char * (key)
+      size_t (length of key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was found, 0 if not
+
+   ************************************************************************* */
+int dstrcmapnget(const dstrcmap_t map, const char *key, size_t n,
+   void **value);
+
+
+/* **** dstrcmapdel ********************************************************
+
+   Removes key, like dstrmapdel().  If two threads remove the same key at
+   once, only one of them gets its value (and a return value of 1).  The
+   map's own copy of the key is freed right away.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t
+      const dstring_t (key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was removed, 0 if it wasn't there
+
+   ************************************************************************* */
+int dstrcmapdel(dstrcmap_t map, const dstring_t key, void **value);
+
+
+/* **** dstrcmapndel *******************************************************
+
+   Like dstrcmapdel(), but the key is n bytes at key, as in dstrmapnset().
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
+
+   *************************************************************************
+
+   Input:
+      dstrcmap_t
+      const char * (key)
+      size_t (length of key)
+      void ** (where to store the value, or NULL)
+
+   Output:
+      1 if key was removed, 0 if it wasn't there
+
+   ************************************************************************* */
+int dstrcmapndel(dstrcmap_t map, const char *key, size_t n, void **value);
+
+
+/*****************************\
+ * String interning functions *
+\*****************************/
+
+
+/* dstrpool_t is another "black-box" type: a pool of interned strings */
+typedef void * dstrpool_t;
+
+/* flags for dstrpoolalloc() */
+enum DSTR_POOL {
+
+   /* let any number of threads use the pool at once (when the library is
+      built with --enable-pthreads) */
+   DSTR_POOL_THREADSAFE = 1
+};
+
+/* what dstrpoolstats() reports about a pool */
+typedef struct {
+   size_t strings;                      /* distinct strings in the pool */
+   size_t bytes;                        /* their total length */
+   size_t memory;                       /* everything the pool has
+                                           allocated, in bytes */
+} dstrpoolstats_t;
+
 
-   Output:
-      Number of characters successfully read (0 on error or EOF - check
-      dstrerrno)
+/* **** dstrpoolalloc ******************************************************
 
-   ************************************************************************* */
-size_t dstrfcatl(dstring_t dest, FILE *fp);
+   This function initializes a variable of type dstrpool_t: a pool that
+   keeps one copy of each distinct string it's given (see dstrintern()).
+   If flags includes DSTR_POOL_THREADSAFE, any number of threads can use
+   the pool at once; as with dstrcmapalloc(), its strings are split
+   between 64 tables, each with its own read-write lock.  If the library
+   wasn't built with --enable-pthreads, asking for DSTR_POOL_THREADSAFE
+   sets dstrerrno to DSTR_UNSUPPORTED.
 
+   dstrpool_t variables should be set to NULL when declared, just like
+   dstring_t variables.
 
-/* **** dstrcatl **********************************************************
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Implemented as a macro, this call wraps around dstrfcatl, using stdin
-   as the input file.
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      dstring_t (our dstring_t object)
+      dstrpool_t * (points to the object to be initialized)
+      int (flags)
 
    Output:
-      Number of characters successfully read (0 on error or EOF - check
-      dstrerrno)
+      An integer status (see enum above)
 
    ************************************************************************* */
-#define dstrcatl(DEST) dstrfcatl(DEST, stdin)
+int dstrpoolalloc(dstrpool_t *poolptr, int flags);
 
 
-/* **** dstrfcatn **********************************************************
-
-   This function reads up to one less than n characters (not including the
-   NULL terminating character), including \n's, from FILE *fp and appends
-   them to the buffer of a dstring_t object.
+/* **** dstrpoolfree *******************************************************
 
-   If size is 0, nothing will be done and dstrerrno will be set to
-   DSTR_SUCCESS.
+   Frees a pool, along with every string in it, and sets it to NULL.
+   None of the pool's strings can be used after that, and no other thread
+   may be using the pool.
 
-   New data is appended to anything previously stored in the buffer.  In
-   the event of a DSTR_NOMEM error, the buffer will be unmodified.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in io.c
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      dstring_t (our dstring_t object)
-      FILE (our input stream)
-      size_t (the number of characters to read)
+      dstrpool_t * (points to the object to be freed)
 
    Output:
-      Number of characters successfully read (0 on error or EOF - check
-      dstrerrno)
+      An integer status (see enum above)
 
    ************************************************************************* */
-size_t dstrfcatn(dstring_t dest, FILE *fp, size_t n);
+int dstrpoolfree(dstrpool_t *poolptr);
 
 
-/* **** dstrcatn ***********************************************************
+/* **** dstrintern *********************************************************
 
-   Implemented as a macro, this wraps around dstrcatn, using stdin as the
-   input file.
+   Returns the pool's string with the same contents as str, adding one if
+   there isn't one yet.  Interning the same contents again always returns
+   the same dstring_t, so two interned strings from the same pool are
+   equal exactly when they're the same pointer.
 
-   If size is 0, nothing will be done and DSTR_SUCCESS will be returned.
+   The pool's strings don't cost two allocations each, like ones from
+   dstralloc(): each one, header and buffer together, is carved out of
+   large blocks of memory that belong to the pool, and the pool's table
+   uses its buffer as the key instead of keeping a copy.  So a string that
+   turns up a million times costs one copy and a million pointers.
+
+   The strings belong to the pool and can't be changed.  They can be passed
+   to any function that only reads a string, from any number of threads
+   at once; any function that would change, resize or free one leaves it
+   alone and fails with DSTR_READONLY.  What dstrhash() and the UTF-8
+   functions would otherwise work out and remember the first time they're
+   asked is worked out when the string is added instead.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      dstring_t (our dstring_t object)
-      size_t (the number of characters to read)
+      dstrpool_t
+      const dstring_t (contents to look for)
 
    Output:
-      Number of characters successfully read (0 on error or EOF - check
-      dstrerrno)
+      the pool's dstring_t, or NULL on error
 
    ************************************************************************* */
-#define dstrcatn(DEST, SIZE) dstrfcatn(DEST, stdin, SIZE)
-
-
-/************************\
- * conversion functions *
-\************************/
+dstring_t dstrintern(dstrpool_t pool, const dstring_t str);
 
 
-/* **** dstrtocstr **********************************************************
-
-   This function copies the string stored in a dstring_t buffer into an
-   ordinary character array, up to one less than size characters (the last
-   space being reserved for \0).
-
-   If size is 0, an empty string (just a single '\0') will be created and
-   DSTR_SUCCESS will be returned.
+/* **** dstrinterncs *******************************************************
 
-   dstrerrno will be set to indicate success or failure, matching the return
-   value.
+   Like dstrintern(), but the contents come from a C string.
 
-   If dest is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in convert.c
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      char * (destination string)
-      const dstring_t (source string)
-      size_t (number of characters to copy minus one)
+      dstrpool_t
+      const char * (contents to look for)
 
    Output:
-      An integer status (see enum above)
+      the pool's dstring_t, or NULL on error
 
    ************************************************************************* */
-int dstrtocstr(char *dest, const dstring_t src, size_t size);
-
+dstring_t dstrinterncs(dstrpool_t pool, const char *src);
 
-/* **** cstrtodstr **********************************************************
-
-   This function copies the string stored in an ordinary character array into
-   the buffer of a dstring_t object.
 
-   The source string overwrites any previous data stored in the dstring_t
-   buffer.
+/* **** dstrninterncs ******************************************************
 
-   dstrerrno will be set to indicate success or failure, matching the return
-   value.
+   Like dstrinterncs(), but only the first n bytes of src are used (or all
+   of it, if it ends sooner), so a string can be interned straight out of
+   a larger buffer.
 
-   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in convert.c
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination string)
-      const char * (source string)
+      dstrpool_t
+      const char * (contents to look for)
+      size_t (maximum number of bytes to use)
 
    Output:
-      An integer status (see enum above)
+      the pool's dstring_t, or NULL on error
 
    ************************************************************************* */
-int cstrtodstr(dstring_t dest, const char *src);
-
-
-/**************************\
- * C Library Replacements *
-\**************************/
+dstring_t dstrninterncs(dstrpool_t pool, const char *src, size_t n);
 
 
-/* **** dstrlen ************************************************************
+/* **** dstrpoolstats ******************************************************
 
-   This function takes as an argument a dstring_t object and returns the
-   length of the string.  This is the dstring_t equivalent of strlen in the
-   standard library.
+   Fills in *stats with the number of distinct strings in the pool, their
+   total length, and the number of bytes the pool has allocated for them
+   and its tables.  While other threads are adding strings, this is only a
+   snapshot.
 
-   dstrerrno will be set to indicate success or type of error.
+   dstrerrno will be set to indicate success or type of error.  The return
+   value of this function will also be the same status code.
 
-   Found in cstdlib.c
+   Found in map.c
 
    *************************************************************************
 
    Input:
-      dstring_t (our dstring_t object)
+      const dstrpool_t
+      dstrpoolstats_t * (where to store the statistics)
 
    Output:
-      The length of the string
-      (BE CAREFUL! A size of 0 is an ambiguous case; since size_t is
-       unsigned, we can't return a status code.  Thus, 0 could indicate a
-       size of 0 OR the fact that the dstring_t object is uninitialized - 
-       on a return of 0, checking dstrerrno is a good idea ;)
+      An integer status (see enum above)
 
    ************************************************************************* */
-size_t dstrlen(const dstring_t str);
+int dstrpoolstats(const dstrpool_t pool, dstrpoolstats_t *stats);
 
 
-/* **** dstrcat ************************************************************
+/******************\
+ * JSON functions *
+\******************/
 
-   This function emulates the behavior of the C standard library function
-   strcat() by appending one dstring_t object to another.
 
-   dstrcat() is safe, unlike strcat(), because the destination buffer will
-   grow to accomodate the required size.
+/* **** dstrcatjson ********************************************************
 
-   dstrerrno will be set to indicate success or the type of error.
+   Appends src to dest as a quoted JSON string.  Quotes, backslashes and
+   control characters are escaped, and everything else (including UTF-8)
+   is copied as-is.  The input is scanned for characters that need escaping
+   16 bytes at a time, and runs that don't need any are copied whole.
 
-   Found in cstdlib.c
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in json.c
 
    *************************************************************************
 
    Input:
       dstring_t (destination)
-      const dstring_t (source)
+      const char * (string to escape)
 
    Output:
-      number of characters concatenated to src
+      number of characters appended to dest
 
    ************************************************************************* */
-int dstrcat(dstring_t dest, const dstring_t src);
+int dstrcatjson(dstring_t dest, const char *src);
 
 
-/* **** dstrncat ***********************************************************
+/* dstrjson_t is also a "black-box" type, which builds JSON objects and
+   arrays at the end of a dstring_t */
+typedef void * dstrjson_t;
 
-   This function emulates the behavior of the C standard library function
-   strncat() by appending one dstring_t object to another, up to n chars.
 
-   dstrerrno will be set to indicate success or the type of error.
+/* **** dstrjsonopen *******************************************************
 
-   Found in cstdlib.c
+   This function initializes a variable of type dstrjson_t, which appends
+   JSON to dest.  Values are added with dstrjsonstring(), dstrjsonint(),
+   etc., objects and arrays are started with dstrjsonobject() and
+   dstrjsonarray() and finished with dstrjsonend(), and commas, colons and
+   escaping are taken care of.  Each finished top-level value is followed
+   by a newline, so a series of records comes out one per line.
+
+   The builder remembers where dest ends, so that nothing has to be
+   measured as each value is added.  If dest is changed by anything else
+   while the builder is open (say, emptied after it's been written out),
+   call dstrjsonsync() before adding anything more.
+
+   dstrjson_t variables should be set to NULL when declared, just like
+   dstring_t variables.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in json.c
 
    *************************************************************************
 
    Input:
+      dstrjson_t * (points to the object to be initialized)
       dstring_t (destination)
-      const dstring_t (source)
-      size_t (number of characters to concatenate in source)
 
    Output:
-      number of characters appended to dest (could be less than n if src has
-      less than n characters)
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrncat(dstring_t dest, const dstring_t src, size_t n);
-
+int dstrjsonopen(dstrjson_t *jsonptr, dstring_t dest);
 
-/* **** dstrcatcs **********************************************************
 
-   This function emulates the behavior of the C standard library function
-   strcat() by appending an ordinary C string to a dstring_t object.
+/* **** dstrjsonclose ******************************************************
 
-   dstrerrno will be set to indicate success or the type of error.
+   Finishes any objects or arrays that are still open, then frees the
+   builder and sets it to NULL.  The dstring_t it was writing to is not
+   freed.
 
-   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in cstdlib.c
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const char * (source)
+      dstrjson_t * (points to the object to be freed)
 
    Output:
-      number of characters successfully appended to dest
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrcatcs(dstring_t dest, const char *src);
-
+int dstrjsonclose(dstrjson_t *jsonptr);
 
-/* **** dstrncatcs *********************************************************
 
-   This function emulates the behavior of the C standard library function
-   strncat() by appending a C string to a dstring_t object, up to n chars.
+/* **** dstrjsonsync *******************************************************
 
-   dstrerrno will be set to indicate success or the type of error.
+   Tells the builder that its dstring_t was changed by something else.  The
+   next value is added to the end of the string as it is now, at the top
+   level; anything that was left open is forgotten.
 
-   If src is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in cstdlib.c
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const char * (source)
-      size_t (number of characters to concatenate in source)
+      dstrjson_t (the builder)
 
    Output:
-      number of characters successfully appended to dest (up to one less
-      than n)
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrncatcs(dstring_t dest, const char *src, size_t n);
+int dstrjsonsync(dstrjson_t json);
 
 
-/* **** dstrcpy ************************************************************
+/* **** dstrjsonobject *****************************************************
 
-   This function emulates the behavior of the C standard library function
-   strcpy() by copying the contents of one initialized dstring_t object to
-   another.  Both dstring_t objects must be initialized.
+   Starts a new object.  Inside of an object, key is the new object's key;
+   anywhere else, key is ignored and may be NULL.  The same goes for the
+   key passed to every function below.
 
-   Unlike strcpy(), dstrcpy() is safe, because the destination buffer will
-   grow to accomodate the required size.
+   If key is NULL inside of an object, dstrerrno will be set to
+   DSTR_NULL_CPTR, and if objects and arrays are already nested too deeply
+   (64 levels), it will be set to DSTR_INVALID_ARGUMENT.  If anything goes
+   wrong, nothing is written.
 
-   dstrerrno will be set to indicate status or the type of error.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in cstdlib.c
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const dstring_t (source)
+      dstrjson_t (the builder)
+      const char * (key)
 
    Output:
-      number of characters copied to dest
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrcpy(dstring_t dest, const dstring_t src);
+int dstrjsonobject(dstrjson_t json, const char *key);
 
 
-/* **** dstrncpy ************************************************************
-
-   This function emulates the behavior of the C standard library function
-   strncpy() by copying the contents of one initialized dstring_t object to
-   another, up to n characters.  Both dstring_t objects must be initialized.
+/* **** dstrjsonarray ******************************************************
 
-   dstrerrno will be set to indicate status or the type of error.
+   Starts a new array.  See dstrjsonobject().
 
-   Found in cstdlib.c
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const dstring_t (source)
-      size_t (number of characters to copy)
+      dstrjson_t (the builder)
+      const char * (key)
 
    Output:
-      number of characters successfully copied to dest
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrncpy(dstring_t dest, const dstring_t src, size_t n);
+int dstrjsonarray(dstrjson_t json, const char *key);
 
 
-/* **** dstrsprintf ********************************************************
+/* **** dstrjsonend ********************************************************
 
-   An implementation of sprintf() that supports writing to dstring_t
-   objects.  This function supports every aspect of the standard library
-   function it aims to replace, and like its counterpart, returns the
-   number of characters written to the dstring_t object on success, or
-   a negative value on error (in the case of an error, the return value
-   will match the value of dstrerrno.)
+   Finishes the innermost object or array.  If nothing is open, dstrerrno
+   will be set to DSTR_INVALID_ARGUMENT.
 
-   dstrerrno will be set to indicate status or the type of error.
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
 
-   Found in sprintf.c
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const char * (format string)
-      possible variable list of arguments
+      dstrjson_t (the builder)
 
    Output:
-      number of characters successfully copied to dest or a status code
-      on error
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrsprintf(dstring_t str, const char *format, ...);
+int dstrjsonend(dstrjson_t json);
 
 
-/* **** dstrvsprintf *******************************************************
+/* **** dstrjsonstring, dstrjsonint, dstrjsonuint, dstrjsondouble, *********
+   **** dstrjsonbool, dstrjsonnull *****************************************
 
-   An implementation of vsprintf() that supports writing to dstring_t
-   objects.  This function supports every aspect of the standard library
-   function it aims to replace, and like its counterpart, returns the
-   number of characters written to the dstring_t object on success, or
-   a negative value on error (in the case of an error, the return value
-   will match the value of dstrerrno.)
+   Add a single value, with the given key if we're inside of an object (see
+   dstrjsonobject().)  Strings are escaped as by dstrcatjson().  Doubles are
+   written in the shortest form that reads back as the same value, like %r
+   in dstrsprintf(); infinities and NaN, which JSON can't represent, are
+   written as null.
 
-   dstrerrno will be set to indicate status or the type of error.
+   If value is a NULL pointer, dstrerrno will be set to DSTR_NULL_CPTR.  If
+   anything goes wrong, nothing is written.
 
-   Found in sprintf.c
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   Found in json.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const char * (format string)
-      va_list containing possible additional arguments
+      dstrjson_t (the builder)
+      const char * (key)
+      the value, if any
 
    Output:
-      number of characters successfully copied to dest or a status code
-      on error
+      An integer status (see enum above)
 
    ************************************************************************* */
-int dstrvsprintf(dstring_t str, const char *format, va_list args);
+int dstrjsonstring(dstrjson_t json, const char *key, const char *value);
+int dstrjsonint(dstrjson_t json, const char *key, long int value);
+int dstrjsonuint(dstrjson_t json, const char *key, unsigned long int value);
+int dstrjsondouble(dstrjson_t json, const char *key, double value);
+int dstrjsonbool(dstrjson_t json, const char *key, int value);
+int dstrjsonnull(dstrjson_t json, const char *key);
 
 
 /*********************\
@@ -1451,6 +4074,9 @@ int dstrleft(dstring_t str, size_t len);
 
    An index of 0 will tell the function to convert the entire string.
 
+   Only single bytes are converted, using toupper(); for UTF-8 text, use
+   dstrutf8toupper() instead.
+
    Found in format.c
 
    *************************************************************************
@@ -1473,6 +4099,9 @@ int dstrtoupper(dstring_t str, size_t index);
 
    An index of 0 will tell the function to convert the entire string.
 
+   Only single bytes are converted, using tolower(); for UTF-8 text, use
+   dstrutf8tolower() instead.
+
    Found in format.c
 
    *************************************************************************
@@ -1583,6 +4212,28 @@ const char * const dstrerrormsg(int code);
 int dstrbuildinfo(dstring_t str);
 
 
+/* **** dstrseterrno *******************************************************
+
+   Sets dstrerrno to the specified status.  This is for code built on top
+   of the library, such as the C++ front end in dstring.hpp, that has to
+   report its own errors the same way the library's functions do.  Unlike
+   assigning to dstrerrno, it's safe to call before any other dstring
+   function.
+
+   Found in dstring.c
+
+   *************************************************************************
+
+   Input:
+      int (status code)
+
+   Output:
+      (none)
+
+   ************************************************************************* */
+void dstrseterrno(int status);
+
+
 /* IMPLEMENT! */
 /* Format */
 
@@ -1590,4 +4241,8 @@ int dstrbuildinfo(dstring_t str);
 int dstrfill(dstring_t str, size_t index, size_t n, char c); 
 /* more in format.c that need prototypes to be made */
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
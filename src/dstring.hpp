@@ -0,0 +1,515 @@
+/* ************************************************************************* *\
+   * File: dstring.hpp                                                     *
+   * Purpose:                                                              *
+   *    A header-only C++20 front end for formatting into dstring_t        *
+   *    objects                                                            *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* A header-only C++ front end for formatting into a dstring_t:
+
+      dstring::format(str, "{} {} status={}\n", date, path, 200);
+
+   Each {} is replaced by the next argument.  The format string is parsed
+   by the compiler, so a stray brace or the wrong number of arguments is a
+   compile-time error, and each argument is written by an appender chosen
+   by its type, with no va_arg or conversion specifiers involved.  Use {{
+   and }} for literal braces.
+
+   Requires C++20 (the format string is checked by a consteval
+   constructor). */
+
+#ifndef DSTRING_HPP_INCLUDED
+#define DSTRING_HPP_INCLUDED
+
+#if __cplusplus < 202002L
+   #error "dstring.hpp requires C++20"
+#endif
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "dstring.h"
+
+namespace dstring {
+
+/* ************************************************************************* */
+
+/* **** writer **************************************************************
+
+   Collects output in a small buffer on the stack and appends it to the
+   dstring_t whenever the buffer fills up, so that a typical line costs a
+   single append.  Appenders (see formatter below) write through this.
+
+   If an append fails, everything after it is ignored, and finish() takes
+   back whatever this writer had already appended.
+
+   ************************************************************************* */
+class writer {
+
+   public:
+
+      /* the most an appender may ask reserve() for at once */
+      static const std::size_t capacity = 256;
+
+      explicit writer(dstring_t str): str(str), used(0), appended(0),
+         status(DSTR_SUCCESS) {}
+
+      writer(const writer &) = delete;
+      writer &operator=(const writer &) = delete;
+
+      /* writes n characters */
+      void write(const char *src, std::size_t n) {
+
+         if (n <= capacity - used) {
+            std::memcpy(buf + used, src, n);
+            used += n;
+            return;
+         }
+
+         while (n > 0) {
+
+            std::size_t chunk;
+
+            if (capacity == used) {
+               flush();
+            }
+
+            chunk = n < capacity - used ? n : capacity - used;
+            std::memcpy(buf + used, src, chunk);
+            used += chunk;
+            src += chunk;
+            n -= chunk;
+         }
+      }
+
+      /* writes a single character */
+      void put(char c) {
+
+         if (capacity == used) {
+            flush();
+         }
+
+         buf[used++] = c;
+      }
+
+      /* returns room for at least n (<= capacity) characters, which become
+         part of the output once commit() is called */
+      char *reserve(std::size_t n) {
+
+         if (n > capacity - used) {
+            flush();
+         }
+
+         return buf + used;
+      }
+
+      void commit(std::size_t n) {
+         used += n;
+      }
+
+      /* signals an error; the rest of the output is discarded */
+      void fail(int code) {
+
+         if (DSTR_SUCCESS == status) {
+            status = code;
+         }
+      }
+
+      /* appends whatever is left and returns the number of characters
+         appended, or a negative status code on error */
+      int finish() {
+
+         flush();
+
+         if (DSTR_SUCCESS != status) {
+            if (appended > 0) {
+               dstrtrunc(str, dstrlen(str) - appended);
+            }
+            dstrseterrno(status);
+            return status;
+         }
+
+         dstrseterrno(DSTR_SUCCESS);
+         return (int)appended;
+      }
+
+   private:
+
+      void flush() {
+
+         if (used > 0 && DSTR_SUCCESS == status) {
+
+            buf[used] = '\0';
+            dstrncatcs(str, buf, used);
+
+            if (DSTR_SUCCESS != dstrerrno) {
+               status = dstrerrno;
+            } else {
+               appended += used;
+            }
+         }
+
+         used = 0;
+      }
+
+      dstring_t   str;
+      char        buf[capacity + 1];
+      std::size_t used;
+      std::size_t appended;
+      int         status;
+};
+
+/* ************************************************************************* */
+
+/* **** formatter ***********************************************************
+
+   formatter<T>::append(writer &, const T &) writes one argument of type T.
+   The library provides formatters for bool, char, the other integer types,
+   floating point types, C strings, std::string, std::string_view and
+   dstr_arg (a wrapped dstring_t); specialize it to format your own types.
+
+   Integers are written in decimal.  Floating point values are written in
+   the shortest form that reads back as the same value, like %r in
+   dstrsprintf().
+
+   ************************************************************************* */
+template <typename T, typename Enable = void>
+struct formatter {
+   static_assert(sizeof(T) == 0, "dstring::format has no formatter for this "
+      "argument type");
+};
+
+template <>
+struct formatter<bool> {
+   static void append(writer &w, bool value) {
+      if (value) {
+         w.write("true", 4);
+      } else {
+         w.write("false", 5);
+      }
+   }
+};
+
+template <>
+struct formatter<char> {
+   static void append(writer &w, char value) {
+      w.put(value);
+   }
+};
+
+template <typename T>
+struct formatter<T, std::enable_if_t<std::is_integral_v<T> &&
+   !std::is_same_v<T, bool> && !std::is_same_v<T, char>>> {
+
+   static void append(writer &w, T value) {
+
+      /* digits10 + 1 digits at most, and a sign */
+      const std::size_t n = std::numeric_limits<T>::digits10 + 2;
+      char *p = w.reserve(n);
+
+      w.commit(std::to_chars(p, p + n, value).ptr - p);
+   }
+};
+
+template <typename T>
+struct formatter<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+
+   static void append(writer &w, T value) {
+
+      /* enough for the longest shortest form of a long double */
+      const std::size_t n = 64;
+      char *p = w.reserve(n);
+
+      w.commit(std::to_chars(p, p + n, value).ptr - p);
+   }
+};
+
+template <>
+struct formatter<const char *> {
+   static void append(writer &w, const char *value) {
+      if (NULL == value) {
+         w.fail(DSTR_NULL_CPTR);
+      } else {
+         w.write(value, std::strlen(value));
+      }
+   }
+};
+
+template <>
+struct formatter<char *>: formatter<const char *> {};
+
+template <>
+struct formatter<std::string_view> {
+   static void append(writer &w, std::string_view value) {
+      w.write(value.data(), value.size());
+   }
+};
+
+template <>
+struct formatter<std::string> {
+   static void append(writer &w, const std::string &value) {
+      w.write(value.data(), value.size());
+   }
+};
+
+/* **** dstr_arg ************************************************************
+
+   dstring_t is a void *, so a dstring_t argument can't be told apart from
+   any other pointer by its type.  Wrap it to format its contents:
+
+      dstring::format(str, "name={}", dstring::dstr_arg{name});
+
+   ************************************************************************* */
+struct dstr_arg {
+   dstring_t str;
+};
+
+template <>
+struct formatter<dstr_arg> {
+   static void append(writer &w, const dstr_arg &value) {
+      if (NULL == value.str) {
+         w.fail(DSTR_UNINITIALIZED);
+      } else {
+         const char *s = dstrview(value.str);
+         w.write(s, std::strlen(s));
+      }
+   }
+};
+
+/* any other pointer, including a bare dstring_t, is refused rather than
+   read from */
+template <typename T>
+struct formatter<T *> {
+   static_assert(sizeof(T *) == 0, "dstring::format can't format a pointer; "
+      "wrap a dstring_t in dstring::dstr_arg");
+};
+
+/* ************************************************************************* */
+
+namespace detail {
+
+   /* not constexpr, so calling it while the format string is being checked
+      stops compilation, and the message shows up in the error */
+   inline void formaterror(const char *message) {
+      (void)message;
+   }
+
+   /* the literal text before a {}, or after the last one */
+   struct piece {
+      std::size_t offset;
+      std::size_t length;
+      bool        escaped;    /* contains {{ or }} */
+   };
+}
+
+/* **** basic_format_string *************************************************
+
+   A format string for the given argument types, split into literal pieces
+   when it's constructed at compile time.  Not used directly; a string
+   literal passed to format() or catformat() becomes one of these.
+
+   ************************************************************************* */
+template <typename... Args>
+class basic_format_string {
+
+   public:
+
+      template <typename S> requires std::is_convertible_v<const S &,
+         std::string_view>
+      consteval basic_format_string(const S &format): text(format) {
+
+         std::size_t i = 0, start = 0, n = 0;
+         bool escaped = false;
+
+         while (i < text.size()) {
+
+            if ('{' == text[i]) {
+               if (i + 1 < text.size() && '{' == text[i + 1]) {
+                  escaped = true;
+                  i += 2;
+               } else if (i + 1 < text.size() && '}' == text[i + 1]) {
+                  if (n == sizeof...(Args)) {
+                     detail::formaterror("more {} than arguments");
+                  }
+                  pieces[n++] = {start, i - start, escaped};
+                  i += 2;
+                  start = i;
+                  escaped = false;
+               } else {
+                  detail::formaterror("'{' must be followed by '}' or '{'");
+               }
+            }
+
+            else if ('}' == text[i]) {
+               if (i + 1 < text.size() && '}' == text[i + 1]) {
+                  escaped = true;
+                  i += 2;
+               } else {
+                  detail::formaterror("unmatched '}' (use '}}')");
+               }
+            }
+
+            else {
+               i++;
+            }
+         }
+
+         if (n != sizeof...(Args)) {
+            detail::formaterror("fewer {} than arguments");
+         }
+
+         pieces[n] = {start, i - start, escaped};
+      }
+
+      /* writes the literal text before argument i (or after the last one) */
+      void literal(writer &w, std::size_t i) const {
+
+         const char *p = text.data() + pieces[i].offset;
+         const char *end = p + pieces[i].length;
+
+         if (!pieces[i].escaped) {
+            w.write(p, pieces[i].length);
+            return;
+         }
+
+         /* {{ and }} become a single brace */
+         for (; p < end; p++) {
+            w.put(*p);
+            if ('{' == *p || '}' == *p) {
+               p++;
+            }
+         }
+      }
+
+   private:
+
+      std::string_view                              text;
+      std::array<detail::piece, sizeof...(Args) + 1> pieces{};
+};
+
+/* the argument types are deduced from the arguments, not the format */
+template <typename... Args>
+using format_string = basic_format_string<std::type_identity_t<Args>...>;
+
+/* ************************************************************************* */
+
+namespace detail {
+
+   template <typename... Args, std::size_t... I>
+   inline void run(writer &w, const basic_format_string<Args...> &format,
+   std::index_sequence<I...>, const Args &... args) {
+
+      ((format.literal(w, I), formatter<std::decay_t<Args>>::append(w,
+         args)), ...);
+      format.literal(w, sizeof...(Args));
+   }
+}
+
+/* **** catformat ***********************************************************
+
+   Appends formatted output to str, like dstrcatprintf().  If an error
+   occurs, str is left as it was.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to append to)
+      format string (checked at compile time)
+      arguments, one per {}
+
+   Output:
+      number of characters appended, or a negative status code on error
+
+   ************************************************************************* */
+template <typename... Args>
+int catformat(dstring_t str, format_string<Args...> format,
+const Args &... args) {
+
+   if (NULL == str) {
+      dstrseterrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   writer w(str);
+
+   detail::run(w, format, std::index_sequence_for<Args...>{}, args...);
+   return w.finish();
+}
+
+/* **** format **************************************************************
+
+   Replaces the contents of str with formatted output, like dstrsprintf().
+   If an error occurs, str is left empty.
+
+   In addition to the return value, dstrerrno will be set to indicate
+   success or failure.
+
+   *************************************************************************
+
+   Input:
+      dstring_t (string to format into)
+      format string (checked at compile time)
+      arguments, one per {}
+
+   Output:
+      number of characters written, or a negative status code on error
+
+   ************************************************************************* */
+template <typename... Args>
+int format(dstring_t str, format_string<Args...> format,
+const Args &... args) {
+
+   if (NULL == str) {
+      dstrseterrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   dstrtrunc(str, 0);
+
+   writer w(str);
+
+   detail::run(w, format, std::index_sequence_for<Args...>{}, args...);
+   return w.finish();
+}
+
+}
+
+#endif
@@ -0,0 +1,862 @@
+
+/* ************************************************************************* *\
+   * File: dtoa.c                                                          *
+   * Purpose:                                                              *
+   *    Converts doubles to decimal digits for dstrsprintf(), either the   *
+   *    shortest digits that read back as the same double, or a fixed      *
+   *    number of correctly rounded digits                                 *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* Doubles are converted with Grisu (Florian Loitsch, "Printing Floating-Point
+   Numbers Quickly and Accurately with Integers", PLDI 2010), which only
+   needs 64-bit integer arithmetic.  Grisu knows when it can't be sure of
+   its answer (which happens for roughly 0.5% of doubles), and in those
+   cases, and whenever more digits are asked for than a double can hold,
+   we fall back on exact big integer arithmetic in the style of Steele &
+   White's Dragon4. */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "sprintf.h"
+
+/* a floating point number with a 64-bit significand (f * 2^e) */
+typedef struct {
+   uint64_t f;
+   int e;
+} diyfp;
+
+/* an arbitrary precision unsigned integer, big enough for any double
+   scaled by any power of ten we'll need */
+#define BIGNUM_LIMBS 40
+
+typedef struct {
+   uint32_t limb[BIGNUM_LIMBS];     /* least significant first */
+   int n;                           /* number of limbs in use */
+} bignum;
+
+/* what kind of digits we want */
+enum {
+   DTOA_SHORTEST, DTOA_COUNTED, DTOA_FIXED
+};
+
+/* Grisu wants the scaled number's binary exponent in this range */
+#define MIN_TARGET_EXPONENT -60
+
+#define SIGNIFICAND_MASK    0x000FFFFFFFFFFFFFULL
+#define HIDDEN_BIT          0x0010000000000000ULL
+#define EXPONENT_BIAS       1075
+
+/* log10(2) */
+#define LOG10_2             0.30102999566398114
+
+/* normalized powers of ten from 10^-348 to 10^340, in steps of 8 */
+static const struct {
+   uint64_t f;
+   short e;
+   short k;
+} cachedpowers[] = {
+   {0xFA8FD5A0081C0288ULL, -1220, -348},
+   {0xBAAEE17FA23EBF76ULL, -1193, -340},
+   {0x8B16FB203055AC76ULL, -1166, -332},
+   {0xCF42894A5DCE35EAULL, -1140, -324},
+   {0x9A6BB0AA55653B2DULL, -1113, -316},
+   {0xE61ACF033D1A45DFULL, -1087, -308},
+   {0xAB70FE17C79AC6CAULL, -1060, -300},
+   {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+   {0xBE5691EF416BD60CULL, -1007, -284},
+   {0x8DD01FAD907FFC3CULL,  -980, -276},
+   {0xD3515C2831559A83ULL,  -954, -268},
+   {0x9D71AC8FADA6C9B5ULL,  -927, -260},
+   {0xEA9C227723EE8BCBULL,  -901, -252},
+   {0xAECC49914078536DULL,  -874, -244},
+   {0x823C12795DB6CE57ULL,  -847, -236},
+   {0xC21094364DFB5637ULL,  -821, -228},
+   {0x9096EA6F3848984FULL,  -794, -220},
+   {0xD77485CB25823AC7ULL,  -768, -212},
+   {0xA086CFCD97BF97F4ULL,  -741, -204},
+   {0xEF340A98172AACE5ULL,  -715, -196},
+   {0xB23867FB2A35B28EULL,  -688, -188},
+   {0x84C8D4DFD2C63F3BULL,  -661, -180},
+   {0xC5DD44271AD3CDBAULL,  -635, -172},
+   {0x936B9FCEBB25C996ULL,  -608, -164},
+   {0xDBAC6C247D62A584ULL,  -582, -156},
+   {0xA3AB66580D5FDAF6ULL,  -555, -148},
+   {0xF3E2F893DEC3F126ULL,  -529, -140},
+   {0xB5B5ADA8AAFF80B8ULL,  -502, -132},
+   {0x87625F056C7C4A8BULL,  -475, -124},
+   {0xC9BCFF6034C13053ULL,  -449, -116},
+   {0x964E858C91BA2655ULL,  -422, -108},
+   {0xDFF9772470297EBDULL,  -396, -100},
+   {0xA6DFBD9FB8E5B88FULL,  -369,  -92},
+   {0xF8A95FCF88747D94ULL,  -343,  -84},
+   {0xB94470938FA89BCFULL,  -316,  -76},
+   {0x8A08F0F8BF0F156BULL,  -289,  -68},
+   {0xCDB02555653131B6ULL,  -263,  -60},
+   {0x993FE2C6D07B7FACULL,  -236,  -52},
+   {0xE45C10C42A2B3B06ULL,  -210,  -44},
+   {0xAA242499697392D3ULL,  -183,  -36},
+   {0xFD87B5F28300CA0EULL,  -157,  -28},
+   {0xBCE5086492111AEBULL,  -130,  -20},
+   {0x8CBCCC096F5088CCULL,  -103,  -12},
+   {0xD1B71758E219652CULL,   -77,   -4},
+   {0x9C40000000000000ULL,   -50,    4},
+   {0xE8D4A51000000000ULL,   -24,   12},
+   {0xAD78EBC5AC620000ULL,     3,   20},
+   {0x813F3978F8940984ULL,    30,   28},
+   {0xC097CE7BC90715B3ULL,    56,   36},
+   {0x8F7E32CE7BEA5C70ULL,    83,   44},
+   {0xD5D238A4ABE98068ULL,   109,   52},
+   {0x9F4F2726179A2245ULL,   136,   60},
+   {0xED63A231D4C4FB27ULL,   162,   68},
+   {0xB0DE65388CC8ADA8ULL,   189,   76},
+   {0x83C7088E1AAB65DBULL,   216,   84},
+   {0xC45D1DF942711D9AULL,   242,   92},
+   {0x924D692CA61BE758ULL,   269,  100},
+   {0xDA01EE641A708DEAULL,   295,  108},
+   {0xA26DA3999AEF774AULL,   322,  116},
+   {0xF209787BB47D6B85ULL,   348,  124},
+   {0xB454E4A179DD1877ULL,   375,  132},
+   {0x865B86925B9BC5C2ULL,   402,  140},
+   {0xC83553C5C8965D3DULL,   428,  148},
+   {0x952AB45CFA97A0B3ULL,   455,  156},
+   {0xDE469FBD99A05FE3ULL,   481,  164},
+   {0xA59BC234DB398C25ULL,   508,  172},
+   {0xF6C69A72A3989F5CULL,   534,  180},
+   {0xB7DCBF5354E9BECEULL,   561,  188},
+   {0x88FCF317F22241E2ULL,   588,  196},
+   {0xCC20CE9BD35C78A5ULL,   614,  204},
+   {0x98165AF37B2153DFULL,   641,  212},
+   {0xE2A0B5DC971F303AULL,   667,  220},
+   {0xA8D9D1535CE3B396ULL,   694,  228},
+   {0xFB9B7CD9A4A7443CULL,   720,  236},
+   {0xBB764C4CA7A44410ULL,   747,  244},
+   {0x8BAB8EEFB6409C1AULL,   774,  252},
+   {0xD01FEF10A657842CULL,   800,  260},
+   {0x9B10A4E5E9913129ULL,   827,  268},
+   {0xE7109BFBA19C0C9DULL,   853,  276},
+   {0xAC2820D9623BF429ULL,   880,  284},
+   {0x80444B5E7AA7CF85ULL,   907,  292},
+   {0xBF21E44003ACDD2DULL,   933,  300},
+   {0x8E679C2F5E44FF8FULL,   960,  308},
+   {0xD433179D9C8CB841ULL,   986,  316},
+   {0x9E19DB92B4E31BA9ULL,  1013,  324},
+   {0xEB96BF6EBADF77D9ULL,  1039,  332},
+   {0xAF87023B9BF0EE6BULL,  1066,  340}
+};
+
+#define CACHED_POWERS_OFFSET 348     /* -k of the first entry */
+#define CACHED_POWERS_STEP   8       /* k of each entry is this much higher */
+
+static const uint32_t smallpowers[] = {
+   0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+   1000000000
+};
+
+static diyfp diymul(diyfp x, diyfp y);
+static diyfp diynormalize(diyfp x);
+static void  splitdouble(double v, uint64_t *f, int *e);
+static int   cachedpower(int minexp, diyfp *power);
+static int   grisushortest(double v, char *digits, int *exponent);
+static int   grisuweed(char *digits, int len, uint64_t distance,
+                uint64_t delta, uint64_t rest, uint64_t tenkappa,
+                uint64_t unit);
+static int   grisucounted(double v, int mode, int n, char *digits,
+                int *exponent);
+static int   grisuweedcounted(char *digits, int len, uint64_t rest,
+                uint64_t tenkappa, uint64_t unit, int *kappa);
+static int   dragon(double v, int mode, int n, char *digits,
+                int *exponent);
+static void  roundup(char *digits, int len, int *exponent);
+
+static void  bigset(bignum *b, uint64_t value);
+static void  bigshl(bignum *b, int bits);
+static void  bigmul(bignum *b, uint32_t factor);
+static void  bigmulpow10(bignum *b, int exponent);
+static int   bigcmp(const bignum *a, const bignum *b);
+static int   bigaddcmp(const bignum *a, const bignum *b, const bignum *c);
+static void  bigsub(bignum *a, const bignum *b);
+
+/* ************************************************************************* */
+
+int dtoashortest(double v, char *digits, int *exponent) {
+
+   int len;
+
+   if ((len = grisushortest(v, digits, exponent)) > 0) {
+      return len;
+   }
+
+   return dragon(v, DTOA_SHORTEST, 0, digits, exponent);
+}
+
+/* ************************************************************************* */
+
+int dtoacounted(double v, int n, char *digits, int *exponent) {
+
+   int len;
+
+   if (n > DTOA_MAXDIGITS) {
+      n = DTOA_MAXDIGITS;
+   }
+
+   if ((len = grisucounted(v, DTOA_COUNTED, n, digits, exponent)) > 0) {
+      return len;
+   }
+
+   return dragon(v, DTOA_COUNTED, n, digits, exponent);
+}
+
+/* ************************************************************************* */
+
+int dtoafixed(double v, int precision, char *digits, int *exponent) {
+
+   int len;
+
+   if ((len = grisucounted(v, DTOA_FIXED, precision, digits, exponent)) > 0) {
+      return len;
+   }
+
+   return dragon(v, DTOA_FIXED, precision, digits, exponent);
+}
+
+/* ************************************************************************* */
+
+/* multiplies two diyfps, rounding the 128-bit product to 64 bits */
+static diyfp diymul(diyfp x, diyfp y) {
+
+   uint64_t a = x.f >> 32, b = x.f & 0xFFFFFFFF;
+   uint64_t c = y.f >> 32, d = y.f & 0xFFFFFFFF;
+   uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+   uint64_t tmp;
+   diyfp r;
+
+   tmp = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+   tmp += 1U << 31;
+
+   r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+   r.e = x.e + y.e + 64;
+   return r;
+}
+
+/* ************************************************************************* */
+
+/* shifts the significand left until its top bit is set */
+static diyfp diynormalize(diyfp x) {
+
+   while (!(x.f & 0xFFC0000000000000ULL)) {
+      x.f <<= 10;
+      x.e -= 10;
+   }
+
+   while (!(x.f & 0x8000000000000000ULL)) {
+      x.f <<= 1;
+      x.e--;
+   }
+
+   return x;
+}
+
+/* ************************************************************************* */
+
+/* splits a positive, finite double into f * 2^e */
+static void splitdouble(double v, uint64_t *f, int *e) {
+
+   uint64_t bits;
+   int biased;
+
+   memcpy(&bits, &v, sizeof(bits));
+   biased = (int)(bits >> 52) & 0x7FF;
+
+   /* denormals don't have the hidden bit */
+   if (0 == biased) {
+      *f = bits & SIGNIFICAND_MASK;
+      *e = 1 - EXPONENT_BIAS;
+   } else {
+      *f = (bits & SIGNIFICAND_MASK) | HIDDEN_BIT;
+      *e = biased - EXPONENT_BIAS;
+   }
+}
+
+/* ************************************************************************* */
+
+/* finds a cached power of ten that brings a diyfp with binary exponent
+   -(minexp + 64) into Grisu's target range, and returns its decimal
+   exponent */
+static int cachedpower(int minexp, diyfp *power) {
+
+   double dk = (minexp + 63) * LOG10_2;
+   int k = (int)dk;
+   int i;
+
+   /* (int) truncates, and we want the ceiling */
+   if (dk > k) {
+      k++;
+   }
+
+   i = (CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_STEP + 1;
+
+   power->f = cachedpowers[i].f;
+   power->e = cachedpowers[i].e;
+   return cachedpowers[i].k;
+}
+
+/* ************************************************************************* */
+
+/* finds the largest power of ten <= number, which has at most bits bits */
+static uint32_t biggestpower(uint32_t number, int bits, int *exponentplusone) {
+
+   int guess = ((bits + 1) * 1233 >> 12) + 1;
+
+   if (number < smallpowers[guess]) {
+      guess--;
+   }
+
+   *exponentplusone = guess;
+   return smallpowers[guess];
+}
+
+/* ************************************************************************* */
+
+/* Grisu3: generates the shortest digits that uniquely identify v, or
+   returns 0 if it can't be sure it got them right */
+static int grisushortest(double v, char *digits, int *exponent) {
+
+   uint64_t f, unit = 1, rest, fractionals, distance, delta, onemask;
+   uint32_t integrals, divisor;
+   int e, mk, kappa, len = 0, shift;
+   diyfp w, plus, minus, power, one;
+
+   splitdouble(v, &f, &e);
+
+   /* v and the boundaries halfway between it and its neighbors */
+   w.f = f, w.e = e;
+   w = diynormalize(w);
+
+   plus.f = (f << 1) + 1, plus.e = e - 1;
+   plus = diynormalize(plus);
+
+   /* the gap below is only half as big when v is a power of two */
+   if (HIDDEN_BIT == f && e > 1 - EXPONENT_BIAS) {
+      minus.f = (f << 2) - 1, minus.e = e - 2;
+   } else {
+      minus.f = (f << 1) - 1, minus.e = e - 1;
+   }
+   minus.f <<= minus.e - plus.e;
+   minus.e = plus.e;
+
+   /* scale everything by a power of ten so the exponent is small */
+   mk = cachedpower(MIN_TARGET_EXPONENT - (w.e + 64), &power);
+   w = diymul(w, power);
+   plus = diymul(plus, power);
+   minus = diymul(minus, power);
+
+   /* the scaled boundaries are each off by up to one unit, so we have to be
+      conservative */
+   minus.f -= unit;
+   plus.f += unit;
+   delta = plus.f - minus.f;
+
+   shift = -w.e;
+   one.f = (uint64_t)1 << shift, one.e = w.e;
+   onemask = one.f - 1;
+
+   integrals = (uint32_t)(plus.f >> shift);
+   fractionals = plus.f & onemask;
+   divisor = biggestpower(integrals, 64 - shift, &kappa);
+
+   /* digits from the integral part */
+   while (kappa > 0) {
+      digits[len++] = '0' + integrals / divisor;
+      integrals %= divisor;
+      kappa--;
+      rest = ((uint64_t)integrals << shift) + fractionals;
+      if (rest < delta) {
+         distance = plus.f - w.f;
+         if (!grisuweed(digits, len, distance, delta, rest,
+         (uint64_t)divisor << shift, unit)) {
+            return 0;
+         }
+         *exponent = kappa - mk + len - 1;
+         return len;
+      }
+      divisor /= 10;
+   }
+
+   /* digits from the fractional part */
+   for (;;) {
+      fractionals *= 10;
+      unit *= 10;
+      delta *= 10;
+      digits[len++] = '0' + (int)(fractionals >> shift);
+      fractionals &= onemask;
+      kappa--;
+      if (fractionals < delta) {
+         distance = (plus.f - w.f) * unit;
+         if (!grisuweed(digits, len, distance, delta, fractionals, one.f,
+         unit)) {
+            return 0;
+         }
+         *exponent = kappa - mk + len - 1;
+         return len;
+      }
+   }
+}
+
+/* ************************************************************************* */
+
+/* nudges the last digit down as close to v as possible, and returns 0 if
+   the result might be wrong (see section 6 of Loitsch's paper) */
+static int grisuweed(char *digits, int len, uint64_t distance,
+uint64_t delta, uint64_t rest, uint64_t tenkappa, uint64_t unit) {
+
+   uint64_t small = distance - unit;
+   uint64_t big = distance + unit;
+
+   while (rest < small && delta - rest >= tenkappa &&
+   (rest + tenkappa < small || small - rest >= rest + tenkappa - small)) {
+      digits[len - 1]--;
+      rest += tenkappa;
+   }
+
+   if (rest < big && delta - rest >= tenkappa &&
+   (rest + tenkappa < big || big - rest > rest + tenkappa - big)) {
+      return 0;
+   }
+
+   return 2 * unit <= rest && rest <= delta - 4 * unit;
+}
+
+/* ************************************************************************* */
+
+/* Grisu in counted mode: generates n correctly rounded digits, or with
+   DTOA_FIXED, as many digits as it takes to reach 10^-n; returns 0 if it
+   can't be sure of the rounding */
+static int grisucounted(double v, int mode, int n, char *digits,
+int *exponent) {
+
+   uint64_t f, error = 1, fractionals, onemask;
+   uint32_t integrals, divisor;
+   int e, mk, kappa, len = 0, shift;
+   diyfp w, power;
+
+   splitdouble(v, &f, &e);
+   w.f = f, w.e = e;
+   w = diynormalize(w);
+
+   mk = cachedpower(MIN_TARGET_EXPONENT - (w.e + 64), &power);
+   w = diymul(w, power);
+
+   shift = -w.e;
+   onemask = ((uint64_t)1 << shift) - 1;
+   integrals = (uint32_t)(w.f >> shift);
+   fractionals = w.f & onemask;
+   divisor = biggestpower(integrals, 64 - shift, &kappa);
+
+   /* now that we know where the first digit is, we know how many digits
+      it takes to get to 10^-n */
+   if (DTOA_FIXED == mode) {
+      n = kappa - mk + n;
+   }
+
+   /* rounding to zero or to a single digit is left to the slow path, as are
+      more digits than Grisu can produce */
+   if (n <= 0 || n > 18) {
+      return 0;
+   }
+
+   while (kappa > 0) {
+      digits[len++] = '0' + integrals / divisor;
+      integrals %= divisor;
+      kappa--;
+      if (--n == 0) {
+         if (!grisuweedcounted(digits, len,
+         ((uint64_t)integrals << shift) + fractionals,
+         (uint64_t)divisor << shift, error, &kappa)) {
+            return 0;
+         }
+         *exponent = kappa - mk + len - 1;
+         return len;
+      }
+      divisor /= 10;
+   }
+
+   while (n > 0 && fractionals > error) {
+      fractionals *= 10;
+      error *= 10;
+      digits[len++] = '0' + (int)(fractionals >> shift);
+      fractionals &= onemask;
+      kappa--;
+      n--;
+   }
+
+   if (0 != n || !grisuweedcounted(digits, len, fractionals, onemask + 1,
+   error, &kappa)) {
+      return 0;
+   }
+
+   *exponent = kappa - mk + len - 1;
+   return len;
+}
+
+/* ************************************************************************* */
+
+/* rounds the digits of a counted conversion, returning 0 if the error in
+   the scaled value makes the direction uncertain (ties included) */
+static int grisuweedcounted(char *digits, int len, uint64_t rest,
+uint64_t tenkappa, uint64_t unit, int *kappa) {
+
+   int carry;
+
+   if (unit >= tenkappa || tenkappa - unit <= unit) {
+      return 0;
+   }
+
+   /* definitely round down */
+   if (tenkappa - rest > rest && tenkappa - 2 * rest >= 2 * unit) {
+      return 1;
+   }
+
+   /* definitely round up */
+   if (rest > unit && tenkappa - (rest - unit) <= rest - unit) {
+      carry = 0;
+      roundup(digits, len, &carry);
+      *kappa += carry;
+      return 1;
+   }
+
+   return 0;
+}
+
+/* ************************************************************************* */
+
+/* adds one to the last digit, carrying as needed; if the carry runs off
+   the front, the digits become 100..., and *exponent is incremented */
+static void roundup(char *digits, int len, int *exponent) {
+
+   int i;
+
+   for (i = len - 1; i >= 0; i--) {
+      if ('9' != digits[i]) {
+         digits[i]++;
+         return;
+      }
+      digits[i] = '0';
+   }
+
+   digits[0] = '1';
+   (*exponent)++;
+}
+
+/* ************************************************************************* */
+
+/* the exact (but slow) way of doing what the Grisu functions do; v is
+   scaled so that v = r / s * 10^k with 1 <= r / s < 10, and then digits are
+   peeled off one at a time */
+static int dragon(double v, int mode, int n, char *digits, int *exponent) {
+
+   bignum r, s, mplus, mminus, tmp;
+   uint64_t f;
+   int e, k, len = 0, bits, even, low, high, cmp, digit;
+   double dk;
+
+   splitdouble(v, &f, &e);
+   even = !(f & 1);
+
+   /* r / s = v, with the gaps to v's neighbors as mplus and mminus (all
+      doubled so the halfway points are integers) */
+   bigset(&r, f);
+   bigset(&s, 1);
+   bigset(&mplus, 1);
+   bigset(&mminus, 1);
+
+   if (HIDDEN_BIT == f && e > 1 - EXPONENT_BIAS) {
+      /* the gap below is half the size of the one above */
+      bigshl(&r, 2);
+      bigshl(&s, 2);
+      bigshl(&mplus, 1);
+   } else {
+      bigshl(&r, 1);
+      bigshl(&s, 1);
+   }
+
+   if (e >= 0) {
+      bigshl(&r, e);
+      bigshl(&mplus, e);
+      bigshl(&mminus, e);
+   } else {
+      bigshl(&s, -e);
+   }
+
+   /* estimate k = floor(log10(v)) and scale by 10^k */
+   for (bits = 0; f >> bits; bits++);
+   dk = (e + bits - 1) * LOG10_2;
+   k = (int)dk;
+   if (dk < k) {
+      k--;
+   }
+
+   if (k >= 0) {
+      bigmulpow10(&s, k);
+   } else {
+      bigmulpow10(&r, -k);
+      bigmulpow10(&mplus, -k);
+      bigmulpow10(&mminus, -k);
+   }
+
+   /* fix the estimate if it was off */
+   tmp = s;
+   bigmul(&tmp, 10);
+   while (bigcmp(&r, &tmp) >= 0) {
+      bigmul(&s, 10);
+      bigmul(&tmp, 10);
+      k++;
+   }
+
+   while (bigcmp(&r, &s) < 0) {
+      bigmul(&r, 10);
+      bigmul(&mplus, 10);
+      bigmul(&mminus, 10);
+      k--;
+   }
+
+   *exponent = k;
+
+   if (DTOA_FIXED == mode) {
+
+      n = k + 1 + n;
+
+      /* v rounds to either 0 or 10^(k + 1) */
+      if (n <= 0) {
+         if (0 == n) {
+            /* compare 2v against 10^(k + 1), i.e. 2r against 10s */
+            tmp = s;
+            bigmul(&tmp, 10);
+            bigmul(&r, 2);
+            if (bigcmp(&r, &tmp) > 0) {
+               digits[0] = '1';
+               *exponent = k + 1;
+               return 1;
+            }
+         }
+         return 0;
+      }
+
+      /* a double has at most 767 significant digits, so anything past the
+         end of the buffer is zero */
+      if (n > DTOA_MAXDIGITS) {
+         n = DTOA_MAXDIGITS;
+      }
+   }
+
+   for (;;) {
+
+      /* the next digit is floor(r / s), which is never more than 9 */
+      for (digit = 0; bigcmp(&r, &s) >= 0; digit++) {
+         bigsub(&r, &s);
+      }
+
+      if (DTOA_SHORTEST == mode) {
+
+         /* can we stop here, or by rounding this digit up? */
+         low = even ? bigcmp(&r, &mminus) <= 0 : bigcmp(&r, &mminus) < 0;
+         high = even ? bigaddcmp(&r, &mplus, &s) >= 0 :
+            bigaddcmp(&r, &mplus, &s) > 0;
+
+         if (low || high) {
+
+            digits[len++] = '0' + digit;
+
+            /* if both will do, pick whichever is closer to v (and if v is
+               exactly in the middle, whichever is even) */
+            if (high && low) {
+               cmp = bigaddcmp(&r, &r, &s);
+               high = cmp > 0 || (0 == cmp && (digit & 1));
+            }
+
+            if (high) {
+               roundup(digits, len, exponent);
+            }
+
+            return len;
+         }
+
+         bigmul(&mplus, 10);
+         bigmul(&mminus, 10);
+      }
+
+      digits[len++] = '0' + digit;
+
+      if (DTOA_SHORTEST != mode && len == n) {
+         /* round half to even, like glibc */
+         cmp = bigaddcmp(&r, &r, &s);
+         if (cmp > 0 || (0 == cmp && (digit & 1))) {
+            roundup(digits, len, exponent);
+         }
+         return len;
+      }
+
+      bigmul(&r, 10);
+   }
+}
+
+/* ************************************************************************* */
+
+static void bigset(bignum *b, uint64_t value) {
+
+   b->limb[0] = (uint32_t)value;
+   b->limb[1] = (uint32_t)(value >> 32);
+   b->n = b->limb[1] ? 2 : (b->limb[0] ? 1 : 0);
+}
+
+/* ************************************************************************* */
+
+static void bigshl(bignum *b, int bits) {
+
+   int limbs = bits / 32, i;
+   uint32_t carry = 0, next;
+
+   bits %= 32;
+
+   if (0 == b->n) {
+      return;
+   }
+
+   if (bits) {
+      for (i = 0; i < b->n; i++) {
+         next = b->limb[i] >> (32 - bits);
+         b->limb[i] = b->limb[i] << bits | carry;
+         carry = next;
+      }
+      if (carry) {
+         b->limb[b->n++] = carry;
+      }
+   }
+
+   if (limbs) {
+      memmove(b->limb + limbs, b->limb, b->n * sizeof(uint32_t));
+      memset(b->limb, 0, limbs * sizeof(uint32_t));
+      b->n += limbs;
+   }
+}
+
+/* ************************************************************************* */
+
+static void bigmul(bignum *b, uint32_t factor) {
+
+   uint64_t carry = 0;
+   int i;
+
+   for (i = 0; i < b->n; i++) {
+      carry += (uint64_t)b->limb[i] * factor;
+      b->limb[i] = (uint32_t)carry;
+      carry >>= 32;
+   }
+
+   if (carry) {
+      b->limb[b->n++] = (uint32_t)carry;
+   }
+}
+
+/* ************************************************************************* */
+
+static void bigmulpow10(bignum *b, int exponent) {
+
+   for (; exponent >= 9; exponent -= 9) {
+      bigmul(b, 1000000000);
+   }
+
+   if (exponent > 0) {
+      bigmul(b, smallpowers[exponent + 1]);
+   }
+}
+
+/* ************************************************************************* */
+
+static int bigcmp(const bignum *a, const bignum *b) {
+
+   int i;
+
+   if (a->n != b->n) {
+      return a->n > b->n ? 1 : -1;
+   }
+
+   for (i = a->n - 1; i >= 0; i--) {
+      if (a->limb[i] != b->limb[i]) {
+         return a->limb[i] > b->limb[i] ? 1 : -1;
+      }
+   }
+
+   return 0;
+}
+
+/* ************************************************************************* */
+
+/* compares a + b with c */
+static int bigaddcmp(const bignum *a, const bignum *b, const bignum *c) {
+
+   bignum sum;
+   uint64_t carry = 0;
+   int i, n = a->n > b->n ? a->n : b->n;
+
+   for (i = 0; i < n; i++) {
+      carry += (uint64_t)(i < a->n ? a->limb[i] : 0) +
+         (i < b->n ? b->limb[i] : 0);
+      sum.limb[i] = (uint32_t)carry;
+      carry >>= 32;
+   }
+
+   sum.n = n;
+   if (carry) {
+      sum.limb[sum.n++] = (uint32_t)carry;
+   }
+
+   return bigcmp(&sum, c);
+}
+
+/* ************************************************************************* */
+
+/* a -= b, where a >= b */
+static void bigsub(bignum *a, const bignum *b) {
+
+   int64_t borrow = 0;
+   int i;
+
+   for (i = 0; i < a->n; i++) {
+      borrow += (int64_t)a->limb[i] - (i < b->n ? b->limb[i] : 0);
+      a->limb[i] = (uint32_t)borrow;
+      borrow = borrow < 0 ? -1 : 0;
+   }
+
+   while (a->n > 0 && 0 == a->limb[a->n - 1]) {
+      a->n--;
+   }
+}
@@ -0,0 +1,669 @@
+
+/* ************************************************************************* *\
+   * File: encode.c                                                        *
+   * Purpose:                                                              *
+   *    Provides functions that append data to a dstring_t as base64 or    *
+   *    hex, and decode it again                                           *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <limits.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+static const char base64stdchars[] =
+   "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const char base64urlchars[] =
+   "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static const char hexlower[] = "0123456789abcdef";
+static const char hexupper[] = "0123456789ABCDEF";
+
+/* the value of each character in standard base64, or 0xff if it isn't one */
+static const unsigned char base64stdvalues[UCHAR_MAX + 1] = {
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+   0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+   0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+   0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+   0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+   0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+   0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+   0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+   0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* the same for URL-safe base64 */
+static const unsigned char base64urlvalues[UCHAR_MAX + 1] = {
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff,
+   0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+   0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+   0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+   0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+   0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3f,
+   0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+   0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+   0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+   0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+/* the value of each hex digit (in either case), or 0xff */
+static const unsigned char hexvalues[UCHAR_MAX + 1] = {
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+   0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+   0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static int reserve(dstring_t dest, size_t len, size_t n);
+static size_t base64encode(char *out, const unsigned char *src, size_t len,
+   const char *chars);
+static int base64decode(unsigned char *out, const char *src, size_t len,
+   const unsigned char *values, char c62, char c63);
+static size_t hexencode(char *out, const unsigned char *src, size_t len,
+   const char *digits);
+static int hexdecode(unsigned char *out, const char *src, size_t len);
+
+/* ************************************************************************* */
+
+size_t dstrcatbase64(dstring_t dest, const void *src, size_t len, int flags) {
+
+   const char *chars;
+   size_t      start, n;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   chars = flags & DSTR_BASE64_URL ? base64urlchars : base64stdchars;
+
+   /* 4 characters for every 3 bytes, and 2 or 3 for whatever's left over,
+      plus padding to a multiple of 4 if it's wanted */
+   n = len / 3 * 4;
+   if (len % 3) {
+      n += flags & DSTR_BASE64_NOPAD ? len % 3 + 1 : 4;
+   }
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, n)) {
+      return 0;
+   }
+
+   n = base64encode(DSTRBUF(dest) + start, src, len, chars);
+
+   /* pad the last group out to 4 characters */
+   if (!(flags & DSTR_BASE64_NOPAD)) {
+      while (n % 4) {
+         DSTRBUF(dest)[start + n++] = '=';
+      }
+   }
+
+   DSTRBUF(dest)[start + n] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcatunbase64(dstring_t dest, const char *src, size_t len,
+int flags) {
+
+   size_t start, n;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   /* padding is optional, but if it's there, it has to be right */
+   if (len > 0 && 0 == len % 4 && '=' == src[len - 1]) {
+      len -= '=' == src[len - 2] ? 2 : 1;
+   }
+
+   /* a single character left over can't encode a whole byte */
+   if (1 == len % 4) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   n = len / 4 * 3 + (len % 4 ? len % 4 - 1 : 0);
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, n)) {
+      return 0;
+   }
+
+   /* if the input turns out to be invalid, dest is left as it was */
+   if (DSTR_SUCCESS != (flags & DSTR_BASE64_URL ?
+      base64decode((unsigned char *)DSTRBUF(dest) + start, src, len,
+         base64urlvalues, '-', '_') :
+      base64decode((unsigned char *)DSTRBUF(dest) + start, src, len,
+         base64stdvalues, '+', '/'))) {
+      DSTRBUF(dest)[start] = '\0';
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   DSTRBUF(dest)[start + n] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcathex(dstring_t dest, const void *src, size_t len, int flags) {
+
+   size_t start;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, len * 2)) {
+      return 0;
+   }
+
+   hexencode(DSTRBUF(dest) + start, src, len,
+      flags & DSTR_HEX_UPPER ? hexupper : hexlower);
+
+   DSTRBUF(dest)[start + len * 2] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return len * 2;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcatunhex(dstring_t dest, const char *src, size_t len) {
+
+   size_t start;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   if (len % 2) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, len / 2)) {
+      return 0;
+   }
+
+   /* if the input turns out to be invalid, dest is left as it was */
+   if (DSTR_SUCCESS != hexdecode((unsigned char *)DSTRBUF(dest) + start, src,
+   len)) {
+      DSTRBUF(dest)[start] = '\0';
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   DSTRBUF(dest)[start + len / 2] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return len / 2;
+}
+
+/* ************************************************************************* */
+
+/* makes sure there's room for n more characters (and a null terminator)
+   after the first len, so the output can be written without checking again;
+   sets dstrerrno on failure - FOR INTERNAL USE ONLY! */
+static int reserve(dstring_t dest, size_t len, size_t n) {
+
+   size_t newsize;
+
+   if (DSTRBUFLEN(dest) >= len + n + 1) {
+      return DSTR_SUCCESS;
+   }
+
+   /* grow geometrically, so appending piece by piece stays linear */
+   newsize = DSTRBUFLEN(dest) * 2;
+   if (newsize < len + n + 1) {
+      newsize = len + n + 1;
+   }
+
+   return dstrealloc(&dest, newsize);
+}
+
+/* ************************************************************************* */
+
+/* writes len bytes of src as base64 without padding and returns the number
+   of characters written - FOR INTERNAL USE ONLY! */
+static size_t base64encode(char *out, const unsigned char *src, size_t len,
+const char *chars) {
+
+   size_t   i = 0, n = 0;
+   uint32_t x;
+
+#ifdef __SSSE3__
+
+   {
+      __m128i v, lo, hi, shift, table;
+
+      /* the difference between each kind of 6-bit value and its character;
+         '+'/'/' or '-'/'_' in slots 11 and 12 */
+      table = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+         '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+         chars[62] - 62, chars[63] - 63, 'A', 0, 0);
+
+      /* 12 bytes at a time (16 are read) */
+      for (; i + 16 <= len; i += 12, n += 16) {
+
+         /* put each group of 3 bytes in a 32-bit lane as b1 b0 b2 b1, then
+            move each 6-bit value into a byte of its own */
+         v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i)),
+            _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+         hi = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)),
+            _mm_set1_epi32(0x04000040));
+         lo = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)),
+            _mm_set1_epi32(0x01000010));
+         v = _mm_or_si128(hi, lo);
+
+         /* 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12 */
+         shift = _mm_subs_epu8(v, _mm_set1_epi8(51));
+         shift = _mm_or_si128(shift, _mm_and_si128(_mm_cmpgt_epi8(
+            _mm_set1_epi8(26), v), _mm_set1_epi8(13)));
+
+         v = _mm_add_epi8(v, _mm_shuffle_epi8(table, shift));
+         _mm_storeu_si128((__m128i *)(out + n), v);
+      }
+   }
+
+#endif
+
+   for (; i + 3 <= len; i += 3, n += 4) {
+      x = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+      out[n] = chars[x >> 18];
+      out[n + 1] = chars[x >> 12 & 63];
+      out[n + 2] = chars[x >> 6 & 63];
+      out[n + 3] = chars[x & 63];
+   }
+
+   if (len - i == 1) {
+      x = (uint32_t)src[i] << 16;
+      out[n++] = chars[x >> 18];
+      out[n++] = chars[x >> 12 & 63];
+   } else if (len - i == 2) {
+      x = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8;
+      out[n++] = chars[x >> 18];
+      out[n++] = chars[x >> 12 & 63];
+      out[n++] = chars[x >> 6 & 63];
+   }
+
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* decodes len characters of unpadded base64, where c62 and c63 are the
+   characters for 62 and 63; returns DSTR_INVALID_ARGUMENT if it finds
+   anything else that isn't a digit or letter - FOR INTERNAL USE ONLY! */
+static int base64decode(unsigned char *out, const char *src, size_t len,
+const unsigned char *values, char c62, char c63) {
+
+   const unsigned char *s = (const unsigned char *)src;
+   size_t   i = 0, n = 0;
+   uint32_t a, b, c, d, x;
+
+#ifdef __SSE2__
+
+   {
+      __m128i v, up, lo, dg, p, q, valid;
+#ifndef __SSSE3__
+      uint32_t groups[4];
+      int      k;
+#endif
+
+      /* 16 characters at a time, leaving the last group for the loop below
+         so that the 16 bytes written never go past the end */
+      for (; i + 20 <= len; i += 16, n += 12) {
+
+         v = _mm_loadu_si128((const __m128i *)(src + i));
+
+         /* the signed compares also reject anything with the high bit set */
+         up = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), v));
+         lo = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), v));
+         dg = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+            _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+         p = _mm_cmpeq_epi8(v, _mm_set1_epi8(c62));
+         q = _mm_cmpeq_epi8(v, _mm_set1_epi8(c63));
+
+         /* let the loop below find out exactly what's wrong */
+         valid = _mm_or_si128(_mm_or_si128(up, lo), _mm_or_si128(dg,
+            _mm_or_si128(p, q)));
+         if (0xffff != _mm_movemask_epi8(valid)) {
+            break;
+         }
+
+         v = _mm_or_si128(
+            _mm_or_si128(
+               _mm_and_si128(up, _mm_sub_epi8(v, _mm_set1_epi8('A'))),
+               _mm_and_si128(lo, _mm_sub_epi8(v, _mm_set1_epi8('a' - 26)))),
+            _mm_or_si128(
+               _mm_and_si128(dg, _mm_add_epi8(v, _mm_set1_epi8(52 - '0'))),
+               _mm_or_si128(_mm_and_si128(p, _mm_set1_epi8(62)),
+                  _mm_and_si128(q, _mm_set1_epi8(63)))));
+
+         /* pairs of 6-bit values into 12 bits, then pairs of those into the
+            24 bits of each group */
+         v = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v,
+            _mm_set1_epi16(0x00ff)), 6), _mm_srli_epi16(v, 8));
+         v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+
+#ifdef __SSSE3__
+         _mm_storeu_si128((__m128i *)(out + n), _mm_shuffle_epi8(v,
+            _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+            -1)));
+#else
+         _mm_storeu_si128((__m128i *)groups, v);
+         for (k = 0; k < 4; k++) {
+            out[n + k * 3] = groups[k] >> 16;
+            out[n + k * 3 + 1] = groups[k] >> 8;
+            out[n + k * 3 + 2] = groups[k];
+         }
+#endif
+      }
+   }
+
+#endif
+
+   for (; i + 4 <= len; i += 4, n += 3) {
+      a = values[s[i]];
+      b = values[s[i + 1]];
+      c = values[s[i + 2]];
+      d = values[s[i + 3]];
+      if ((a | b | c | d) & 0x80) {
+         return DSTR_INVALID_ARGUMENT;
+      }
+      x = a << 18 | b << 12 | c << 6 | d;
+      out[n] = x >> 16;
+      out[n + 1] = x >> 8;
+      out[n + 2] = x;
+   }
+
+   /* 2 or 3 characters left over make 1 or 2 bytes */
+   if (len - i >= 2) {
+      a = values[s[i]];
+      b = values[s[i + 1]];
+      c = len - i == 3 ? values[s[i + 2]] : 0;
+      if ((a | b | c) & 0x80) {
+         return DSTR_INVALID_ARGUMENT;
+      }
+      x = a << 18 | b << 12 | c << 6;
+      /* the bits past the last whole byte must be 0, or the same bytes
+         would have more than one encoding ("QR==" as well as "QQ==") */
+      if (x & (len - i == 3 ? 0xff : 0xffff)) {
+         return DSTR_INVALID_ARGUMENT;
+      }
+      out[n] = x >> 16;
+      if (len - i == 3) {
+         out[n + 1] = x >> 8;
+      }
+   }
+
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* writes len bytes of src as pairs of hex digits and returns the number of
+   characters written - FOR INTERNAL USE ONLY! */
+static size_t hexencode(char *out, const unsigned char *src, size_t len,
+const char *digits) {
+
+   size_t i = 0;
+
+#ifdef __SSE2__
+
+   {
+      __m128i v, hi, lo, letters;
+
+      /* what to add to a nibble over 9 to make it a letter */
+      letters = _mm_set1_epi8(digits[10] - '0' - 10);
+
+      for (; i + 16 <= len; i += 16) {
+
+         v = _mm_loadu_si128((const __m128i *)(src + i));
+         hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+         lo = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+
+         hi = _mm_add_epi8(_mm_add_epi8(hi, _mm_set1_epi8('0')),
+            _mm_and_si128(_mm_cmpgt_epi8(hi, _mm_set1_epi8(9)), letters));
+         lo = _mm_add_epi8(_mm_add_epi8(lo, _mm_set1_epi8('0')),
+            _mm_and_si128(_mm_cmpgt_epi8(lo, _mm_set1_epi8(9)), letters));
+
+         _mm_storeu_si128((__m128i *)(out + i * 2), _mm_unpacklo_epi8(hi, lo));
+         _mm_storeu_si128((__m128i *)(out + i * 2 + 16),
+            _mm_unpackhi_epi8(hi, lo));
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      out[i * 2] = digits[src[i] >> 4];
+      out[i * 2 + 1] = digits[src[i] & 15];
+   }
+
+   return len * 2;
+}
+
+/* ************************************************************************* */
+
+/* decodes len (an even number) hex digits; returns DSTR_INVALID_ARGUMENT if
+   it finds something that isn't one - FOR INTERNAL USE ONLY! */
+static int hexdecode(unsigned char *out, const char *src, size_t len) {
+
+   const unsigned char *s = (const unsigned char *)src;
+   size_t i = 0;
+   unsigned int hi, lo;
+
+#ifdef __SSE2__
+
+   {
+      __m128i v[2], digit, letter, isdig, islet;
+      int     k;
+
+      /* 32 digits make 16 bytes */
+      for (; i + 32 <= len; i += 32) {
+
+         for (k = 0; k < 2; k++) {
+
+            v[k] = _mm_loadu_si128((const __m128i *)(src + i + k * 16));
+
+            /* unsigned range checks: x <= 9 if min(x, 9) == x */
+            digit = _mm_sub_epi8(v[k], _mm_set1_epi8('0'));
+            letter = _mm_sub_epi8(_mm_or_si128(v[k], _mm_set1_epi8(0x20)),
+               _mm_set1_epi8('a'));
+            isdig = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)),
+               digit);
+            islet = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)),
+               letter);
+
+            if (0xffff != _mm_movemask_epi8(_mm_or_si128(isdig,
+            islet))) {
+               return DSTR_INVALID_ARGUMENT;
+            }
+
+            v[k] = _mm_or_si128(_mm_and_si128(isdig, digit),
+               _mm_and_si128(islet, _mm_add_epi8(letter,
+               _mm_set1_epi8(10))));
+
+            /* each pair of nibbles into one byte, in a 16-bit lane */
+            v[k] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v[k],
+               _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(v[k], 8));
+         }
+
+         _mm_storeu_si128((__m128i *)(out + i / 2), _mm_packus_epi16(v[0],
+            v[1]));
+      }
+   }
+
+#endif
+
+   for (; i < len; i += 2) {
+      hi = hexvalues[s[i]];
+      lo = hexvalues[s[i + 1]];
+      if ((hi | lo) & 0x80) {
+         return DSTR_INVALID_ARGUMENT;
+      }
+      out[i / 2] = hi << 4 | lo;
+   }
+
+   return DSTR_SUCCESS;
+}
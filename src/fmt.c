@@ -0,0 +1,348 @@
+
+/* ************************************************************************* *\
+   * File: fmt.c                                                           *
+   * Purpose:                                                              *
+   *    Provides precompiled format strings for dstrsprintf() and a cache  *
+   *    of compiled formats keyed by their address                         *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+#include "static.h"
+#include "dstring.h"
+#include "sprintf.h"
+
+/* number of formats dstrcsprintf() can remember (must be a power of 2) */
+#define FMTCACHE_SIZE 512
+
+/* hashes a format's address into a slot in the cache */
+#define FMTHASH(P) ((size_t)(((uintptr_t)(P) >> 3) * 2654435761U) & \
+(FMTCACHE_SIZE - 1))
+
+/* entries are never removed (except by dstrfmtcacheclear()), so lookups
+   don't need a lock as long as the key is published after the format */
+#ifdef DSTR_PTHREAD
+static pthread_mutex_t fmtcachelock = PTHREAD_MUTEX_INITIALIZER;
+#define LOADKEY(I)     __atomic_load_n(&fmtcache[I].key, __ATOMIC_ACQUIRE)
+#define STOREKEY(I, K) __atomic_store_n(&fmtcache[I].key, (K), \
+__ATOMIC_RELEASE)
+#else
+#define LOADKEY(I)     (fmtcache[I].key)
+#define STOREKEY(I, K) (fmtcache[I].key = (K))
+#endif
+
+static struct {
+   const char *key;
+   dstrfmt_t fmt;
+} fmtcache[FMTCACHE_SIZE];
+
+static int fmtexec(struct output *out, const dstrfmt *fmt, va_list *args);
+static dstrfmt_t fmtcachelookup(const char *format);
+static dstrfmt_t fmtcacheinsert(const char *format);
+
+/* ************************************************************************* */
+
+int dstrfmtcompile(dstrfmt_t *fmtptr, const char *format) {
+
+   dstrfmt *fmt;
+   struct specifier conversion;
+   char *pos, *end, *literal;
+   size_t maxops = 1;
+
+   if (NULL == format) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return DSTR_NULL_CPTR;
+   }
+
+   /* every % can at most end one literal run and start a conversion */
+   for (pos = (char *)format; NULL != (pos = strchr(pos, '%')); pos++) {
+      maxops += 2;
+   }
+
+   if (NULL == (fmt = calloc(1, sizeof(dstrfmt)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   if (NULL == (fmt->format = malloc(strlen(format) + 1)) ||
+   NULL == (fmt->ops = malloc(maxops * sizeof(struct fmtop)))) {
+      free(fmt->format), free(fmt);
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   strcpy(fmt->format, format);
+
+   for (pos = literal = fmt->format; '\0' != *pos; pos = end) {
+
+      if ('%' != *pos || pos == (end = parsearg(pos, &conversion))) {
+         end = pos + 1;
+         continue;
+      }
+
+      /* %% is just the first % on the end of the current literal run */
+      if (PERCENT == (CONVERSIONBITS & conversion.format)) {
+         pos++;
+      }
+
+      if (pos > literal) {
+         fmt->ops[fmt->nops].conversion.format = 0;
+         fmt->ops[fmt->nops].literal = literal;
+         fmt->ops[fmt->nops].len = pos - literal;
+         fmt->literallen += pos - literal;
+         fmt->nops++;
+      }
+
+      if (PERCENT != (CONVERSIONBITS & conversion.format)) {
+         fmt->ops[fmt->nops++].conversion = conversion;
+      }
+
+      literal = end;
+   }
+
+   /* whatever's left over after the last conversion */
+   if (pos > literal) {
+      fmt->ops[fmt->nops].conversion.format = 0;
+      fmt->ops[fmt->nops].literal = literal;
+      fmt->ops[fmt->nops].len = pos - literal;
+      fmt->literallen += pos - literal;
+      fmt->nops++;
+   }
+
+   *fmtptr = fmt;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrfmtfree(dstrfmt_t *fmtptr) {
+
+   dstrfmt *fmt = *fmtptr;
+
+   if (NULL == fmt) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   free(fmt->ops);
+   free(fmt->format);
+   free(fmt);
+
+   *fmtptr = NULL;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrfmtprintf(dstring_t str, const dstrfmt_t fmt, ...) {
+
+   va_list args;
+   int chars;
+
+   va_start(args, fmt);
+   chars = dstrvfmtprintf(str, fmt, args);
+   va_end(args);
+
+   return chars;
+}
+
+/* ************************************************************************* */
+
+int dstrvfmtprintf(dstring_t str, const dstrfmt_t fmt, va_list args) {
+
+   struct output out;
+   va_list ap;
+   int r;
+
+   if (NULL == str || NULL == fmt) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return -1;
+   }
+
+   if (!DSTRWRITABLE(str)) {
+      return -1;
+   }
+
+   out.str = str;
+   out.len = out.start = 0;
+
+   va_copy(ap, args);
+   r = fmtexec(&out, fmt, &ap);
+   va_end(ap);
+
+   /* on error, leave nothing half-formatted behind, like dstrvsprintf() */
+   if (r < 0) {
+      DSTRBUF(str)[out.start] = '\0';
+      return -1;
+   }
+
+   DSTRBUF(str)[out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return out.len;
+}
+
+/* ************************************************************************* */
+
+int dstrcsprintf(dstring_t str, const char *format, ...) {
+
+   va_list args;
+   int chars;
+
+   va_start(args, format);
+   chars = dstrvcsprintf(str, format, args);
+   va_end(args);
+
+   return chars;
+}
+
+/* ************************************************************************* */
+
+int dstrvcsprintf(dstring_t str, const char *format, va_list args) {
+
+   dstrfmt_t fmt;
+
+   if (NULL == format) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return -1;
+   }
+
+   if (NULL == (fmt = fmtcachelookup(format)) &&
+   NULL == (fmt = fmtcacheinsert(format))) {
+      /* the cache is full, so do it the old-fashioned way */
+      return dstrvsprintf(str, format, args);
+   }
+
+   return dstrvfmtprintf(str, fmt, args);
+}
+
+/* ************************************************************************* */
+
+void dstrfmtcacheclear(void) {
+
+   size_t i;
+
+   for (i = 0; i < FMTCACHE_SIZE; i++) {
+      if (NULL != fmtcache[i].key) {
+         dstrfmtfree(&fmtcache[i].fmt);
+         fmtcache[i].key = NULL;
+      }
+   }
+}
+
+/* ************************************************************************* */
+
+/* writes out each literal run and conversion in turn */
+static int fmtexec(struct output *out, const dstrfmt *fmt, va_list *args) {
+
+   size_t i;
+
+   /* the literals are all we know about in advance */
+   if (DSTR_SUCCESS != outreserve(out, fmt->literallen +
+   fmt->nops * CONVERSION_ESTIMATE)) {
+      return -1;
+   }
+
+   for (i = 0; i < fmt->nops; i++) {
+      if (0 == fmt->ops[i].conversion.format) {
+         if (outwrite(out, fmt->ops[i].literal, fmt->ops[i].len) < 0) {
+            return -1;
+         }
+      } else if (appendarg(out, fmt->ops[i].conversion, args) < 0) {
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+/* ************************************************************************* */
+
+/* returns the compiled version of format, or NULL if it isn't cached */
+static dstrfmt_t fmtcachelookup(const char *format) {
+
+   const char *key;
+   size_t i, probes;
+
+   for (i = FMTHASH(format), probes = 0; probes < FMTCACHE_SIZE;
+   i = (i + 1) & (FMTCACHE_SIZE - 1), probes++) {
+      if (format == (key = LOADKEY(i))) {
+         return fmtcache[i].fmt;
+      } else if (NULL == key) {
+         break;
+      }
+   }
+
+   return NULL;
+}
+
+/* ************************************************************************* */
+
+/* compiles format and adds it to the cache, returning NULL if there's no
+   more room or not enough memory */
+static dstrfmt_t fmtcacheinsert(const char *format) {
+
+   dstrfmt_t fmt = NULL;
+   size_t i, probes;
+
+#ifdef DSTR_PTHREAD
+   pthread_mutex_lock(&fmtcachelock);
+#endif
+
+   for (i = FMTHASH(format), probes = 0; probes < FMTCACHE_SIZE;
+   i = (i + 1) & (FMTCACHE_SIZE - 1), probes++) {
+
+      /* another thread may have beaten us to it */
+      if (format == fmtcache[i].key) {
+         fmt = fmtcache[i].fmt;
+         break;
+      }
+
+      else if (NULL == fmtcache[i].key) {
+         if (DSTR_SUCCESS == dstrfmtcompile(&fmt, format)) {
+            fmtcache[i].fmt = fmt;
+            STOREKEY(i, format);
+         }
+         break;
+      }
+   }
+
+#ifdef DSTR_PTHREAD
+   pthread_mutex_unlock(&fmtcachelock);
+#endif
+
+   return fmt;
+}
@@ -54,6 +54,10 @@ int dstrpadl(dstring_t str, size_t n, char c) {
       return oldstrlen;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return oldstrlen;
+   }
+
    /* if n is 0, do nothing */
    if (0 == n) {
       _setdstrerrno(DSTR_SUCCESS);
@@ -106,6 +110,10 @@ int dstrpadr(dstring_t str, size_t n, char c) {
       return dstrlen(str);
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return strlen(DSTRBUF(str));
+   }
+
    /* if n is 0, do nothing */
    if (0 == n) {
       _setdstrerrno(DSTR_SUCCESS);
@@ -173,6 +181,10 @@ int dstrtoupper(dstring_t str, size_t index) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    len = dstrlen(str);
 
    /* make sure the index is not invalid */
@@ -202,6 +214,10 @@ int dstrtolower(dstring_t str, size_t index) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    len = dstrlen(str);
 
    /* make sure the index is not invalid */
@@ -231,6 +247,10 @@ int dstrntoupper(dstring_t str, size_t index, size_t n) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    len = dstrlen(str);
 
    /* make sure the index is not invalid */
@@ -266,6 +286,10 @@ int dstrntolower(dstring_t str, size_t index, size_t n) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    len = dstrlen(str);
 
    /* make sure the index is not invalid */
@@ -0,0 +1,232 @@
+
+/* ************************************************************************* *\
+   * File: hash.c                                                          *
+   * Purpose:                                                              *
+   *    Provides a fast, seeded, non-cryptographic hash of a dstring_t,    *
+   *    remembered until the string changes                               *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* The hash is wyhash (final version 4, by Wang Yi, released into the public
+   domain): 48 bytes per round are folded into three independent lanes with
+   64x64->128 bit multiplies, and anything up to 16 bytes takes a single
+   multiply.  It passes SMHasher, and a secret seed keeps anyone who doesn't
+   know it from choosing keys that collide. */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "static.h"
+#include "dstring.h"
+
+/* wyhash's default secret: four odd 64-bit constants, each with 32 bits set
+   and no byte that's all ones or all zeros */
+#define HASH_SECRET0 ((uint64_t)0xa0761d6478bd642fULL)
+#define HASH_SECRET1 ((uint64_t)0xe7037ed1a0b428dbULL)
+#define HASH_SECRET2 ((uint64_t)0x8ebc6af09c88c6e3ULL)
+#define HASH_SECRET3 ((uint64_t)0x589965cc75374cc3ULL)
+
+static uint64_t hashmix(uint64_t a, uint64_t b);
+static void     hashmul(uint64_t *a, uint64_t *b);
+static uint64_t read8(const unsigned char *p);
+static uint64_t read4(const unsigned char *p);
+
+/* ************************************************************************* */
+
+uint64_t dstrhash(const dstring_t str, uint64_t seed) {
+
+   uint64_t hash;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if ((DSTRREF(str)->cached & DSTR_CACHE_HASH) &&
+   DSTRREF(str)->hashseed == seed) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return DSTRREF(str)->hash;
+   }
+
+   hash = _dstrhashbytes(DSTRBUF(str), strlen(DSTRBUF(str)), seed);
+
+   /* a pool's string may be hashed by several threads at once, so it only
+      remembers the hash it was interned with */
+   if (!(DSTRREF(str)->flags & DSTR_FLAG_POOLED)) {
+      DSTRREF(str)->hash = hash;
+      DSTRREF(str)->hashseed = seed;
+      DSTRREF(str)->cached |= DSTR_CACHE_HASH;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return hash;
+}
+
+/* ************************************************************************* */
+
+uint64_t dstrhashcs(const char *src, uint64_t seed) {
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return _dstrhashbytes(src, strlen(src), seed);
+}
+
+/* ************************************************************************* */
+
+uint64_t dstrnhashcs(const char *src, size_t n, uint64_t seed) {
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return _dstrhashbytes(src, n, seed);
+}
+
+/* ************************************************************************* */
+
+/* hashes len bytes at data, for dstrhash() and the other hash functions
+   in the library - FOR INTERNAL USE ONLY! */
+uint64_t _dstrhashbytes(const void *data, size_t len, uint64_t seed) {
+
+   const unsigned char *p = data;
+   uint64_t             a, b, lane1, lane2;
+   size_t               i = len;
+
+   seed ^= hashmix(seed ^ HASH_SECRET0, HASH_SECRET1);
+
+   if (len <= 16) {
+
+      /* two overlapping 4 byte reads from each end cover 4 to 16 bytes */
+      if (len >= 4) {
+         a = read4(p) << 32 | read4(p + (len >> 3 << 2));
+         b = read4(p + len - 4) << 32 | read4(p + len - 4 - (len >> 3 << 2));
+      } else if (len > 0) {
+         a = (uint64_t)p[0] << 16 | (uint64_t)p[len >> 1] << 8 | p[len - 1];
+         b = 0;
+      } else {
+         a = b = 0;
+      }
+   }
+
+   else {
+
+      if (i > 48) {
+
+         lane1 = lane2 = seed;
+
+         do {
+            seed = hashmix(read8(p) ^ HASH_SECRET1, read8(p + 8) ^ seed);
+            lane1 = hashmix(read8(p + 16) ^ HASH_SECRET2,
+               read8(p + 24) ^ lane1);
+            lane2 = hashmix(read8(p + 32) ^ HASH_SECRET3,
+               read8(p + 40) ^ lane2);
+            p += 48;
+            i -= 48;
+         } while (i > 48);
+
+         seed ^= lane1 ^ lane2;
+      }
+
+      while (i > 16) {
+         seed = hashmix(read8(p) ^ HASH_SECRET1, read8(p + 8) ^ seed);
+         p += 16;
+         i -= 16;
+      }
+
+      /* the last 16 bytes, which may overlap what's already been read */
+      a = read8(p + i - 16);
+      b = read8(p + i - 8);
+   }
+
+   a ^= HASH_SECRET1;
+   b ^= seed;
+   hashmul(&a, &b);
+
+   return hashmix(a ^ HASH_SECRET0 ^ (uint64_t)len, b ^ HASH_SECRET1);
+}
+
+/* ************************************************************************* */
+
+/* the full 128 bit product of a and b, folded into 64 bits */
+static uint64_t hashmix(uint64_t a, uint64_t b) {
+
+   hashmul(&a, &b);
+   return a ^ b;
+}
+
+/* replaces a and b with the low and high halves of their product */
+static void hashmul(uint64_t *a, uint64_t *b) {
+
+#ifdef __SIZEOF_INT128__
+
+   unsigned __int128 p = (unsigned __int128)*a * *b;
+
+   *a = (uint64_t)p;
+   *b = (uint64_t)(p >> 64);
+
+#else
+
+   uint64_t a0 = *a & 0xFFFFFFFF, a1 = *a >> 32;
+   uint64_t b0 = *b & 0xFFFFFFFF, b1 = *b >> 32;
+   uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+   uint64_t middle = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+
+   *a = (middle << 32) | (p00 & 0xFFFFFFFF);
+   *b = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+
+#endif
+}
+
+/* ************************************************************************* */
+
+/* unaligned reads in the machine's byte order, so hashes are only
+   comparable between machines that have the same one */
+
+static uint64_t read8(const unsigned char *p) {
+
+   uint64_t v;
+
+   memcpy(&v, p, 8);
+   return v;
+}
+
+static uint64_t read4(const unsigned char *p) {
+
+   uint32_t v;
+
+   memcpy(&v, p, 4);
+   return v;
+}
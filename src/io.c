@@ -34,11 +34,32 @@
 \* ************************************************************************* */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#else
+struct iovec {
+   void   *iov_base;
+   size_t  iov_len;
+};
+#endif
 
 #include "static.h"
 #include "dstring.h"
 
+/* the most buffers a single call to writev() will accept */
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* number of iovec structures dstrfdwritev() keeps on the stack */
+#define IOV_STACK_SIZE 64
+
 /* ************************************************************************* */
 
 size_t dstrfreadl(dstring_t dest, FILE *fp) {
@@ -56,6 +77,10 @@ size_t dstrfreadl(dstring_t dest, FILE *fp) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* make sure fp is an opened file */
    if (NULL == fp) {
       _setdstrerrno(DSTR_UNOPENED_FILE);
@@ -151,6 +176,10 @@ size_t dstrfreadn(dstring_t dest, FILE *fp, size_t n) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
    /* make sure fp is an opened file */
    if (NULL == fp) {
       _setdstrerrno(DSTR_UNOPENED_FILE);
@@ -281,3 +310,400 @@ size_t dstrfcatn(dstring_t dest, FILE *fp, size_t n) {
    _setdstrerrno(olddstrerrno);
    return count;
 }
+
+/* ************************************************************************* */
+
+size_t dstrfwrite(const dstring_t src, FILE *fp) {
+
+   size_t len;       /* number of characters in src */
+   size_t count;     /* number of characters written to fp */
+
+   /* make sure src is initialized */
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   /* make sure fp is an opened file */
+   if (NULL == fp) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   /* nothing to do for an empty string */
+   if (0 == (len = strlen(DSTRBUF(src)))) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   /* write the whole buffer at once instead of character by character */
+   count = fwrite((const void *)DSTRBUF(src), sizeof(char), len, fp);
+   if (count < len) {
+      _setdstrerrno(DSTR_WRITE_ERROR);
+      return count;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return count;
+}
+
+/* ************************************************************************* */
+
+size_t dstrfdwrite(const dstring_t src, int fd) {
+
+   const char *bufpos;    /* next character to be written */
+   size_t      remaining; /* number of characters left to write */
+   ssize_t     written;   /* return value of write() */
+
+   /* make sure src is initialized */
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   /* make sure we were given something that looks like a file descriptor */
+   if (fd < 0) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   bufpos = DSTRBUF(src);
+   remaining = strlen(bufpos);
+
+   /* keep going until everything's been written (write() may be partial) */
+   while (remaining > 0) {
+
+      written = write(fd, bufpos, remaining);
+
+      if (written < 0) {
+         /* we were interrupted by a signal before anything was written */
+         if (EINTR == errno) {
+            continue;
+         }
+         /* a non-blocking descriptor is full; the rest can be written
+            later with dstrfdwritefrom() */
+         if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            _setdstrerrno(DSTR_WOULDBLOCK);
+            return bufpos - DSTRBUF(src);
+         }
+         _setdstrerrno(DSTR_WRITE_ERROR);
+         return bufpos - DSTRBUF(src);
+      }
+
+      /* nothing was written and nothing went wrong, so trying again would
+         just go around in circles */
+      if (0 == written) {
+         _setdstrerrno(DSTR_WRITE_ERROR);
+         return bufpos - DSTRBUF(src);
+      }
+
+      bufpos += written;
+      remaining -= written;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return bufpos - DSTRBUF(src);
+}
+
+/* ************************************************************************* */
+
+size_t dstrfdwritev(const dstring_t *srcs, size_t n, int fd) {
+
+   struct iovec  stackiov[IOV_STACK_SIZE];
+   struct iovec *iov = stackiov;    /* one iovec per non-empty string */
+
+   size_t iovcount = 0;             /* number of iovecs actually in use */
+   size_t first = 0;                /* first iovec that isn't fully written */
+   size_t batch;                    /* number of iovecs passed to writev() */
+   size_t total = 0;                /* total characters written to fd */
+   size_t i;
+
+   ssize_t written;                 /* return value of writev() */
+
+   /* make sure srcs points to something */
+   if (NULL == srcs) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   /* make sure we were given something that looks like a file descriptor */
+   if (fd < 0) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   /* nothing to do */
+   if (0 == n) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   /* make sure every string is initialized before we write anything */
+   for (i = 0; i < n; i++) {
+      if (NULL == srcs[i]) {
+         _setdstrerrno(DSTR_UNINITIALIZED);
+         return 0;
+      }
+   }
+
+   /* only go to the heap if there are too many strings for the stack */
+   if (n > IOV_STACK_SIZE) {
+      if (NULL == (iov = malloc(n * sizeof(struct iovec)))) {
+         _setdstrerrno(DSTR_NOMEM);
+         return 0;
+      }
+   }
+
+   /* point an iovec at each string's buffer, skipping empty strings */
+   for (i = 0; i < n; i++) {
+      iov[iovcount].iov_base = (void *)DSTRBUF(srcs[i]);
+      iov[iovcount].iov_len = strlen(DSTRBUF(srcs[i]));
+      if (iov[iovcount].iov_len > 0) {
+         iovcount++;
+      }
+   }
+
+   /* normally, this loop will only execute once */
+   while (first < iovcount) {
+
+      batch = iovcount - first > IOV_MAX ? IOV_MAX : iovcount - first;
+
+#ifdef HAVE_WRITEV
+      written = writev(fd, iov + first, batch);
+#else
+      /* without writev(), we have to write one buffer at a time */
+      batch = 1;
+      written = write(fd, iov[first].iov_base, iov[first].iov_len);
+#endif
+
+      if (written < 0) {
+         /* we were interrupted by a signal before anything was written */
+         if (EINTR == errno) {
+            continue;
+         }
+         if (iov != stackiov) {
+            free(iov);
+         }
+         _setdstrerrno(EAGAIN == errno || EWOULDBLOCK == errno ?
+            DSTR_WOULDBLOCK : DSTR_WRITE_ERROR);
+         return total;
+      }
+
+      /* nothing was written and nothing went wrong, so trying again would
+         just go around in circles */
+      if (0 == written) {
+         if (iov != stackiov) {
+            free(iov);
+         }
+         _setdstrerrno(DSTR_WRITE_ERROR);
+         return total;
+      }
+
+      total += written;
+
+      /* skip past any buffers that were completely written... */
+      while (first < iovcount && (size_t)written >= iov[first].iov_len) {
+         written -= iov[first].iov_len;
+         first++;
+      }
+
+      /* ...and adjust the one that was only partially written, if any */
+      if (written > 0) {
+         iov[first].iov_base = (char *)iov[first].iov_base + written;
+         iov[first].iov_len -= written;
+      }
+   }
+
+   if (iov != stackiov) {
+      free(iov);
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return total;
+}
+
+/* ************************************************************************* */
+
+/* does the work for dstrfdcat() and dstrfdcatn(); limit is the maximum
+   number of characters to read - FOR INTERNAL USE ONLY! */
+static size_t fdcat(dstring_t dest, int fd, size_t limit) {
+
+   size_t  len;               /* current length of the string */
+   size_t  spare;             /* room left in the buffer (not counting '\0') */
+   size_t  count = 0;         /* number of characters read so far */
+   size_t  newsize;           /* size to grow the buffer to */
+   ssize_t r;                 /* return value of read() */
+
+   len = strlen(DSTRBUF(dest));
+
+   /* if we know how much we might read, make room for all of it up front */
+   if ((size_t)-1 != limit && DSTRBUFLEN(dest) < len + limit + 1) {
+      if (DSTR_SUCCESS != dstrealloc(&dest, len + limit + 1)) {
+         return 0;
+      }
+   }
+
+   while (count < limit) {
+
+      /* make sure there's some room to read into */
+      if (DSTRBUFLEN(dest) - len - 1 == 0) {
+         newsize = DSTRBUFLEN(dest) * 2;
+         if (DSTR_SUCCESS != dstrealloc(&dest, newsize)) {
+            /* dstrealloc() leaves the string alone, so keep what we got */
+            return count;
+         }
+      }
+
+      spare = DSTRBUFLEN(dest) - len - 1;
+      if (spare > limit - count) {
+         spare = limit - count;
+      }
+
+      r = read(fd, DSTRBUF(dest) + len, spare);
+
+      if (r < 0) {
+         /* we were interrupted by a signal before anything was read */
+         if (EINTR == errno) {
+            continue;
+         }
+         /* we've drained everything that was available */
+         if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            _setdstrerrno(count > 0 ? DSTR_SUCCESS : DSTR_WOULDBLOCK);
+            return count;
+         }
+         _setdstrerrno(DSTR_FILE_ERROR);
+         return count;
+      }
+
+      /* the other end was closed */
+      if (0 == r) {
+         _setdstrerrno(DSTR_EOF);
+         return count;
+      }
+
+      len += r;
+      count += r;
+      DSTRBUF(dest)[len] = '\0';
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return count;
+}
+
+/* ************************************************************************* */
+
+size_t dstrfdcat(dstring_t dest, int fd) {
+
+   /* make sure dest is initialized */
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   /* make sure we were given something that looks like a file descriptor */
+   if (fd < 0) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   return fdcat(dest, fd, (size_t)-1);
+}
+
+/* ************************************************************************* */
+
+size_t dstrfdcatn(dstring_t dest, int fd, size_t n) {
+
+   /* make sure dest is initialized */
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   /* make sure we were given something that looks like a file descriptor */
+   if (fd < 0) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   /* if n is 0, return DSTR_SUCCESS without doing anything */
+   if (0 == n) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   return fdcat(dest, fd, n);
+}
+
+/* ************************************************************************* */
+
+size_t dstrfdwritefrom(const dstring_t src, size_t index, int fd) {
+
+   const char *bufpos;    /* next character to be written */
+   size_t      remaining; /* number of characters left to write */
+   size_t      count = 0; /* number of characters written so far */
+   ssize_t     written;   /* return value of write() */
+
+   /* make sure src is initialized */
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   /* make sure we were given something that looks like a file descriptor */
+   if (fd < 0) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return 0;
+   }
+
+   remaining = strlen(DSTRBUF(src));
+
+   /* writing from the end of the string is allowed, but does nothing */
+   if (index > remaining) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return 0;
+   }
+
+   bufpos = DSTRBUF(src) + index;
+   remaining -= index;
+
+   while (remaining > 0) {
+
+      written = write(fd, bufpos, remaining);
+
+      if (written < 0) {
+         /* we were interrupted by a signal before anything was written */
+         if (EINTR == errno) {
+            continue;
+         }
+         /* the descriptor can't take any more right now */
+         if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            _setdstrerrno(count > 0 ? DSTR_SUCCESS : DSTR_WOULDBLOCK);
+            return count;
+         }
+         _setdstrerrno(DSTR_WRITE_ERROR);
+         return count;
+      }
+
+      /* nothing was written and nothing went wrong, so trying again would
+         just go around in circles */
+      if (0 == written) {
+         _setdstrerrno(DSTR_WRITE_ERROR);
+         return count;
+      }
+
+      bufpos += written;
+      count += written;
+      remaining -= written;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return count;
+}
@@ -0,0 +1,507 @@
+
+/* ************************************************************************* *\
+   * File: json.c                                                          *
+   * Purpose:                                                              *
+   *    Provides JSON string escaping and a builder that writes JSON       *
+   *    objects and arrays straight into a dstring_t                       *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+#include "sprintf.h"
+
+/* how deeply objects and arrays can be nested */
+#define JSON_MAXDEPTH 64
+
+/* what kind of container each level of nesting is */
+#define JSON_OBJECT  0x01
+#define JSON_ARRAY   0x02
+#define JSON_MEMBERS 0x04     /* something has already been written to it */
+
+/* what the opaque datatype dstrjson_t points to */
+typedef struct {
+   struct output out;                     /* where the next value goes */
+   int           depth;                   /* 0 when nothing is open */
+   unsigned char levels[JSON_MAXDEPTH + 1];
+} dstrjson;
+
+#define JSONREF(X) ((dstrjson *)(X))
+
+/* kinds of values for jsonvalue() */
+enum {
+   JSON_STRING, JSON_INT, JSON_UINT, JSON_DOUBLE, JSON_LITERAL, JSON_OPEN
+};
+
+/* for each byte, 0 if it can be copied as-is, otherwise the character that
+   follows the backslash ('u' means \u00XX) */
+static const char jsonescapes[UCHAR_MAX + 1] = {
+   'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r',
+   'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+   'u', 'u', 'u', 'u',
+   ['"'] = '"', ['\\'] = '\\'
+};
+
+/* bytes in a word that are less than N, or equal to C (any byte, if the
+   word contains one; the exact positions aren't reliable) */
+#define SWAR_ONES     ((uint64_t)0x0101010101010101ULL)
+#define SWAR_HIGHS    ((uint64_t)0x8080808080808080ULL)
+#define SWAR_LESS(X, N) (((X) - SWAR_ONES * (N)) & ~(X) & SWAR_HIGHS)
+#define SWAR_HAS(X, C)  SWAR_LESS((X) ^ (SWAR_ONES * (C)), 1)
+
+static size_t jsonclean(const char *src, size_t n);
+static int outjson(struct output *out, const char *src, size_t n);
+static int jsonvalue(dstrjson_t json, const char *key, int type,
+   const void *value);
+
+/* ************************************************************************* */
+
+int dstrcatjson(dstring_t dest, const char *src) {
+
+   struct output out;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   out.str = dest;
+   out.len = out.start = dstrlen(dest);
+
+   /* if there isn't enough memory, the string is untouched */
+   if (outjson(&out, src, strlen(src)) < 0) {
+      DSTRBUF(dest)[out.start] = '\0';
+      _setdstrerrno(DSTR_NOMEM);
+      return 0;
+   }
+
+   DSTRBUF(dest)[out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return out.len - out.start;
+}
+
+/* ************************************************************************* */
+
+int dstrjsonopen(dstrjson_t *jsonptr, dstring_t dest) {
+
+   dstrjson *json;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return DSTR_READONLY;
+   }
+
+   if (NULL == (json = calloc(1, sizeof(dstrjson)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   json->out.str = dest;
+   json->out.len = json->out.start = dstrlen(dest);
+
+   *jsonptr = json;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrjsonclose(dstrjson_t *jsonptr) {
+
+   int status = DSTR_SUCCESS;
+
+   if (NULL == *jsonptr) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   /* finish anything that was left open */
+   while (JSONREF(*jsonptr)->depth > 0 && DSTR_SUCCESS == status) {
+      status = dstrjsonend(*jsonptr);
+   }
+
+   free(*jsonptr);
+   *jsonptr = NULL;
+
+   _setdstrerrno(status);
+   return status;
+}
+
+/* ************************************************************************* */
+
+int dstrjsonsync(dstrjson_t json) {
+
+   if (NULL == json) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   JSONREF(json)->out.len = dstrlen(JSONREF(json)->out.str);
+   JSONREF(json)->depth = 0;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrjsonobject(dstrjson_t json, const char *key) {
+
+   unsigned char type = JSON_OBJECT;
+
+   return jsonvalue(json, key, JSON_OPEN, &type);
+}
+
+/* ************************************************************************* */
+
+int dstrjsonarray(dstrjson_t json, const char *key) {
+
+   unsigned char type = JSON_ARRAY;
+
+   return jsonvalue(json, key, JSON_OPEN, &type);
+}
+
+/* ************************************************************************* */
+
+int dstrjsonend(dstrjson_t json) {
+
+   dstrjson *j = JSONREF(json);
+   size_t    mark;
+
+   if (NULL == json) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   /* there's nothing to end */
+   if (0 == j->depth) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return DSTR_INVALID_ARGUMENT;
+   }
+
+   if (!DSTRWRITABLE(j->out.str)) {
+      return DSTR_READONLY;
+   }
+   mark = j->out.len;
+
+   /* a finished top-level value is followed by a newline, so that a
+      series of them can be read back one per line */
+   if (outwrite(&j->out, j->levels[j->depth] & JSON_OBJECT ? "}" : "]",
+   1) < 0 || (1 == j->depth && outwrite(&j->out, "\n", 1) < 0)) {
+      j->out.len = mark;
+      DSTRBUF(j->out.str)[mark] = '\0';
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   j->depth--;
+   DSTRBUF(j->out.str)[j->out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrjsonstring(dstrjson_t json, const char *key, const char *value) {
+   return jsonvalue(json, key, JSON_STRING, value);
+}
+
+/* ************************************************************************* */
+
+int dstrjsonint(dstrjson_t json, const char *key, long int value) {
+   return jsonvalue(json, key, JSON_INT, &value);
+}
+
+/* ************************************************************************* */
+
+int dstrjsonuint(dstrjson_t json, const char *key, unsigned long int value) {
+   return jsonvalue(json, key, JSON_UINT, &value);
+}
+
+/* ************************************************************************* */
+
+int dstrjsondouble(dstrjson_t json, const char *key, double value) {
+   return jsonvalue(json, key, JSON_DOUBLE, &value);
+}
+
+/* ************************************************************************* */
+
+int dstrjsonbool(dstrjson_t json, const char *key, int value) {
+   return jsonvalue(json, key, JSON_LITERAL, value ? "true" : "false");
+}
+
+/* ************************************************************************* */
+
+int dstrjsonnull(dstrjson_t json, const char *key) {
+   return jsonvalue(json, key, JSON_LITERAL, "null");
+}
+
+/* ************************************************************************* */
+
+/* writes a single value (or the start of an object or array), preceded by
+   a comma and its key as needed; if anything goes wrong, nothing is
+   written */
+static int jsonvalue(dstrjson_t json, const char *key, int type,
+const void *value) {
+
+   dstrjson         *j = JSONREF(json);
+   struct output    *out;
+   struct specifier  conversion = {0, 0, 0};
+   unsigned char     level;
+   size_t            mark;
+   double            d;
+   int               status = 0;
+
+   if (NULL == json) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   out = &j->out;
+   if (!DSTRWRITABLE(out->str)) {
+      return DSTR_READONLY;
+   }
+   level = j->levels[j->depth];
+
+   /* members of an object need a key */
+   if ((level & JSON_OBJECT && NULL == key) ||
+   (JSON_STRING == type && NULL == value)) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return DSTR_NULL_CPTR;
+   }
+
+   if (JSON_OPEN == type && JSON_MAXDEPTH == j->depth) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return DSTR_INVALID_ARGUMENT;
+   }
+
+   mark = out->len;
+
+   if (level & JSON_MEMBERS) {
+      status = outwrite(out, ",", 1);
+   }
+
+   if (0 == status && level & JSON_OBJECT) {
+      if (0 == (status = outjson(out, key, strlen(key)))) {
+         status = outwrite(out, ":", 1);
+      }
+   }
+
+   if (0 == status) {
+
+      switch (type) {
+
+         case JSON_STRING:
+            status = outjson(out, value, strlen(value));
+            break;
+
+         case JSON_INT:
+            status = appendsignedint(out, conversion, *(const long *)value,
+               10);
+            break;
+
+         case JSON_UINT:
+            status = appendunsignedint(out, conversion,
+               *(const unsigned long *)value, 10);
+            break;
+
+         /* JSON has no way to write infinity or NaN */
+         case JSON_DOUBLE:
+            d = *(const double *)value;
+            if (d - d != d - d) {
+               status = outwrite(out, "null", 4);
+            } else {
+               conversion.format = FLOAT_SHORTEST;
+               status = appendfloat(out, conversion, d);
+            }
+            break;
+
+         case JSON_LITERAL:
+            status = outwrite(out, value, strlen(value));
+            break;
+
+         case JSON_OPEN:
+            status = outwrite(out, JSON_OBJECT ==
+               *(const unsigned char *)value ? "{" : "[", 1);
+            break;
+      }
+   }
+
+   /* a top-level value that isn't a container is finished already */
+   if (0 == status && 0 == j->depth && JSON_OPEN != type) {
+      status = outwrite(out, "\n", 1);
+   }
+
+   if (status < 0) {
+      out->len = mark;
+      DSTRBUF(out->str)[mark] = '\0';
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   if (j->depth > 0) {
+      j->levels[j->depth] |= JSON_MEMBERS;
+   }
+
+   if (JSON_OPEN == type) {
+      j->levels[++j->depth] = *(const unsigned char *)value;
+   }
+
+   DSTRBUF(out->str)[out->len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* returns the length of the longest prefix of src that doesn't need to be
+   escaped, looking at 16 (or 8) bytes at a time */
+static size_t jsonclean(const char *src, size_t n) {
+
+   size_t i = 0;
+
+#ifdef __SSE2__
+
+   const __m128i quote = _mm_set1_epi8('"');
+   const __m128i backslash = _mm_set1_epi8('\\');
+   const __m128i control = _mm_set1_epi8(0x1f);
+   __m128i v, m;
+   int mask;
+
+   for (; i + 16 <= n; i += 16) {
+
+      v = _mm_loadu_si128((const __m128i *)(src + i));
+
+      /* v <= 0x1f (unsigned) exactly when min(v, 0x1f) == v */
+      m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+         _mm_cmpeq_epi8(v, backslash)),
+         _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+
+      if (0 != (mask = _mm_movemask_epi8(m))) {
+         return i + __builtin_ctz(mask);
+      }
+   }
+
+#else
+
+   uint64_t w;
+
+   for (; i + 8 <= n; i += 8) {
+      memcpy(&w, src + i, 8);
+      if (SWAR_LESS(w, 0x20) | SWAR_HAS(w, '"') | SWAR_HAS(w, '\\')) {
+         break;
+      }
+   }
+
+#endif
+
+   while (i < n && 0 == jsonescapes[(unsigned char)src[i]]) {
+      i++;
+   }
+
+   return i;
+}
+
+/* ************************************************************************* */
+
+/* writes n bytes of src as a quoted JSON string; bytes outside of ASCII
+   are copied as-is, so UTF-8 stays UTF-8 */
+static int outjson(struct output *out, const char *src, size_t n) {
+
+   static const char hex[] = "0123456789abcdef";
+
+   size_t clean;
+   char   *p;
+   char   c;
+
+   /* usually there's nothing to escape, and this is all we need */
+   if (DSTR_SUCCESS != outreserve(out, n + 2)) {
+      return -1;
+   }
+
+   DSTRBUF(out->str)[out->len++] = '"';
+
+   for (;;) {
+
+      clean = jsonclean(src, n);
+
+      if (DSTR_SUCCESS != outreserve(out, clean + 7)) {
+         return -1;
+      }
+
+      memcpy(DSTRBUF(out->str) + out->len, src, clean);
+      out->len += clean;
+
+      if (clean == n) {
+         break;
+      }
+
+      c = jsonescapes[(unsigned char)src[clean]];
+      p = DSTRBUF(out->str) + out->len;
+      *p++ = '\\';
+      *p++ = c;
+
+      if ('u' == c) {
+         *p++ = '0';
+         *p++ = '0';
+         *p++ = hex[(unsigned char)src[clean] >> 4];
+         *p++ = hex[(unsigned char)src[clean] & 0x0f];
+      }
+
+      out->len = p - DSTRBUF(out->str);
+      src += clean + 1;
+      n -= clean + 1;
+   }
+
+   DSTRBUF(out->str)[out->len++] = '"';
+   return 0;
+}
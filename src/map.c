@@ -0,0 +1,1369 @@
+
+/* ************************************************************************* *\
+   * File: map.c                                                           *
+   * Purpose:                                                              *
+   *    Provides dstrmap_t, a hash map from strings to pointers,           *
+   *    dstrcmap_t, a version of it that threads can share, and            *
+   *    dstrpool_t, a pool of interned strings built on the same tables    *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+/* The map is a "Swiss table": open addressing, with a separate array of one
+   control byte per slot.  A control byte is MAP_EMPTY, MAP_DELETED, or the
+   low 7 bits of the hash of the key in that slot.  Slots are probed 16 at a
+   time, in groups: one SSE2 compare finds every slot in a group whose
+   control byte matches the key's 7 bits, and only those slots (almost
+   always the right one, or none) are looked at.  A group with an empty
+   slot ends the search.
+
+   Keys shorter than MAP_INLINE bytes are kept in the slot itself, which
+   makes a slot 32 bytes, two to a cache line: a lookup that finds its key
+   usually touches one line of control bytes and one of slots.  Slots don't
+   keep the full hash (it would make them 40 bytes, and 7 matching bits
+   already rule out all but 1 in 128 wrong keys), so growing the table
+   hashes each key again.
+
+   A dstrcmap_t is CMAP_SHARDS of these tables, each behind its own
+   read-write lock, with the top bits of a key's hash choosing the shard.
+   Threads only wait for each other when they use the same shard at the
+   same time and one of them is changing it, and nobody ever holds on to
+   anything in a shard after unlocking it, so whatever a change removes
+   (a key's copy, or the old table when one grows) is freed on the spot.
+
+   A dstrpool_t is one of these tables (or CMAP_SHARDS of them, if threads
+   are to share it) mapping each string's contents to the string.  The
+   strings, header and buffer together, are carved out of large chunks of
+   memory that belong to the pool, and each one is its own key: the table
+   points at its buffer instead of keeping a copy. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+#ifdef DSTR_PTHREAD
+#include <pthread.h>
+#endif
+
+/* slots per group */
+#define MAP_GROUP 16
+
+/* keys shorter than this are stored in the slot, with a '\0' after them */
+#define MAP_INLINE 16
+
+/* the slots start on a cache line, so that none of them straddles two */
+#define MAP_ALIGN 64
+
+/* control bytes; anything with the high bit clear is a full slot */
+#define MAP_EMPTY   0x80
+#define MAP_DELETED 0xfe
+
+/* the table grows once it's 7/8 full (counting deleted slots) */
+#define MAP_MAXLOAD(CAPACITY) ((CAPACITY) - (CAPACITY) / 8)
+
+/* the two parts of a hash: which group to start at, and the 7 bits kept in
+   the control byte */
+#define MAP_H1(HASH) ((HASH) >> 7)
+#define MAP_H2(HASH) ((unsigned char)((HASH) & 0x7f))
+
+typedef struct {
+   size_t   len;
+   union {
+      char  bytes[MAP_INLINE];
+      char *ptr;
+   } key;
+   void    *value;
+} mapslot;
+
+/* what the opaque datatype dstrmap_t points to */
+typedef struct {
+   void          *table;                 /* slots and ctrl, in one block */
+   unsigned char *ctrl;                  /* capacity control bytes */
+   mapslot       *slots;                 /* capacity slots, cache aligned */
+   size_t         capacity;              /* a power of 2, at least
+                                            MAP_GROUP */
+   size_t         size;                  /* full slots */
+   size_t         deleted;               /* MAP_DELETED slots */
+   uint64_t       seed;
+   int            borrowed;              /* keys of MAP_INLINE bytes or
+                                            more aren't copied, and
+                                            belong to someone else */
+} dstrmap;
+
+#define MAPREF(X) ((dstrmap *)(X))
+
+#define MAPKEY(SLOT) ((SLOT)->len < MAP_INLINE ? (SLOT)->key.bytes : \
+   (SLOT)->key.ptr)
+
+/* shards in a dstrcmap_t, as a power of 2; 64 keeps 32 threads from
+   running into each other very often */
+#define CMAP_SHARDBITS 6
+#define CMAP_SHARDS    (1 << CMAP_SHARDBITS)
+
+/* one shard of a dstrcmap_t: a table and the lock that protects it, padded
+   out so that threads using neighboring shards don't fight over a cache
+   line (or the pair of them that's fetched together) */
+typedef union {
+   struct {
+      dstrmap          map;
+#ifdef DSTR_PTHREAD
+      pthread_rwlock_t lock;
+#endif
+   } s;
+   char pad[2 * MAP_ALIGN];
+} cmapshard;
+
+/* what the opaque datatype dstrcmap_t points to; the shards come right
+   after it, in the same block */
+typedef struct {
+   cmapshard *shards;                    /* CMAP_SHARDS, cache aligned */
+   uint64_t   seed;                      /* shared by every shard */
+} dstrcmap;
+
+#define CMAPREF(X) ((dstrcmap *)(X))
+
+/* the shard a key with the given hash belongs in; the Swiss table uses the
+   low bits, so the shard comes from the high ones */
+#define CMAPSHARD(MAP, HASH) (&(MAP)->shards[(HASH) >> (64 - CMAP_SHARDBITS)])
+
+/* the memory interned strings are carved out of, one chunk at a time; a
+   chunk's header is followed by size bytes, used of which are taken */
+typedef struct poolchunk {
+   struct poolchunk *next;
+   size_t            size;
+   size_t            used;
+} poolchunk;
+
+/* the first chunk in each of a pool's arenas is POOL_CHUNKMIN bytes, and
+   each one after that is twice the size of the last, up to POOL_CHUNKMAX;
+   strings too big to fit a quarter of that many times get a chunk to
+   themselves */
+#define POOL_CHUNKMIN 1024
+#define POOL_CHUNKMAX 65536
+
+/* each interned string starts at a multiple of this */
+#define POOL_ALIGN sizeof(uint64_t)
+
+typedef struct {
+   poolchunk *chunks;                    /* the one in use comes first */
+   size_t     bytes;                     /* total length of the strings */
+} poolarena;
+
+/* what the opaque datatype dstrpool_t points to; the shards come right
+   after it, in the same block */
+typedef struct {
+   cmapshard *shards;                    /* nshards, cache aligned */
+   size_t     nshards;                   /* 1, or CMAP_SHARDS if
+                                            threadsafe */
+   int        threadsafe;
+   uint64_t   seed;                      /* shared by every shard */
+   poolarena  arenas[CMAP_SHARDS];       /* one for each shard, used while
+                                            holding its lock */
+} dstrpool;
+
+#define POOLREF(X) ((dstrpool *)(X))
+
+#ifdef DSTR_PTHREAD
+#define CMAP_RDLOCK(SHARD) pthread_rwlock_rdlock(&(SHARD)->s.lock)
+#define CMAP_WRLOCK(SHARD) pthread_rwlock_wrlock(&(SHARD)->s.lock)
+#define CMAP_UNLOCK(SHARD) pthread_rwlock_unlock(&(SHARD)->s.lock)
+#else
+#define CMAP_RDLOCK(SHARD)
+#define CMAP_WRLOCK(SHARD)
+#define CMAP_UNLOCK(SHARD)
+#endif
+
+static uint64_t mapseed(const void *map);
+static size_t   mapcapacity(size_t keys);
+static int      maptable(dstrmap *map, size_t capacity);
+static void     mapclear(dstrmap *map, void (*release)(void *value));
+static int      mapgrow(dstrmap *map);
+static size_t   mapfind(const dstrmap *map, const char *key, size_t len,
+   uint64_t hash);
+static size_t   mapfree(const dstrmap *map, uint64_t hash);
+static int      mapset(dstrmap_t map, const char *key, size_t len,
+   uint64_t hash, void *value, void **old);
+static int      mapget(const dstrmap_t map, const char *key, size_t len,
+   uint64_t hash, void **value);
+static int      mapdel(dstrmap_t map, const char *key, size_t len,
+   uint64_t hash, void **value);
+static unsigned groupmatch(const unsigned char *ctrl, unsigned char c);
+static unsigned groupfree(const unsigned char *ctrl);
+static unsigned lowbit(unsigned mask);
+static int      shardsinit(cmapshard *shards, size_t n, size_t capacity,
+   uint64_t seed, int borrowed);
+static void     shardsclear(cmapshard *shards, size_t n,
+   void (*release)(void *value));
+static int      cmapset(dstrcmap *map, const char *key, size_t len,
+   void *value, void **old);
+static int      cmapget(const dstrcmap *map, const char *key, size_t len,
+   void **value);
+static int      cmapdel(dstrcmap *map, const char *key, size_t len,
+   void **value);
+static dstring_t poolintern(dstrpool *pool, const char *src, size_t len);
+static dstring_t poolnew(poolarena *arena, const char *src, size_t len,
+   uint64_t hash, uint64_t seed);
+static void     poolrelease(void *str);
+
+/* ************************************************************************* */
+
+int dstrmapalloc(dstrmap_t *mapptr, size_t capacity) {
+
+   dstrmap *map;
+   int      status;
+
+   if (NULL == (map = calloc(1, sizeof(dstrmap)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   if (DSTR_SUCCESS != (status = maptable(map, mapcapacity(capacity)))) {
+      free(map);
+      _setdstrerrno(status);
+      return status;
+   }
+
+   map->seed = mapseed(map);
+
+   *mapptr = map;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrmapfree(dstrmap_t *mapptr) {
+
+   if (NULL == mapptr || NULL == *mapptr) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   mapclear(MAPREF(*mapptr), NULL);
+   free(*mapptr);
+   *mapptr = NULL;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+size_t dstrmapsize(const dstrmap_t map) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return MAPREF(map)->size;
+}
+
+/* ************************************************************************* */
+
+int dstrmapset(dstrmap_t map, const dstring_t key, void *value) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   /* dstrhash() remembers the hash, so a key that's used again (or looked
+      up afterwards) isn't hashed again */
+   return mapset(map, DSTRBUF(key), strlen(DSTRBUF(key)),
+      dstrhash(key, MAPREF(map)->seed), value, NULL);
+}
+
+/* ************************************************************************* */
+
+int dstrmapnset(dstrmap_t map, const char *key, size_t n, void *value) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return DSTR_NULL_CPTR;
+   }
+
+   return mapset(map, key, n, _dstrhashbytes(key, n, MAPREF(map)->seed),
+      value, NULL);
+}
+
+/* ************************************************************************* */
+
+int dstrmapget(const dstrmap_t map, const dstring_t key, void **value) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   return mapget(map, DSTRBUF(key), strlen(DSTRBUF(key)),
+      dstrhash(key, MAPREF(map)->seed), value);
+}
+
+/* ************************************************************************* */
+
+int dstrmapnget(const dstrmap_t map, const char *key, size_t n,
+void **value) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   return mapget(map, key, n, _dstrhashbytes(key, n, MAPREF(map)->seed),
+      value);
+}
+
+/* ************************************************************************* */
+
+int dstrmapdel(dstrmap_t map, const dstring_t key, void **value) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   return mapdel(map, DSTRBUF(key), strlen(DSTRBUF(key)),
+      dstrhash(key, MAPREF(map)->seed), value);
+}
+
+/* ************************************************************************* */
+
+int dstrmapndel(dstrmap_t map, const char *key, size_t n, void **value) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   return mapdel(map, key, n, _dstrhashbytes(key, n, MAPREF(map)->seed),
+      value);
+}
+
+/* ************************************************************************* */
+
+int dstrmapnext(const dstrmap_t map, size_t *index, const char **key,
+size_t *n, void **value) {
+
+   const dstrmap *m = MAPREF(map);
+   size_t         i;
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == index) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   for (i = *index; i < m->capacity; i++) {
+
+      if (m->ctrl[i] & 0x80) {
+         continue;
+      }
+
+      if (NULL != key) {
+         *key = MAPKEY(&m->slots[i]);
+      }
+      if (NULL != n) {
+         *n = m->slots[i].len;
+      }
+      if (NULL != value) {
+         *value = m->slots[i].value;
+      }
+
+      *index = i + 1;
+      _setdstrerrno(DSTR_SUCCESS);
+      return 1;
+   }
+
+   *index = m->capacity;
+   _setdstrerrno(DSTR_EOF);
+   return 0;
+}
+
+/* ************************************************************************* */
+
+int dstrcmapalloc(dstrcmap_t *mapptr, size_t capacity) {
+
+#ifdef DSTR_PTHREAD
+   dstrcmap *map;
+   int       status;
+
+   if (NULL == (map = malloc(sizeof(dstrcmap) + MAP_ALIGN +
+   CMAP_SHARDS * sizeof(cmapshard)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   map->shards = (cmapshard *)((char *)(map + 1) + (MAP_ALIGN -
+      (uintptr_t)(map + 1) % MAP_ALIGN) % MAP_ALIGN);
+   map->seed = mapseed(map);
+
+   if (DSTR_SUCCESS != (status = shardsinit(map->shards, CMAP_SHARDS,
+   mapcapacity(capacity / CMAP_SHARDS + 1), map->seed, 0))) {
+      free(map);
+      _setdstrerrno(status);
+      return status;
+   }
+
+   *mapptr = map;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+#else
+   /* without the locks, threads can't share the shards */
+   (void)mapptr;
+   (void)capacity;
+   _setdstrerrno(DSTR_UNSUPPORTED);
+   return DSTR_UNSUPPORTED;
+#endif
+}
+
+/* ************************************************************************* */
+
+int dstrcmapfree(dstrcmap_t *mapptr, void (*release)(void *value)) {
+
+   if (NULL == mapptr || NULL == *mapptr) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   shardsclear(CMAPREF(*mapptr)->shards, CMAP_SHARDS, release);
+   free(*mapptr);
+   *mapptr = NULL;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcmapsize(const dstrcmap_t map) {
+
+   cmapshard *shard;
+   size_t     size = 0, i;
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   for (i = 0; i < CMAP_SHARDS; i++) {
+      shard = &CMAPREF(map)->shards[i];
+      CMAP_RDLOCK(shard);
+      size += shard->s.map.size;
+      CMAP_UNLOCK(shard);
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return size;
+}
+
+/* ************************************************************************* */
+
+int dstrcmapset(dstrcmap_t map, const dstring_t key, void *value,
+void **old) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   return cmapset(map, DSTRBUF(key), strlen(DSTRBUF(key)), value, old);
+}
+
+/* ************************************************************************* */
+
+int dstrcmapnset(dstrcmap_t map, const char *key, size_t n, void *value,
+void **old) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return DSTR_NULL_CPTR;
+   }
+
+   return cmapset(map, key, n, value, old);
+}
+
+/* ************************************************************************* */
+
+int dstrcmapget(const dstrcmap_t map, const dstring_t key, void **value) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   return cmapget(map, DSTRBUF(key), strlen(DSTRBUF(key)), value);
+}
+
+/* ************************************************************************* */
+
+int dstrcmapnget(const dstrcmap_t map, const char *key, size_t n,
+void **value) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   return cmapget(map, key, n, value);
+}
+
+/* ************************************************************************* */
+
+int dstrcmapdel(dstrcmap_t map, const dstring_t key, void **value) {
+
+   if (NULL == map || NULL == key) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   return cmapdel(map, DSTRBUF(key), strlen(DSTRBUF(key)), value);
+}
+
+/* ************************************************************************* */
+
+int dstrcmapndel(dstrcmap_t map, const char *key, size_t n, void **value) {
+
+   if (NULL == map) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == key) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   return cmapdel(map, key, n, value);
+}
+
+/* ************************************************************************* */
+
+int dstrpoolalloc(dstrpool_t *poolptr, int flags) {
+
+   dstrpool *pool;
+   size_t    nshards = flags & DSTR_POOL_THREADSAFE ? CMAP_SHARDS : 1;
+   int       status;
+
+#ifndef DSTR_PTHREAD
+   /* without the locks, threads can't share the shards */
+   if (flags & DSTR_POOL_THREADSAFE) {
+      _setdstrerrno(DSTR_UNSUPPORTED);
+      return DSTR_UNSUPPORTED;
+   }
+#endif
+
+   if (NULL == (pool = malloc(sizeof(dstrpool) + MAP_ALIGN +
+   nshards * sizeof(cmapshard)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   pool->shards = (cmapshard *)((char *)(pool + 1) + (MAP_ALIGN -
+      (uintptr_t)(pool + 1) % MAP_ALIGN) % MAP_ALIGN);
+   pool->nshards = nshards;
+   pool->threadsafe = flags & DSTR_POOL_THREADSAFE;
+   pool->seed = mapseed(pool);
+   memset(pool->arenas, 0, sizeof(pool->arenas));
+
+   if (DSTR_SUCCESS != (status = shardsinit(pool->shards, nshards,
+   MAP_GROUP, pool->seed, 1))) {
+      free(pool);
+      _setdstrerrno(status);
+      return status;
+   }
+
+   *poolptr = pool;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrpoolfree(dstrpool_t *poolptr) {
+
+   dstrpool  *pool;
+   poolchunk *chunk, *next;
+   size_t     i;
+
+   if (NULL == poolptr || NULL == *poolptr) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   pool = POOLREF(*poolptr);
+
+   /* the strings themselves go with their chunks, but anything they've
+      allocated since (a code point index) has to be freed first */
+   shardsclear(pool->shards, pool->nshards, poolrelease);
+
+   for (i = 0; i < pool->nshards; i++) {
+      for (chunk = pool->arenas[i].chunks; NULL != chunk; chunk = next) {
+         next = chunk->next;
+         free(chunk);
+      }
+   }
+
+   free(pool);
+   *poolptr = NULL;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+dstring_t dstrintern(dstrpool_t pool, const dstring_t str) {
+
+   if (NULL == pool || NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return NULL;
+   }
+
+   return poolintern(pool, DSTRBUF(str), strlen(DSTRBUF(str)));
+}
+
+/* ************************************************************************* */
+
+dstring_t dstrinterncs(dstrpool_t pool, const char *src) {
+
+   if (NULL == pool) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return NULL;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return NULL;
+   }
+
+   return poolintern(pool, src, strlen(src));
+}
+
+/* ************************************************************************* */
+
+dstring_t dstrninterncs(dstrpool_t pool, const char *src, size_t n) {
+
+   const char *end;
+
+   if (NULL == pool) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return NULL;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return NULL;
+   }
+
+   /* a string can't hold a '\0', so that's where it ends */
+   if (NULL != (end = memchr(src, '\0', n))) {
+      n = end - src;
+   }
+
+   return poolintern(pool, src, n);
+}
+
+/* ************************************************************************* */
+
+int dstrpoolstats(const dstrpool_t pool, dstrpoolstats_t *stats) {
+
+   const dstrpool *p = POOLREF(pool);
+   cmapshard      *shard;
+   poolchunk      *chunk;
+   size_t          i;
+
+   if (NULL == pool) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   if (NULL == stats) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return DSTR_INVALID_ARGUMENT;
+   }
+
+   stats->strings = 0;
+   stats->bytes = 0;
+   stats->memory = sizeof(dstrpool) + MAP_ALIGN +
+      p->nshards * sizeof(cmapshard);
+
+   for (i = 0; i < p->nshards; i++) {
+
+      shard = &p->shards[i];
+
+      if (p->threadsafe) {
+         CMAP_RDLOCK(shard);
+      }
+
+      stats->strings += shard->s.map.size;
+      stats->bytes += p->arenas[i].bytes;
+      stats->memory += shard->s.map.capacity * (sizeof(mapslot) + 1) +
+         MAP_ALIGN;
+
+      for (chunk = p->arenas[i].chunks; NULL != chunk; chunk = chunk->next) {
+         stats->memory += sizeof(poolchunk) + chunk->size;
+      }
+
+      if (p->threadsafe) {
+         CMAP_UNLOCK(shard);
+      }
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* a different seed for every map, so that nobody can work out in advance
+   which keys will collide - FOR INTERNAL USE ONLY! */
+static uint64_t mapseed(const void *map) {
+
+   uint64_t seed = (uint64_t)(uintptr_t)map ^ (uint64_t)time(NULL);
+
+   return _dstrhashbytes(&seed, sizeof(seed), (uint64_t)clock());
+}
+
+/* ************************************************************************* */
+
+/* the number of slots that holds keys keys without growing - FOR INTERNAL
+   USE ONLY! */
+static size_t mapcapacity(size_t keys) {
+
+   size_t n = MAP_GROUP;
+
+   while (MAP_MAXLOAD(n) < keys) {
+      n *= 2;
+   }
+
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* gives map an empty table of capacity slots - FOR INTERNAL USE ONLY! */
+static int maptable(dstrmap *map, size_t capacity) {
+
+   char *table;
+
+   if (NULL == (table = malloc(capacity * sizeof(mapslot) + MAP_ALIGN +
+   capacity))) {
+      return DSTR_NOMEM;
+   }
+
+   map->table = table;
+   map->slots = (mapslot *)(table + (MAP_ALIGN - (uintptr_t)table %
+      MAP_ALIGN) % MAP_ALIGN);
+   map->ctrl = (unsigned char *)(map->slots + capacity);
+   memset(map->ctrl, MAP_EMPTY, capacity);
+
+   map->capacity = capacity;
+   map->size = 0;
+   map->deleted = 0;
+
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* frees map's table and its copies of the keys, first passing each value
+   to release, if there is one - FOR INTERNAL USE ONLY! */
+static void mapclear(dstrmap *map, void (*release)(void *value)) {
+
+   size_t i;
+
+   for (i = 0; i < map->capacity; i++) {
+      if (!(map->ctrl[i] & 0x80)) {
+         if (NULL != release) {
+            release(map->slots[i].value);
+         }
+         if (map->slots[i].len >= MAP_INLINE && !map->borrowed) {
+            free(map->slots[i].key.ptr);
+         }
+      }
+   }
+
+   free(map->table);
+   return;
+}
+
+/* ************************************************************************* */
+
+/* makes room for another key: the table doubles, or, if it's mostly deleted
+   slots, is rebuilt at the same size.  Keys are moved, not copied. */
+static int mapgrow(dstrmap *map) {
+
+   dstrmap old = *map;
+   size_t  capacity = map->capacity, i, j;
+   int     status;
+
+   if (map->size >= capacity / 2) {
+      capacity *= 2;
+   }
+
+   /* if this fails, map is left as it was */
+   if (DSTR_SUCCESS != (status = maptable(map, capacity))) {
+      return status;
+   }
+
+   for (i = 0; i < old.capacity; i++) {
+      if (!(old.ctrl[i] & 0x80)) {
+         j = mapfree(map, _dstrhashbytes(MAPKEY(&old.slots[i]),
+            old.slots[i].len, map->seed));
+         map->ctrl[j] = old.ctrl[i];
+         map->slots[j] = old.slots[i];
+      }
+   }
+
+   map->size = old.size;
+
+   free(old.table);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* returns the slot that holds key, or map->capacity if it isn't there;
+   this is the only place the probe sequence is followed for a lookup */
+static size_t mapfind(const dstrmap *map, const char *key, size_t len,
+uint64_t hash) {
+
+   const mapslot *slot;
+   size_t         groups = map->capacity / MAP_GROUP, g, step = 0, i;
+   unsigned       match;
+
+   g = MAP_H1(hash) & (groups - 1);
+
+   for (;;) {
+
+      match = groupmatch(map->ctrl + g * MAP_GROUP, MAP_H2(hash));
+
+      while (match) {
+         i = g * MAP_GROUP + lowbit(match);
+         slot = &map->slots[i];
+         if (slot->len == len &&
+         0 == memcmp(MAPKEY(slot), key, len)) {
+            return i;
+         }
+         match &= match - 1;
+      }
+
+      /* a key is never put past a group that has an empty slot */
+      if (groupmatch(map->ctrl + g * MAP_GROUP, MAP_EMPTY)) {
+         return map->capacity;
+      }
+
+      /* triangular steps visit every group once the table is a power of 2
+         groups long, which it always is */
+      g = (g + ++step) & (groups - 1);
+   }
+}
+
+/* ************************************************************************* */
+
+/* returns the first empty or deleted slot where a key with the given hash
+   can go; the table must have one */
+static size_t mapfree(const dstrmap *map, uint64_t hash) {
+
+   size_t   groups = map->capacity / MAP_GROUP, g, step = 0;
+   unsigned avail;
+
+   g = MAP_H1(hash) & (groups - 1);
+
+   while (0 == (avail = groupfree(map->ctrl + g * MAP_GROUP))) {
+      g = (g + ++step) & (groups - 1);
+   }
+
+   return g * MAP_GROUP + lowbit(avail);
+}
+
+/* ************************************************************************* */
+
+/* maps key to value; if key was already there, the value it had is stored
+   in *old, and otherwise NULL is (unless old is NULL) */
+static int mapset(dstrmap_t map, const char *key, size_t len, uint64_t hash,
+void *value, void **old) {
+
+   dstrmap *m = MAPREF(map);
+   mapslot *slot;
+   char    *dest;
+   size_t   i;
+   int      status;
+
+   if (m->capacity != (i = mapfind(m, key, len, hash))) {
+      if (NULL != old) {
+         *old = m->slots[i].value;
+      }
+      m->slots[i].value = value;
+      _setdstrerrno(DSTR_SUCCESS);
+      return DSTR_SUCCESS;
+   }
+
+   if (NULL != old) {
+      *old = NULL;
+   }
+
+   if (m->size + m->deleted >= MAP_MAXLOAD(m->capacity) &&
+   DSTR_SUCCESS != (status = mapgrow(m))) {
+      _setdstrerrno(status);
+      return status;
+   }
+
+   i = mapfree(m, hash);
+   slot = &m->slots[i];
+
+   if (len < MAP_INLINE) {
+      dest = slot->key.bytes;
+   } else if (m->borrowed) {
+      dest = NULL;
+      slot->key.ptr = (char *)key;
+   } else if (NULL == (dest = malloc(len + 1))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   } else {
+      slot->key.ptr = dest;
+   }
+
+   if (NULL != dest) {
+      memcpy(dest, key, len);
+      dest[len] = '\0';
+   }
+
+   if (MAP_DELETED == m->ctrl[i]) {
+      m->deleted--;
+   }
+
+   slot->len = len;
+   slot->value = value;
+   m->ctrl[i] = MAP_H2(hash);
+   m->size++;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+static int mapget(const dstrmap_t map, const char *key, size_t len,
+uint64_t hash, void **value) {
+
+   const dstrmap *m = MAPREF(map);
+   size_t         i;
+
+   if (m->capacity == (i = mapfind(m, key, len, hash))) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   if (NULL != value) {
+      *value = m->slots[i].value;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return 1;
+}
+
+/* ************************************************************************* */
+
+static int mapdel(dstrmap_t map, const char *key, size_t len, uint64_t hash,
+void **value) {
+
+   dstrmap *m = MAPREF(map);
+   size_t   i;
+
+   if (m->capacity == (i = mapfind(m, key, len, hash))) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return 0;
+   }
+
+   if (NULL != value) {
+      *value = m->slots[i].value;
+   }
+
+   if (len >= MAP_INLINE && !m->borrowed) {
+      free(m->slots[i].key.ptr);
+   }
+
+   /* if the group still has an empty slot, no search has ever gone past
+      it, so this slot can be empty too; otherwise a search might need to
+      go past it, and it has to be marked as deleted instead */
+   if (groupmatch(m->ctrl + i / MAP_GROUP * MAP_GROUP, MAP_EMPTY)) {
+      m->ctrl[i] = MAP_EMPTY;
+   } else {
+      m->ctrl[i] = MAP_DELETED;
+      m->deleted++;
+   }
+
+   m->size--;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* returns a bit for each of the MAP_GROUP control bytes at ctrl that's
+   equal to c */
+static unsigned groupmatch(const unsigned char *ctrl, unsigned char c) {
+
+#ifdef __SSE2__
+
+   return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128((const __m128i *)ctrl), _mm_set1_epi8((char)c)));
+
+#else
+
+   unsigned mask = 0, i;
+
+   for (i = 0; i < MAP_GROUP; i++) {
+      if (ctrl[i] == c) {
+         mask |= 1u << i;
+      }
+   }
+
+   return mask;
+
+#endif
+}
+
+/* ...and for each one that's empty or deleted (has its high bit set) */
+static unsigned groupfree(const unsigned char *ctrl) {
+
+#ifdef __SSE2__
+
+   return (unsigned)_mm_movemask_epi8(_mm_loadu_si128(
+      (const __m128i *)ctrl));
+
+#else
+
+   unsigned mask = 0, i;
+
+   for (i = 0; i < MAP_GROUP; i++) {
+      if (ctrl[i] & 0x80) {
+         mask |= 1u << i;
+      }
+   }
+
+   return mask;
+
+#endif
+}
+
+/* ************************************************************************* */
+
+/* the index of the lowest bit set in a nonzero mask */
+static unsigned lowbit(unsigned mask) {
+
+#ifdef __GNUC__
+
+   return (unsigned)__builtin_ctz(mask);
+
+#else
+
+   unsigned i = 0;
+
+   while (!(mask & 1)) {
+      mask >>= 1;
+      i++;
+   }
+
+   return i;
+
+#endif
+}
+
+/* ************************************************************************* */
+
+/* gives each of n shards an empty table of capacity slots and a lock;
+   if one can't be set up, the ones before it are undone - FOR INTERNAL USE
+   ONLY! */
+static int shardsinit(cmapshard *shards, size_t n, size_t capacity,
+uint64_t seed, int borrowed) {
+
+   size_t i;
+   int    status = DSTR_SUCCESS;
+
+   for (i = 0; i < n; i++) {
+
+      if (DSTR_SUCCESS != (status = maptable(&shards[i].s.map, capacity))) {
+         break;
+      }
+
+#ifdef DSTR_PTHREAD
+      if (0 != pthread_rwlock_init(&shards[i].s.lock, NULL)) {
+         mapclear(&shards[i].s.map, NULL);
+         status = DSTR_NOMEM;
+         break;
+      }
+#endif
+
+      shards[i].s.map.seed = seed;
+      shards[i].s.map.borrowed = borrowed;
+   }
+
+   if (DSTR_SUCCESS != status) {
+      shardsclear(shards, i, NULL);
+   }
+
+   return status;
+}
+
+/* frees what shardsinit() set up - FOR INTERNAL USE ONLY! */
+static void shardsclear(cmapshard *shards, size_t n,
+void (*release)(void *value)) {
+
+   size_t i;
+
+   for (i = 0; i < n; i++) {
+      mapclear(&shards[i].s.map, release);
+#ifdef DSTR_PTHREAD
+      pthread_rwlock_destroy(&shards[i].s.lock);
+#endif
+   }
+
+   return;
+}
+
+/* ************************************************************************* */
+
+/* Keys given as a dstring_t are hashed here rather than with dstrhash(),
+   which would write the hash into them: threads are free to look up the
+   same dstring_t at the same time, as long as none of them changes it. */
+
+static int cmapset(dstrcmap *map, const char *key, size_t len, void *value,
+void **old) {
+
+   uint64_t   hash = _dstrhashbytes(key, len, map->seed);
+   cmapshard *shard = CMAPSHARD(map, hash);
+   int        status;
+
+   CMAP_WRLOCK(shard);
+   status = mapset(&shard->s.map, key, len, hash, value, old);
+   CMAP_UNLOCK(shard);
+
+   return status;
+}
+
+static int cmapget(const dstrcmap *map, const char *key, size_t len,
+void **value) {
+
+   uint64_t   hash = _dstrhashbytes(key, len, map->seed);
+   cmapshard *shard = CMAPSHARD(map, hash);
+   int        found;
+
+   CMAP_RDLOCK(shard);
+   found = mapget(&shard->s.map, key, len, hash, value);
+   CMAP_UNLOCK(shard);
+
+   return found;
+}
+
+static int cmapdel(dstrcmap *map, const char *key, size_t len,
+void **value) {
+
+   uint64_t   hash = _dstrhashbytes(key, len, map->seed);
+   cmapshard *shard = CMAPSHARD(map, hash);
+   int        found;
+
+   CMAP_WRLOCK(shard);
+   found = mapdel(&shard->s.map, key, len, hash, value);
+   CMAP_UNLOCK(shard);
+
+   return found;
+}
+
+/* ************************************************************************* */
+
+/* returns the pool's string with len bytes of src as its contents, adding
+   one if there isn't one yet - FOR INTERNAL USE ONLY! */
+static dstring_t poolintern(dstrpool *pool, const char *src, size_t len) {
+
+   uint64_t   hash = _dstrhashbytes(src, len, pool->seed);
+   size_t     s = pool->threadsafe ? hash >> (64 - CMAP_SHARDBITS) : 0;
+   cmapshard *shard = &pool->shards[s];
+   void      *str = NULL;
+   int        status = DSTR_SUCCESS, found;
+
+   /* nearly every string's already there, and finding it only needs a read
+      lock; adding one needs a write lock, and another look, since another
+      thread may have added it in between */
+   if (pool->threadsafe) {
+
+      CMAP_RDLOCK(shard);
+      found = mapget(&shard->s.map, src, len, hash, &str);
+      CMAP_UNLOCK(shard);
+
+      if (found) {
+         _setdstrerrno(DSTR_SUCCESS);
+         return str;
+      }
+
+      CMAP_WRLOCK(shard);
+   }
+
+   if (!mapget(&shard->s.map, src, len, hash, &str)) {
+
+      /* the string is its own key; if it can't be added, its memory is
+         left in the chunk, unused */
+      if (NULL == (str = poolnew(&pool->arenas[s], src, len, hash,
+      pool->seed))) {
+         status = DSTR_NOMEM;
+      } else if (DSTR_SUCCESS != (status = mapset(&shard->s.map,
+      DSTRBUF(str), len, hash, str, NULL))) {
+         str = NULL;
+      } else {
+         pool->arenas[s].bytes += len;
+      }
+   }
+
+   if (pool->threadsafe) {
+      CMAP_UNLOCK(shard);
+   }
+
+   _setdstrerrno(status);
+   return str;
+}
+
+/* ************************************************************************* */
+
+/* makes a string out of len bytes of src, header, buffer and all, in the
+   arena's memory; hash is its hash with seed - FOR INTERNAL USE ONLY! */
+static dstring_t poolnew(poolarena *arena, const char *src, size_t len,
+uint64_t hash, uint64_t seed) {
+
+   poolchunk *chunk = arena->chunks;
+   size_t     need = sizeof(dstr) + len + 1 + POOL_ALIGN, size, pad;
+   dstr      *str;
+   char      *p;
+
+   if (NULL == chunk || chunk->size - chunk->used < need) {
+
+      /* a string too big to share a chunk gets one to itself, which goes
+         behind the one in use so that what's left of that isn't wasted */
+      if (need > POOL_CHUNKMAX / 4) {
+         if (NULL == (chunk = malloc(sizeof(poolchunk) + need))) {
+            return NULL;
+         }
+         chunk->size = need;
+         chunk->used = 0;
+         if (NULL == arena->chunks) {
+            chunk->next = NULL;
+            arena->chunks = chunk;
+         } else {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+         }
+      }
+
+      else {
+         size = NULL == chunk ? POOL_CHUNKMIN : chunk->size * 2;
+         if (size > POOL_CHUNKMAX) {
+            size = POOL_CHUNKMAX;
+         }
+         if (NULL == (chunk = malloc(sizeof(poolchunk) + size))) {
+            return NULL;
+         }
+         chunk->size = size;
+         chunk->used = 0;
+         chunk->next = arena->chunks;
+         arena->chunks = chunk;
+      }
+   }
+
+   p = (char *)(chunk + 1) + chunk->used;
+   pad = (POOL_ALIGN - (uintptr_t)p % POOL_ALIGN) % POOL_ALIGN;
+   str = (dstr *)(p + pad);
+   chunk->used += pad + sizeof(dstr) + len + 1;
+
+   memset(str, 0, sizeof(dstr));
+   str->buf = (char *)(str + 1);
+   str->buflen = len + 1;
+   str->flags = DSTR_FLAG_POOLED;
+   memcpy(str->buf, src, len);
+   str->buf[len] = '\0';
+
+   /* once the string's shared, nothing can be cached in it without a race,
+      so whatever would be cached the first time it's asked for is worked
+      out now */
+   str->hash = hash;
+   str->hashseed = seed;
+   str->cached = DSTR_CACHE_HASH;
+   _dstrutf8cache(str);
+
+   return str;
+}
+
+/* ************************************************************************* */
+
+/* frees what an interned string may have allocated for itself since it was
+   made - FOR INTERNAL USE ONLY! */
+static void poolrelease(void *str) {
+
+   free(DSTRREF(str)->cpindex);
+   return;
+}
@@ -0,0 +1,714 @@
+
+/* ************************************************************************* *\
+   * File: reader.c                                                        *
+   * Purpose:                                                              *
+   *    Provides line-oriented input for dstring_t objects from plain and  *
+   *    compressed streams                                                 *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#define READER_GZIP
+#include <zlib.h>
+#endif
+
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+#define READER_ZSTD
+#include <zstd.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* size of the buffers for compressed and decompressed data */
+#define READER_BUFSIZE 65536
+
+/* what the opaque datatype dstrreader_t points to */
+typedef struct {
+   FILE   *fp;                         /* where the (compressed) data is */
+   int     compression;                /* one of DSTR_COMPRESS_* */
+   int     ineof;                      /* nothing more to read from fp */
+   int     streamend;                  /* the current gzip member ended */
+   int     pending;                    /* the decompressor filled out[] and
+                                          may have more to give without any
+                                          new input */
+
+   unsigned char in[READER_BUFSIZE];   /* compressed data from fp */
+   size_t        inlen;                /* bytes in in[] */
+
+   char    out[READER_BUFSIZE];        /* decompressed data for the caller */
+   size_t  outpos;                     /* next unread byte in out[] */
+   size_t  outlen;                     /* bytes in out[] */
+
+#ifdef READER_GZIP
+   z_stream zs;
+#endif
+
+#ifdef READER_ZSTD
+   ZSTD_DCtx     *zd;
+   ZSTD_inBuffer  zin;
+   size_t         zret;                /* last return from zstd (0 = frame
+                                          complete) */
+#endif
+} reader;
+
+/* macro for typecasting */
+#define READERREF(X) ((reader *)(X))
+
+/* CSV is classified 64 bytes at a time, one bit per byte */
+#define CSV_BLOCK 64
+
+/* a character to look for in a block, ready for csvmask() */
+typedef struct {
+#ifdef __SSE2__
+   __m128i  v;
+#endif
+   char     c;
+} csvbyte;
+
+static int refill(reader *r);
+static int fillin(reader *r);
+static size_t readline(dstring_t dest, reader *r, size_t len);
+static void csvbyteinit(csvbyte *b, char c);
+static uint64_t csvmask(const char *block, const csvbyte *b);
+static uint64_t prefixxor(uint64_t x);
+static size_t unquote(char *field, size_t length);
+
+/* ************************************************************************* */
+
+int dstrreaderopen(dstrreader_t *rptr, FILE *fp, int compression) {
+
+   reader *r;
+
+   /* make sure fp is an opened file */
+   if (NULL == fp) {
+      _setdstrerrno(DSTR_UNOPENED_FILE);
+      return DSTR_UNOPENED_FILE;
+   }
+
+   if (NULL == (r = calloc(1, sizeof(reader)))) {
+      _setdstrerrno(DSTR_NOMEM);
+      return DSTR_NOMEM;
+   }
+
+   r->fp = fp;
+
+   /* look at the magic number to figure out what we're dealing with */
+   if (DSTR_COMPRESS_AUTO == compression) {
+
+      while (r->inlen < 4 && !r->ineof) {
+         if (DSTR_SUCCESS != fillin(r)) {
+            free(r);
+            _setdstrerrno(DSTR_FILE_ERROR);
+            return DSTR_FILE_ERROR;
+         }
+      }
+
+      if (r->inlen >= 2 && 0x1f == r->in[0] && 0x8b == r->in[1]) {
+         compression = DSTR_COMPRESS_GZIP;
+      } else if (r->inlen >= 4 && 0x28 == r->in[0] && 0xb5 == r->in[1] &&
+         0x2f == r->in[2] && 0xfd == r->in[3]) {
+         compression = DSTR_COMPRESS_ZSTD;
+      } else {
+         compression = DSTR_COMPRESS_NONE;
+      }
+   }
+
+   r->compression = compression;
+
+   switch (compression) {
+
+      case DSTR_COMPRESS_NONE:
+
+         /* anything we peeked at is already decompressed ;) */
+         memcpy(r->out, r->in, r->inlen);
+         r->outlen = r->inlen;
+         r->inlen = 0;
+         break;
+
+#ifdef READER_GZIP
+      case DSTR_COMPRESS_GZIP:
+
+         /* 15 + 32 tells zlib to detect gzip or zlib headers on its own */
+         r->zs.next_in = r->in;
+         r->zs.avail_in = r->inlen;
+         if (Z_OK != inflateInit2(&r->zs, 15 + 32)) {
+            free(r);
+            _setdstrerrno(DSTR_NOMEM);
+            return DSTR_NOMEM;
+         }
+         break;
+#endif
+
+#ifdef READER_ZSTD
+      case DSTR_COMPRESS_ZSTD:
+
+         if (NULL == (r->zd = ZSTD_createDCtx())) {
+            free(r);
+            _setdstrerrno(DSTR_NOMEM);
+            return DSTR_NOMEM;
+         }
+         r->zin.src = r->in;
+         r->zin.size = r->inlen;
+         r->zin.pos = 0;
+         break;
+#endif
+
+      /* either it's nonsense, or we weren't built with support for it */
+      default:
+         free(r);
+         _setdstrerrno(DSTR_UNSUPPORTED);
+         return DSTR_UNSUPPORTED;
+   }
+
+   *rptr = (dstrreader_t)r;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrreaderclose(dstrreader_t *rptr) {
+
+   reader *r;
+
+   /* make sure it's not an uninitialized reader */
+   if (NULL == *rptr) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   r = READERREF(*rptr);
+
+#ifdef READER_GZIP
+   if (DSTR_COMPRESS_GZIP == r->compression) {
+      inflateEnd(&r->zs);
+   }
+#endif
+
+#ifdef READER_ZSTD
+   if (DSTR_COMPRESS_ZSTD == r->compression) {
+      ZSTD_freeDCtx(r->zd);
+   }
+#endif
+
+   free(r);
+
+   /* ensure that the caller's dstrreader_t is set to NULL upon return */
+   *rptr = NULL;
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+size_t dstrrreadl(dstring_t dest, dstrreader_t r) {
+
+   /* make sure dest and r are both initialized */
+   if (NULL == dest || NULL == r) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   return readline(dest, READERREF(r), 0);
+}
+
+/* ************************************************************************* */
+
+size_t dstrrcatl(dstring_t dest, dstrreader_t r) {
+
+   /* make sure dest and r are both initialized */
+   if (NULL == dest || NULL == r) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   return readline(dest, READERREF(r), strlen(DSTRBUF(dest)));
+}
+
+/* ************************************************************************* */
+
+size_t dstrrreadcsv(dstring_t dest, dstrreader_t rd, char delim,
+dstrfield_t *fields, size_t max) {
+
+   reader   *r;
+   csvbyte   quote, comma, newline;
+   char      tmp[CSV_BLOCK];
+   char     *buf;
+   const char *start, *block;
+   size_t    avail;           /* unread bytes in r->out */
+   size_t    i;               /* start of the current block in r->out */
+   size_t    len = 0;         /* characters copied into dest so far */
+   size_t    end = 0;         /* length of the record, without the newline */
+   size_t    fieldstart = 0;  /* offset in dest of the current field */
+   size_t    count = 0;       /* number of fields found */
+   size_t    chunk, newsize, pos;
+   uint64_t  q, inside, ends, delims;
+   uint64_t  carry = 0;       /* all 1s if the last block ended in quotes */
+   uint64_t  quotes = 0;      /* nonzero if the record contains a quote */
+   int       found = 0, status;
+   int       unclosed = 0;    /* the stream ended inside quotes */
+
+   /* make sure dest and rd are both initialized */
+   if (NULL == dest || NULL == rd) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if ('"' == delim || '\n' == delim || '\r' == delim || '\0' == delim ||
+   (NULL == fields && max > 0)) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   r = READERREF(rd);
+
+   csvbyteinit(&quote, '"');
+   csvbyteinit(&comma, delim);
+   csvbyteinit(&newline, '\n');
+
+   while (!found) {
+
+      /* we've used up everything that was decompressed; get more */
+      if (r->outpos == r->outlen) {
+         if (DSTR_SUCCESS != (status = refill(r))) {
+            /* hitting EOF after part of a record ends the record */
+            if (DSTR_EOF == status && len > 0) {
+               end = len;
+               unclosed = 0 != carry;
+               break;
+            }
+            if (len > 0) {
+               DSTRBUF(dest)[len] = '\0';
+            }
+            _setdstrerrno(status);
+            return 0;
+         }
+      }
+
+      start = r->out + r->outpos;
+      avail = r->outlen - r->outpos;
+
+      for (i = 0; i < avail; i += CSV_BLOCK) {
+
+         /* the last partial block is padded with bytes that match nothing */
+         if (avail - i >= CSV_BLOCK) {
+            block = start + i;
+         } else {
+            memset(tmp, 0, CSV_BLOCK);
+            memcpy(tmp, start + i, avail - i);
+            block = tmp;
+         }
+
+         /* a byte is inside quotes if an odd number of quotes come before
+            it, so "" inside a quoted field flips the state twice and leaves
+            it alone */
+         q = csvmask(block, &quote);
+         inside = prefixxor(q) ^ carry;
+         carry = (uint64_t)0 - (inside >> (CSV_BLOCK - 1));
+         quotes |= q;
+
+         ends = csvmask(block, &newline) & ~inside;
+         delims = csvmask(block, &comma) & ~inside;
+
+         /* only the delimiters before the end of the record count */
+         if (ends) {
+            ends = ends & (0 - ends);
+            delims &= ends - 1;
+         }
+
+         for (; delims; delims &= delims - 1) {
+            pos = len + i + __builtin_ctzll(delims);
+            if (count < max) {
+               fields[count].offset = fieldstart;
+               fields[count].length = pos - fieldstart;
+            }
+            count++;
+            fieldstart = pos + 1;
+         }
+
+         if (ends) {
+            end = len + i + __builtin_ctzll(ends);
+            found = 1;
+            break;
+         }
+      }
+
+      /* copy what we've looked at, including the newline */
+      chunk = found ? end - len + 1 : avail;
+
+      if (DSTRBUFLEN(dest) < len + chunk + 1) {
+         newsize = DSTRBUFLEN(dest) * 2;
+         if (newsize < len + chunk + 1) {
+            newsize = len + chunk + 1;
+         }
+         if (DSTR_SUCCESS != dstrealloc(&dest, newsize)) {
+            DSTRBUF(dest)[len] = '\0';
+            return 0;
+         }
+      }
+
+      memcpy(DSTRBUF(dest) + len, start, chunk);
+      len += chunk;
+      r->outpos += chunk;
+   }
+
+   buf = DSTRBUF(dest);
+
+   /* the last field ends at the newline, or just before a \r\n */
+   if (end > fieldstart && '\r' == buf[end - 1]) {
+      end--;
+   }
+
+   if (count < max) {
+      fields[count].offset = fieldstart;
+      fields[count].length = end - fieldstart;
+   }
+   count++;
+
+   /* strip quotes and terminate each field, so it can be used in place */
+   for (i = 0; i < count && i < max; i++) {
+      if (quotes && NULL != memchr(buf + fields[i].offset, '"',
+      fields[i].length)) {
+         fields[i].length = unquote(buf + fields[i].offset, fields[i].length);
+      }
+      buf[fields[i].offset + fields[i].length] = '\0';
+   }
+
+   /* the record is still returned, but the caller should know it was cut
+      short */
+   _setdstrerrno(unclosed ? DSTR_EOF : DSTR_SUCCESS);
+   return count;
+}
+
+/* ************************************************************************* */
+
+/* gets ready to find c with csvmask() - FOR INTERNAL USE ONLY! */
+static void csvbyteinit(csvbyte *b, char c) {
+
+   b->c = c;
+
+#ifdef __SSE2__
+   b->v = _mm_set1_epi8(c);
+#endif
+}
+
+/* ************************************************************************* */
+
+/* returns a mask with bit i set if block[i] is b's character - FOR INTERNAL
+   USE ONLY! */
+static uint64_t csvmask(const char *block, const csvbyte *b) {
+
+#ifdef __SSE2__
+
+   uint64_t m0, m1, m2, m3;
+
+   m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b->v,
+      _mm_loadu_si128((const __m128i *)block)));
+   m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b->v,
+      _mm_loadu_si128((const __m128i *)(block + 16))));
+   m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b->v,
+      _mm_loadu_si128((const __m128i *)(block + 32))));
+   m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b->v,
+      _mm_loadu_si128((const __m128i *)(block + 48))));
+
+   return m0 | m1 << 16 | m2 << 32 | m3 << 48;
+
+#else
+
+   uint64_t m = 0;
+   int      i;
+
+   for (i = 0; i < CSV_BLOCK; i++) {
+      m |= (uint64_t)(block[i] == b->c) << i;
+   }
+
+   return m;
+
+#endif
+}
+
+/* ************************************************************************* */
+
+/* bit i of the result is the XOR of bits 0 through i of x - FOR INTERNAL USE
+   ONLY! */
+static uint64_t prefixxor(uint64_t x) {
+
+   x ^= x << 1;
+   x ^= x << 2;
+   x ^= x << 4;
+   x ^= x << 8;
+   x ^= x << 16;
+   x ^= x << 32;
+
+   return x;
+}
+
+/* ************************************************************************* */
+
+/* removes the quotes from a field in place, turning each "" inside quotes
+   into a single quote, and returns its new length - FOR INTERNAL USE ONLY! */
+static size_t unquote(char *field, size_t length) {
+
+   size_t i, j = 0;
+   int    quoted = 0;
+
+   for (i = 0; i < length; i++) {
+      if ('"' != field[i]) {
+         field[j++] = field[i];
+      } else if (quoted && i + 1 < length && '"' == field[i + 1]) {
+         field[j++] = '"';
+         i++;
+      } else {
+         quoted = !quoted;
+      }
+   }
+
+   return j;
+}
+
+/* ************************************************************************* */
+
+/* copies the next line from r's decompressed data into dest, starting at
+   index len; dest is left alone if nothing is left to read - FOR INTERNAL
+   USE ONLY! */
+static size_t readline(dstring_t dest, reader *r, size_t len) {
+
+   char   *start;        /* first unread character in r->out */
+   char   *newline;      /* end of the line, if it's in r->out */
+   size_t  chunk;        /* number of characters to copy this time around */
+   size_t  count = 0;    /* number of characters copied so far */
+   size_t  newsize;
+   int     status;
+
+   while (1) {
+
+      /* we've used up everything that was decompressed; get more */
+      if (r->outpos == r->outlen) {
+         if (DSTR_SUCCESS != (status = refill(r))) {
+            /* hitting EOF after part of a line is still a success */
+            if (DSTR_EOF == status && count > 0) {
+               break;
+            }
+            /* keep whatever part of the line we did manage to get */
+            if (count > 0) {
+               DSTRBUF(dest)[len] = '\0';
+            }
+            _setdstrerrno(status);
+            return count;
+         }
+      }
+
+      start = r->out + r->outpos;
+      newline = memchr(start, '\n', r->outlen - r->outpos);
+      chunk = NULL != newline ? (size_t)(newline - start) + 1 :
+         r->outlen - r->outpos;
+
+      /* make sure dest has room for this piece of the line */
+      if (DSTRBUFLEN(dest) < len + chunk + 1) {
+         newsize = DSTRBUFLEN(dest) * 2;
+         if (newsize < len + chunk + 1) {
+            newsize = len + chunk + 1;
+         }
+         if (DSTR_SUCCESS != dstrealloc(&dest, newsize)) {
+            DSTRBUF(dest)[len] = '\0';
+            return count;
+         }
+      }
+
+      memcpy(DSTRBUF(dest) + len, start, chunk);
+      len += chunk;
+      count += chunk;
+      r->outpos += chunk;
+
+      /* we're done */
+      if (NULL != newline) {
+         break;
+      }
+   }
+
+   DSTRBUF(dest)[len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return count;
+}
+
+/* ************************************************************************* */
+
+/* reads more compressed data from the file, if there's room; sets ineof when
+   the file has nothing left - FOR INTERNAL USE ONLY! */
+static int fillin(reader *r) {
+
+   size_t n;
+
+   n = fread(r->in + r->inlen, 1, READER_BUFSIZE - r->inlen, r->fp);
+   if (0 == n) {
+      if (ferror(r->fp)) {
+         return DSTR_FILE_ERROR;
+      }
+      r->ineof = 1;
+   }
+
+   r->inlen += n;
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* replaces the contents of r->out with the next block of decompressed data;
+   returns DSTR_EOF at the end of the stream - FOR INTERNAL USE ONLY! */
+static int refill(reader *r) {
+
+   r->outpos = r->outlen = 0;
+
+   switch (r->compression) {
+
+      case DSTR_COMPRESS_NONE:
+
+         r->outlen = fread(r->out, 1, READER_BUFSIZE, r->fp);
+         if (0 == r->outlen) {
+            return ferror(r->fp) ? DSTR_FILE_ERROR : DSTR_EOF;
+         }
+         return DSTR_SUCCESS;
+
+#ifdef READER_GZIP
+      case DSTR_COMPRESS_GZIP: {
+
+         int ret;
+
+         while (0 == r->outlen) {
+
+            /* out of compressed data; get some more */
+            if (0 == r->zs.avail_in && !r->pending) {
+               if (r->ineof) {
+                  /* a stream that stops in the middle is corrupt */
+                  return r->streamend ? DSTR_EOF : DSTR_FILE_ERROR;
+               }
+               r->inlen = 0;
+               if (DSTR_SUCCESS != fillin(r)) {
+                  return DSTR_FILE_ERROR;
+               }
+               r->zs.next_in = r->in;
+               r->zs.avail_in = r->inlen;
+               continue;
+            }
+
+            /* there's more after the end of a member, so gzip files that
+               were concatenated together are read as one */
+            if (r->streamend) {
+               if (Z_OK != inflateReset(&r->zs)) {
+                  return DSTR_FILE_ERROR;
+               }
+               r->streamend = 0;
+            }
+
+            r->zs.next_out = (unsigned char *)r->out;
+            r->zs.avail_out = READER_BUFSIZE;
+
+            ret = inflate(&r->zs, Z_NO_FLUSH);
+            r->outlen = READER_BUFSIZE - r->zs.avail_out;
+            r->pending = 0 == r->zs.avail_out && Z_STREAM_END != ret;
+
+            if (Z_STREAM_END == ret) {
+               r->streamend = 1;
+            } else if (Z_MEM_ERROR == ret) {
+               return DSTR_NOMEM;
+            } else if (Z_OK != ret && Z_BUF_ERROR != ret) {
+               return DSTR_FILE_ERROR;
+            }
+         }
+
+         return DSTR_SUCCESS;
+      }
+#endif
+
+#ifdef READER_ZSTD
+      case DSTR_COMPRESS_ZSTD: {
+
+         ZSTD_outBuffer zout;
+
+         while (0 == r->outlen) {
+
+            /* out of compressed data; get some more */
+            if (r->zin.pos == r->zin.size && !r->pending) {
+               if (r->ineof) {
+                  /* a frame that stops in the middle is corrupt */
+                  return 0 == r->zret ? DSTR_EOF : DSTR_FILE_ERROR;
+               }
+               r->inlen = 0;
+               if (DSTR_SUCCESS != fillin(r)) {
+                  return DSTR_FILE_ERROR;
+               }
+               r->zin.size = r->inlen;
+               r->zin.pos = 0;
+               continue;
+            }
+
+            zout.dst = r->out;
+            zout.size = READER_BUFSIZE;
+            zout.pos = 0;
+
+            r->zret = ZSTD_decompressStream(r->zd, &zout, &r->zin);
+            if (ZSTD_isError(r->zret)) {
+               return DSTR_FILE_ERROR;
+            }
+
+            r->outlen = zout.pos;
+            r->pending = zout.pos == zout.size;
+         }
+
+         return DSTR_SUCCESS;
+      }
+#endif
+
+      default:
+         return DSTR_UNSUPPORTED;
+   }
+}
@@ -0,0 +1,309 @@
+
+/* ************************************************************************* *\
+   * File: split.c                                                         *
+   * Purpose:                                                              *
+   *    Provides functions that split a dstring_t into fields without      *
+   *    copying or allocating anything                                     *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <limits.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* sets of up to this many delimiters are compared a word at a time; larger
+   sets are looked up in a table, one byte at a time */
+#define SPLIT_MAXVECTOR 4
+
+/* what *index is set to once the last field has been returned */
+#define SPLIT_DONE ((size_t)-1)
+
+/* a set of delimiters, ready to be searched for */
+typedef struct {
+   const char          *delims;
+   size_t               n;
+   const unsigned char *table;               /* only if n > SPLIT_MAXVECTOR */
+#ifdef __SSE2__
+   __m128i              v[SPLIT_MAXVECTOR];
+#endif
+} byteset;
+
+/* bytes in a word that are equal to C (any byte, if the word contains one;
+   the exact positions aren't reliable) */
+#define SWAR_ONES     ((uint64_t)0x0101010101010101ULL)
+#define SWAR_HIGHS    ((uint64_t)0x8080808080808080ULL)
+#define SWAR_ZERO(X)  (((X) - SWAR_ONES) & ~(X) & SWAR_HIGHS)
+#define SWAR_HAS(X, C) SWAR_ZERO((X) ^ (SWAR_ONES * (unsigned char)(C)))
+
+static void   tableinit(unsigned char *table, const char *delims, size_t n);
+static void   setinit(byteset *set, const char *delims, size_t n,
+   const unsigned char *table);
+static size_t setscan(const char *buf, size_t i, size_t buflen,
+   const byteset *set);
+
+/* ************************************************************************* */
+
+size_t dstrsplit(const dstring_t str, const char *delims, dstrfield_t *fields,
+size_t max) {
+
+   const char    *buf;
+   byteset        set;
+   unsigned char  table[UCHAR_MAX + 1];
+   size_t         n, start = 0, end, count = 0;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == delims) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   if (NULL == fields || 0 == max) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   buf = DSTRBUF(str);
+   if ((n = strlen(delims)) > SPLIT_MAXVECTOR) {
+      tableinit(table, delims, n);
+   }
+   setinit(&set, delims, n, table);
+
+   for (;;) {
+
+      /* if we're down to the last slot, it gets the rest of the string */
+      if (count == max - 1) {
+         fields[count].offset = start;
+         fields[count].length = strlen(buf + start);
+         count++;
+         break;
+      }
+
+      end = setscan(buf, start, DSTRBUFLEN(str), &set);
+      fields[count].offset = start;
+      fields[count].length = end - start;
+      count++;
+
+      if ('\0' == buf[end]) {
+         break;
+      }
+
+      start = end + 1;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return count;
+}
+
+/* ************************************************************************* */
+
+int dstrsplitbegin(dstrsplit_t *split, const char *delims) {
+
+   if (NULL == split) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return DSTR_INVALID_ARGUMENT;
+   }
+
+   if (NULL == delims) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return DSTR_NULL_CPTR;
+   }
+
+   split->index = 0;
+   split->delims = delims;
+
+   /* the table is built once here, rather than on every dstrsplitnext() */
+   if ((split->ndelims = strlen(delims)) > SPLIT_MAXVECTOR) {
+      tableinit(split->table, delims, split->ndelims);
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+int dstrsplitnext(const dstring_t str, dstrsplit_t *split,
+dstrfield_t *field) {
+
+   const char *buf;
+   byteset     set;
+   size_t      end;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == split || NULL == field) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   /* the last field has already been returned */
+   if (SPLIT_DONE == split->index) {
+      _setdstrerrno(DSTR_EOF);
+      return 0;
+   }
+
+   if (split->index >= DSTRBUFLEN(str)) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return 0;
+   }
+
+   buf = DSTRBUF(str);
+   setinit(&set, split->delims, split->ndelims, split->table);
+
+   end = setscan(buf, split->index, DSTRBUFLEN(str), &set);
+   field->offset = split->index;
+   field->length = end - split->index;
+
+   split->index = '\0' == buf[end] ? SPLIT_DONE : end + 1;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* marks each of the n delimiters in a table indexed by byte */
+static void tableinit(unsigned char *table, const char *delims, size_t n) {
+
+   size_t i;
+
+   memset(table, 0, UCHAR_MAX + 1);
+   for (i = 0; i < n; i++) {
+      table[(unsigned char)delims[i]] = 1;
+   }
+}
+
+/* ************************************************************************* */
+
+/* gets a set of n delimiters ready for setscan(); if there are more than
+   SPLIT_MAXVECTOR, table must already have been built by tableinit() */
+static void setinit(byteset *set, const char *delims, size_t n,
+const unsigned char *table) {
+
+   set->delims = delims;
+   set->n = n;
+   set->table = table;
+
+#ifdef __SSE2__
+   if (n <= SPLIT_MAXVECTOR) {
+      size_t i;
+      for (i = 0; i < n; i++) {
+         set->v[i] = _mm_set1_epi8(delims[i]);
+      }
+   }
+#endif
+}
+
+/* ************************************************************************* */
+
+/* returns the index of the first delimiter (or the null terminator) at or
+   after buf[i]; whole words are only read while they're inside the buffer */
+static size_t setscan(const char *buf, size_t i, size_t buflen,
+const byteset *set) {
+
+   size_t k;
+
+   if (set->n > SPLIT_MAXVECTOR) {
+      while ('\0' != buf[i] && !set->table[(unsigned char)buf[i]]) {
+         i++;
+      }
+      return i;
+   }
+
+#ifdef __SSE2__
+
+   {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i v, m;
+      int mask;
+
+      for (; i + 16 <= buflen; i += 16) {
+
+         v = _mm_loadu_si128((const __m128i *)(buf + i));
+         m = _mm_cmpeq_epi8(v, zero);
+
+         for (k = 0; k < set->n; k++) {
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, set->v[k]));
+         }
+
+         if (0 != (mask = _mm_movemask_epi8(m))) {
+            return i + __builtin_ctz(mask);
+         }
+      }
+   }
+
+#else
+
+   {
+      uint64_t w, hit;
+
+      for (; i + 8 <= buflen; i += 8) {
+
+         memcpy(&w, buf + i, 8);
+         hit = SWAR_ZERO(w);
+
+         for (k = 0; k < set->n; k++) {
+            hit |= SWAR_HAS(w, set->delims[k]);
+         }
+
+         if (hit) {
+            break;
+         }
+      }
+   }
+
+#endif
+
+   for (;; i++) {
+      if ('\0' == buf[i]) {
+         return i;
+      }
+      for (k = 0; k < set->n; k++) {
+         if (buf[i] == set->delims[k]) {
+            return i;
+         }
+      }
+   }
+}
@@ -36,6 +36,8 @@
 
 
 #include <ctype.h>
+#include <limits.h>
+#include <math.h>
 #include <string.h>
 #include <stdarg.h>
 
@@ -43,9 +45,30 @@
 #include "static.h"
 #include "sprintf.h"
 
-static char *flags       = FLAGSC;
-static char *modifiers   = MODIFIERSC;
-static char *conversions = CONVERSIONSC;
+/* maps every character that can appear in a conversion specifier to its
+   bit flag; flags, modifiers and conversions each have their own range of
+   bits, so a single table covers all three */
+static const long int specbits[UCHAR_MAX + 1] = {
+   [' '] = FLAG_SPACE,      ['-'] = FLAG_MINUS,      ['+'] = FLAG_PLUS,
+   ['0'] = FLAG_0,          ['#'] = FLAG_POUND,
+
+   ['h'] = SHORT,           ['l'] = LONG,            ['L'] = LONG_DOUBLE,
+
+   ['d'] = SIGNED_INT,      ['i'] = SIGNED_INT,      ['o'] = OCTAL,
+   ['x'] = HEX_LOWERCASE,   ['X'] = HEX_UPPERCASE,   ['u'] = UNSIGNED_INT,
+   ['c'] = CHAR,            ['s'] = C_STRING,        ['S'] = DSTRING,
+   ['f'] = FLOAT,           ['e'] = FLOAT_EXP_LOWER, ['E'] = FLOAT_EXP_UPPER,
+   ['g'] = FLOAT_G_LOWER,   ['G'] = FLOAT_G_UPPER,   ['p'] = POINTER,
+   ['n'] = NUM_CHARS,       ['r'] = FLOAT_SHORTEST
+};
+
+/* reads a field width or precision, stopping short of overflowing an int */
+#define PARSEINT(POS, N) \
+   for ((N) = 0; isdigit((unsigned char)*(POS)); (POS)++) { \
+      if ((N) <= (INT_MAX - 9) / 10) { \
+         (N) = (N) * 10 + (*(POS) - '0'); \
+      } \
+   }
 
 
 /* ************************************************************************* */
@@ -66,264 +89,377 @@ int dstrsprintf(dstring_t str, const char *format, ...) {
 
 int dstrvsprintf(dstring_t str, const char *format, va_list args) {
 
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return -1;
+   }
+
+   if (!DSTRWRITABLE(str)) {
+      return -1;
+   }
+
+   /* the string is overwritten, so this is just appending to nothing */
+   DSTRBUF(str)[0] = '\0';
+   return dstrvcatprintf(str, format, args);
+}
+
+/* ************************************************************************* */
+
+int dstrcatprintf(dstring_t str, const char *format, ...) {
+
+   va_list args;
+   int chars;
+
+   va_start(args, format);
+   chars = dstrvcatprintf(str, format, args);
+   va_end(args);
+
+   return chars;
+}
+
+/* ************************************************************************* */
+
+int dstrvcatprintf(dstring_t str, const char *format, va_list args) {
+
    /* flags containing information about a single conversion specifier */
    struct specifier conversion;
 
+   /* where we're writing to in str */
+   struct output out;
+
+   /* our own copy of args, so it can be passed around by reference */
+   va_list ap;
+
    /* keeps track of our position in format */
    char *curpos;
    char *end;
 
-   /* keeps track of the return value of append* functions */
-   int r;
+   /* for estimating how much room we'll need */
+   size_t estimate;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return -1;
+   }
+
+   if (!DSTRWRITABLE(str)) {
+      return -1;
+   }
+
+   if (NULL == format) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return -1;
+   }
+
+   /* start writing at the end of whatever's already there, and make room
+      for the literal part of the format plus a guess at each conversion */
+   for (estimate = 0, curpos = (char *)format; '\0' != *curpos; curpos++) {
+      estimate += '%' == *curpos ? CONVERSION_ESTIMATE : 1;
+   }
+
+   out.str = str;
+   out.len = out.start = dstrlen(str);
+   if (DSTR_SUCCESS != outreserve(&out, estimate)) {
+      return -1;
+   }
 
    curpos = (char *)format;
+   va_copy(ap, args);
 
-   /* make sure the string is empty */
-   if (dstrlen(str) != 0) {
-      dstrtrunc(str, 0);
-      if (dstrerrno != DSTR_SUCCESS) {
-         return -1;
+   while (*curpos != '\0') {
+
+      /* copy everything up to the next possible conversion specifier */
+      if ('%' != *curpos) {
+         if (NULL == (end = strchr(curpos, '%'))) {
+            end = curpos + strlen(curpos);
+         }
+         if (outwrite(&out, curpos, end - curpos) < 0) {
+            goto error;
+         }
+         curpos = end;
+         continue;
+      }
+
+      end = parsearg(curpos, &conversion);
+
+      /* it wasn't a valid specifier, so the % is just an ordinary character */
+      if (end == curpos) {
+         if (outwrite(&out, curpos, 1) < 0) {
+            goto error;
+         }
+         curpos++;
+         continue;
+      }
+
+      /* it was a valid specifier, so make sure we update curpos */
+      curpos = end;
+      if (appendarg(&out, conversion, &ap) < 0) {
+         goto error;
       }
    }
 
-   while (*curpos != '\0') {
+   va_end(ap);
+   DSTRBUF(str)[out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return out.len - out.start;
+
+error:
+   /* leave str the way we found it */
+   va_end(ap);
+   DSTRBUF(str)[out.start] = '\0';
+   return -1;
+}
 
-      /* possible conversion specifier */
-      if ('%' == *curpos) {
+/* ************************************************************************* */
+
+int dstrcatint(dstring_t dest, long int value) {
+
+   struct output out;
+   struct specifier conversion = {0, 0, 0};
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   out.str = dest;
+   out.len = out.start = dstrlen(dest);
+
+   /* if there isn't enough memory, the string is untouched */
+   if (appendsignedint(&out, conversion, value, 10) < 0) {
+      return 0;
+   }
+
+   DSTRBUF(dest)[out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return out.len - out.start;
+}
+
+/* ************************************************************************* */
+
+int dstrcatuint(dstring_t dest, unsigned long int value) {
+
+   struct output out;
+   struct specifier conversion = {0, 0, 0};
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   out.str = dest;
+   out.len = out.start = dstrlen(dest);
+
+   /* if there isn't enough memory, the string is untouched */
+   if (appendunsignedint(&out, conversion, value, 10) < 0) {
+      return 0;
+   }
 
-         end = parsearg(curpos, &conversion);
-         if (dstrerrno != DSTR_SUCCESS) {
+   DSTRBUF(dest)[out.len] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return out.len - out.start;
+}
+
+/* ************************************************************************* */
+
+int appendarg(struct output *out, const struct specifier conversion,
+   va_list *args) {
+
+   /* used for %c, %s and %S */
+   char c;
+   const char *cs;
+   const char *end;
+   dstring_t ds;
+   size_t n;
+
+   switch(CONVERSIONBITS & conversion.format) {
+
+      case PERCENT:
+         return outwrite(out, "%", 1);
+
+      case SIGNED_INT:
+
+         if (conversion.format & LONG) {
+            return appendsignedint(out, conversion,
+                      va_arg(*args, long int), 10);
+         } else if (conversion.format & SHORT) {
+            return appendsignedint(out, conversion,
+                      (short)va_arg(*args, int), 10);
+         } else {
+            return appendsignedint(out, conversion,
+                      (long int)va_arg(*args, int), 10);
+         }
+
+      case UNSIGNED_INT:
+      case OCTAL:
+      case HEX_LOWERCASE:
+      case HEX_UPPERCASE:
+
+         n = UNSIGNED_INT & conversion.format ? 10 :
+            (OCTAL & conversion.format ? 8 : 16);
+
+         if (conversion.format & LONG) {
+            return appendunsignedint(out, conversion,
+                      va_arg(*args, unsigned long int), n);
+         } else if (conversion.format & SHORT) {
+            return appendunsignedint(out, conversion,
+                      (unsigned short)va_arg(*args, unsigned int), n);
+         } else {
+            return appendunsignedint(out, conversion,
+                      (unsigned long)va_arg(*args, unsigned int), n);
+         }
+
+      case CHAR:
+
+         c = (unsigned char)va_arg(*args, int);
+         return outpadded(out, conversion, &c, 1);
+
+      case C_STRING:
+
+         if (NULL == (cs = va_arg(*args, char *))) {
+            _setdstrerrno(DSTR_NULL_CPTR);
             return -1;
          }
 
-         /* it wasn't a valid specifier */
-         if (end == curpos) {
-            dstrinsertc(str, dstrlen(str), *curpos);
-            if (dstrerrno != DSTR_SUCCESS) {
-               return -1;
-            }
-            curpos++;
-            continue;
+         /* don't look past the precision for the null terminator */
+         if (conversion.format & PRECISION) {
+            end = memchr(cs, '\0', conversion.precision);
+            n = NULL == end ? (size_t)conversion.precision : (size_t)(end - cs);
+         } else {
+            n = strlen(cs);
          }
 
-         /* it was a valid specifier */
-         else {
-            /* make sure we update curpos */
-            curpos = end;
-            switch(CONVERSIONBITS & conversion.format) {
-               case PERCENT:
-                  dstrinsertc(str, dstrlen(str) - 1, '%');
-                  if (DSTR_SUCCESS != dstrerrno) {
-                     return -1;
-                  }
-                  break;
-
-               case SIGNED_INT:
-
-                  if (conversion.format & LONG) {
-                     r = appendsignedint(str, conversion,
-                            va_arg(args, long int), 10);
-                  } else if (conversion.format & SHORT) {
-                     r = appendsignedint(str, conversion,
-                            (long int)va_arg(args, int), 10);
-                  } else {
-                     r = appendsignedint(str, conversion,
-                            (long int)va_arg(args, int), 10);
-                  }
-
-                  if (r < 0) {
-                     return -1;
-                  }
-
-                  break;
-
-               case UNSIGNED_INT:
-
-                  if (conversion.format & LONG) {
-                     r = appendunsignedint(str, conversion,
-                            va_arg(args, unsigned long int), 10);
-                  } else if (conversion.format & SHORT) {
-                     r = appendsignedint(str, conversion,
-                            (unsigned long)va_arg(args, unsigned int), 10);
-                  } else {
-                     r = appendsignedint(str, conversion,
-                            (unsigned long)va_arg(args, unsigned int), 10);
-                  }
-
-                  if (r < 0) {
-                     return -1;
-                  }
-
-                  break;
-
-               case OCTAL:
-
-                  if (conversion.format & LONG) {
-                     r = appendunsignedint(str, conversion,
-                            va_arg(args, unsigned long int), 8);
-                  } else if (conversion.format & SHORT) {
-                     r = appendunsignedint(str, conversion,
-                            (unsigned long)va_arg(args, unsigned int), 8);
-                  } else {
-                     r = appendunsignedint(str, conversion,
-                            (unsigned long)va_arg(args, unsigned int), 8);
-                  }
-
-                  if (r < 0) {
-                     return -1;
-                  }
-
-                  break;
-
-               case HEX_LOWERCASE:
-               case HEX_UPPERCASE:
-
-                  if (conversion.format & LONG) {
-                     r = appendsignedint(str, conversion,
-                            va_arg(args, long int), 16);
-                  } else if (conversion.format & SHORT) {
-                     r = appendsignedint(str, conversion,
-                            (long)va_arg(args, int), 16);
-                  } else {
-                     r = appendsignedint(str, conversion,
-                            (long)va_arg(args, int), 16);
-                  }
-
-                  if (r < 0) {
-                     return -1;
-                  }
-
-                  break;
+         return outpadded(out, conversion, cs, n);
 
-               case CHAR:
+      case DSTRING:
 
-                  dstrinsertc(str, dstrlen(str) - 1,
-                     (unsigned char)va_arg(args, int));
-                  if (DSTR_SUCCESS != dstrerrno) {
-                     return -1;
-                  }
+         if (NULL == (ds = va_arg(*args, dstring_t))) {
+            _setdstrerrno(DSTR_UNINITIALIZED);
+            return -1;
+         }
 
-                  break;
+         n = dstrlen(ds);
+         if (conversion.format & PRECISION &&
+         n > (size_t)conversion.precision) {
+            n = conversion.precision;
+         }
 
-               case C_STRING:
-
-                  if (conversion.format & PRECISION) {
-                     dstrncatcs(str, va_arg(args, char *),
-                        conversion.precision);
-                  } else {
-                     dstrcatcs(str, va_arg(args, char *));
-                  }
+         return outpadded(out, conversion, DSTRBUF(ds), n);
 
-                  if (DSTR_SUCCESS != dstrerrno) {
-                     return -1;
-                  }
+      case FLOAT:
+      case FLOAT_EXP_LOWER:
+      case FLOAT_EXP_UPPER:
+      case FLOAT_G_LOWER:
+      case FLOAT_G_UPPER:
+      case FLOAT_SHORTEST:
 
-                  break;
+         if (conversion.format & LONG_DOUBLE) {
+            return appendfloat(out, conversion,
+                      (double)va_arg(*args, long double));
+         } else {
+            return appendfloat(out, conversion, va_arg(*args, double));
+         }
 
-               case DSTRING:
+      case POINTER:
 
-                  if (conversion.format & PRECISION) {
-                     dstrncat(str, va_arg(args, dstring_t),
-                        conversion.precision);
-                  } else {
-                     dstrcat(str, va_arg(args, dstring_t));
-                  }
+         return appendptr(out, conversion, va_arg(*args, void *));
 
-                  if (DSTR_SUCCESS != dstrerrno) {
-                     return -1;
-                  }
+      /* like printf, store the number of characters written so far */
+      case NUM_CHARS:
 
-                  break;
+         if (conversion.format & LONG) {
+            *va_arg(*args, long int *) = out->len - out->start;
+         } else if (conversion.format & SHORT) {
+            *va_arg(*args, short *) = out->len - out->start;
+         } else {
+            *va_arg(*args, int *) = out->len - out->start;
+         }
 
-               case FLOAT:
+         return 0;
 
-                  if (conversion.format & LONG_DOUBLE) {
-                     r = appendfloat(str, conversion,
-                            va_arg(args, long double));
-                  } else {
-                     r = appendfloat(str, conversion,
-                            (long double)va_arg(args, double));
-                  }
+      default:
+         return 0;
+   }
+}
 
-                  if (r < 0) {
-                     return -1;
-                  }
+/* ************************************************************************* */
 
-                  break;
+int outreserve(struct output *out, size_t n) {
 
-               case FLOAT_EXP_LOWER:
-               case FLOAT_EXP_UPPER:
+   size_t size;
 
-                  if (conversion.format & LONG_DOUBLE) {
-                     r = appendfloatexp(str, conversion,
-                            va_arg(args, long double));
-                  } else {
-                     r = appendfloatexp(str, conversion,
-                            (long double)va_arg(args, long double));
-                  }
+   if (out->len + n < DSTRBUFLEN(out->str)) {
+      return DSTR_SUCCESS;
+   }
 
-                  if (r < 0) {
-                     return -1;
-                  }
+   size = DSTRBUFLEN(out->str) * 2;
+   if (size < out->len + n + 1) {
+      size = out->len + n + 1;
+   }
 
-                  break;
+   return dstrealloc(&out->str, size);
+}
 
-               case FLOAT_G_LOWER:
-               case FLOAT_G_UPPER:
+/* ************************************************************************* */
 
-                  break;
+int outwrite(struct output *out, const char *src, size_t n) {
 
-               case POINTER:
+   if (DSTR_SUCCESS != outreserve(out, n)) {
+      return -1;
+   }
 
-                  r = appendptr(str, conversion, va_arg(args, void *));
+   memcpy(DSTRBUF(out->str) + out->len, src, n);
+   out->len += n;
+   return 0;
+}
 
-                  if (r < 0) {
-                     return -1;
-                  }
+/* ************************************************************************* */
 
-                  break;
+int outpadded(struct output *out, const struct specifier conversion,
+   const char *src, size_t n) {
 
-               case NUM_CHARS:
+   size_t pad = 0;
 
-                  r = appendunsignedint(str, conversion,
-                         (unsigned long)dstrlen(str), 10);
+   if (conversion.format & FIELDWIDTH && n < (size_t)conversion.field) {
+      pad = conversion.field - n;
+   }
 
-                  if (r < 0) {
-                     return -1;
-                  }
+   if (DSTR_SUCCESS != outreserve(out, n + pad)) {
+      return -1;
+   }
 
-                  break;
+   /* right justified by default, left justified with the - flag */
+   if (!(conversion.format & FLAG_MINUS)) {
+      memset(DSTRBUF(out->str) + out->len, ' ', pad);
+      out->len += pad;
+   }
 
-               default:
-                  break;
-            }
-            continue;
-         }
-      }
+   memcpy(DSTRBUF(out->str) + out->len, src, n);
+   out->len += n;
 
-      /* just another ordinary character to insert into str */
-      dstrinsertc(str, dstrlen(str), *curpos);
-      if (dstrerrno != DSTR_SUCCESS) {
-         return -1;
-      }
-      curpos++;
+   if (conversion.format & FLAG_MINUS) {
+      memset(DSTRBUF(out->str) + out->len, ' ', pad);
+      out->len += pad;
    }
 
-   _setdstrerrno(DSTR_SUCCESS);
-   return dstrlen(str);
+   return 0;
 }
 
 /* ************************************************************************* */
 
 char *parsearg(char *format, struct specifier *conversion) {
 
-   int i;
+   long int bits;
    char *pos = format;
 
-   /* store string versions of the field width and precision */
-   dstring_t fieldstr;
-   dstring_t precisionstr;
-
    /* make sure we zero out the format structure each time */
    conversion->format    = 0;
    conversion->field     = 0;
@@ -339,308 +475,509 @@ char *parsearg(char *format, struct specifier *conversion) {
       return pos;
    }
 
-   /* initialize the temporary field width and precision strings */
-   if (DSTR_SUCCESS != dstralloc(&fieldstr)) {
-      return format;
-   }
-
-   if (DSTR_SUCCESS != dstralloc(&precisionstr)) {
-      dstrfree(&fieldstr);
-      return format;
-   }
-
    /* check for flags */
-   for (i = 0; flags[i] != '\0'; i++) {
+   while ((bits = specbits[(unsigned char)*pos] & FLAGBITS)) {
 
-      /* we found a flag */
-      if (*pos == flags[i]) {
-
-         /* make sure it's not a duplicate */
-         if (FLAG(flags[i]) == (conversion->format & FLAG(flags[i]))) {
-            dstrfree(&fieldstr), dstrfree(&precisionstr);
-            return format;
-         } else {
-            conversion->format |= FLAG(flags[i]);
-         }
-
-         /* look to see if there are more flags */
-         pos++, i = 0;
-      }
-   }
-
-   /* is there a field width? */
-   for (; isdigit(*pos); pos++) {
-      dstrinsertc(fieldstr, dstrlen(fieldstr), *pos);
-      if (DSTR_SUCCESS != dstrerrno) {
-         dstrfree(&fieldstr), dstrfree(&precisionstr);
+      /* make sure it's not a duplicate */
+      if (conversion->format & bits) {
          return format;
       }
+
+      conversion->format |= bits;
+      pos++;
    }
 
-   /* we got a field width, so convert it into an integer */
-   if (dstrlen(fieldstr) > 0) {
-      conversion->field = str2int(fieldstr);
-      if (conversion->field < 0) {
-         dstrfree(&fieldstr), dstrfree(&precisionstr);
-         return format;
-      }
+   /* is there a field width? */
+   if (isdigit((unsigned char)*pos)) {
+      PARSEINT(pos, conversion->field);
       conversion->format |= FIELDWIDTH;
    }
 
-   /* is there a precision? */
+   /* is there a precision? (like printf, "." on its own means 0) */
    if ('.' == *pos) {
-      for (pos++; isdigit(*pos); pos++) {
-         dstrinsertc(precisionstr, dstrlen(precisionstr), *pos);
-         if (DSTR_SUCCESS != dstrerrno) {
-            dstrfree(&fieldstr), dstrfree(&precisionstr);
-            return format;
-         }
-      }
-   }
-
-   /* we got a precision, so convert it into an integer */
-   if (dstrlen(precisionstr) > 0) {
-      conversion->precision = str2int(precisionstr);
-      if (conversion->field < 0) {
-         dstrfree(&fieldstr), dstrfree(&precisionstr);
-         return format;
-      }
+      pos++;
+      PARSEINT(pos, conversion->precision);
       conversion->format |= PRECISION;
    }
 
    /* now, check for modifiers */
-   for (i = 0; modifiers[i] != '\0'; i++) {
-
-      /* we found a modifier */
-      if (*pos == modifiers[i]) {
-
-         /* make sure it's not a duplicate */
-         /* NOTE: we'll have to make an exception for C99 'll' */
-         if (MOD(modifiers[i]) == (conversion->format & MOD(modifiers[i]))) {
-            dstrfree(&fieldstr), dstrfree(&precisionstr);
-            return format;
-         } else {
-            conversion->format |= MOD(modifiers[i]);
-         }
+   /* NOTE: we'll have to make an exception for C99 'll' */
+   while ((bits = specbits[(unsigned char)*pos] & MODIFIERBITS)) {
 
-         /* look to see if there are more flags */
-         pos++, i = 0;
+      /* make sure it's not a duplicate */
+      if (conversion->format & bits) {
+         return format;
       }
+
+      conversion->format |= bits;
+      pos++;
    }
 
    /* lastly, make sure we have a conversion specifier */
-   for (i = 0; conversions[i] != '\0'; i++) {
-
-      /* we found a conversion specifier */
-      if (*pos == conversions[i]) {
-            conversion->format |= CONVERSION(conversions[i]);
-            dstrfree(&fieldstr), dstrfree(&precisionstr);
-            pos++;
-            return pos;
-      }
+   if ((bits = specbits[(unsigned char)*pos] & CONVERSIONBITS)) {
+      conversion->format |= bits;
+      pos++;
+      return pos;
    }
 
-   /* there was no conversion specifier, so we did all that for nothing! */
-   dstrfree(&fieldstr), dstrfree(&precisionstr);
+   /* there was no conversion specifier, so it isn't valid */
    return format;
 }
 
 /* ************************************************************************* */
 
-int appendsignedint(dstring_t dest, const struct specifier conversion,
+int appendsignedint(struct output *out, const struct specifier conversion,
    long int arg, int base) {
 
-   /* this is the index in which we insert digits in reverse order */
-   int index = 0;
-   dstring_t tempint;
-
-
-   if (DSTR_SUCCESS != dstralloc(&tempint)) {
-      return -1;
-   }
-
-   /* is the integer negative? */
+   /* is the integer negative? (negate as unsigned so LONG_MIN works) */
    if (arg < 0) {
-      if (DSTR_SUCCESS != dstrinsertc(tempint, 0, '-')) {
-         dstrfree(&tempint);
-         return -1;
-      }
-      index = 1;
-      arg *= -1;
+      return appendintcommon(out, '-', conversion,
+         0UL - (unsigned long)arg, base);
    }
 
    /* + flag set, so append the sign even if it's positive */
    else if (conversion.format & FLAG_PLUS) {
-      if (DSTR_SUCCESS != dstrinsertc(tempint, 0, '+')) {
-         dstrfree(&tempint);
-         return -1;
-      }
-      index = 1;
+      return appendintcommon(out, '+', conversion, arg, base);
    }
 
    /* space flag set, so if there's no sign, prefix with a space */
    else if (conversion.format & FLAG_SPACE) {
-      if (DSTR_SUCCESS != dstrinsertc(tempint, 0, ' ')) {
-         dstrfree(&tempint);
+      return appendintcommon(out, ' ', conversion, arg, base);
+   }
+
+   return appendintcommon(out, '\0', conversion, arg, base);
+}
+
+/* ************************************************************************* */
+
+int appendunsignedint(struct output *out, const struct specifier conversion,
+   unsigned long int arg, int base) {
+
+   /* like printf, the + and space flags only apply to signed conversions */
+   return appendintcommon(out, '\0', conversion, arg, base);
+}
+
+/* ************************************************************************* */
+
+int appendfloat(struct output *out, const struct specifier conversion,
+   double arg) {
+
+   char digits[DTOA_MAXDIGITS];
+   char sign = '\0';
+   char *pos;
+   const char *special;
+   struct specifier nozeros;
+   int len = 0, exponent = 0, precision = 6;
+   size_t pad;
+
+   if (signbit(arg)) {
+      sign = '-';
+      arg = -arg;
+   } else if (conversion.format & FLAG_PLUS) {
+      sign = '+';
+   } else if (conversion.format & FLAG_SPACE) {
+      sign = ' ';
+   }
+
+   /* infinity and NaN are never padded with zeros */
+   if (isinf(arg) || isnan(arg)) {
+
+      if (conversion.format & (FLOAT_EXP_UPPER | FLOAT_G_UPPER)) {
+         special = isinf(arg) ? "INF" : "NAN";
+      } else {
+         special = isinf(arg) ? "inf" : "nan";
+      }
+
+      nozeros = conversion;
+      nozeros.format &= ~FLAG_0;
+      if (NULL == (pos = floatfield(out, nozeros, sign, 3, &pad))) {
          return -1;
       }
-      index = 1;
-   }
 
-   /* append the rest of the number */
-   if (0 != appendintcommon(tempint, index, conversion, (unsigned)arg, base)) {
-      dstrfree(&tempint);
-      return -1;
+      memcpy(pos, special, 3);
+      memset(pos + 3, ' ', pad);
+      return 0;
    }
 
-   /* append the temporary string to the dest string and return */
-   dstrcat(dest, tempint);
-   if (DSTR_SUCCESS != dstrerrno) {
-      dstrfree(&tempint);
-      return -1;
+   if (conversion.format & PRECISION) {
+      precision = conversion.precision;
    }
 
-   dstrfree(&tempint);
-   return 0;
+   switch (CONVERSIONBITS & conversion.format) {
+
+      case FLOAT:
+
+         if (0 != arg) {
+            len = dtoafixed(arg, precision, digits, &exponent);
+         }
+
+         return appendfloatfixed(out, conversion, sign, digits, len,
+            exponent, precision);
+
+      case FLOAT_EXP_LOWER:
+      case FLOAT_EXP_UPPER:
+
+         if (0 != arg) {
+            len = dtoacounted(arg, precision + 1, digits, &exponent);
+         }
+
+         return appendfloatexp(out, conversion, sign, digits, len,
+            exponent, precision);
+
+      case FLOAT_G_LOWER:
+      case FLOAT_G_UPPER:
+
+         if (0 == precision) {
+            precision = 1;
+         }
+
+         if (0 != arg) {
+            len = dtoacounted(arg, precision, digits, &exponent);
+         }
+
+         /* unless the # flag was given, trailing zeros are dropped */
+         if (!(conversion.format & FLAG_POUND)) {
+            while (len > 0 && '0' == digits[len - 1]) {
+               len--;
+            }
+         }
+
+         /* the style depends on the exponent %e would have used */
+         if (exponent >= -4 && exponent < precision) {
+            precision = precision - 1 - exponent;
+            if (!(conversion.format & FLAG_POUND)) {
+               precision = len - 1 - exponent > 0 ? len - 1 - exponent : 0;
+            }
+            return appendfloatfixed(out, conversion, sign, digits, len,
+               exponent, precision);
+         }
+
+         precision--;
+         if (!(conversion.format & FLAG_POUND)) {
+            precision = len > 1 ? len - 1 : 0;
+         }
+         return appendfloatexp(out, conversion, sign, digits, len,
+            exponent, precision);
+
+      /* as few digits as it takes to read back the same double */
+      case FLOAT_SHORTEST:
+
+         if (0 != arg) {
+            len = dtoashortest(arg, digits, &exponent);
+         }
+
+         if (exponent >= -4 && exponent < 17) {
+            return appendfloatfixed(out, conversion, sign, digits, len,
+               exponent, len - 1 - exponent > 0 ? len - 1 - exponent : 0);
+         }
+
+         return appendfloatexp(out, conversion, sign, digits, len,
+            exponent, len > 1 ? len - 1 : 0);
+
+      default:
+         return 0;
+   }
 }
 
 /* ************************************************************************* */
 
-int appendunsignedint(dstring_t dest, const struct specifier conversion,
-   unsigned long int arg, int base) {
+int appendfloatfixed(struct output *out, const struct specifier conversion,
+   char sign, const char *digits, int len, int exponent, int precision) {
+
+   char *pos;
+   size_t pad, intdigits, point, lead, start, n;
 
-   /* this is the index in which we insert digits in reverse order */
-   int index = 0;
-   dstring_t tempint;
+   /* there's always at least one digit before the point */
+   intdigits = exponent >= 0 ? exponent + 1 : 1;
+   point = precision > 0 || conversion.format & FLAG_POUND;
 
-   if (DSTR_SUCCESS != dstralloc(&tempint)) {
+   if (NULL == (pos = floatfield(out, conversion, sign,
+   intdigits + point + precision, &pad))) {
       return -1;
    }
 
-   /* + flag set, so append the sign even though it's positive */
-   if (conversion.format & FLAG_PLUS) {
-      if (DSTR_SUCCESS != dstrinsertc(tempint, 0, '+')) {
-         dstrfree(&tempint);
-         return -1;
-      }
-      index = 1;
+   /* the integer part */
+   if (exponent >= 0) {
+      n = len < exponent + 1 ? (size_t)len : intdigits;
+      memcpy(pos, digits, n);
+      memset(pos + n, '0', intdigits - n);
+   } else {
+      *pos = '0';
    }
+   pos += intdigits;
 
-   /* space flag set, so if there's no sign, prefix with a space */
-   else if (conversion.format & FLAG_SPACE) {
-      if (DSTR_SUCCESS != dstrinsertc(tempint, 0, ' ')) {
-         dstrfree(&tempint);
-         return -1;
-      }
-      index = 1;
+   if (point) {
+      *pos++ = '.';
    }
 
-   /* append the rest of the number */
-   if (0 != appendintcommon(tempint, index, conversion, arg, base)) {
-      dstrfree(&tempint);
-      return -1;
+   /* the fraction, which may start with zeros if exponent < -1 */
+   lead = exponent < -1 ? (size_t)(-1 - exponent) : 0;
+   if (lead > (size_t)precision) {
+      lead = precision;
    }
+   memset(pos, '0', lead);
+   pos += lead;
 
-   /* append the temporary string to the dest string and return */
-   dstrcat(dest, tempint);
-   if (DSTR_SUCCESS != dstrerrno) {
-      dstrfree(&tempint);
-      return -1;
+   start = exponent + 1 + lead;
+   n = (size_t)len > start ? len - start : 0;
+   if (n > precision - lead) {
+      n = precision - lead;
    }
+   memcpy(pos, digits + start, n);
+   memset(pos + n, '0', precision - lead - n);
+   pos += precision - lead;
 
-   dstrfree(&tempint);
+   memset(pos, ' ', pad);
    return 0;
 }
 
 /* ************************************************************************* */
 
-int appendfloat(dstring_t dest, const struct specifier conversion,
-   long double arg) {
+int appendfloatexp(struct output *out, const struct specifier conversion,
+   char sign, const char *digits, int len, int exponent, int precision) {
+
+   char *pos;
+   size_t pad, point, n, expdigits;
+   int absexp = exponent < 0 ? -exponent : exponent;
+
+   point = precision > 0 || conversion.format & FLAG_POUND;
+   expdigits = absexp >= 100 ? 3 : 2;
+
+   if (NULL == (pos = floatfield(out, conversion, sign,
+   1 + point + precision + 2 + expdigits, &pad))) {
+      return -1;
+   }
+
+   *pos++ = len > 0 ? digits[0] : '0';
 
+   if (point) {
+      *pos++ = '.';
+   }
+
+   n = len > 1 ? len - 1 : 0;
+   if (n > (size_t)precision) {
+      n = precision;
+   }
+   memcpy(pos, digits + 1, n);
+   memset(pos + n, '0', precision - n);
+   pos += precision;
+
+   *pos++ = conversion.format & (FLOAT_EXP_UPPER | FLOAT_G_UPPER) ? 'E' : 'e';
+   *pos++ = exponent < 0 ? '-' : '+';
+
+   if (3 == expdigits) {
+      *pos++ = '0' + absexp / 100;
+   }
+   *pos++ = '0' + absexp / 10 % 10;
+   *pos++ = '0' + absexp % 10;
+
+   memset(pos, ' ', pad);
    return 0;
 }
 
 /* ************************************************************************* */
 
-int appendfloatexp(dstring_t dest, const struct specifier conversion,
-   long double arg) {
+char *floatfield(struct output *out, const struct specifier conversion,
+   char sign, size_t len, size_t *rightpad) {
 
-   return 0;
+   char *pos;
+   size_t total = len + ('\0' != sign), pad = 0, zeros = 0;
+
+   if (conversion.format & FIELDWIDTH && (size_t)conversion.field > total) {
+      if (conversion.format & FLAG_0 && !(conversion.format & FLAG_MINUS)) {
+         zeros = conversion.field - total;
+      } else {
+         pad = conversion.field - total;
+      }
+      total = conversion.field;
+   }
+
+   if (DSTR_SUCCESS != outreserve(out, total)) {
+      return NULL;
+   }
+
+   pos = DSTRBUF(out->str) + out->len;
+   out->len += total;
+
+   /* by default, the number will be right justified in its field */
+   if (!(conversion.format & FLAG_MINUS)) {
+      memset(pos, ' ', pad), pos += pad;
+      pad = 0;
+   }
+
+   if ('\0' != sign) {
+      *pos++ = sign;
+   }
+
+   memset(pos, '0', zeros);
+
+   *rightpad = pad;
+   return pos + zeros;
 }
 
 /* ************************************************************************* */
 
-int appendptr(dstring_t dest, const struct specifier conversion,
+int appendptr(struct output *out, const struct specifier conversion,
    void *ptr) {
 
-   return 0;
+   struct specifier hex = conversion;
+
+   /* pointers are printed like %#lx */
+   hex.format = (conversion.format & ~CONVERSIONBITS) | POINTER | FLAG_POUND;
+   return appendintcommon(out, '\0', hex, (unsigned long)ptr, 16);
 }
 
 /* ************************************************************************* */
 
-int appendintcommon(dstring_t tempint, int index,
+int appendintcommon(struct output *out, char sign,
    const struct specifier conversion, unsigned long int arg, int base) {
 
-   int digit;
-   char fillc = ' ';
+   char prefix[3];
+   char *pos;
+   size_t ndigits = 0, nprefix = 0, zeros = 0, pad = 0, total;
 
-   /* does the user want to pad with 0's instead of spaces? */
-   if (conversion.format & FLAG_0) {
-      fillc = '0';
+   /* like printf, a value of 0 with a precision of 0 has no digits at all */
+   if (arg > 0 || !(conversion.format & PRECISION) ||
+   conversion.precision > 0) {
+      ndigits = countdigits(arg, base);
    }
 
-   /* insert each digit */
-   do {
-      digit = arg % base;
-      if (conversion.format & HEX_LOWERCASE) {
-         if (DSTR_SUCCESS != dstrinsertc(tempint, index, DIGITCL(digit))) {
-            return -1;
-         }
-      } else {
-         if (DSTR_SUCCESS != dstrinsertc(tempint, index, DIGITC(digit))) {
-            return -1;
-         }
+   if ('\0' != sign) {
+      prefix[nprefix++] = sign;
+   }
+
+   /* the # flag gives hex a 0x prefix and makes sure octal starts with 0 */
+   if (conversion.format & FLAG_POUND) {
+      if (16 == base && arg > 0) {
+         prefix[nprefix++] = '0';
+         prefix[nprefix++] = conversion.format & HEX_UPPERCASE ? 'X' : 'x';
+      } else if (8 == base && (0 == ndigits || arg > 0)) {
+         zeros = 1;
       }
-      arg /= base;
-   } while (arg > 0);
+   }
 
-   /* did the user specify a field width? */
-   if (conversion.format & FIELDWIDTH) {
-      while (dstrlen(tempint) < conversion.field) {
+   /* the precision is the minimum number of digits */
+   if (conversion.format & PRECISION &&
+   (size_t)conversion.precision > ndigits + zeros) {
+      zeros = conversion.precision - ndigits;
+   }
 
-         /* the user wants to left justify his int in its field */
-         if (conversion.format & FLAG_MINUS) {
-            if (DSTR_SUCCESS != dstrinsertc(tempint, dstrlen(tempint), fillc)) {
-               return -1;
-            }
-         }
+   total = nprefix + zeros + ndigits;
 
-         /* by default, the int will be right justified in its field */
-         else {
-            if (DSTR_SUCCESS != dstrinsertc(tempint, index, fillc)) {
-               return -1;
-            }
-         }
+   /* did the user specify a field width? */
+   if (conversion.format & FIELDWIDTH && (size_t)conversion.field > total) {
+
+      /* the 0 flag is ignored with - or if there's a precision */
+      if (conversion.format & FLAG_0 &&
+      !(conversion.format & (FLAG_MINUS | PRECISION))) {
+         zeros += conversion.field - total;
+      } else {
+         pad = conversion.field - total;
       }
+
+      total = conversion.field;
+   }
+
+   /* now that we know how long the field is, write it all out at once */
+   if (DSTR_SUCCESS != outreserve(out, total)) {
+      return -1;
+   }
+
+   pos = DSTRBUF(out->str) + out->len;
+
+   /* by default, the int will be right justified in its field */
+   if (!(conversion.format & FLAG_MINUS)) {
+      memset(pos, ' ', pad), pos += pad;
+   }
+
+   memcpy(pos, prefix, nprefix), pos += nprefix;
+   memset(pos, '0', zeros), pos += zeros;
+
+   if (ndigits > 0) {
+      writedigits(pos + ndigits, arg, base,
+         conversion.format & (HEX_LOWERCASE | POINTER));
+      pos += ndigits;
    }
 
+   /* the user wants to left justify his int in its field */
+   if (conversion.format & FLAG_MINUS) {
+      memset(pos, ' ', pad);
+   }
+
+   out->len += total;
    return 0;
 }
 
 /* ************************************************************************* */
 
-int str2int(dstring_t intstr) {
+int countdigits(unsigned long int arg, int base) {
 
-   int intval = 0;
+   int shift, n;
 
-   while (dstrlen(intstr) > 0) {
-      intval *= 10;
-      intval += DIGITI(dstrgetc(intstr, dstrlen(intstr) - 1));
-      dstrdel(intstr, dstrlen(intstr) - 1);
-      if (DSTR_SUCCESS != dstrerrno) {
-         return -1;
+   if (10 == base) {
+      for (n = 1; ; n += 4, arg /= 10000) {
+         if (arg < 10) {
+            return n;
+         } else if (arg < 100) {
+            return n + 1;
+         } else if (arg < 1000) {
+            return n + 2;
+         } else if (arg < 10000) {
+            return n + 3;
+         }
       }
    }
 
-   return intval;
+   shift = 16 == base ? 4 : 3;
+   for (n = 1; arg >>= shift; n++);
+   return n;
+}
+
+/* ************************************************************************* */
+
+void writedigits(char *end, unsigned long int arg, int base, int lowercase) {
+
+   static const char *upper = "0123456789ABCDEF";
+   static const char *lower = "0123456789abcdef";
+
+   /* every number from 00 to 99 */
+   static const char pairs[] =
+      "00010203040506070809101112131415161718192021222324252627282930313233"
+      "34353637383940414243444546474849505152535455565758596061626364656667"
+      "6869707172737475767778798081828384858687888990919293949596979899";
+
+   const char *table = lowercase ? lower : upper;
+   unsigned int i;
+
+   switch (base) {
+
+      case 10:
+         while (arg >= 100) {
+            i = (arg % 100) * 2;
+            arg /= 100;
+            *--end = pairs[i + 1];
+            *--end = pairs[i];
+         }
+         if (arg >= 10) {
+            *--end = pairs[arg * 2 + 1];
+            *--end = pairs[arg * 2];
+         } else {
+            *--end = '0' + arg;
+         }
+         break;
+
+      case 16:
+         do {
+            *--end = table[arg & 0xF];
+            arg >>= 4;
+         } while (arg > 0);
+         break;
+
+      default:
+         do {
+            *--end = '0' + (arg & 7);
+            arg >>= 3;
+         } while (arg > 0);
+         break;
+   }
 }
@@ -38,6 +38,9 @@
 #ifndef SPRINTF_H_INCLUDED
 #define SPRINTF_H_INCLUDED
 
+#include <limits.h>
+#include <stdarg.h>
+
 #include "dstring.h"
 
 
@@ -47,15 +50,44 @@ struct specifier {
         int precision;   /* precision */
 };
 
+/* a cursor into the destination buffer; output is written straight into
+   DSTRBUF(str) at offset len, and the string is only null terminated once
+   formatting is finished */
+struct output {
+   dstring_t str;
+   size_t    len;
+   size_t    start;     /* where this call's output began */
+};
+
+/* a single step in a precompiled format: either a run of literal characters
+   or a conversion specifier (literals have a format of 0) */
+struct fmtop {
+   struct specifier conversion;
+   const char *literal;
+   size_t len;
+};
+
+/* what the opaque datatype dstrfmt_t points to */
+typedef struct {
+   char *format;          /* our own copy; literals point into it */
+   struct fmtop *ops;
+   size_t nops;
+   size_t literallen;     /* total number of literal characters */
+} dstrfmt;
+
+/* the most digits a double will ever be converted to; every double has at
+   most 767 significant digits, and the rest are always zeros */
+#define DTOA_MAXDIGITS 800
+
+/* how much room to reserve up front for each conversion in a format, which
+   along with the literal text is usually enough to format a whole line
+   without growing again */
+#define CONVERSION_ESTIMATE 16
+
 enum {
    UPPERCASE, LOWERCASE
 };
 
-/* possible specifiers, flags and modifiers in character form */
-#define FLAGSC        " -+0#"
-#define MODIFIERSC    "hlL"
-#define CONVERSIONSC  "dioxXucsSfeEgGpn"
-
 /* conversion specifiers */
 #define SIGNED_INT          0x00000001
 #define OCTAL               0x00000002
@@ -88,53 +120,21 @@ enum {
 #define LONG                0x01000000
 #define LONG_DOUBLE         0x02000000
 
+/* more conversion specifiers */
+#define FLOAT_SHORTEST      0x04000000
+
 /* convenient bitmasks */
-#define CONVERSIONBITS      0x0000FFFF
-
-
-/* maps modifiers to their appropriate bit flags */
-#define MOD(X) ((X) == 'h' ? SHORT : ((X) == 'l' ? LONG : LONG_DOUBLE))
-
-/* maps flags to their appropriate bit flags */
-#define FLAG(X) ((X) == ' ' ? FLAG_SPACE : ((X) == '-' ? FLAG_MINUS : \
-((X) == '+' ? FLAG_PLUS : ((X) == '0' ? FLAG_0 : FLAG_POUND))))
-
-/* maps conversion specifiers to their appropriate bit flags */
-#define CONVERSION(X) ((X) == 'd' || (X) == 'i' ? SIGNED_INT : \
-((X) == 'o' ? OCTAL : ((X) == 'x' ? HEX_LOWERCASE : \
-((X) == 'X' ? HEX_UPPERCASE : ((X) == 'u' ? UNSIGNED_INT : \
-((X) == 'c' ? CHAR : ((X) == 's' ? C_STRING : ((X) == 'S' ? DSTRING : \
-((X) == 'f' ? FLOAT : ((X) == 'e' ? FLOAT_EXP_LOWER : \
-((X) == 'E' ? FLOAT_EXP_UPPER : ((X) == 'g' ? FLOAT_G_LOWER : \
-((X) == 'G' ? FLOAT_G_UPPER : ((X) == 'p' ? POINTER : NUM_CHARS))))))))))))))
-
-/* maps digits to their corresponding characters */
-#define DIGITC(X)  ((X) ==  0 ? '0' : ((X) ==  1 ? '1' : ((X) ==  2 ? '2' : \
-((X) ==  3 ? '3' : ((X) ==  4 ? '4' : ((X) ==  5 ? '5' : ((X) ==  6 ? '6' : \
-((X) ==  7 ? '7' : ((X) ==  8 ? '8' : ((X) ==  9 ? '9' : ((X) == 10 ? 'A' : \
-((X) == 11 ? 'B' : ((X) == 12 ? 'C' : ((X) == 13 ? 'D' : ((X) == 14 ? 'E' : \
-'F')))))))))))))))
-
-/* maps digits to their corresponding lowercase characters */
-#define DIGITCL(X)  ((X) ==  0 ? '0' : ((X) ==  1 ? '1' : ((X) ==  2 ? '2' : \
-((X) ==  3 ? '3' : ((X) ==  4 ? '4' : ((X) ==  5 ? '5' : ((X) ==  6 ? '6' : \
-((X) ==  7 ? '7' : ((X) ==  8 ? '8' : ((X) ==  9 ? '9' : ((X) == 10 ? 'a' : \
-((X) == 11 ? 'b' : ((X) == 12 ? 'c' : ((X) == 13 ? 'd' : ((X) == 14 ? 'e' : \
-'f')))))))))))))))
-
-/* maps digit characters to their corresponding integers */
-#define DIGITI(X)  ((X) == '0' ?  0 : ((X) == '1' ?  1 : ((X) == '2' ?  2 : \
-((X) == '3' ?  3 : ((X) == '4' ?  4 : ((X) == '5' ?  5 : ((X) == '6' ?  6 : \
-((X) == '7' ?  7 : ((X) == '8' ?  8 : ((X) == '9' ?  9 : ((X) == 'A' ? 10 : \
-((X) == 'B' ? 11 : ((X) == 'C' ? 12 : ((X) == 'D' ? 13 : ((X) == 'E' ? 14 : \
-15)))))))))))))))
+#define CONVERSIONBITS      0x0400FFFF
+#define FLAGBITS            0x001F0000
+#define MODIFIERBITS        0x03800000
 
 
 /* **** parsearg ***********************************************************
 
    This function parses a single format specifier and fills in a structure
    containing the appropriate information.  It is intended only for
-   internal use with dstrvsprintf().
+   internal use with dstrvsprintf().  Flags, modifiers and conversions are
+   looked up in a table, and nothing is allocated.
 
    Found in sprintf.c
 
@@ -152,20 +152,111 @@ enum {
 char *parsearg(char *format, struct specifier *conversion);
 
 
+/* **** appendarg ********************************************************
+
+   Formats the next argument according to a single parsed conversion
+   specifier and appends it to the output.  This is shared by
+   dstrvsprintf() and by precompiled formats.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      va_list * (arguments; the next one is consumed)
+
+   Output:
+      0 on success
+     <0 if an error occured
+
+   ************************************************************************* */
+int appendarg(struct output *out, const struct specifier conversion,
+   va_list *args);
+
+
+/* **** outreserve *******************************************************
+
+   Makes sure there's room for at least n more characters (plus a null
+   terminator) after the output cursor.  When the buffer has to grow, it at
+   least doubles, so a single call to dstrvsprintf() almost never needs more
+   than one reallocation.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      size_t (number of characters we're about to write)
+
+   Output:
+      DSTR_SUCCESS on success or DSTR_NOMEM if the buffer couldn't grow
+
+   ************************************************************************* */
+int outreserve(struct output *out, size_t n);
+
+
+/* **** outwrite ***********************************************************
+
+   Copies n characters to the output cursor, growing the buffer if needed.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      const char * (characters to copy)
+      size_t (number of characters to copy)
+
+   Output:
+      0 on success
+     <0 if an error occured
+
+   ************************************************************************* */
+int outwrite(struct output *out, const char *src, size_t n);
+
+
+/* **** outpadded **********************************************************
+
+   Copies n characters to the output cursor, padded with spaces to the
+   field width (on the left, or on the right if the - flag was given.)
+   This is used for %c, %s and %S.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      const char * (characters to copy)
+      size_t (number of characters to copy)
+
+   Output:
+      0 on success
+     <0 if an error occured
+
+   ************************************************************************* */
+int outpadded(struct output *out, const struct specifier conversion,
+   const char *src, size_t n);
+
+
 /* **** appendsignedint ****************************************************
 
-   This function appends a formatted integer to a dstring object.  It is
-   an internal function designed for use with dstrvsprintf(), and it is
-   assumed that all input is valid and that the destination string is
-   initialized.
+   This function appends a formatted integer to the output.  It is an
+   internal function designed for use with dstrvsprintf(), and it is
+   assumed that all input is valid.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const struct specifier * (will contain information about the conversion)
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
       long int (the integer to format)
       a number base
 
@@ -174,7 +265,7 @@ char *parsearg(char *format, struct specifier *conversion);
      <0 if an error occured
 
    ************************************************************************* */
-int appendsignedint(dstring_t dest, const struct specifier conversion,
+int appendsignedint(struct output *out, const struct specifier conversion,
    long int arg, int base);
 
 
@@ -188,8 +279,8 @@ int appendsignedint(dstring_t dest, const struct specifier conversion,
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const struct specifier * (will contain information about the conversion)
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
       unsigned long int (the integer to format)
       a number base
 
@@ -198,68 +289,191 @@ int appendsignedint(dstring_t dest, const struct specifier conversion,
      <0 if an error occured
 
    ************************************************************************* */
-int appendunsignedint(dstring_t dest, const struct specifier conversion,
+int appendunsignedint(struct output *out, const struct specifier conversion,
    unsigned long int arg, int base);
 
 
 /* **** appendfloat ********************************************************
 
    This internal-only function appends the string representation of a
-   double to a dstring_t object.
+   double to the output, for any of the %f, %e, %E, %g, %G and %r
+   conversions.  long doubles are converted with double precision.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      double (the float to format)
+
+   Output:
+      0 on success
+     <0 if an error occured
+
+   ************************************************************************* */
+int appendfloat(struct output *out, const struct specifier conversion,
+   double arg);
+
+
+/* **** appendfloatfixed ***************************************************
+
+   Writes decimal digits in %f style, with the given number of digits after
+   the decimal point.  The digits are d.ddd * 10^exponent; any positions
+   they don't cover are zeros.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const struct specifier * (will contain information about the conversion)
-      long double (the float to format)
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      char (sign character, or '\0' if there isn't one)
+      const char * (digits)
+      int (number of digits)
+      int (decimal exponent of the first digit)
+      int (number of digits after the decimal point)
 
    Output:
       0 on success
      <0 if an error occured
 
    ************************************************************************* */
-int appendfloat(dstring_t dest, const struct specifier conversion,
-   long double arg);
+int appendfloatfixed(struct output *out, const struct specifier conversion,
+   char sign, const char *digits, int len, int exponent, int precision);
 
 
 /* **** appendfloatexp *****************************************************
 
-   This internal-only function appends the string representation of a
-   double to a dstring_t object in scientific notation.
+   Writes decimal digits in %e style (d.ddde+dd), with the given number of
+   digits after the decimal point.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const struct specifier * (will contain information about the conversion)
-      long double (the float to format)
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      char (sign character, or '\0' if there isn't one)
+      const char * (digits)
+      int (number of digits)
+      int (decimal exponent of the first digit)
+      int (number of digits after the decimal point)
 
    Output:
       0 on success
      <0 if an error occured
 
    ************************************************************************* */
-int appendfloatexp(dstring_t dest, const struct specifier conversion,
-   long double arg);
+int appendfloatexp(struct output *out, const struct specifier conversion,
+   char sign, const char *digits, int len, int exponent, int precision);
+
+
+/* **** floatfield *********************************************************
+
+   Reserves room for a formatted float of the given length (not counting
+   the sign), and writes any padding that goes in front of it, followed by
+   the sign and any zeros from the 0 flag.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
+      char (sign character, or '\0' if there isn't one)
+      size_t (length of the rest of the number)
+      size_t * (returns how many spaces go after the number)
+
+   Output:
+      Where the rest of the number should be written, or NULL on error
+
+   ************************************************************************* */
+char *floatfield(struct output *out, const struct specifier conversion,
+   char sign, size_t len, size_t *rightpad);
+
+
+/* **** dtoashortest *******************************************************
+
+   Converts a positive, finite double to the shortest string of decimal
+   digits that reads back as exactly the same double.
+
+   Found in dtoa.c
+
+   *************************************************************************
+
+   Input:
+      double (the number to convert)
+      char * (at least DTOA_MAXDIGITS characters; not null terminated)
+      int * (returns the decimal exponent of the first digit)
+
+   Output:
+      the number of digits
+
+   ************************************************************************* */
+int dtoashortest(double v, char *digits, int *exponent);
+
+
+/* **** dtoacounted ********************************************************
+
+   Converts a positive, finite double to n correctly rounded significant
+   digits (ties are rounded to even, like glibc).
+
+   Found in dtoa.c
+
+   *************************************************************************
+
+   Input:
+      double (the number to convert)
+      int (number of significant digits)
+      char * (at least DTOA_MAXDIGITS characters; not null terminated)
+      int * (returns the decimal exponent of the first digit)
+
+   Output:
+      the number of digits (which will be n, unless n > DTOA_MAXDIGITS)
+
+   ************************************************************************* */
+int dtoacounted(double v, int n, char *digits, int *exponent);
+
+
+/* **** dtoafixed **********************************************************
+
+   Converts a positive, finite double to correctly rounded digits, down to
+   the 10^-precision place.
+
+   Found in dtoa.c
+
+   *************************************************************************
+
+   Input:
+      double (the number to convert)
+      int (number of digits after the decimal point)
+      char * (at least DTOA_MAXDIGITS characters; not null terminated)
+      int * (returns the decimal exponent of the first digit)
+
+   Output:
+      the number of digits, which is 0 if v rounds to 0
+
+   ************************************************************************* */
+int dtoafixed(double v, int precision, char *digits, int *exponent);
 
 
 /* **** appendptr **********************************************************
 
    This internal-only function appends the string representation of a
-   pointer to a dstring_t object.
+   pointer to the output.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (destination)
-      const struct specifier * (will contain information about the conversion)
+      struct output * (output cursor)
+      const struct specifier (information about the conversion)
       void * (the pointer to format)
 
    Output:
@@ -267,49 +481,77 @@ int appendfloatexp(dstring_t dest, const struct specifier conversion,
      <0 if an error occured
 
    ************************************************************************* */
-int appendptr(dstring_t dest, const struct specifier conversion,
+int appendptr(struct output *out, const struct specifier conversion,
    void *ptr);
 
 
 /* **** appendintcommon ****************************************************
 
    This function contains code common to all internal functions that
-   process integers.
+   process integers.  Once the number of digits is known, the whole field
+   (padding, sign, prefix, zeros and digits) is written to the output in
+   one go, with the digits going straight into the destination buffer.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (the string we want to convert)
+      struct output * (output cursor)
+      char (sign character, or '\0' if there isn't one)
+      const struct specifier (information about the conversion)
+      unsigned long int (magnitude of the integer)
+      a number base (8, 10 or 16)
 
    Output:
       0 on success
      <0 if an error occured
 
    ************************************************************************* */
-int appendintcommon(dstring_t tempint, int index,
+int appendintcommon(struct output *out, char sign,
    const struct specifier conversion, unsigned long int arg, int base);
 
 
-/* **** str2int ************************************************************
+/* **** countdigits ********************************************************
 
-   This function converts an integer into a dstring_t string.  It is
-   assumed that all the characters in intstr are numbers.
+   Returns the number of digits in an integer in base 8, 10 or 16.
 
    Found in sprintf.c
 
    *************************************************************************
 
    Input:
-      dstring_t (the string we want to convert)
+      unsigned long int (the integer)
+      a number base (8, 10 or 16)
 
    Output:
-      0 on success
-     <0 if an error occured
+      number of digits (at least 1)
+
+   ************************************************************************* */
+int countdigits(unsigned long int arg, int base);
+
+
+/* **** writedigits ********************************************************
+
+   Writes the digits of an integer backwards from end, two at a time for
+   base 10, so end must be exactly countdigits() characters past where the
+   number should start.
+
+   Found in sprintf.c
+
+   *************************************************************************
+
+   Input:
+      char * (just past where the last digit goes)
+      unsigned long int (the integer)
+      a number base (8, 10 or 16)
+      int (non-zero for lowercase hex digits)
+
+   Output:
+      (none)
 
    ************************************************************************* */
-int str2int(dstring_t intstr);
+void writedigits(char *end, unsigned long int arg, int base, int lowercase);
 
 
 #endif
@@ -35,6 +35,7 @@
 \* ************************************************************************* */
 
 #include <stddef.h>
+#include <stdint.h>
 
 #define DSTRALLOC_DEFAULT_SIZE 20
 
@@ -42,8 +43,36 @@
 typedef struct {
    char *buf;
    size_t buflen;
+
+   /* facts about the contents, worked out when they're first asked for and
+      forgotten (see DSTRDIRTY) whenever the contents change */
+   unsigned int cached;                 /* which of these are known */
+   unsigned int flags;                  /* DSTR_FLAG_* bits, which never
+                                           change (not cleared by
+                                           DSTRDIRTY) */
+   size_t codepoints;                   /* UTF-8 code points in buf */
+   size_t *cpindex;                     /* byte offset of every
+                                           DSTR_CPINDEX_STEPth code point */
+   size_t cpindexsize;                  /* entries allocated in cpindex */
+   uint64_t hash;                       /* dstrhash() of buf... */
+   uint64_t hashseed;                   /* ...with this seed */
 } dstr;
 
+/* bits for dstr's cached member */
+#define DSTR_CACHE_UTF8CHECKED  0x01    /* we know whether buf is UTF-8 */
+#define DSTR_CACHE_UTF8         0x02    /* ...and it is, and codepoints is
+                                           the number of code points */
+#define DSTR_CACHE_CPINDEX      0x04    /* cpindex is up to date */
+#define DSTR_CACHE_HASH         0x08    /* hash is up to date */
+
+/* bits for dstr's flags member */
+#define DSTR_FLAG_POOLED        0x01    /* header and buf belong to a
+                                           dstrpool_t, so neither may be
+                                           freed or resized */
+
+/* code points between entries in a dstr's cpindex */
+#define DSTR_CPINDEX_STEP 64
+
 typedef dstr * dstrptr;
 
 /* macros for typecasting and accessing data members */
@@ -51,5 +80,25 @@ typedef dstr * dstrptr;
 #define DSTRBUF(X)     (DSTRREF(X)->buf)
 #define DSTRBUFLEN(X)  (DSTRREF(X)->buflen)
 
+/* forgets everything cached about a string's contents; functions that
+   change a string call this through DSTRWRITABLE, and again afterward if
+   they worked anything out along the way that no longer holds */
+#define DSTRDIRTY(X)   (DSTRREF(X)->cached = 0)
+
+/* every function that changes a string's contents must check this before
+   changing anything, and give up if it's false.  A pool's strings are
+   shared by everyone who interned them, and the pool finds them again by
+   their contents, so they can't be changed at all (dstrerrno is set to
+   DSTR_READONLY); any other string is marked dirty. */
+#define DSTRWRITABLE(X) (DSTRREF(X)->flags & DSTR_FLAG_POOLED ? \
+   (_setdstrerrno(DSTR_READONLY), 0) : (DSTRDIRTY(X), 1))
+
 /* prototype for the internal-only _setdstrerrno function */
 void _setdstrerrno(int status);
+
+/* the hash behind dstrhash(), for len bytes at data (found in hash.c) */
+uint64_t _dstrhashbytes(const void *data, size_t len, uint64_t seed);
+
+/* fills in a string's UTF-8 facts and code point index ahead of time
+   (found in utf8.c) */
+void _dstrutf8cache(dstr *str);
@@ -37,6 +37,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "dstring.h"
 
@@ -50,6 +55,24 @@ typedef enum {
 const char *teststr = "How many lines could a hacker hack if a hacker could \
 hack code?";
 
+/* each tier beyond the first two is a function of its own */
+static STAT tierformatting(void);
+static STAT tierutf8(void);
+static STAT tierhash(void);
+static STAT tiermaps(void);
+static STAT tiernumbers(void);
+static STAT tierfdio(void);
+static STAT tiercsv(void);
+static STAT tierencoding(void);
+static STAT tiertranscoding(void);
+static STAT tierurl(void);
+
+/* print one test and whether it passed */
+static STAT checkstr(int test, const char *description, const char *expected,
+   const char *actual);
+static STAT checkint(int test, const char *description, long expected,
+   long actual);
+
 /* ************************************************************************* */
 
 int main(int argc, char *argv[]) {
@@ -192,5 +215,1953 @@ int main(int argc, char *argv[]) {
 
    printf("TIER 2: Allocation Functions\n\n");
 
+   /**************************************************************************\
+    * TIER 3: formatting functions                                           *
+   \**************************************************************************/
+
+   printf("TIER 3: Formatting Functions\n\n");
+   tierformatting();
+
+   /**************************************************************************\
+    * TIER 4: UTF-8 functions                                                *
+   \**************************************************************************/
+
+   printf("TIER 4: UTF-8 Functions\n\n");
+   tierutf8();
+
+   /**************************************************************************\
+    * TIER 5: hashing functions                                              *
+   \**************************************************************************/
+
+   printf("TIER 5: Hashing Functions\n\n");
+   tierhash();
+
+   /**************************************************************************\
+    * TIER 6: maps and pools                                                 *
+   \**************************************************************************/
+
+   printf("TIER 6: Maps and Pools\n\n");
+   tiermaps();
+
+   /**************************************************************************\
+    * TIER 7: number parsing                                                 *
+   \**************************************************************************/
+
+   printf("TIER 7: Number Parsing\n\n");
+   tiernumbers();
+
+   /**************************************************************************\
+    * TIER 8: file descriptor I/O                                            *
+   \**************************************************************************/
+
+   printf("TIER 8: File Descriptor I/O\n\n");
+   tierfdio();
+
+   /**************************************************************************\
+    * TIER 9: CSV records                                                    *
+   \**************************************************************************/
+
+   printf("TIER 9: CSV Records\n\n");
+   tiercsv();
+
+   /**************************************************************************\
+    * TIER 10: base64 and hex                                                *
+   \**************************************************************************/
+
+   printf("TIER 10: Base64 and Hex\n\n");
+   tierencoding();
+
+   /**************************************************************************\
+    * TIER 11: UTF-16, UTF-32 and Latin-1                                    *
+   \**************************************************************************/
+
+   printf("TIER 11: UTF-16, UTF-32 and Latin-1\n\n");
+   tiertranscoding();
+
+   /**************************************************************************\
+    * TIER 12: URL encoding and query strings                                *
+   \**************************************************************************/
+
+   printf("TIER 12: URL Encoding and Query Strings\n\n");
+   tierurl();
+
    return EXIT_SUCCESS;
 }
+
+/* ************************************************************************* */
+
+static STAT checkstr(int test, const char *description, const char *expected,
+const char *actual) {
+
+   printf("\tTest %d: %s\n", test, description);
+   printf("\tExpected: \"%s\"\n", expected);
+   printf("\tActual:   \"%s\"\n", NULL == actual ? "(null)" : actual);
+
+   if (NULL == actual || 0 != strcmp(expected, actual)) {
+      printf("\tFAIL\n\n");
+      return FAIL;
+   }
+
+   printf("\tPASS\n\n");
+   return PASS;
+}
+
+/* ************************************************************************* */
+
+static STAT checkint(int test, const char *description, long expected,
+long actual) {
+
+   printf("\tTest %d: %s\n", test, description);
+   printf("\tExpected: %ld\n", expected);
+   printf("\tActual:   %ld\n", actual);
+
+   if (expected != actual) {
+      printf("\tFAIL\n\n");
+      return FAIL;
+   }
+
+   printf("\tPASS\n\n");
+   return PASS;
+}
+
+/* ************************************************************************* */
+
+/* integer conversions, checked against the C library's sprintf() */
+static const struct {
+   const char *format;
+   long        value;
+} intformats[] = {
+   {"%d", 0},         {"%d", -42},        {"%5d", 42},       {"%-5d|", 42},
+   {"%+d", 42},       {"% d", 42},        {"%05d", -42},     {"%.3d", 7},
+   {"%8.3d", -7},     {"%-+8.3d|", 7},    {"%.0d", 0},       {"%x", 255},
+   {"%#x", 255},      {"%#08X", 255},     {"%#o", 8},        {"%o", 0},
+   {"%u", 4000000000L}, {"%ld", -9000000000L}, {"%hd", 70000}, {"%c", 'q'},
+   {"%-3c|", 'q'},    {"[%%]%d", 1}
+};
+
+/* floating point conversions, which are correctly rounded both here and in
+   the C library */
+static const struct {
+   const char *format;
+   double      value;
+} floatformats[] = {
+   {"%f", 3.14159265},  {"%.0f", 2.5},       {"%.0f", 3.5},
+   {"%.2f", 1.005},     {"%+.2f", -0.005},   {"%10.4f", 3.14159265},
+   {"%-12f|", -1.5},    {"%f", 1e20},        {"%f", -0.0},
+   {"%e", 12345.678},   {"%.3e", 0.00012345}, {"%E", 1e-300},
+   {"%-14e|", 2.0},     {"%e", 0.0},         {"%g", 0.0001234},
+   {"%g", 123456789.0}, {"%#g", 1.0},        {"%g", 1e-5},
+   {"%G", 1e20},        {"%.10g", 1.0 / 3},  {"%.0e", 5e10},
+   {"%012.3f", -3.14159}
+};
+
+/* values that %r has to print so that they read back exactly */
+static const double roundtrip[] = {
+   0.1, 1.0 / 3, 2.0 / 3, 1e-300, 5e-324, DBL_MAX, DBL_MIN, 123456.789,
+   9007199254740993.0, -2.5e-7, 1e21, 1e22, 0.3
+};
+
+static STAT tierformatting(void) {
+
+   STAT     status = PASS;
+   dstring_t str = NULL;
+   char     expected[256];
+   char     nonul[4] = {'a', 'b', 'c', 'd'};
+   char     description[128];
+   size_t   i;
+   int      test = 0, n;
+   double   d;
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrsprintf():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(intformats) / sizeof(intformats[0]); i++) {
+      sprintf(description, "flags, width and precision: \"%s\"",
+         intformats[i].format);
+      if (strstr(intformats[i].format, "ld")) {
+         sprintf(expected, intformats[i].format, intformats[i].value);
+         dstrsprintf(str, intformats[i].format, intformats[i].value);
+      } else {
+         sprintf(expected, intformats[i].format, (int)intformats[i].value);
+         dstrsprintf(str, intformats[i].format, (int)intformats[i].value);
+      }
+      if (PASS != checkstr(++test, description, expected, dstrview(str))) {
+         status = FAIL;
+      }
+   }
+
+   for (i = 0; i < sizeof(floatformats) / sizeof(floatformats[0]); i++) {
+      sprintf(description, "floating point: \"%s\"", floatformats[i].format);
+      sprintf(expected, floatformats[i].format, floatformats[i].value);
+      dstrsprintf(str, floatformats[i].format, floatformats[i].value);
+      if (PASS != checkstr(++test, description, expected, dstrview(str))) {
+         status = FAIL;
+      }
+   }
+
+   dstrsprintf(str, "[%10s][%-10s][%10.2s][%-5.2s][%.0s]", "right", "left",
+      "cut", "abc", "gone");
+   if (PASS != checkstr(++test, "string width and precision",
+   "[     right][left      ][        cu][ab   ][]", dstrview(str))) {
+      status = FAIL;
+   }
+
+   /* the precision says how much of the array may be read */
+   dstrsprintf(str, "%.4s|%.2s", nonul, nonul);
+   if (PASS != checkstr(++test, "%.Ns of an array with no null terminator",
+   "abcd|ab", dstrview(str))) {
+      status = FAIL;
+   }
+
+   dstrsprintf(str, "%.4s|%.9s", "ab\0cd", "xy\0z");
+   if (PASS != checkstr(++test, "%.Ns of a string that ends before N",
+   "ab|xy", dstrview(str))) {
+      status = FAIL;
+   }
+
+   dstrsprintf(str, "%s", teststr);
+   dstrsprintf(str, "%d%n", 12345, &n);
+   if (PASS != checkint(++test, "%n after a long string is overwritten", 5,
+   n)) {
+      status = FAIL;
+   }
+
+   for (i = 0; i < sizeof(roundtrip) / sizeof(roundtrip[0]); i++) {
+      dstrsprintf(str, "%r", roundtrip[i]);
+      d = strtod(dstrview(str), NULL);
+      sprintf(description, "%%r reads back as the same value (%s)",
+         dstrview(str));
+      if (PASS != checkint(++test, description, 1, d == roundtrip[i])) {
+         status = FAIL;
+      }
+   }
+
+   dstrsprintf(str, "%r %r %r", 0.1, 100.0, 1.5e-7);
+   if (PASS != checkstr(++test, "%r uses the fewest digits",
+   "0.1 100 1.5e-07", dstrview(str))) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "an uninitialized string is an error", -1,
+   dstrsprintf(NULL, "%d", 1)) || PASS != checkint(++test,
+   "...which sets dstrerrno to DSTR_UNINITIALIZED", DSTR_UNINITIALIZED,
+   dstrerrno)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "a NULL format is an error", -1,
+   dstrsprintf(str, NULL)) || PASS != checkint(++test,
+   "...which sets dstrerrno to DSTR_NULL_CPTR", DSTR_NULL_CPTR, dstrerrno)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "before");
+   if (PASS != checkint(++test, "a NULL %s argument is an error", -1,
+   dstrsprintf(str, "abc %d %s", 1, (char *)NULL)) || PASS != checkint(++test,
+   "...which sets dstrerrno to DSTR_NULL_CPTR", DSTR_NULL_CPTR, dstrerrno) ||
+   PASS != checkstr(++test, "...and leaves the string empty", "",
+   dstrview(str))) {
+      status = FAIL;
+   }
+
+   printf("dstrsprintf(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrcatprintf():\n");
+   putchar('\n');
+
+   cstrtodstr(str, "before");
+   dstrcatprintf(str, " %s %05.1f", "and after", 2.25);
+   if (PASS != checkstr(++test, "appends to what's there",
+   "before and after 002.2", dstrview(str))) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "before");
+   if (PASS != checkint(++test, "a failed conversion is an error", -1,
+   dstrcatprintf(str, "%d %s", 1, (char *)NULL)) || PASS != checkstr(++test,
+   "...and leaves the string as it was", "before", dstrview(str))) {
+      status = FAIL;
+   }
+
+   printf("dstrcatprintf(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* UTF-8 text with a percent-encoded character in it, so that every function
+   in mutations[] changes it somehow */
+static const char *utf8sample = "  h\xc3\xa9llo w\xc3\xb6rld %41 \xe2\x82\xac";
+
+/* functions that change a string, each of which must make the library
+   forget what it remembered about the old contents */
+static const char *mutations[] = {
+   "cstrtodstr()", "dstrcatcs()", "dstrncatcs()", "dstrcpy()",
+   "dstrsprintf()", "dstrcatprintf()", "dstrcatint()", "dstrtrunc()",
+   "dstrtruncleft()", "dstrtrim()", "dstrdel()", "dstrndel()",
+   "dstrinsertc()", "dstrinsertcs()", "dstrxchg()", "dstrpopc()",
+   "dstrdequeuec()", "dstreplacec()", "dstreplaces()", "dstrpadl()",
+   "dstrpadr()", "dstrtoupper()", "dstrinsertcp()",
+   "dstrdelcp()", "dstrutf8toupper()", "dstrcatbase64()", "dstrurldecode()"
+};
+
+#define NUM_MUTATIONS (sizeof(mutations) / sizeof(mutations[0]))
+
+/* applies the ith function in mutations[] to str */
+static void mutate(dstring_t str, dstring_t other, size_t i) {
+
+   switch (i) {
+      case 0:  cstrtodstr(str, "\xff"); break;
+      case 1:  dstrcatcs(str, "\xe2\x82"); break;
+      case 2:  dstrncatcs(str, "\xc3\xa9\xc3\xa9", 2); break;
+      case 3:  cstrtodstr(other, "\xc3"), dstrcpy(str, other); break;
+      case 4:  dstrsprintf(str, "%s!", "\xc3\xb6"); break;
+      case 5:  dstrcatprintf(str, "%c", '\xc3'); break;
+      case 6:  dstrcatint(str, -12); break;
+      case 7:  dstrtrunc(str, 4); break;
+      case 8:  dstrtruncleft(str, 4); break;
+      case 9:  dstrtrim(str); break;
+      case 10: dstrdel(str, 3); break;
+      case 11: dstrndel(str, 2, 3); break;
+      case 12: dstrinsertc(str, 0, '\x80'); break;
+      case 13: dstrinsertcs(str, "\xc3\xa9\xc3\xa9", 0); break;
+      case 14: dstrxchg(str, 3, 'x'); break;
+      case 15: dstrpopc(str); break;
+      case 16: dstrdequeuec(str); break;
+      case 17: dstreplacec(str, 'l', '\xc3'); break;
+      case 18: dstreplaces(str, "\xc3\xa9", "e"); break;
+      case 19: dstrpadl(str, 40, '.'); break;
+      case 20: dstrpadr(str, 40, '.'); break;
+      case 21: dstrtoupper(str, 2); break;
+      case 22: dstrinsertcp(str, 0, 0x1f600); break;
+      case 23: dstrdelcp(str, 3); break;
+      case 24: dstrutf8toupper(str); break;
+      case 25: dstrcatbase64(str, "\xc3\xa9", 2, 0); break;
+      case 26: dstrurldecode(str, 0); break;
+   }
+}
+
+/* ************************************************************************* */
+
+static STAT tierutf8(void) {
+
+   STAT      status = PASS;
+   dstring_t str = NULL, fresh = NULL, other = NULL, sample = NULL;
+   char      description[128];
+   size_t    i, j;
+   int       test = 0;
+
+   /* where to look for code points in the long sample, which has an entry
+      in its index every 64 */
+   static const size_t cps[] = {0, 1, 63, 64, 65, 130, 200, 319};
+
+   if (DSTR_SUCCESS != dstralloc(&str) || DSTR_SUCCESS != dstralloc(&fresh) ||
+   DSTR_SUCCESS != dstralloc(&other) || DSTR_SUCCESS != dstralloc(&sample)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrisutf8() and dstrutf8len() after a change:\n");
+   putchar('\n');
+
+   /* ask about the sample, change it, and ask again: the answers have to be
+      the same as for a string that's never been asked about before */
+   for (i = 0; i < NUM_MUTATIONS; i++) {
+
+      cstrtodstr(str, utf8sample);
+      dstrisutf8(str);
+      dstrutf8len(str);
+
+      mutate(str, other, i);
+      cstrtodstr(fresh, dstrview(str));
+
+      sprintf(description, "dstrisutf8() after %s", mutations[i]);
+      if (PASS != checkint(++test, description, dstrisutf8(fresh),
+      dstrisutf8(str))) {
+         status = FAIL;
+      }
+
+      sprintf(description, "dstrutf8len() after %s", mutations[i]);
+      if (PASS != checkint(++test, description, (long)dstrutf8len(fresh),
+      (long)dstrutf8len(str))) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrisutf8() and dstrutf8len(): %s\n\n", PASS == status ? "PASS" :
+      "FAIL");
+
+   printf("dstrgetcp() and dstrcpoffset() after a change:\n");
+   putchar('\n');
+
+   /* long enough to be indexed: 320 code points of 1 to 4 bytes each */
+   for (i = 0; i < 80; i++) {
+      dstrcatcs(sample, "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+   }
+
+   for (i = 0; i < NUM_MUTATIONS; i++) {
+
+      dstrcpy(str, sample);
+      for (j = 0; j < sizeof(cps) / sizeof(cps[0]); j++) {
+         dstrgetcp(str, cps[j]);
+      }
+
+      mutate(str, other, i);
+      cstrtodstr(fresh, dstrview(str));
+
+      for (j = 0; j < sizeof(cps) / sizeof(cps[0]); j++) {
+
+         sprintf(description, "dstrgetcp(%lu) after %s",
+            (unsigned long)cps[j], mutations[i]);
+         if (PASS != checkint(++test, description, dstrgetcp(fresh, cps[j]),
+         dstrgetcp(str, cps[j]))) {
+            status = FAIL;
+         }
+
+         sprintf(description, "dstrcpoffset(%lu) after %s",
+            (unsigned long)cps[j], mutations[i]);
+         if (PASS != checkint(++test, description,
+         (long)dstrcpoffset(fresh, cps[j]), (long)dstrcpoffset(str, cps[j]))) {
+            status = FAIL;
+         }
+      }
+   }
+
+   printf("dstrgetcp() and dstrcpoffset(): %s\n\n", PASS == status ? "PASS" :
+      "FAIL");
+
+   dstrfree(&sample);
+   dstrfree(&other);
+   dstrfree(&fresh);
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+static STAT tierhash(void) {
+
+   STAT      status = PASS;
+   dstring_t str = NULL, other = NULL;
+   char      description[128];
+   size_t    i;
+   int       test = 0;
+
+   if (DSTR_SUCCESS != dstralloc(&str) || DSTR_SUCCESS != dstralloc(&other)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrhash() after a change:\n");
+   putchar('\n');
+
+   /* the remembered hash has to be forgotten by every function that changes
+      the string, so it must always agree with hashing the bytes afresh */
+   for (i = 0; i < NUM_MUTATIONS; i++) {
+
+      cstrtodstr(str, utf8sample);
+      dstrhash(str, 1);
+
+      mutate(str, other, i);
+
+      sprintf(description, "dstrhash() after %s equals dstrnhashcs()",
+         mutations[i]);
+      if (PASS != checkint(++test, description, 1,
+      dstrnhashcs(dstrview(str), dstrlen(str), 1) == dstrhash(str, 1))) {
+         status = FAIL;
+      }
+   }
+
+   /* the hash is remembered along with its seed */
+   cstrtodstr(str, utf8sample);
+   dstrhash(str, 1);
+   if (PASS != checkint(++test, "dstrhash() with a different seed", 1,
+   dstrhashcs(utf8sample, 2) == dstrhash(str, 2)) || PASS != checkint(++test,
+   "...and the first seed again", 1, dstrhashcs(utf8sample, 1) ==
+   dstrhash(str, 1))) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "different seeds give different hashes", 1,
+   dstrhash(str, 1) != dstrhash(str, 2))) {
+      status = FAIL;
+   }
+
+   printf("dstrhash(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&other);
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+static STAT tiermaps(void) {
+
+   STAT      status = PASS;
+   dstring_t key = NULL, other = NULL;
+   dstrmap_t map = NULL;
+   dstrcmap_t cmap = NULL;
+   dstrpool_t pool = NULL;
+   dstring_t before, after;
+   char      description[128];
+   void     *value;
+   size_t    i;
+   int       test = 0, same;
+
+   if (DSTR_SUCCESS != dstralloc(&key) || DSTR_SUCCESS != dstralloc(&other) ||
+   DSTR_SUCCESS != dstrmapalloc(&map, 0)) {
+      printf("\terror: allocation failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrmapget() after the key is changed:\n");
+   putchar('\n');
+
+   /* the map keeps its own copy of the key, and a lookup with the changed
+      string must use its new contents, not a hash remembered from before */
+   for (i = 0; i < NUM_MUTATIONS; i++) {
+
+      cstrtodstr(key, utf8sample);
+      dstrmapset(map, key, (void *)key);
+      dstrmapget(map, key, NULL);
+
+      mutate(key, other, i);
+      same = 0 == strcmp(utf8sample, dstrview(key));
+
+      sprintf(description, "dstrmapget() after %s", mutations[i]);
+      if (PASS != checkint(++test, description, same,
+      dstrmapget(map, key, NULL))) {
+         status = FAIL;
+      }
+
+      value = NULL;
+      if (PASS != checkint(++test, "...the original key is still there", 1,
+      dstrmapnget(map, utf8sample, strlen(utf8sample), &value) &&
+      (void *)key == value)) {
+         status = FAIL;
+      }
+
+      dstrmapndel(map, utf8sample, strlen(utf8sample), NULL);
+   }
+
+   if (PASS != checkint(++test, "the map is empty again", 0,
+   (long)dstrmapsize(map))) {
+      status = FAIL;
+   }
+
+   printf("dstrmapget(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrcmapget() after the key is changed:\n");
+   putchar('\n');
+
+#ifdef DSTR_PTHREAD
+
+   if (PASS != checkint(++test, "dstrcmapalloc()", DSTR_SUCCESS,
+   dstrcmapalloc(&cmap, 0))) {
+      status = FAIL;
+   }
+
+   for (i = 0; NULL != cmap && i < NUM_MUTATIONS; i++) {
+
+      cstrtodstr(key, utf8sample);
+      dstrcmapset(cmap, key, (void *)key, NULL);
+      dstrcmapget(cmap, key, NULL);
+
+      mutate(key, other, i);
+      same = 0 == strcmp(utf8sample, dstrview(key));
+
+      sprintf(description, "dstrcmapget() after %s", mutations[i]);
+      if (PASS != checkint(++test, description, same,
+      dstrcmapget(cmap, key, NULL))) {
+         status = FAIL;
+      }
+
+      value = NULL;
+      if (PASS != checkint(++test, "...the original key is still there", 1,
+      dstrcmapnget(cmap, utf8sample, strlen(utf8sample), &value) &&
+      (void *)key == value)) {
+         status = FAIL;
+      }
+
+      dstrcmapndel(cmap, utf8sample, strlen(utf8sample), NULL);
+   }
+
+   if (NULL != cmap && PASS != checkint(++test, "the map is empty again", 0,
+   (long)dstrcmapsize(cmap))) {
+      status = FAIL;
+   }
+
+   dstrcmapfree(&cmap, NULL);
+
+#else
+
+   /* without locks, there's no such thing as a map threads can share */
+   if (PASS != checkint(++test, "dstrcmapalloc() without thread support",
+   DSTR_UNSUPPORTED, dstrcmapalloc(&cmap, 0)) || PASS != checkint(++test,
+   "...leaves the map uninitialized", 1, NULL == cmap)) {
+      status = FAIL;
+   }
+
+#endif
+
+   printf("dstrcmapget(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrintern() after the string is changed:\n");
+   putchar('\n');
+
+   if (PASS != checkint(++test, "dstrpoolalloc()", DSTR_SUCCESS,
+   dstrpoolalloc(&pool, 0))) {
+      status = FAIL;
+   }
+
+   /* interning the changed string gives the same pool string exactly when
+      the contents are the same, and the pool's copy never changes */
+   for (i = 0; NULL != pool && i < NUM_MUTATIONS; i++) {
+
+      cstrtodstr(key, utf8sample);
+      before = dstrintern(pool, key);
+
+      mutate(key, other, i);
+      same = 0 == strcmp(utf8sample, dstrview(key));
+      after = dstrintern(pool, key);
+
+      sprintf(description, "dstrintern() after %s", mutations[i]);
+      if (PASS != checkint(++test, description, same, before == after) ||
+      PASS != checkstr(++test, "...the pool's copy is unchanged", utf8sample,
+      dstrview(before))) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrintern(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("changing a pool's string:\n");
+   putchar('\n');
+
+   before = NULL == pool ? NULL : dstrinterncs(pool, utf8sample);
+   after = before;
+
+   if (NULL != before) {
+
+      if (PASS != checkint(++test, "dstrfree() refuses a pool's string",
+      DSTR_READONLY, dstrfree(&after)) || PASS != checkint(++test,
+      "...and leaves it alone", 1, before == after)) {
+         status = FAIL;
+      }
+
+      if (PASS != checkint(++test, "dstrealloc() refuses a pool's string",
+      DSTR_READONLY, dstrealloc(&after, 1000))) {
+         status = FAIL;
+      }
+
+      dstrcatcs(after, "more than fits");
+      if (PASS != checkint(++test, "appending to a pool's string fails",
+      DSTR_READONLY, dstrerrno) || PASS != checkstr(++test,
+      "...and leaves it alone", utf8sample, dstrview(after))) {
+         status = FAIL;
+      }
+
+      /* nothing is cached in a pool's string after it's added, so these
+         must all give the same answers as for a string of its own */
+      cstrtodstr(key, utf8sample);
+      if (PASS != checkint(++test, "dstrhash() of a pool's string", 1,
+      dstrhash(key, 7) == dstrhash(before, 7) && dstrhash(key, 8) ==
+      dstrhash(before, 8)) || PASS != checkint(++test,
+      "dstrutf8len() of a pool's string", (long)dstrutf8len(key),
+      (long)dstrutf8len(before)) || PASS != checkint(++test,
+      "dstrgetcp() of a pool's string", dstrgetcp(key, 4),
+      dstrgetcp(before, 4))) {
+         status = FAIL;
+      }
+
+      /* changing it in place would be just as bad, since the pool finds it
+         again by its contents */
+      for (i = 0; i < NUM_MUTATIONS; i++) {
+
+         mutate(before, other, i);
+
+         sprintf(description, "%s refuses a pool's string", mutations[i]);
+         if (PASS != checkint(++test, description, DSTR_READONLY,
+         dstrerrno) || PASS != checkstr(++test, "...and leaves it alone",
+         utf8sample, dstrview(before)) || PASS != checkint(++test,
+         "...which the pool still finds", 1,
+         before == dstrinterncs(pool, utf8sample))) {
+            status = FAIL;
+         }
+      }
+   }
+
+   dstrpoolfree(&pool);
+
+#ifdef DSTR_PTHREAD
+   if (PASS != checkint(++test, "dstrpoolalloc() with DSTR_POOL_THREADSAFE",
+   DSTR_SUCCESS, dstrpoolalloc(&pool, DSTR_POOL_THREADSAFE))) {
+      status = FAIL;
+   }
+   dstrpoolfree(&pool);
+#else
+   if (PASS != checkint(++test, "DSTR_POOL_THREADSAFE without thread support",
+   DSTR_UNSUPPORTED, dstrpoolalloc(&pool, DSTR_POOL_THREADSAFE))) {
+      status = FAIL;
+   }
+#endif
+
+   printf("pool strings: %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   dstrmapfree(&map);
+   dstrfree(&other);
+   dstrfree(&key);
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* signed integers at and just past the edges of the range */
+static const struct {
+   const char *text;
+   size_t      index;
+   int64_t     value;
+   size_t      consumed;
+   int         status;
+} i64cases[] = {
+   {"0", 0, 0, 1, DSTR_SUCCESS},
+   {"x=-42;", 2, -42, 3, DSTR_SUCCESS},
+   {"+17 apples", 0, 17, 3, DSTR_SUCCESS},
+   {"0000000000000000000000012", 0, 12, 25, DSTR_SUCCESS},
+   {"9223372036854775807", 0, INT64_MAX, 19, DSTR_SUCCESS},
+   {"-9223372036854775808", 0, INT64_MIN, 20, DSTR_SUCCESS},
+   {"9223372036854775808", 0, INT64_MAX, 19, DSTR_OUT_OF_RANGE},
+   {"-9223372036854775809", 0, INT64_MIN, 20, DSTR_OUT_OF_RANGE},
+   {"99999999999999999999999", 0, INT64_MAX, 23, DSTR_OUT_OF_RANGE},
+   {"abc", 0, 0, 0, DSTR_INVALID_ARGUMENT},
+   {"-", 0, 0, 0, DSTR_INVALID_ARGUMENT},
+   {" 1", 0, 0, 0, DSTR_INVALID_ARGUMENT}
+};
+
+/* unsigned integers, where a sign of either kind is a mistake */
+static const struct {
+   const char *text;
+   uint64_t    value;
+   size_t      consumed;
+   int         status;
+} u64cases[] = {
+   {"18446744073709551615", UINT64_MAX, 20, DSTR_SUCCESS},
+   {"18446744073709551616", UINT64_MAX, 20, DSTR_OUT_OF_RANGE},
+   {"4294967296,", 4294967296U, 10, DSTR_SUCCESS},
+   {"-1", 0, 0, DSTR_INVALID_ARGUMENT}
+};
+
+/* doubles that have to come out exactly as strtod() rounds them: the edges
+   of the range, subnormals, ties broken to even, and halfway cases that
+   are only decided many digits in */
+static const char *doublecases[] = {
+   "0", "0.1", "-2.5", "1e23", "8.98846567431158e307", "1.5e-7",
+   "9007199254740993", "9007199254740995", "123456789012345678901234567890",
+   "1.7976931348623157e308", "1.7976931348623158e308",
+   "2.2250738585072011e-308", "2.2250738585072014e-308", "4.9e-324",
+   "2.4703282292062327e-324", "2.4703282292062328e-324",
+   "1.00000000000000011102230246251565404236316680908203125",
+   "1.00000000000000011102230246251565404236316680908203126",
+   "1.00000000000000011102230246251565404236316680908203124",
+   "0.000000000000000000000000000000000000000000001e-280", "1e-400",
+   ".5", "5.", "1E+2", "3.25e0x"
+};
+
+static STAT tiernumbers(void) {
+
+   STAT      status = PASS;
+   dstring_t str = NULL;
+   char      description[128];
+   int64_t   i64;
+   uint64_t  u64;
+   double    d;
+   char     *end;
+   size_t    i, n;
+   int       test = 0;
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrtoi64():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(i64cases) / sizeof(i64cases[0]); i++) {
+
+      cstrtodstr(str, i64cases[i].text);
+      n = dstrtoi64(str, i64cases[i].index, &i64);
+
+      sprintf(description, "\"%s\" from index %lu", i64cases[i].text,
+         (unsigned long)i64cases[i].index);
+      if (PASS != checkint(++test, description, 1, i64 == i64cases[i].value)
+      || PASS != checkint(++test, "...characters consumed",
+      (long)i64cases[i].consumed, (long)n) || PASS != checkint(++test,
+      "...dstrerrno", i64cases[i].status, dstrerrno)) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrtoi64(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrtou64():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(u64cases) / sizeof(u64cases[0]); i++) {
+
+      cstrtodstr(str, u64cases[i].text);
+      n = dstrtou64(str, 0, &u64);
+
+      sprintf(description, "\"%s\"", u64cases[i].text);
+      if (PASS != checkint(++test, description, 1, u64 == u64cases[i].value)
+      || PASS != checkint(++test, "...characters consumed",
+      (long)u64cases[i].consumed, (long)n) || PASS != checkint(++test,
+      "...dstrerrno", u64cases[i].status, dstrerrno)) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrtou64(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrtod():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(doublecases) / sizeof(doublecases[0]); i++) {
+
+      cstrtodstr(str, doublecases[i]);
+      n = dstrtod(str, 0, &d);
+
+      sprintf(description, "\"%.60s\" rounds like strtod()",
+         doublecases[i]);
+      if (PASS != checkint(++test, description, 1,
+      d == strtod(doublecases[i], &end)) || PASS != checkint(++test,
+      "...characters consumed", (long)(end - doublecases[i]), (long)n) ||
+      PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS, dstrerrno)) {
+         status = FAIL;
+      }
+   }
+
+   cstrtodstr(str, "-1.8e308");
+   dstrtod(str, 0, &d);
+   if (PASS != checkint(++test, "\"-1.8e308\" is too large", 1, -HUGE_VAL ==
+   d) || PASS != checkint(++test, "...dstrerrno", DSTR_OUT_OF_RANGE,
+   dstrerrno)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "Infinity and NaN");
+   n = dstrtod(str, 0, &d);
+   if (PASS != checkint(++test, "\"Infinity\"", 1, HUGE_VAL == d) ||
+   PASS != checkint(++test, "...characters consumed", 8, (long)n)) {
+      status = FAIL;
+   }
+
+   n = dstrtod(str, 13, &d);
+   if (PASS != checkint(++test, "\"NaN\"", 1, d != d) || PASS !=
+   checkint(++test, "...characters consumed", 3, (long)n)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "e5");
+   if (PASS != checkint(++test, "\"e5\" isn't a number", 0,
+   (long)dstrtod(str, 0, &d)) || PASS != checkint(++test, "...dstrerrno",
+   DSTR_INVALID_ARGUMENT, dstrerrno)) {
+      status = FAIL;
+   }
+
+   printf("dstrtod(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* reads whatever is waiting in a non-blocking pipe, up to size - 1
+   characters, and returns how many there were */
+static size_t drain(int fd, char *buf, size_t size) {
+
+   size_t  count = 0;
+   ssize_t r;
+
+   while (count < size - 1 && (r = read(fd, buf + count, size - 1 - count))
+   > 0) {
+      count += r;
+   }
+
+   buf[count] = '\0';
+   return count;
+}
+
+static STAT tierfdio(void) {
+
+   STAT      status = PASS;
+   dstring_t strs[4] = {NULL, NULL, NULL, NULL};
+   dstring_t big = NULL;
+   char      buf[128];
+   char     *bigbuf;
+   int       fds[2];
+   size_t    n, i;
+   int       test = 0;
+
+   /* the pipe must be able to fill up, so big has to be larger than any
+      pipe buffer */
+   static const size_t bigsize = 1 << 20;
+
+   /* strs[3] is left for big, which is written after the others */
+   for (i = 0; i < 3; i++) {
+      if (DSTR_SUCCESS != dstralloc(&strs[i])) {
+         printf("\terror: dstralloc() failed; skipping this tier\n\n");
+         return FAIL;
+      }
+   }
+
+   if (DSTR_SUCCESS != dstralloc(&big) || 0 > dstrpadr(big, bigsize, 'x') ||
+   NULL == (bigbuf = malloc(bigsize + 1))) {
+      printf("\terror: allocation failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   if (0 != pipe(fds) || 0 != fcntl(fds[0], F_SETFL, O_NONBLOCK) ||
+   0 != fcntl(fds[1], F_SETFL, O_NONBLOCK)) {
+      printf("\terror: pipe() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrfdwrite() and dstrfdwritev():\n");
+   putchar('\n');
+
+   cstrtodstr(strs[0], "hello, ");
+   cstrtodstr(strs[2], "pipe");
+
+   n = dstrfdwrite(strs[0], fds[1]);
+   drain(fds[0], buf, sizeof(buf));
+   if (PASS != checkint(++test, "dstrfdwrite() to a pipe", 7, (long)n) ||
+   PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS, dstrerrno) ||
+   PASS != checkstr(++test, "...what came out the other end", "hello, ",
+   buf)) {
+      status = FAIL;
+   }
+
+   /* the empty string in the middle is skipped */
+   n = dstrfdwritev(strs, 3, fds[1]);
+   drain(fds[0], buf, sizeof(buf));
+   if (PASS != checkint(++test, "dstrfdwritev() to a pipe", 11, (long)n) ||
+   PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS, dstrerrno) ||
+   PASS != checkstr(++test, "...what came out the other end",
+   "hello, pipe", buf)) {
+      status = FAIL;
+   }
+
+   /* a full non-blocking pipe has to stop the write rather than spin */
+   n = dstrfdwrite(big, fds[1]);
+   if (PASS != checkint(++test, "dstrfdwrite() to a pipe that fills up", 1,
+   n > 0 && n < bigsize) || PASS != checkint(++test, "...dstrerrno",
+   DSTR_WOULDBLOCK, dstrerrno) || PASS != checkint(++test,
+   "...everything it counted is in the pipe", (long)n,
+   (long)drain(fds[0], bigbuf, bigsize + 1))) {
+      status = FAIL;
+   }
+
+   strs[3] = big;
+   n = dstrfdwritev(strs + 2, 2, fds[1]);
+   if (PASS != checkint(++test, "dstrfdwritev() to a pipe that fills up", 1,
+   n > 4 && n < bigsize + 4) || PASS != checkint(++test, "...dstrerrno",
+   DSTR_WOULDBLOCK, dstrerrno) || PASS != checkint(++test,
+   "...everything it counted is in the pipe", (long)n,
+   (long)drain(fds[0], bigbuf, bigsize + 1))) {
+      status = FAIL;
+   }
+   strs[3] = NULL;
+
+   if (PASS != checkint(++test, "dstrfdwrite() to a negative descriptor", 0,
+   (long)dstrfdwrite(strs[0], -1)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_UNOPENED_FILE, dstrerrno)) {
+      status = FAIL;
+   }
+
+   /* with nobody left to read, write() fails with EPIPE */
+   signal(SIGPIPE, SIG_IGN);
+   close(fds[0]);
+
+   if (PASS != checkint(++test, "dstrfdwrite() to a pipe nobody reads", 0,
+   (long)dstrfdwrite(strs[0], fds[1])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_WRITE_ERROR, dstrerrno)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdwritev() to a pipe nobody reads", 0,
+   (long)dstrfdwritev(strs, 3, fds[1])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_WRITE_ERROR, dstrerrno)) {
+      status = FAIL;
+   }
+
+   close(fds[1]);
+   signal(SIGPIPE, SIG_DFL);
+
+   printf("dstrfdwrite() and dstrfdwritev(): %s\n\n", PASS == status ?
+      "PASS" : "FAIL");
+
+   printf("dstrfdcat(), dstrfdcatn() and dstrfdwritefrom():\n");
+   putchar('\n');
+
+   if (0 != pipe(fds) || 0 != fcntl(fds[0], F_SETFL, O_NONBLOCK) ||
+   0 != fcntl(fds[1], F_SETFL, O_NONBLOCK)) {
+      printf("\terror: pipe() failed; skipping the rest of this tier\n\n");
+      status = FAIL;
+      goto done;
+   }
+
+   cstrtodstr(strs[0], "x:");
+   if (PASS != checkint(++test, "dstrfdcat() from an empty pipe", 0,
+   (long)dstrfdcat(strs[0], fds[0])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_WOULDBLOCK, dstrerrno) || PASS != checkstr(++test,
+   "...the string is unchanged", "x:", dstrview(strs[0]))) {
+      status = FAIL;
+   }
+
+   cstrtodstr(strs[1], "abcdef");
+   dstrfdwrite(strs[1], fds[1]);
+
+   if (PASS != checkint(++test, "dstrfdcatn() reads no more than n", 2,
+   (long)dstrfdcatn(strs[0], fds[0], 2)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_SUCCESS, dstrerrno) || PASS != checkstr(++test,
+   "...and appends it", "x:ab", dstrview(strs[0]))) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdcat() reads the rest", 4,
+   (long)dstrfdcat(strs[0], fds[0])) || PASS != checkint(++test,
+   "...and stops without blocking", DSTR_SUCCESS, dstrerrno) ||
+   PASS != checkstr(++test, "...and appends it", "x:abcdef",
+   dstrview(strs[0]))) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdcatn() with n of 0", 0,
+   (long)dstrfdcatn(strs[0], fds[0], 0)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_SUCCESS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(strs[1], "0123456789");
+   n = dstrfdwritefrom(strs[1], 4, fds[1]);
+   drain(fds[0], buf, sizeof(buf));
+   if (PASS != checkint(++test, "dstrfdwritefrom() index 4", 6, (long)n) ||
+   PASS != checkstr(++test, "...what came out the other end", "456789",
+   buf)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdwritefrom() the end of the string", 0,
+   (long)dstrfdwritefrom(strs[1], 10, fds[1])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_SUCCESS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdwritefrom() past the end", 0,
+   (long)dstrfdwritefrom(strs[1], 11, fds[1])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_OUT_OF_BOUNDS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   /* fill the pipe, then keep resuming from where the last write stopped
+      until the reader has everything */
+   n = dstrfdwritefrom(big, 0, fds[1]);
+   if (PASS != checkint(++test, "dstrfdwritefrom() until the pipe is full",
+   1, n > 0 && n < bigsize) || PASS != checkint(++test, "...dstrerrno",
+   DSTR_SUCCESS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdwritefrom() to a full pipe", 0,
+   (long)dstrfdwritefrom(big, n, fds[1])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_WOULDBLOCK, dstrerrno)) {
+      status = FAIL;
+   }
+
+   i = drain(fds[0], bigbuf, bigsize + 1);
+   while (n < bigsize) {
+      n += dstrfdwritefrom(big, n, fds[1]);
+      if (DSTR_SUCCESS != dstrerrno && DSTR_WOULDBLOCK != dstrerrno) {
+         break;
+      }
+      i += drain(fds[0], bigbuf, bigsize + 1);
+   }
+
+   if (PASS != checkint(++test, "...resuming from the index writes it all",
+   (long)bigsize, (long)n) || PASS != checkint(++test,
+   "...and the reader got all of it", (long)bigsize, (long)i)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(strs[1], "end");
+   dstrfdwrite(strs[1], fds[1]);
+   close(fds[1]);
+
+   cstrtodstr(strs[0], "");
+   if (PASS != checkint(++test, "dstrfdcat() from a closed pipe", 3,
+   (long)dstrfdcat(strs[0], fds[0])) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno) || PASS != checkstr(++test,
+   "...what was left is still appended", "end", dstrview(strs[0]))) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "dstrfdcatn() after the end", 0,
+   (long)dstrfdcatn(strs[0], fds[0], 10)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno)) {
+      status = FAIL;
+   }
+
+   close(fds[0]);
+
+   printf("dstrfdcat(), dstrfdcatn() and dstrfdwritefrom(): %s\n\n",
+      PASS == status ? "PASS" : "FAIL");
+
+done:
+   free(bigbuf);
+   dstrfree(&big);
+   for (i = 0; i < 3; i++) {
+      dstrfree(&strs[i]);
+   }
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* records that exercise quoting, followed in the file by one that spans
+   the reader's 64K buffer and one whose quotes are never closed */
+static const char *csvtext =
+   "a,\"b,c\",\"d\ne\"\r\n"
+   "\"say \"\"hi\"\"\",,x\n"
+   "1\t2\r\n"
+   "\n"
+   "\"\"\"\",\"\",\"a\"\"\"\n";
+
+static const struct {
+   size_t      count;
+   const char *fields[3];
+} csvrecords[] = {
+   {3, {"a", "b,c", "d\ne"}},
+   {3, {"say \"hi\"", "", "x"}},
+   {1, {"1\t2"}},
+   {1, {""}},
+   {3, {"\"", "", "a\""}}
+};
+
+/* where the record spanning the buffer starts, relative to its end */
+#define CSV_SPAN 8
+
+static STAT tiercsv(void) {
+
+   STAT         status = PASS;
+   dstring_t    rec = NULL;
+   dstrreader_t rd = NULL;
+   dstrfield_t  fields[3];
+   FILE        *fp;
+   char         description[128];
+   size_t       i, j, n, pad;
+   int          test = 0;
+
+   if (DSTR_SUCCESS != dstralloc(&rec) || NULL == (fp = tmpfile())) {
+      printf("\terror: allocation failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   /* the padding record makes the next one start CSV_SPAN bytes before
+      the end of the first 64K, with a quote opened before the boundary
+      and closed after it */
+   fputs(csvtext, fp);
+   fputs("pad,", fp);
+   for (pad = strlen(csvtext) + 5; pad < 65536 - CSV_SPAN; pad++) {
+      putc('y', fp);
+   }
+   fputs("\none,\"t,\nwo\",three\r\n", fp);
+   fputs("last,\"open\nstill", fp);
+   rewind(fp);
+
+   if (DSTR_SUCCESS != dstrreaderopen(&rd, fp, DSTR_COMPRESS_NONE)) {
+      printf("\terror: dstrreaderopen() failed; skipping this tier\n\n");
+      fclose(fp);
+      dstrfree(&rec);
+      return FAIL;
+   }
+
+   printf("dstrrreadcsv():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(csvrecords) / sizeof(csvrecords[0]); i++) {
+
+      n = dstrrreadcsv(rec, rd, ',', fields, 3);
+
+      sprintf(description, "fields in record %lu", (unsigned long)i + 1);
+      if (PASS != checkint(++test, description, (long)csvrecords[i].count,
+      (long)n) || PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS,
+      dstrerrno)) {
+         status = FAIL;
+         continue;
+      }
+
+      for (j = 0; j < n; j++) {
+         sprintf(description, "...field %lu", (unsigned long)j + 1);
+         if (PASS != checkstr(++test, description, csvrecords[i].fields[j],
+         dstrview(rec) + fields[j].offset) || PASS != checkint(++test,
+         "...its length", (long)strlen(csvrecords[i].fields[j]),
+         (long)fields[j].length)) {
+            status = FAIL;
+         }
+      }
+   }
+
+   /* only the first field is wanted, but all of them are counted */
+   n = dstrrreadcsv(rec, rd, ',', fields, 1);
+   if (PASS != checkint(++test, "more fields than max are still counted", 2,
+   (long)n) || PASS != checkstr(++test, "...and the first is stored", "pad",
+   dstrview(rec) + fields[0].offset)) {
+      status = FAIL;
+   }
+
+   n = dstrrreadcsv(rec, rd, ',', fields, 3);
+   if (PASS != checkint(++test, "a record spanning the 64K buffer", 3,
+   (long)n) || PASS != checkstr(++test, "...field 1", "one", dstrview(rec) +
+   fields[0].offset) || PASS != checkstr(++test, "...field 2", "t,\nwo",
+   dstrview(rec) + fields[1].offset) || PASS != checkstr(++test,
+   "...field 3", "three", dstrview(rec) + fields[2].offset)) {
+      status = FAIL;
+   }
+
+   /* a quote that's never closed runs to the end, which is reported */
+   n = dstrrreadcsv(rec, rd, ',', fields, 3);
+   if (PASS != checkint(++test, "a quote left open at the end", 2, (long)n)
+   || PASS != checkint(++test, "...dstrerrno", DSTR_EOF, dstrerrno) ||
+   PASS != checkstr(++test, "...field 2 runs to the end", "open\nstill",
+   dstrview(rec) + fields[1].offset)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "reading past the end", 0,
+   (long)dstrrreadcsv(rec, rd, ',', fields, 3)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno)) {
+      status = FAIL;
+   }
+
+   dstrreaderclose(&rd);
+   fclose(fp);
+
+   /* a last record without a newline is fine, as long as its quotes are */
+   if (NULL != (fp = tmpfile())) {
+
+      fputs("x,\"y\"", fp);
+      rewind(fp);
+
+      if (DSTR_SUCCESS == dstrreaderopen(&rd, fp, DSTR_COMPRESS_NONE)) {
+
+         if (PASS != checkint(++test, "a quote as the delimiter", 0,
+         (long)dstrrreadcsv(rec, rd, '"', fields, 3)) || PASS !=
+         checkint(++test, "...dstrerrno", DSTR_INVALID_ARGUMENT,
+         dstrerrno)) {
+            status = FAIL;
+         }
+
+         n = dstrrreadcsv(rec, rd, ',', fields, 3);
+         if (PASS != checkint(++test, "a last record without a newline", 2,
+         (long)n) || PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS,
+         dstrerrno) || PASS != checkstr(++test, "...field 2", "y",
+         dstrview(rec) + fields[1].offset)) {
+            status = FAIL;
+         }
+
+         dstrreaderclose(&rd);
+      }
+
+      fclose(fp);
+   }
+
+   printf("dstrrreadcsv(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&rec);
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* the examples from RFC 4648 */
+static const struct {
+   const char *text;
+   const char *base64;
+} base64vectors[] = {
+   {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+   {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}
+};
+
+/* base64 that has to be rejected, whatever its length */
+static const char *badbase64[] = {
+   "Q", "QQ=", "Q===", "QR==", "QQQ=Q", "QUJD=", "QU=D", "QUJD QUJD",
+   "QUJ\nD", "QU*D"
+};
+
+/* characters that aren't base64 (in the standard alphabet) */
+static const char badbase64chars[] = "=*-_ \n\x80\xff:@[`{.";
+
+/* characters that aren't hex, including the neighbours of each range */
+static const char badhexchars[] = "=*- \n\x80\xff\xc1:@[`{/gG";
+
+/* counts how many of the 0 to 99 byte prefixes of data don't come back
+   unchanged from being encoded and decoded */
+static int roundtrips(const unsigned char *data, int base64, int flags) {
+
+   dstring_t encoded = NULL, decoded = NULL;
+   size_t    len, n;
+   int       failures = 0;
+
+   if (DSTR_SUCCESS != dstralloc(&encoded) ||
+   DSTR_SUCCESS != dstralloc(&decoded)) {
+      return -1;
+   }
+
+   for (len = 0; len < 100; len++) {
+
+      cstrtodstr(encoded, "");
+      cstrtodstr(decoded, "");
+
+      if (base64) {
+         dstrcatbase64(encoded, data, len, flags);
+         n = dstrcatunbase64(decoded, dstrview(encoded), dstrlen(encoded),
+            flags);
+      } else {
+         dstrcathex(encoded, data, len, flags);
+         n = dstrcatunhex(decoded, dstrview(encoded), dstrlen(encoded));
+      }
+
+      if (n != len || DSTR_SUCCESS != dstrerrno ||
+      0 != memcmp(data, dstrview(decoded), len)) {
+         failures++;
+      }
+   }
+
+   dstrfree(&decoded);
+   dstrfree(&encoded);
+   return failures;
+}
+
+/* counts how many ways of putting a bad character into a copy of valid
+   (at every position) aren't rejected, or change dest anyway */
+static int rejections(dstring_t dest, const char *valid, int base64,
+int flags) {
+
+   const char *bad = base64 ? badbase64chars : badhexchars;
+   char        copy[128];
+   size_t      len = strlen(valid), i, j, n;
+   int         failures = 0;
+
+   for (i = 0; i < len; i++) {
+      for (j = 0; '\0' != bad[j]; j++) {
+
+         /* '-' and '_' are fine in URL-safe base64, and so is padding at
+            the end where it belongs */
+         if ((flags & DSTR_BASE64_URL && ('-' == bad[j] || '_' == bad[j])) ||
+         (base64 && '=' == bad[j] && i >= len - 2)) {
+            continue;
+         }
+
+         strcpy(copy, valid);
+         copy[i] = bad[j];
+
+         cstrtodstr(dest, "kept");
+         n = base64 ? dstrcatunbase64(dest, copy, len, flags) :
+            dstrcatunhex(dest, copy, len);
+
+         if (0 != n || DSTR_INVALID_ARGUMENT != dstrerrno ||
+         0 != strcmp("kept", dstrview(dest))) {
+            failures++;
+         }
+      }
+   }
+
+   return failures;
+}
+
+static STAT tierencoding(void) {
+
+   STAT          status = PASS;
+   dstring_t     str = NULL;
+   unsigned char data[100];
+   char          description[128], valid[128];
+   size_t        i, n;
+   int           test = 0;
+
+   /* the encoders and decoders work on 12 to 32 characters at a time where
+      they can, with the rest done one group at a time, so everything here
+      is tried at lengths on both sides of that */
+   static const size_t lengths[] = {3, 12, 45};
+
+   static const int base64flags[] = {0, DSTR_BASE64_URL, DSTR_BASE64_NOPAD,
+      DSTR_BASE64_URL | DSTR_BASE64_NOPAD};
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   /* every byte value turns up, including '\0' */
+   for (i = 0; i < sizeof(data); i++) {
+      data[i] = (unsigned char)(i * 167 + 13);
+   }
+   data[7] = 0xfb;
+   data[8] = 0xff;
+
+   printf("dstrcatbase64() and dstrcatunbase64():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(base64vectors) / sizeof(base64vectors[0]); i++) {
+
+      cstrtodstr(str, "");
+      dstrcatbase64(str, base64vectors[i].text,
+         strlen(base64vectors[i].text), 0);
+      sprintf(description, "encoding \"%s\"", base64vectors[i].text);
+      if (PASS != checkstr(++test, description, base64vectors[i].base64,
+      dstrview(str))) {
+         status = FAIL;
+      }
+
+      cstrtodstr(str, "");
+      dstrcatunbase64(str, base64vectors[i].base64,
+         strlen(base64vectors[i].base64), 0);
+      sprintf(description, "decoding \"%s\"", base64vectors[i].base64);
+      if (PASS != checkstr(++test, description, base64vectors[i].text,
+      dstrview(str))) {
+         status = FAIL;
+      }
+   }
+
+   cstrtodstr(str, "");
+   dstrcatbase64(str, "\xfb\xff", 2, 0);
+   dstrcatbase64(str, "\xfb\xff", 2, DSTR_BASE64_URL);
+   dstrcatbase64(str, "\xfb\xff", 2, DSTR_BASE64_URL | DSTR_BASE64_NOPAD);
+   if (PASS != checkstr(++test, "the two alphabets, and no padding",
+   "+/8=-_8=-_8", dstrview(str))) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "");
+   if (PASS != checkint(++test, "padding is optional when decoding", 2,
+   (long)dstrcatunbase64(str, "Zm8", 3, 0)) || PASS != checkstr(++test,
+   "...and the result is the same", "fo", dstrview(str))) {
+      status = FAIL;
+   }
+
+   for (i = 0; i < sizeof(base64flags) / sizeof(base64flags[0]); i++) {
+      sprintf(description, "round trips of 0 to 99 bytes, flags %d",
+         base64flags[i]);
+      if (PASS != checkint(++test, description, 0, roundtrips(data, 1,
+      base64flags[i]))) {
+         status = FAIL;
+      }
+   }
+
+   for (i = 0; i < sizeof(badbase64) / sizeof(badbase64[0]); i++) {
+      cstrtodstr(str, "kept");
+      n = dstrcatunbase64(str, badbase64[i], strlen(badbase64[i]), 0);
+      sprintf(description, "\"%s\" is rejected", badbase64[i]);
+      if (PASS != checkint(++test, description, 1, 0 == n &&
+      DSTR_INVALID_ARGUMENT == dstrerrno) || PASS != checkstr(++test,
+      "...and the string is left alone", "kept", dstrview(str))) {
+         status = FAIL;
+      }
+   }
+
+   /* a bad character has to be found wherever it is, whether that part of
+      the input is decoded in bulk or not */
+   for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+
+      cstrtodstr(str, "");
+      dstrcatbase64(str, data, lengths[i], 0);
+      strcpy(valid, dstrview(str));
+      sprintf(description, "bad characters anywhere in %lu characters",
+         (unsigned long)strlen(valid));
+      if (PASS != checkint(++test, description, 0, rejections(str, valid, 1,
+      0))) {
+         status = FAIL;
+      }
+
+      cstrtodstr(str, "");
+      dstrcatbase64(str, data, lengths[i], DSTR_BASE64_URL);
+      strcpy(valid, dstrview(str));
+      if (PASS != checkint(++test, "...with the URL-safe alphabet", 0,
+      rejections(str, valid, 1, DSTR_BASE64_URL))) {
+         status = FAIL;
+      }
+   }
+
+   cstrtodstr(str, "");
+   dstrcatbase64(str, data, 45, DSTR_BASE64_URL);
+   n = strcspn(dstrview(str), "-_");
+   if (n < dstrlen(str)) {
+      strcpy(valid, dstrview(str));
+      cstrtodstr(str, "kept");
+      if (PASS != checkint(++test, "the URL-safe alphabet isn't standard", 0,
+      (long)dstrcatunbase64(str, valid, strlen(valid), 0)) ||
+      PASS != checkint(++test, "...dstrerrno", DSTR_INVALID_ARGUMENT,
+      dstrerrno)) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrcatbase64() and dstrcatunbase64(): %s\n\n", PASS == status ?
+      "PASS" : "FAIL");
+
+   printf("dstrcathex() and dstrcatunhex():\n");
+   putchar('\n');
+
+   cstrtodstr(str, "");
+   dstrcathex(str, "\x00\x9f\xfa", 3, 0);
+   dstrcathex(str, "\x00\x9f\xfa", 3, DSTR_HEX_UPPER);
+   if (PASS != checkstr(++test, "lowercase and uppercase", "009ffa009FFA",
+   dstrview(str))) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "");
+   dstrcatunhex(str, "4a4B6c", 6);
+   if (PASS != checkstr(++test, "decoding mixed case", "JKl",
+   dstrview(str))) {
+      status = FAIL;
+   }
+
+   for (i = 0; i < 2; i++) {
+      sprintf(description, "round trips of 0 to 99 bytes, flags %d",
+         i ? DSTR_HEX_UPPER : 0);
+      if (PASS != checkint(++test, description, 0, roundtrips(data, 0,
+      i ? DSTR_HEX_UPPER : 0))) {
+         status = FAIL;
+      }
+   }
+
+   cstrtodstr(str, "kept");
+   if (PASS != checkint(++test, "an odd number of digits is rejected", 0,
+   (long)dstrcatunhex(str, "abc", 3)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_INVALID_ARGUMENT, dstrerrno) || PASS !=
+   checkstr(++test, "...and the string is left alone", "kept",
+   dstrview(str))) {
+      status = FAIL;
+   }
+
+   for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+      cstrtodstr(str, "");
+      dstrcathex(str, data, lengths[i], 0);
+      strcpy(valid, dstrview(str));
+      sprintf(description, "bad characters anywhere in %lu digits",
+         (unsigned long)strlen(valid));
+      if (PASS != checkint(++test, description, 0, rejections(str, valid, 0,
+      0))) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrcathex() and dstrcatunhex(): %s\n\n", PASS == status ?
+      "PASS" : "FAIL");
+
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+/* input to dstrcatutf16() (width 2) or dstrcatutf32() (width 4), and the
+   UTF-8 that should come out, or NULL if it has to be rejected */
+static const struct {
+   const char *description;
+   int         width;
+   const char *input;
+   size_t      len;
+   int         flags;
+   const char *expected;
+} utfcases[] = {
+   {"little-endian UTF-16", 2, "h\0\xe9\0", 4, 0, "h\xc3\xa9"},
+   {"big-endian UTF-16", 2, "\0h\0\xe9", 4, DSTR_UTF_BE, "h\xc3\xa9"},
+   {"a surrogate pair", 2, "=\xd8\0\xde", 4, 0, "\xf0\x9f\x98\x80"},
+   {"a BOM decides the byte order", 2, "\xff\xfeh\0", 4,
+      DSTR_UTF_BOM | DSTR_UTF_BE, "h"},
+   {"...the other way round too", 2, "\xfe\xff\0h", 4, DSTR_UTF_BOM, "h"},
+   {"a BOM is only skipped if asked", 2, "\xff\xfeh\0", 4, 0,
+      "\xef\xbb\xbfh"},
+   {"a 0 code unit stops the input", 2, "h\0\0\0i\0", 6, 0, "h"},
+   {"an odd number of bytes", 2, "h\0i", 3, 0, NULL},
+   {"...even with DSTR_UTF_REPLACE", 2, "h\0i", 3, DSTR_UTF_REPLACE, NULL},
+   {"an unpaired high surrogate", 2, "=\xd8h\0", 4, 0, NULL},
+   {"...replaced", 2, "=\xd8h\0", 4, DSTR_UTF_REPLACE, "\xef\xbf\xbdh"},
+   {"an unpaired low surrogate", 2, "h\0\0\xde", 4, 0, NULL},
+   {"...replaced", 2, "h\0\0\xde", 4, DSTR_UTF_REPLACE, "h\xef\xbf\xbd"},
+   {"a high surrogate at the end", 2, "h\0=\xd8", 4, 0, NULL},
+   {"...replaced", 2, "h\0=\xd8", 4, DSTR_UTF_REPLACE, "h\xef\xbf\xbd"},
+   {"two high surrogates", 2, "=\xd8=\xd8\0\xde", 6, 0, NULL},
+   {"...replaced", 2, "=\xd8=\xd8\0\xde", 6, DSTR_UTF_REPLACE,
+      "\xef\xbf\xbd\xf0\x9f\x98\x80"},
+   {"little-endian UTF-32", 4, "\0\xf6\x01\0", 4, 0, "\xf0\x9f\x98\x80"},
+   {"big-endian UTF-32", 4, "\0\x01\xf6\0", 4, DSTR_UTF_BE,
+      "\xf0\x9f\x98\x80"},
+   {"a UTF-32 BOM", 4, "\0\0\xfe\xffh\0\0\0", 8, DSTR_UTF_BOM, NULL},
+   {"...decides the byte order", 4, "\0\0\xfe\xff\0\0\0h", 8, DSTR_UTF_BOM,
+      "h"},
+   {"a length that isn't a multiple of 4", 4, "h\0\0\0i\0", 6, 0, NULL},
+   {"a surrogate in UTF-32", 4, "\0\xd8\0\0", 4, 0, NULL},
+   {"...replaced", 4, "\0\xd8\0\0", 4, DSTR_UTF_REPLACE, "\xef\xbf\xbd"},
+   {"a code point past U+10FFFF", 4, "\0\0\x11\0", 4, 0, NULL},
+   {"...replaced", 4, "\0\0\x11\0", 4, DSTR_UTF_REPLACE, "\xef\xbf\xbd"}
+};
+
+/* long enough that the 8 and 16 at a time parts of the conversions get a
+   go, with every UTF-8 length in there, including in the middle of a run */
+static const char *transcodesample =
+   "plain ASCII, long enough for a few blocks "
+   "caf\xc3\xa9 na\xc3\xafve \xe2\x82\xac 10 \xf0\x9f\x98\x80 \xf0\x9f\x98\x80"
+   " and a bit more plain ASCII at the end\xc2\xa0";
+
+static STAT tiertranscoding(void) {
+
+   STAT          status = PASS;
+   dstring_t     str = NULL, back = NULL;
+   unsigned char out[512];
+   size_t        i, n;
+   int           test = 0, flags;
+
+   if (DSTR_SUCCESS != dstralloc(&str) || DSTR_SUCCESS != dstralloc(&back)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrcatutf16() and dstrcatutf32():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(utfcases) / sizeof(utfcases[0]); i++) {
+
+      cstrtodstr(str, "kept");
+      n = 2 == utfcases[i].width ?
+         dstrcatutf16(str, utfcases[i].input, utfcases[i].len,
+            utfcases[i].flags) :
+         dstrcatutf32(str, utfcases[i].input, utfcases[i].len,
+            utfcases[i].flags);
+
+      if (NULL == utfcases[i].expected) {
+         if (PASS != checkint(++test, utfcases[i].description, 1, 0 == n &&
+         DSTR_INVALID_ARGUMENT == dstrerrno) || PASS != checkstr(++test,
+         "...and the string is left alone", "kept", dstrview(str))) {
+            status = FAIL;
+         }
+      }
+
+      else {
+         cstrtodstr(back, "kept");
+         dstrcatcs(back, utfcases[i].expected);
+         if (PASS != checkstr(++test, utfcases[i].description,
+         dstrview(back), dstrview(str)) || PASS != checkint(++test,
+         "...return value", (long)strlen(utfcases[i].expected), (long)n)) {
+            status = FAIL;
+         }
+      }
+   }
+
+   printf("dstrcatutf16() and dstrcatutf32(): %s\n\n", PASS == status ?
+      "PASS" : "FAIL");
+
+   printf("dstrcatlatin1():\n");
+   putchar('\n');
+
+   cstrtodstr(str, "");
+   dstrcatlatin1(str, "caf\xe9 \x80\xff", 7);
+   if (PASS != checkstr(++test, "every byte is a character",
+   "caf\xc3\xa9 \xc2\x80\xc3\xbf", dstrview(str))) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "");
+   if (PASS != checkint(++test, "a '\\0' stops the input", 1,
+   (long)dstrcatlatin1(str, "a\0b", 3)) || PASS != checkstr(++test,
+   "...and the rest is left out", "a", dstrview(str))) {
+      status = FAIL;
+   }
+
+   printf("dstrcatlatin1(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrtoutf16(), dstrtoutf32() and dstrtolatin1():\n");
+   putchar('\n');
+
+   cstrtodstr(str, "h\xc3\xa9\xf0\x9f\x98\x80");
+
+   if (PASS != checkint(++test, "the size of the UTF-16, with no buffer", 8,
+   (long)dstrtoutf16(NULL, str, 0, 0)) || PASS != checkint(++test,
+   "...with a BOM", 10, (long)dstrtoutf16(NULL, str, 0, DSTR_UTF_BOM)) ||
+   PASS != checkint(++test, "...dstrerrno", DSTR_SUCCESS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   if (PASS != checkint(++test, "the size of the UTF-32, with no buffer", 12,
+   (long)dstrtoutf32(NULL, str, 0, 0)) || PASS != checkint(++test,
+   "...with a BOM", 16, (long)dstrtoutf32(NULL, str, 0, DSTR_UTF_BOM))) {
+      status = FAIL;
+   }
+
+   memset(out, '#', sizeof(out));
+   if (PASS != checkint(++test, "a buffer that's too small", 10,
+   (long)dstrtoutf16(out, str, 9, DSTR_UTF_BOM)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_INVALID_BUFLEN, dstrerrno) || PASS != checkint(++test,
+   "...and nothing is written", '#', out[0])) {
+      status = FAIL;
+   }
+
+   dstrtoutf16(out, str, sizeof(out), DSTR_UTF_BOM | DSTR_UTF_BE);
+   if (PASS != checkint(++test, "big-endian UTF-16 with a BOM", 0,
+   memcmp(out, "\xfe\xff\0h\0\xe9\xd8=\xde\0", 10))) {
+      status = FAIL;
+   }
+
+   dstrtoutf32(out, str, sizeof(out), DSTR_UTF_BOM);
+   if (PASS != checkint(++test, "little-endian UTF-32 with a BOM", 0,
+   memcmp(out, "\xff\xfe\0\0h\0\0\0\xe9\0\0\0\0\xf6\x01\0", 16))) {
+      status = FAIL;
+   }
+
+   /* with and without a BOM, and in both byte orders, what's written has to
+      read back the same */
+   cstrtodstr(str, transcodesample);
+   for (flags = 0; flags <= (DSTR_UTF_BE | DSTR_UTF_BOM); flags++) {
+
+      n = dstrtoutf16(out, str, sizeof(out), flags);
+      cstrtodstr(back, "");
+      dstrcatutf16(back, out, n, flags);
+      if (PASS != checkstr(++test, "UTF-16 round trip", transcodesample,
+      dstrview(back))) {
+         status = FAIL;
+      }
+
+      n = dstrtoutf32(out, str, sizeof(out), flags);
+      cstrtodstr(back, "");
+      dstrcatutf32(back, out, n, flags);
+      if (PASS != checkstr(++test, "UTF-32 round trip", transcodesample,
+      dstrview(back))) {
+         status = FAIL;
+      }
+   }
+
+   cstrtodstr(str, "caf\xc3\xa9 \xc2\x80");
+   memset(out, 0, sizeof(out));
+   if (PASS != checkint(++test, "the length of the Latin-1, with no buffer",
+   6, (long)dstrtolatin1(NULL, str, 0, 0)) || PASS != checkint(++test,
+   "...and with one", 6, (long)dstrtolatin1((char *)out, str, sizeof(out),
+   0)) || PASS != checkstr(++test, "...what's written", "caf\xe9 \x80",
+   (const char *)out)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "10 \xe2\x82\xac");
+   if (PASS != checkint(++test, "a code point Latin-1 doesn't have", 0,
+   (long)dstrtolatin1(NULL, str, 0, 0)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_OUT_OF_RANGE, dstrerrno)) {
+      status = FAIL;
+   }
+
+   memset(out, 0, sizeof(out));
+   if (PASS != checkint(++test, "...replaced", 4, (long)dstrtolatin1(
+   (char *)out, str, sizeof(out), DSTR_UTF_REPLACE)) || PASS !=
+   checkstr(++test, "...what's written", "10 ?", (const char *)out)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "h\xc3");
+   if (PASS != checkint(++test, "a string that isn't UTF-8", 0,
+   (long)dstrtoutf16(NULL, str, 0, 0)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_INVALID_UTF8, dstrerrno)) {
+      status = FAIL;
+   }
+
+   printf("dstrtoutf16(), dstrtoutf32() and dstrtolatin1(): %s\n\n",
+      PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&back);
+   dstrfree(&str);
+   return status;
+}
+
+/* ************************************************************************* */
+
+static const struct {
+   const char *input;
+   int         flags;
+   const char *expected;
+} urlencodecases[] = {
+   {"a b/c~+", 0, "a%20b%2Fc~%2B"},
+   {"a b/c~+", DSTR_URL_FORM, "a+b%2Fc~%2B"},
+   {"a b/c~+", DSTR_URL_PATH, "a%20b/c~%2B"},
+   {"a b/c~+", DSTR_URL_FORM | DSTR_URL_PATH, "a+b/c~%2B"},
+   {"caf\xc3\xa9", 0, "caf%C3%A9"},
+   {"nothing_to-escape.here~0123456789", 0,
+      "nothing_to-escape.here~0123456789"},
+   {"16 characters a ./@[`{:/-_~ and 16 more AZaz09", DSTR_URL_PATH,
+      "16%20characters%20a%20./%40%5B%60%7B%3A/-_~%20and%2016%20more%20"
+      "AZaz09"}
+};
+
+static const struct {
+   const char *input;
+   int         flags;
+   const char *expected;
+} urldecodecases[] = {
+   {"%41%4a%4A", 0, "AJJ"},
+   {"%00 stays", 0, "%00 stays"},
+   {"100%", 0, "100%"},
+   {"%4", 0, "%4"},
+   {"%zz%4g%g4", 0, "%zz%4g%g4"},
+   {"%%41%", 0, "%A%"},
+   {"a+b%2B", 0, "a+b+"},
+   {"a+b%2B", DSTR_URL_FORM, "a b+"},
+   {"a long run with nothing to decode before one at the end %7E", 0,
+      "a long run with nothing to decode before one at the end ~"}
+};
+
+static STAT tierurl(void) {
+
+   STAT        status = PASS;
+   dstring_t   str = NULL;
+   dstrfield_t key, value;
+   char        bytes[256], found[256];
+   size_t      i, index, n;
+   int         test = 0, flags;
+
+   if (DSTR_SUCCESS != dstralloc(&str)) {
+      printf("\terror: dstralloc() failed; skipping this tier\n\n");
+      return FAIL;
+   }
+
+   printf("dstrcaturlencode():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(urlencodecases) / sizeof(urlencodecases[0]);
+   i++) {
+      cstrtodstr(str, "");
+      n = dstrcaturlencode(str, urlencodecases[i].input,
+         urlencodecases[i].flags);
+      if (PASS != checkstr(++test, urlencodecases[i].input,
+      urlencodecases[i].expected, dstrview(str)) || PASS != checkint(++test,
+      "...return value", (long)strlen(urlencodecases[i].expected),
+      (long)n)) {
+         status = FAIL;
+      }
+   }
+
+   /* every character but '\0', so the bulk counting and the escaping have
+      to agree about all of them */
+   for (i = 0; i < 255; i++) {
+      bytes[i] = (char)(i + 1);
+   }
+   bytes[255] = '\0';
+
+   for (flags = 0; flags <= (DSTR_URL_FORM | DSTR_URL_PATH); flags++) {
+      cstrtodstr(str, "");
+      dstrcaturlencode(str, bytes, flags);
+      dstrurldecode(str, flags & DSTR_URL_FORM);
+      sprintf(found, "every character round trips, flags %d", flags);
+      if (PASS != checkint(++test, found, 1, 0 == strcmp(bytes,
+      dstrview(str)))) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrcaturlencode(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrurldecode():\n");
+   putchar('\n');
+
+   for (i = 0; i < sizeof(urldecodecases) / sizeof(urldecodecases[0]);
+   i++) {
+      cstrtodstr(str, urldecodecases[i].input);
+      n = dstrurldecode(str, urldecodecases[i].flags);
+      if (PASS != checkstr(++test, urldecodecases[i].input,
+      urldecodecases[i].expected, dstrview(str)) || PASS != checkint(++test,
+      "...return value", (long)strlen(urldecodecases[i].expected),
+      (long)n)) {
+         status = FAIL;
+      }
+   }
+
+   printf("dstrurldecode(): %s\n\n", PASS == status ? "PASS" : "FAIL");
+
+   printf("dstrquerynext() and dstrurldecodefield():\n");
+   putchar('\n');
+
+   cstrtodstr(str, "a=1&&b=&c&=d&e=%41+x&&#f=2&g=3");
+   found[0] = '\0';
+   index = 0;
+   while (dstrquerynext(str, &index, &key, &value)) {
+      sprintf(found + strlen(found), "[%.*s|%.*s]", (int)key.length,
+         dstrview(str) + key.offset, (int)value.length,
+         dstrview(str) + value.offset);
+   }
+   if (PASS != checkstr(++test, "parameters, up to the '#'",
+   "[a|1][b|][c|][|d][e|%41+x]", found) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno) || PASS != checkint(++test,
+   "...and again after the end", 0, dstrquerynext(str, &index, &key,
+   &value)) || PASS != checkint(++test, "...dstrerrno", DSTR_EOF,
+   dstrerrno)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "&&&#a=1");
+   index = 0;
+   if (PASS != checkint(++test, "only empty parameters", 0,
+   dstrquerynext(str, &index, &key, &value)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno)) {
+      status = FAIL;
+   }
+
+   cstrtodstr(str, "");
+   index = 0;
+   if (PASS != checkint(++test, "an empty query string", 0,
+   dstrquerynext(str, &index, &key, &value)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_EOF, dstrerrno)) {
+      status = FAIL;
+   }
+
+   /* decoding one field mustn't disturb the next */
+   cstrtodstr(str, "q=%41+%42%00&r=%2B+");
+   index = 0;
+   dstrquerynext(str, &index, &key, &value);
+   n = dstrurldecodefield(str, &value, DSTR_URL_FORM);
+   sprintf(found, "%.*s", (int)value.length, dstrview(str) + value.offset);
+   if (PASS != checkstr(++test, "decoding a value", "A B%00", found) ||
+   PASS != checkint(++test, "...return value", 6, (long)n) ||
+   PASS != checkint(++test, "...and the field's length", 6,
+   (long)value.length)) {
+      status = FAIL;
+   }
+
+   dstrquerynext(str, &index, &key, &value);
+   dstrurldecodefield(str, &value, DSTR_URL_FORM);
+   sprintf(found, "%.*s=%.*s", (int)key.length, dstrview(str) + key.offset,
+      (int)value.length, dstrview(str) + value.offset);
+   if (PASS != checkstr(++test, "...and then the next parameter", "r=+ ",
+   found)) {
+      status = FAIL;
+   }
+
+   value.offset = 0;
+   value.length = dstrallocsize(str);
+   if (PASS != checkint(++test, "a field past the end", 0,
+   (long)dstrurldecodefield(str, &value, 0)) || PASS != checkint(++test,
+   "...dstrerrno", DSTR_OUT_OF_BOUNDS, dstrerrno)) {
+      status = FAIL;
+   }
+
+   printf("dstrquerynext() and dstrurldecodefield(): %s\n\n",
+      PASS == status ? "PASS" : "FAIL");
+
+   dstrfree(&str);
+   return status;
+}
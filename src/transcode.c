@@ -0,0 +1,1118 @@
+
+/* ************************************************************************* *\
+   * File: transcode.c                                                     *
+   * Purpose:                                                              *
+   *    Provides functions that convert UTF-16, UTF-32 and Latin-1 to and  *
+   *    from the UTF-8 in a dstring_t                                      *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* what an unpaired surrogate (or anything else that isn't a code point)
+   becomes with DSTR_UTF_REPLACE */
+#define REPLACEMENT_CHAR 0xfffd
+
+/* ...and a code point that Latin-1 doesn't have */
+#define REPLACEMENT_LATIN1 '?'
+
+/* returned by the sizing functions when the input can't be converted */
+#define TRANSCODE_INVALID ((size_t)-1)
+
+static int           reserve(dstring_t dest, size_t len, size_t n);
+static int           byteorder(const unsigned char **s, size_t *len,
+   int flags, size_t unit);
+static unsigned long get16(const unsigned char *s, size_t i, int be);
+static unsigned long get32(const unsigned char *s, size_t i, int be);
+static void          put16(unsigned char *out, unsigned long u, int be);
+static void          put32(unsigned char *out, unsigned long u, int be);
+static size_t        utf8put(unsigned char *out, unsigned long cp);
+static unsigned long utf8get(const unsigned char *s, size_t *i);
+static int           utf16step(const unsigned char *s, size_t *i, size_t end,
+   int be, int replace, size_t *n);
+static int           utf32step(unsigned long u, int replace, size_t *n);
+static size_t        utf16size(const unsigned char *s, size_t *units, int be,
+   int replace);
+static size_t        utf16decode(unsigned char *out, const unsigned char *s,
+   size_t units, int be);
+static size_t        utf32size(const unsigned char *s, size_t *units, int be,
+   int replace);
+static size_t        utf32decode(unsigned char *out, const unsigned char *s,
+   size_t units, int be);
+static size_t        latin1size(const unsigned char *s, size_t *len);
+static size_t        latin1decode(unsigned char *out, const unsigned char *s,
+   size_t len);
+static size_t        utf16units(const unsigned char *s, size_t len,
+   size_t codepoints);
+static void          utf16encode(unsigned char *out, const unsigned char *s,
+   size_t len, int be);
+static void          utf32encode(unsigned char *out, const unsigned char *s,
+   size_t len, int be);
+static int           latin1check(const unsigned char *s, size_t len);
+static void          latin1encode(unsigned char *out, const unsigned char *s,
+   size_t len);
+
+#ifdef __SSE2__
+static __m128i       load16(const unsigned char *s, int be);
+static __m128i       load32(const unsigned char *s, int be);
+#endif
+
+/* ************************************************************************* */
+
+size_t dstrcatutf16(dstring_t dest, const void *src, size_t len, int flags) {
+
+   const unsigned char *s = src;
+   size_t               start, units, n;
+   int                  be;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   be = byteorder(&s, &len, flags, 2);
+
+   if (len % 2) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   units = len / 2;
+   if (TRANSCODE_INVALID == (n = utf16size(s, &units, be,
+   flags & DSTR_UTF_REPLACE))) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, n)) {
+      return 0;
+   }
+
+   utf16decode((unsigned char *)DSTRBUF(dest) + start, s, units, be);
+
+   DSTRBUF(dest)[start + n] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcatutf32(dstring_t dest, const void *src, size_t len, int flags) {
+
+   const unsigned char *s = src;
+   size_t               start, units, n;
+   int                  be;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   be = byteorder(&s, &len, flags, 4);
+
+   if (len % 4) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   units = len / 4;
+   if (TRANSCODE_INVALID == (n = utf32size(s, &units, be,
+   flags & DSTR_UTF_REPLACE))) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, n)) {
+      return 0;
+   }
+
+   utf32decode((unsigned char *)DSTRBUF(dest) + start, s, units, be);
+
+   DSTRBUF(dest)[start + n] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcatlatin1(dstring_t dest, const char *src, size_t len) {
+
+   size_t start, n;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   n = latin1size((const unsigned char *)src, &len);
+
+   start = dstrlen(dest);
+   if (DSTR_SUCCESS != reserve(dest, start, n)) {
+      return 0;
+   }
+
+   latin1decode((unsigned char *)DSTRBUF(dest) + start,
+      (const unsigned char *)src, len);
+
+   DSTRBUF(dest)[start + n] = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrtoutf16(void *dest, const dstring_t src, size_t size, int flags) {
+
+   const unsigned char *s;
+   unsigned char       *out = dest;
+   size_t               len, n;
+   int                  be = 0 != (flags & DSTR_UTF_BE);
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!dstrisutf8(src)) {
+      _setdstrerrno(DSTR_INVALID_UTF8);
+      return 0;
+   }
+
+   s = (const unsigned char *)DSTRBUF(src);
+   len = strlen((const char *)s);
+
+   n = utf16units(s, len, DSTRREF(src)->codepoints) * 2;
+   if (flags & DSTR_UTF_BOM) {
+      n += 2;
+   }
+
+   /* with no buffer, the caller just wants to know how big one should be */
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return n;
+   }
+
+   if (n > size) {
+      _setdstrerrno(DSTR_INVALID_BUFLEN);
+      return n;
+   }
+
+   if (flags & DSTR_UTF_BOM) {
+      put16(out, 0xfeff, be);
+      out += 2;
+   }
+
+   utf16encode(out, s, len, be);
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrtoutf32(void *dest, const dstring_t src, size_t size, int flags) {
+
+   const unsigned char *s;
+   unsigned char       *out = dest;
+   size_t               len, n;
+   int                  be = 0 != (flags & DSTR_UTF_BE);
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!dstrisutf8(src)) {
+      _setdstrerrno(DSTR_INVALID_UTF8);
+      return 0;
+   }
+
+   s = (const unsigned char *)DSTRBUF(src);
+   len = strlen((const char *)s);
+
+   /* one unit per code point, which dstrisutf8() has already counted */
+   n = DSTRREF(src)->codepoints * 4;
+   if (flags & DSTR_UTF_BOM) {
+      n += 4;
+   }
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return n;
+   }
+
+   if (n > size) {
+      _setdstrerrno(DSTR_INVALID_BUFLEN);
+      return n;
+   }
+
+   if (flags & DSTR_UTF_BOM) {
+      put32(out, 0xfeff, be);
+      out += 4;
+   }
+
+   utf32encode(out, s, len, be);
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrtolatin1(char *dest, const dstring_t src, size_t size, int flags) {
+
+   const unsigned char *s;
+   size_t               len, n;
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!dstrisutf8(src)) {
+      _setdstrerrno(DSTR_INVALID_UTF8);
+      return 0;
+   }
+
+   s = (const unsigned char *)DSTRBUF(src);
+   len = strlen((const char *)s);
+
+   if (!(flags & DSTR_UTF_REPLACE) && !latin1check(s, len)) {
+      _setdstrerrno(DSTR_OUT_OF_RANGE);
+      return 0;
+   }
+
+   n = DSTRREF(src)->codepoints;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_SUCCESS);
+      return n;
+   }
+
+   if (n > size) {
+      _setdstrerrno(DSTR_INVALID_BUFLEN);
+      return n;
+   }
+
+   latin1encode((unsigned char *)dest, s, len);
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* makes sure there's room for n more characters (and a null terminator)
+   after the first len, so the output can be written without checking again;
+   sets dstrerrno on failure - FOR INTERNAL USE ONLY! */
+static int reserve(dstring_t dest, size_t len, size_t n) {
+
+   size_t newsize;
+
+   if (DSTRBUFLEN(dest) >= len + n + 1) {
+      return DSTR_SUCCESS;
+   }
+
+   /* grow geometrically, so appending piece by piece stays linear */
+   newsize = DSTRBUFLEN(dest) * 2;
+   if (newsize < len + n + 1) {
+      newsize = len + n + 1;
+   }
+
+   return dstrealloc(&dest, newsize);
+}
+
+/* ************************************************************************* */
+
+/* returns 1 if the input is big-endian and 0 if it's little-endian; with
+   DSTR_UTF_BOM, a byte order mark at the start decides (and is skipped),
+   and flags only matter if there isn't one - FOR INTERNAL USE ONLY! */
+static int byteorder(const unsigned char **s, size_t *len, int flags,
+size_t unit) {
+
+   const unsigned char *p = *s;
+
+   if ((flags & DSTR_UTF_BOM) && *len >= unit) {
+
+      if (2 == unit ? 0xff == p[0] && 0xfe == p[1] :
+      0xff == p[0] && 0xfe == p[1] && 0 == p[2] && 0 == p[3]) {
+         *s += unit;
+         *len -= unit;
+         return 0;
+      }
+
+      if (2 == unit ? 0xfe == p[0] && 0xff == p[1] :
+      0 == p[0] && 0 == p[1] && 0xfe == p[2] && 0xff == p[3]) {
+         *s += unit;
+         *len -= unit;
+         return 1;
+      }
+   }
+
+   return 0 != (flags & DSTR_UTF_BE);
+}
+
+/* ************************************************************************* */
+
+/* reads and writes code units one byte at a time, so neither the byte
+   order of the machine nor the alignment of the buffer matters */
+
+static unsigned long get16(const unsigned char *s, size_t i, int be) {
+
+   s += 2 * i;
+   return be ? (unsigned long)s[0] << 8 | s[1] :
+      (unsigned long)s[1] << 8 | s[0];
+}
+
+static unsigned long get32(const unsigned char *s, size_t i, int be) {
+
+   s += 4 * i;
+   return be ?
+      (unsigned long)s[0] << 24 | (unsigned long)s[1] << 16 |
+         (unsigned long)s[2] << 8 | s[3] :
+      (unsigned long)s[3] << 24 | (unsigned long)s[2] << 16 |
+         (unsigned long)s[1] << 8 | s[0];
+}
+
+static void put16(unsigned char *out, unsigned long u, int be) {
+
+   out[be ? 0 : 1] = (unsigned char)(u >> 8);
+   out[be ? 1 : 0] = (unsigned char)u;
+}
+
+static void put32(unsigned char *out, unsigned long u, int be) {
+
+   out[be ? 0 : 3] = (unsigned char)(u >> 24);
+   out[be ? 1 : 2] = (unsigned char)(u >> 16);
+   out[be ? 2 : 1] = (unsigned char)(u >> 8);
+   out[be ? 3 : 0] = (unsigned char)u;
+}
+
+/* ************************************************************************* */
+
+#ifdef __SSE2__
+
+/* loads 8 UTF-16 code units, swapping their bytes if they're big-endian */
+static __m128i load16(const unsigned char *s, int be) {
+
+   __m128i v = _mm_loadu_si128((const __m128i *)s);
+
+   if (be) {
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+   }
+
+   return v;
+}
+
+/* ...and 4 UTF-32 code units */
+static __m128i load32(const unsigned char *s, int be) {
+
+   __m128i v = _mm_loadu_si128((const __m128i *)s);
+
+   if (be) {
+      v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+   }
+
+   return v;
+}
+
+#endif
+
+/* ************************************************************************* */
+
+/* writes cp as UTF-8 and returns its length */
+static size_t utf8put(unsigned char *out, unsigned long cp) {
+
+   if (cp < 0x80) {
+      out[0] = (unsigned char)cp;
+      return 1;
+   }
+
+   if (cp < 0x800) {
+      out[0] = (unsigned char)(0xc0 | cp >> 6);
+      out[1] = (unsigned char)(0x80 | (cp & 0x3f));
+      return 2;
+   }
+
+   if (cp < 0x10000) {
+      out[0] = (unsigned char)(0xe0 | cp >> 12);
+      out[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+      out[2] = (unsigned char)(0x80 | (cp & 0x3f));
+      return 3;
+   }
+
+   out[0] = (unsigned char)(0xf0 | cp >> 18);
+   out[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3f));
+   out[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+   out[3] = (unsigned char)(0x80 | (cp & 0x3f));
+   return 4;
+}
+
+/* decodes the code point at s[*i], which must be valid UTF-8, and moves *i
+   past it */
+static unsigned long utf8get(const unsigned char *s, size_t *i) {
+
+   const unsigned char *p = s + *i;
+
+   if (p[0] < 0x80) {
+      *i += 1;
+      return p[0];
+   }
+
+   if (p[0] < 0xe0) {
+      *i += 2;
+      return (unsigned long)(p[0] & 0x1f) << 6 | (p[1] & 0x3f);
+   }
+
+   if (p[0] < 0xf0) {
+      *i += 3;
+      return (unsigned long)(p[0] & 0x0f) << 12 |
+         (unsigned long)(p[1] & 0x3f) << 6 | (p[2] & 0x3f);
+   }
+
+   *i += 4;
+   return (unsigned long)(p[0] & 0x07) << 18 |
+      (unsigned long)(p[1] & 0x3f) << 12 |
+      (unsigned long)(p[2] & 0x3f) << 6 | (p[3] & 0x3f);
+}
+
+/* ************************************************************************* */
+
+/* adds the length in UTF-8 of the code point at unit *i (of end) to *n and
+   moves *i past it; returns 0 if it's an unpaired surrogate that can't be
+   replaced */
+static int utf16step(const unsigned char *s, size_t *i, size_t end, int be,
+int replace, size_t *n) {
+
+   unsigned long u = get16(s, *i, be);
+
+   *i += 1;
+
+   if (u < 0x80) {
+      *n += 1;
+   } else if (u < 0x800) {
+      *n += 2;
+   } else if (0xd800 != (u & 0xf800)) {
+      *n += 3;
+   } else if (u < 0xdc00 && *i < end &&
+   0xdc00 == (get16(s, *i, be) & 0xfc00)) {
+      *n += 4;
+      *i += 1;
+   } else if (replace) {
+      *n += 3;
+   } else {
+      return 0;
+   }
+
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* returns the number of bytes of UTF-8 that the first *units code units of
+   s come to; a 0 ends the input early, and *units is set to where it was.
+   Returns TRANSCODE_INVALID if there's an unpaired surrogate and replace
+   isn't set. */
+static size_t utf16size(const unsigned char *s, size_t *units, int be,
+int replace) {
+
+   size_t i = 0, n = 0, end = *units, block;
+
+#ifdef __SSE2__
+
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i high5 = _mm_set1_epi16((short)0xf800);
+   const __m128i surrogates = _mm_set1_epi16((short)0xd800);
+   const __m128i max1 = _mm_set1_epi16(0x7f);
+   const __m128i max2 = _mm_set1_epi16(0x7ff);
+   __m128i v, m;
+
+   while (i + 8 <= end) {
+
+      v = load16(s + 2 * i, be);
+      m = _mm_or_si128(_mm_cmpeq_epi16(v, zero),
+         _mm_cmpeq_epi16(_mm_and_si128(v, high5), surrogates));
+
+      /* a surrogate or a 0 somewhere in here, so go one unit at a time */
+      if (0 != _mm_movemask_epi8(m)) {
+         for (block = i + 8; i < block && i < end;) {
+            if (0 == get16(s, i, be)) {
+               *units = i;
+               return n;
+            }
+            if (!utf16step(s, &i, end, be, replace, &n)) {
+               return TRANSCODE_INVALID;
+            }
+         }
+         continue;
+      }
+
+      /* each unit is 3 bytes, less one for each that's below 0x800 and one
+         more for each that's below 0x80 */
+      m = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_subs_epu16(v, max1), zero),
+         _mm_cmpeq_epi16(_mm_subs_epu16(v, max2), zero));
+      n += 24 - __builtin_popcount(_mm_movemask_epi8(m));
+      i += 8;
+   }
+
+#else
+
+   (void)block;
+
+#endif
+
+   while (i < end) {
+      if (0 == get16(s, i, be)) {
+         *units = i;
+         return n;
+      }
+      if (!utf16step(s, &i, end, be, replace, &n)) {
+         return TRANSCODE_INVALID;
+      }
+   }
+
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* writes the UTF-8 for units code units of s, which utf16size() has
+   already checked, and returns the number of bytes written */
+static size_t utf16decode(unsigned char *out, const unsigned char *s,
+size_t units, int be) {
+
+   unsigned char *start = out;
+   unsigned long  u, low;
+   size_t         i = 0, block;
+
+   while (i < units) {
+
+      block = units;
+
+#ifdef __SSE2__
+
+      if (i + 8 <= units) {
+
+         __m128i v = load16(s + 2 * i, be);
+
+         /* 8 ASCII characters at once */
+         if (0xffff == _mm_movemask_epi8(_mm_cmpeq_epi16(
+         _mm_subs_epu16(v, _mm_set1_epi16(0x7f)), _mm_setzero_si128()))) {
+            _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(v, v));
+            out += 8;
+            i += 8;
+            continue;
+         }
+
+         block = i + 8;
+      }
+
+#endif
+
+      /* the rest of the block (or of the input) one code point at a time;
+         a surrogate pair may run one unit past the end of the block */
+      while (i < block) {
+
+         u = get16(s, i++, be);
+
+         if (0xd800 == (u & 0xf800)) {
+            if (u < 0xdc00 && i < units &&
+            0xdc00 == ((low = get16(s, i, be)) & 0xfc00)) {
+               u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+               i++;
+            } else {
+               u = REPLACEMENT_CHAR;
+            }
+         }
+
+         out += utf8put(out, u);
+      }
+   }
+
+   return out - start;
+}
+
+/* ************************************************************************* */
+
+/* adds the length in UTF-8 of the UTF-32 unit u to *n; returns 0 if it
+   isn't a code point and can't be replaced */
+static int utf32step(unsigned long u, int replace, size_t *n) {
+
+   if (u < 0x80) {
+      *n += 1;
+   } else if (u < 0x800) {
+      *n += 2;
+   } else if (u < 0x10000 && 0xd800 != (u & 0xf800)) {
+      *n += 3;
+   } else if (u >= 0x10000 && u <= 0x10ffff) {
+      *n += 4;
+   } else if (replace) {
+      *n += 3;
+   } else {
+      return 0;
+   }
+
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* utf16size() for UTF-32 */
+static size_t utf32size(const unsigned char *s, size_t *units, int be,
+int replace) {
+
+   unsigned long u;
+   size_t        i = 0, n = 0, end = *units, block;
+
+   while (i < end) {
+
+      block = end;
+
+#ifdef __SSE2__
+
+      if (i + 4 <= end) {
+
+         const __m128i zero = _mm_setzero_si128();
+         __m128i v = load32(s + 4 * i, be);
+
+         /* 4 ASCII characters (and no 0) at once */
+         if (0xffff == _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v,
+         _mm_set1_epi32(~0x7f)), zero)) &&
+         0 == _mm_movemask_epi8(_mm_cmpeq_epi32(v, zero))) {
+            n += 4;
+            i += 4;
+            continue;
+         }
+
+         block = i + 4;
+      }
+
+#endif
+
+      for (; i < block; i++) {
+         if (0 == (u = get32(s, i, be))) {
+            *units = i;
+            return n;
+         }
+         if (!utf32step(u, replace, &n)) {
+            return TRANSCODE_INVALID;
+         }
+      }
+   }
+
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* utf16decode() for UTF-32 */
+static size_t utf32decode(unsigned char *out, const unsigned char *s,
+size_t units, int be) {
+
+   unsigned char *start = out;
+   unsigned long  u;
+   size_t         i = 0, block;
+
+   while (i < units) {
+
+      block = units;
+
+#ifdef __SSE2__
+
+      if (i + 4 <= units) {
+
+         __m128i v = load32(s + 4 * i, be);
+         int32_t ascii;
+
+         if (0xffff == _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v,
+         _mm_set1_epi32(~0x7f)), _mm_setzero_si128()))) {
+            v = _mm_packs_epi32(v, v);
+            ascii = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+            memcpy(out, &ascii, 4);
+            out += 4;
+            i += 4;
+            continue;
+         }
+
+         block = i + 4;
+      }
+
+#endif
+
+      for (; i < block; i++) {
+
+         u = get32(s, i, be);
+
+         if (u > 0x10ffff || (u < 0x10000 && 0xd800 == (u & 0xf800))) {
+            u = REPLACEMENT_CHAR;
+         }
+
+         out += utf8put(out, u);
+      }
+   }
+
+   return out - start;
+}
+
+/* ************************************************************************* */
+
+/* returns the number of bytes of UTF-8 that the first *len bytes of
+   Latin-1 come to; a 0 ends the input early, and *len is set to where it
+   was */
+static size_t latin1size(const unsigned char *s, size_t *len) {
+
+   size_t i = 0, n = 0;
+
+#ifdef __SSE2__
+
+   const __m128i zero = _mm_setzero_si128();
+   __m128i v;
+
+   /* everything from 0x80 up takes two bytes */
+   for (; i + 16 <= *len; i += 16) {
+
+      v = _mm_loadu_si128((const __m128i *)(s + i));
+
+      if (0 != _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) {
+         break;
+      }
+
+      n += 16 + __builtin_popcount(_mm_movemask_epi8(v));
+   }
+
+#endif
+
+   for (; i < *len; i++) {
+      if (0 == s[i]) {
+         *len = i;
+         break;
+      }
+      n += s[i] < 0x80 ? 1 : 2;
+   }
+
+   return n;
+}
+
+/* ************************************************************************* */
+
+/* writes the UTF-8 for len bytes of Latin-1 and returns its length */
+static size_t latin1decode(unsigned char *out, const unsigned char *s,
+size_t len) {
+
+   unsigned char *start = out;
+   size_t         i = 0, block;
+
+   while (i < len) {
+
+      block = len;
+
+#ifdef __SSE2__
+
+      if (i + 16 <= len) {
+
+         __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+         if (0 == _mm_movemask_epi8(v)) {
+            _mm_storeu_si128((__m128i *)out, v);
+            out += 16;
+            i += 16;
+            continue;
+         }
+
+         block = i + 16;
+      }
+
+#endif
+
+      for (; i < block; i++) {
+         if (s[i] < 0x80) {
+            *out++ = s[i];
+         } else {
+            *out++ = (unsigned char)(0xc0 | s[i] >> 6);
+            *out++ = (unsigned char)(0x80 | (s[i] & 0x3f));
+         }
+      }
+   }
+
+   return out - start;
+}
+
+/* ************************************************************************* */
+
+/* returns the number of UTF-16 code units needed for len bytes of valid
+   UTF-8 holding the given number of code points: one per code point, and
+   another for each one that starts with a 4 byte sequence */
+static size_t utf16units(const unsigned char *s, size_t len,
+size_t codepoints) {
+
+   size_t i = 0;
+
+#ifdef __SSE2__
+
+   const __m128i lead4 = _mm_set1_epi8((char)0xf0);
+   __m128i v;
+
+   for (; i + 16 <= len; i += 16) {
+      v = _mm_loadu_si128((const __m128i *)(s + i));
+      codepoints += __builtin_popcount(_mm_movemask_epi8(
+         _mm_cmpeq_epi8(_mm_max_epu8(v, lead4), v)));
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      if (s[i] >= 0xf0) {
+         codepoints++;
+      }
+   }
+
+   return codepoints;
+}
+
+/* ************************************************************************* */
+
+/* writes len bytes of valid UTF-8 as UTF-16 */
+static void utf16encode(unsigned char *out, const unsigned char *s,
+size_t len, int be) {
+
+   unsigned long cp;
+   size_t        i = 0, block;
+
+   while (i < len) {
+
+      block = len;
+
+#ifdef __SSE2__
+
+      if (i + 16 <= len) {
+
+         __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+         __m128i lo, hi;
+
+         /* 16 ASCII characters become 16 code units by adding a zero byte
+            to each one */
+         if (0 == _mm_movemask_epi8(v)) {
+            lo = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+            hi = _mm_unpackhi_epi8(v, _mm_setzero_si128());
+            if (be) {
+               lo = _mm_or_si128(_mm_slli_epi16(lo, 8), _mm_srli_epi16(lo, 8));
+               hi = _mm_or_si128(_mm_slli_epi16(hi, 8), _mm_srli_epi16(hi, 8));
+            }
+            _mm_storeu_si128((__m128i *)out, lo);
+            _mm_storeu_si128((__m128i *)(out + 16), hi);
+            out += 32;
+            i += 16;
+            continue;
+         }
+
+         block = i + 16;
+      }
+
+#endif
+
+      while (i < block) {
+
+         cp = utf8get(s, &i);
+
+         if (cp < 0x10000) {
+            put16(out, cp, be);
+            out += 2;
+         } else {
+            cp -= 0x10000;
+            put16(out, 0xd800 | cp >> 10, be);
+            put16(out + 2, 0xdc00 | (cp & 0x3ff), be);
+            out += 4;
+         }
+      }
+   }
+}
+
+/* ************************************************************************* */
+
+/* writes len bytes of valid UTF-8 as UTF-32 */
+static void utf32encode(unsigned char *out, const unsigned char *s,
+size_t len, int be) {
+
+   size_t i = 0, block, k;
+
+   while (i < len) {
+
+      block = len;
+
+#ifdef __SSE2__
+
+      if (i + 16 <= len) {
+
+         const __m128i zero = _mm_setzero_si128();
+         __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+         __m128i half[2], unit;
+
+         if (0 == _mm_movemask_epi8(v)) {
+
+            half[0] = _mm_unpacklo_epi8(v, zero);
+            half[1] = _mm_unpackhi_epi8(v, zero);
+
+            for (k = 0; k < 4; k++) {
+               unit = k & 1 ? _mm_unpackhi_epi16(half[k / 2], zero) :
+                  _mm_unpacklo_epi16(half[k / 2], zero);
+               if (be) {
+                  unit = _mm_slli_epi32(unit, 24);
+               }
+               _mm_storeu_si128((__m128i *)(out + 16 * k), unit);
+            }
+
+            out += 64;
+            i += 16;
+            continue;
+         }
+
+         block = i + 16;
+      }
+
+#else
+
+      (void)k;
+
+#endif
+
+      while (i < block) {
+         put32(out, utf8get(s, &i), be);
+         out += 4;
+      }
+   }
+}
+
+/* ************************************************************************* */
+
+/* returns 1 if every code point in len bytes of valid UTF-8 is in Latin-1
+   (so nothing starts with a byte above 0xc3) and 0 if not */
+static int latin1check(const unsigned char *s, size_t len) {
+
+   size_t i = 0;
+
+#ifdef __SSE2__
+
+   const __m128i above = _mm_set1_epi8((char)0xc4);
+   __m128i v;
+
+   for (; i + 16 <= len; i += 16) {
+      v = _mm_loadu_si128((const __m128i *)(s + i));
+      if (0 != _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, above), v))) {
+         return 0;
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      if (s[i] >= 0xc4) {
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* writes len bytes of valid UTF-8 as Latin-1 */
+static void latin1encode(unsigned char *out, const unsigned char *s,
+size_t len) {
+
+   unsigned long cp;
+   size_t        i = 0, block;
+
+   while (i < len) {
+
+      block = len;
+
+#ifdef __SSE2__
+
+      if (i + 16 <= len) {
+
+         __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+         if (0 == _mm_movemask_epi8(v)) {
+            _mm_storeu_si128((__m128i *)out, v);
+            out += 16;
+            i += 16;
+            continue;
+         }
+
+         block = i + 16;
+      }
+
+#endif
+
+      while (i < block) {
+         cp = utf8get(s, &i);
+         *out++ = cp > 0xff ? REPLACEMENT_LATIN1 : (unsigned char)cp;
+      }
+   }
+}
@@ -0,0 +1,390 @@
+
+/* ************************************************************************* *\
+   * File: url.c                                                           *
+   * Purpose:                                                              *
+   *    Provides functions for percent-encoding and decoding URLs and for  *
+   *    picking apart query strings                                        *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* what *index is set to once the last parameter has been returned */
+#define QUERY_DONE ((size_t)-1)
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+static int    urlkeep(unsigned char c, int flags);
+static size_t urlscan(const char *s, size_t i, size_t len, int flags);
+static size_t urldecode(char *s, size_t len, int flags);
+static int    hexvalue(char c);
+
+/* ************************************************************************* */
+
+size_t dstrcaturlencode(dstring_t dest, const char *src, int flags) {
+
+   const unsigned char *s = (const unsigned char *)src;
+   size_t  len, n, i = 0, start, newsize;
+   char   *out;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(dest)) {
+      return 0;
+   }
+
+   if (NULL == src) {
+      _setdstrerrno(DSTR_NULL_CPTR);
+      return 0;
+   }
+
+   len = strlen(src);
+   n = len;
+
+   /* first, count the characters that turn into three */
+#ifdef __SSE2__
+
+   {
+      __m128i v, letter, digit, keep;
+
+      for (; i + 16 <= len; i += 16) {
+
+         v = _mm_loadu_si128((const __m128i *)(src + i));
+
+         /* unsigned range checks: x <= 9 if min(x, 9) == x */
+         letter = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+            _mm_set1_epi8('a'));
+         digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+
+         keep = _mm_or_si128(
+            _mm_or_si128(
+               _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)),
+                  letter),
+               _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit)),
+            _mm_or_si128(
+               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')),
+                  _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))),
+               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')),
+                  _mm_cmpeq_epi8(v, _mm_set1_epi8('~')))));
+
+         if (flags & DSTR_URL_FORM) {
+            keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+         }
+
+         if (flags & DSTR_URL_PATH) {
+            keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+         }
+
+         n += 2 * (16 - __builtin_popcount(_mm_movemask_epi8(keep)));
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      if (!urlkeep(s[i], flags)) {
+         n += 2;
+      }
+   }
+
+   start = dstrlen(dest);
+
+   /* grow geometrically, so appending piece by piece stays linear */
+   if (DSTRBUFLEN(dest) < start + n + 1) {
+      newsize = DSTRBUFLEN(dest) * 2;
+      if (newsize < start + n + 1) {
+         newsize = start + n + 1;
+      }
+      if (DSTR_SUCCESS != dstrealloc(&dest, newsize)) {
+         return 0;
+      }
+   }
+
+   out = DSTRBUF(dest) + start;
+
+   /* nothing needs escaping, which is common enough to be worth it */
+   if (n == len && !(flags & DSTR_URL_FORM)) {
+      memcpy(out, src, len + 1);
+      _setdstrerrno(DSTR_SUCCESS);
+      return n;
+   }
+
+   for (i = 0; i < len; i++) {
+      if (' ' == s[i] && flags & DSTR_URL_FORM) {
+         *out++ = '+';
+      } else if (urlkeep(s[i], flags)) {
+         *out++ = s[i];
+      } else {
+         *out++ = '%';
+         *out++ = hexdigits[s[i] >> 4];
+         *out++ = hexdigits[s[i] & 15];
+      }
+   }
+
+   *out = '\0';
+   _setdstrerrno(DSTR_SUCCESS);
+   return n;
+}
+
+/* ************************************************************************* */
+
+size_t dstrurldecode(dstring_t str, int flags) {
+
+   size_t len;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
+   len = urldecode(DSTRBUF(str), dstrlen(str), flags);
+   DSTRBUF(str)[len] = '\0';
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return len;
+}
+
+/* ************************************************************************* */
+
+size_t dstrurldecodefield(dstring_t str, dstrfield_t *field, int flags) {
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
+   if (NULL == field) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   if (field->offset > DSTRBUFLEN(str) ||
+   field->length >= DSTRBUFLEN(str) - field->offset) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return 0;
+   }
+
+   field->length = urldecode(DSTRBUF(str) + field->offset, field->length,
+      flags);
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return field->length;
+}
+
+/* ************************************************************************* */
+
+int dstrquerynext(const dstring_t str, size_t *index, dstrfield_t *key,
+dstrfield_t *value) {
+
+   const char *buf, *eq;
+   size_t      i, end;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (NULL == index || NULL == key || NULL == value) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return 0;
+   }
+
+   if (QUERY_DONE == *index) {
+      _setdstrerrno(DSTR_EOF);
+      return 0;
+   }
+
+   if (*index >= DSTRBUFLEN(str)) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return 0;
+   }
+
+   buf = DSTRBUF(str);
+
+   for (i = *index; ; i = end + 1) {
+
+      /* the query string ends at the fragment, if there is one */
+      end = i + strcspn(buf + i, "&#");
+
+      /* skip empty parameters, as in "a=1&&b=2" */
+      if (end > i) {
+         break;
+      }
+
+      if ('&' != buf[end]) {
+         *index = QUERY_DONE;
+         _setdstrerrno(DSTR_EOF);
+         return 0;
+      }
+   }
+
+   /* a parameter without an '=' has an empty value */
+   key->offset = i;
+   if (NULL != (eq = memchr(buf + i, '=', end - i))) {
+      key->length = eq - (buf + i);
+      value->offset = key->offset + key->length + 1;
+      value->length = end - value->offset;
+   } else {
+      key->length = end - i;
+      value->offset = end;
+      value->length = 0;
+   }
+
+   *index = '&' == buf[end] ? end + 1 : QUERY_DONE;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* returns true if c can appear in a URL as it is: letters, digits and
+   "-._~" (RFC 3986's unreserved characters), plus ' ' (which becomes '+')
+   and '/' if the flags say so - FOR INTERNAL USE ONLY! */
+static int urlkeep(unsigned char c, int flags) {
+
+   if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+   (c >= '0' && c <= '9') || '-' == c || '.' == c || '_' == c || '~' == c) {
+      return 1;
+   }
+
+   return (' ' == c && flags & DSTR_URL_FORM) ||
+      ('/' == c && flags & DSTR_URL_PATH);
+}
+
+/* ************************************************************************* */
+
+/* returns the index of the first '%' (or '+', for forms) at or after s[i],
+   or len if there isn't one - FOR INTERNAL USE ONLY! */
+static size_t urlscan(const char *s, size_t i, size_t len, int flags) {
+
+   char plus = flags & DSTR_URL_FORM ? '+' : '%';
+
+#ifdef __SSE2__
+
+   {
+      __m128i v;
+      int     mask;
+
+      for (; i + 16 <= len; i += 16) {
+         v = _mm_loadu_si128((const __m128i *)(s + i));
+         mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('%')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8(plus))));
+         if (0 != mask) {
+            return i + __builtin_ctz(mask);
+         }
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      if ('%' == s[i] || plus == s[i]) {
+         return i;
+      }
+   }
+
+   return len;
+}
+
+/* ************************************************************************* */
+
+/* decodes len characters of s in place and returns the new length; nothing
+   is written until the first escape, and the text between escapes is moved
+   down a run at a time - FOR INTERNAL USE ONLY! */
+static size_t urldecode(char *s, size_t len, int flags) {
+
+   size_t r, w, next;
+   int    hi, lo;
+
+   r = w = urlscan(s, 0, len, flags);
+
+   while (r < len) {
+
+      if ('+' == s[r] && flags & DSTR_URL_FORM) {
+         s[w++] = ' ';
+         r++;
+         continue;
+      }
+
+      /* broken escapes, and %00 (a dstring_t can't hold a '\0'), are left
+         the way they are */
+      if ('%' == s[r] && r + 2 < len && -1 != (hi = hexvalue(s[r + 1])) &&
+      -1 != (lo = hexvalue(s[r + 2])) && (hi | lo)) {
+         s[w++] = (char)(hi << 4 | lo);
+         r += 3;
+         continue;
+      }
+
+      next = urlscan(s, r + 1, len, flags);
+      memmove(s + w, s + r, next - r);
+      w += next - r;
+      r = next;
+   }
+
+   return w;
+}
+
+/* ************************************************************************* */
+
+/* returns the value of a hex digit, or -1 - FOR INTERNAL USE ONLY! */
+static int hexvalue(char c) {
+
+   if (c >= '0' && c <= '9') {
+      return c - '0';
+   }
+
+   c |= 0x20;
+   if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+   }
+
+   return -1;
+}
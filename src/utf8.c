@@ -0,0 +1,747 @@
+
+/* ************************************************************************* *\
+   * File: utf8.c                                                          *
+   * Purpose:                                                              *
+   *    Provides functions that validate the UTF-8 in a dstring_t and      *
+   *    count its code points                                              *
+   *************************************************************************
+   * Project:    DString                                                   *
+   * Programmer: James Colannino                                           *
+   * Email:      james@colannino.org                                       *
+   * Homepage:   http://james.colannino.org/                               *
+   *                                                                       *
+   * Description:                                                          *
+   *     The purpose of this library is to provide facilities for easily   *
+   * dealing with dynamically allocated strings.                           *
+   *************************************************************************
+   * DString Library Copyright 2006 by James Colannino                     *
+   *                                                                       *
+   * This program is free software; you can redistribute it and/or         *
+   * modify it under the terms of the GNU Lesser General Public            *
+   * License as published by the Free Software Foundation; either          *
+   * version 2.1 of the License, or (at your option) any later version.    *
+   *                                                                       *
+   * This program is distributed in the hope that it will be useful,       *
+   * but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+   * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+   * Lesser General Public License for more details.                       *
+   *                                                                       *
+   * You should have received a copy of the GNU Lesser General Public      *
+   * License along with this library; if not, write to:                    *
+   *                                                                       *
+   * The Free Software Foundation, Inc.                                    *
+   * 51 Franklin St, Fifth Floor                                           *
+   * Boston, MA 02110-1301 USA                                             *
+\* ************************************************************************* */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "static.h"
+#include "dstring.h"
+
+/* the high bit of every byte in a word, for spotting anything that isn't
+   ASCII eight bytes at a time */
+#define SWAR_HIGHS ((uint64_t)0x8080808080808080ULL)
+
+/* the length of a UTF-8 sequence, given the high nibble of its first byte
+   (0 for a continuation byte) */
+static const unsigned char utf8lengths[16] = {
+   1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 2, 2, 3, 4
+};
+
+static void   utf8cache(const dstring_t str);
+static int    cplocate(const dstring_t str, size_t n, size_t *offset);
+static void   cpindexbuild(const dstring_t str);
+static long   cpdecode(const unsigned char *s, size_t *length);
+static int    utf8check(const unsigned char *s, size_t len, size_t *count);
+#ifndef __SSSE3__
+static size_t utf8seq(const unsigned char *s, size_t i, size_t len);
+#endif
+
+/* ************************************************************************* */
+
+int dstrisutf8(const dstring_t str) {
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!(DSTRREF(str)->cached & DSTR_CACHE_UTF8CHECKED)) {
+      utf8cache(str);
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return 0 != (DSTRREF(str)->cached & DSTR_CACHE_UTF8);
+}
+
+/* ************************************************************************* */
+
+size_t dstrutf8len(const dstring_t str) {
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (!(DSTRREF(str)->cached & DSTR_CACHE_UTF8CHECKED)) {
+      utf8cache(str);
+   }
+
+   if (!(DSTRREF(str)->cached & DSTR_CACHE_UTF8)) {
+      _setdstrerrno(DSTR_INVALID_UTF8);
+      return 0;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTRREF(str)->codepoints;
+}
+
+/* ************************************************************************* */
+
+size_t dstrcpoffset(const dstring_t str, size_t n) {
+
+   size_t offset;
+   int    status;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return 0;
+   }
+
+   if (DSTR_SUCCESS != (status = cplocate(str, n, &offset))) {
+      _setdstrerrno(status);
+      return 0;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return offset;
+}
+
+/* ************************************************************************* */
+
+long dstrgetcp(const dstring_t str, size_t n) {
+
+   size_t offset, length;
+   int    status;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return -1;
+   }
+
+   if (DSTR_SUCCESS != (status = cplocate(str, n, &offset))) {
+      _setdstrerrno(status);
+      return -1;
+   }
+
+   /* as with dstrgetc(), the '\0' is out of bounds */
+   if (n == DSTRREF(str)->codepoints) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return -1;
+   }
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return cpdecode((const unsigned char *)DSTRBUF(str) + offset, &length);
+}
+
+/* ************************************************************************* */
+
+int dstrinsertcp(dstring_t dest, size_t n, long cp) {
+
+   unsigned char seq[4];
+   size_t        offset, len, length, codepoints, newsize;
+   int           status;
+
+   if (NULL == dest) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return DSTR_UNINITIALIZED;
+   }
+
+   /* a pool's strings can't be changed, and cplocate() needs the cache */
+   if (DSTRREF(dest)->flags & DSTR_FLAG_POOLED) {
+      _setdstrerrno(DSTR_READONLY);
+      return DSTR_READONLY;
+   }
+
+   /* '\0' can't be inserted, and surrogates and anything beyond U+10FFFF
+      aren't code points that UTF-8 can hold */
+   if (cp <= 0 || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+      _setdstrerrno(DSTR_INVALID_ARGUMENT);
+      return DSTR_INVALID_ARGUMENT;
+   }
+
+   if (DSTR_SUCCESS != (status = cplocate(dest, n, &offset))) {
+      _setdstrerrno(status);
+      return status;
+   }
+
+   if (cp < 0x80) {
+      seq[0] = (unsigned char)cp;
+      length = 1;
+   } else if (cp < 0x800) {
+      seq[0] = (unsigned char)(0xc0 | cp >> 6);
+      seq[1] = (unsigned char)(0x80 | (cp & 0x3f));
+      length = 2;
+   } else if (cp < 0x10000) {
+      seq[0] = (unsigned char)(0xe0 | cp >> 12);
+      seq[1] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+      seq[2] = (unsigned char)(0x80 | (cp & 0x3f));
+      length = 3;
+   } else {
+      seq[0] = (unsigned char)(0xf0 | cp >> 18);
+      seq[1] = (unsigned char)(0x80 | (cp >> 12 & 0x3f));
+      seq[2] = (unsigned char)(0x80 | (cp >> 6 & 0x3f));
+      seq[3] = (unsigned char)(0x80 | (cp & 0x3f));
+      length = 4;
+   }
+
+   codepoints = DSTRREF(dest)->codepoints;
+   len = offset + strlen(DSTRBUF(dest) + offset);
+
+   /* grow geometrically, so inserting one code point at a time stays
+      linear in the number of reallocations */
+   if (DSTRBUFLEN(dest) < len + length + 1) {
+      newsize = DSTRBUFLEN(dest) * 2;
+      if (newsize < len + length + 1) {
+         newsize = len + length + 1;
+      }
+      if (DSTR_SUCCESS != (status = dstrealloc(&dest, newsize))) {
+         return status;
+      }
+   }
+
+   memmove(DSTRBUF(dest) + offset + length, DSTRBUF(dest) + offset,
+      len - offset + 1);
+   memcpy(DSTRBUF(dest) + offset, seq, length);
+
+   /* the index is out of date, but the string is still UTF-8 */
+   DSTRDIRTY(dest);
+   DSTRREF(dest)->codepoints = codepoints + 1;
+   DSTRREF(dest)->cached = DSTR_CACHE_UTF8CHECKED | DSTR_CACHE_UTF8;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+long dstrdelcp(dstring_t str, size_t n) {
+
+   unsigned char *s;
+   size_t         offset, length;
+   long           cp;
+   int            status;
+
+   if (NULL == str) {
+      _setdstrerrno(DSTR_UNINITIALIZED);
+      return -1;
+   }
+
+   /* a pool's strings can't be changed */
+   if (DSTRREF(str)->flags & DSTR_FLAG_POOLED) {
+      _setdstrerrno(DSTR_READONLY);
+      return -1;
+   }
+
+   if (DSTR_SUCCESS != (status = cplocate(str, n, &offset))) {
+      _setdstrerrno(status);
+      return -1;
+   }
+
+   if (n == DSTRREF(str)->codepoints) {
+      _setdstrerrno(DSTR_OUT_OF_BOUNDS);
+      return -1;
+   }
+
+   s = (unsigned char *)DSTRBUF(str) + offset;
+   cp = cpdecode(s, &length);
+   memmove(s, s + length, strlen((char *)s + length) + 1);
+
+   DSTRDIRTY(str);
+   DSTRREF(str)->codepoints--;
+   DSTRREF(str)->cached = DSTR_CACHE_UTF8CHECKED | DSTR_CACHE_UTF8;
+
+   _setdstrerrno(DSTR_SUCCESS);
+   return cp;
+}
+
+/* ************************************************************************* */
+
+/* finds the byte offset of code point n (or the length of str, if n is the
+   number of code points), building str's index if it doesn't have one;
+   returns a status code - FOR INTERNAL USE ONLY! */
+static int cplocate(const dstring_t str, size_t n, size_t *offset) {
+
+   const unsigned char *s = (const unsigned char *)DSTRBUF(str);
+   size_t               i = 0;
+
+   if (!(DSTRREF(str)->cached & DSTR_CACHE_UTF8CHECKED)) {
+      utf8cache(str);
+   }
+
+   if (!(DSTRREF(str)->cached & DSTR_CACHE_UTF8)) {
+      return DSTR_INVALID_UTF8;
+   }
+
+   if (n > DSTRREF(str)->codepoints) {
+      return DSTR_OUT_OF_BOUNDS;
+   }
+
+   /* short strings aren't worth an index */
+   if (DSTRREF(str)->codepoints >= DSTR_CPINDEX_STEP) {
+
+      /* a pool's string was given its index (if there was memory for
+         one) when it was interned, and mustn't be written to since */
+      if (!(DSTRREF(str)->cached & DSTR_CACHE_CPINDEX) &&
+      !(DSTRREF(str)->flags & DSTR_FLAG_POOLED)) {
+         cpindexbuild(str);
+      }
+
+      /* if there wasn't enough memory for one, we just start at the
+         beginning */
+      if (DSTRREF(str)->cached & DSTR_CACHE_CPINDEX) {
+         i = DSTRREF(str)->cpindex[n / DSTR_CPINDEX_STEP];
+         n %= DSTR_CPINDEX_STEP;
+      }
+   }
+
+#ifdef __SSE2__
+
+   /* skip whole blocks of 16 bytes while they don't go past the code point
+      we want (or the end of the string) */
+   {
+      const __m128i lastcont = _mm_set1_epi8((char)0xbf);
+      const __m128i zero = _mm_setzero_si128();
+      __m128i       v;
+      size_t        pop;
+
+      while (i + 16 <= DSTRBUFLEN(str)) {
+         v = _mm_loadu_si128((const __m128i *)(s + i));
+         pop = __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(v,
+            lastcont)));
+         if (pop > n || 0 != _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) {
+            break;
+         }
+         i += 16;
+         n -= pop;
+      }
+   }
+
+   /* the last block skipped may have ended partway through a sequence */
+   while (0x80 == (s[i] & 0xc0)) {
+      i++;
+   }
+
+#endif
+
+   /* the string is known to be UTF-8, so each sequence's first byte says
+      how long it is */
+   for (; n > 0; n--) {
+      i += utf8lengths[s[i] >> 4];
+   }
+
+   *offset = i;
+   return DSTR_SUCCESS;
+}
+
+/* ************************************************************************* */
+
+/* records the byte offset of code points 0, DSTR_CPINDEX_STEP,
+   2 * DSTR_CPINDEX_STEP and so on (up to and including the number of code
+   points, if it's a multiple) in str's index */
+static void cpindexbuild(const dstring_t str) {
+
+   const unsigned char *s = (const unsigned char *)DSTRBUF(str);
+   size_t              *index, entries, len, i = 0, count = 0, next, k = 0;
+
+   entries = DSTRREF(str)->codepoints / DSTR_CPINDEX_STEP + 1;
+
+   if (DSTRREF(str)->cpindexsize < entries) {
+      if (NULL == (index = realloc(DSTRREF(str)->cpindex,
+      entries * sizeof(size_t)))) {
+         return;
+      }
+      DSTRREF(str)->cpindex = index;
+      DSTRREF(str)->cpindexsize = entries;
+   }
+
+   index = DSTRREF(str)->cpindex;
+   index[0] = 0;
+   next = DSTR_CPINDEX_STEP;
+   len = strlen((const char *)s);
+
+#ifdef __SSE2__
+
+   /* count the bytes that begin a code point 16 at a time; since a block
+      can't hold DSTR_CPINDEX_STEP of them, at most one entry is in each */
+   {
+      const __m128i lastcont = _mm_set1_epi8((char)0xbf);
+      int           mask, pop, skip;
+
+      for (; i + 16 <= len; i += 16) {
+
+         mask = _mm_movemask_epi8(_mm_cmpgt_epi8(
+            _mm_loadu_si128((const __m128i *)(s + i)), lastcont));
+         pop = __builtin_popcount(mask);
+
+         if (count + pop > next) {
+            for (skip = (int)(next - count); skip > 0; skip--) {
+               mask &= mask - 1;
+            }
+            index[++k] = i + __builtin_ctz(mask);
+            next += DSTR_CPINDEX_STEP;
+         }
+
+         count += pop;
+      }
+   }
+
+#endif
+
+   for (; i < len; i++) {
+      if (0x80 != (s[i] & 0xc0)) {
+         if (count == next) {
+            index[++k] = i;
+            next += DSTR_CPINDEX_STEP;
+         }
+         count++;
+      }
+   }
+
+   if (count == next) {
+      index[++k] = len;
+   }
+
+   DSTRREF(str)->cached |= DSTR_CACHE_CPINDEX;
+}
+
+/* ************************************************************************* */
+
+/* decodes the (known to be valid) sequence at s and stores its length */
+static long cpdecode(const unsigned char *s, size_t *length) {
+
+   switch (*length = utf8lengths[s[0] >> 4]) {
+
+      case 1:
+         return s[0];
+
+      case 2:
+         return (long)(s[0] & 0x1f) << 6 | (s[1] & 0x3f);
+
+      case 3:
+         return (long)(s[0] & 0x0f) << 12 | (long)(s[1] & 0x3f) << 6 |
+            (s[2] & 0x3f);
+
+      default:
+         return (long)(s[0] & 0x07) << 18 | (long)(s[1] & 0x3f) << 12 |
+            (long)(s[2] & 0x3f) << 6 | (s[3] & 0x3f);
+   }
+}
+
+/* ************************************************************************* */
+
+/* works out everything the functions above would remember about str,
+   including its index if it's long enough to need one; this is done for a
+   pool's string before anyone else can see it - FOR INTERNAL USE ONLY! */
+void _dstrutf8cache(dstr *str) {
+
+   utf8cache(str);
+
+   if ((DSTRREF(str)->cached & DSTR_CACHE_UTF8) &&
+   DSTRREF(str)->codepoints >= DSTR_CPINDEX_STEP) {
+      cpindexbuild(str);
+   }
+}
+
+/* ************************************************************************* */
+
+/* checks str and remembers the answer (and, if it's UTF-8, the number of
+   code points) until it changes */
+static void utf8cache(const dstring_t str) {
+
+   size_t count;
+
+   if (utf8check((const unsigned char *)DSTRBUF(str), strlen(DSTRBUF(str)),
+   &count)) {
+      DSTRREF(str)->codepoints = count;
+      DSTRREF(str)->cached |= DSTR_CACHE_UTF8CHECKED | DSTR_CACHE_UTF8;
+   } else {
+      DSTRREF(str)->cached |= DSTR_CACHE_UTF8CHECKED;
+   }
+}
+
+/* ************************************************************************* */
+
+#ifdef __SSSE3__
+
+/* The lookup-table validator of Keiser and Lemire ("Validating UTF-8 In
+   Less Than One Instruction Per Byte", 2021).  Every error in UTF-8 can be
+   seen in some pair of adjacent bytes (the high nibble of the first, its
+   low nibble and the high nibble of the second), except for a missing or
+   extra third or fourth byte, which is caught by comparing where 3 and 4
+   byte sequences began against where continuation bytes are.  Each nibble
+   looks up, with _mm_shuffle_epi8(), the set of errors it could be part
+   of, and a pair of bytes is an error if all three agree. */
+
+#define TOO_SHORT      (1 << 0)  /* 11______ 0_______ or 11______ 11______ */
+#define TOO_LONG       (1 << 1)  /* 0_______ 10______ */
+#define OVERLONG_3     (1 << 2)  /* 11100000 100_____ */
+#define TOO_LARGE      (1 << 3)  /* 11110100 1001____ and up */
+#define SURROGATE      (1 << 4)  /* 11101101 101_____ */
+#define OVERLONG_2     (1 << 5)  /* 1100000_ 10______ */
+#define TOO_LARGE_1000 (1 << 6)  /* 11110101 1000____ and up */
+#define OVERLONG_4     (1 << 6)  /* 11110000 1000____ */
+#define TWO_CONTS      (1 << 7)  /* 10______ 10______ */
+#define CARRY          (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+/* the high nibble of each byte */
+#define HIGHNIBBLES(V) \
+   _mm_and_si128(_mm_srli_epi16((V), 4), _mm_set1_epi8(0x0f))
+
+/* returns the errors in each 16 bytes of input, given the 16 before them */
+static __m128i utf8block(__m128i input, __m128i prev) {
+
+   const __m128i byte1high = _mm_setr_epi8(
+      TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+      TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+      TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+      TOO_SHORT | OVERLONG_2,
+      TOO_SHORT,
+      TOO_SHORT | OVERLONG_3 | SURROGATE,
+      TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+
+   const __m128i byte1low = _mm_setr_epi8(
+      CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+      CARRY | OVERLONG_2,
+      CARRY,
+      CARRY,
+      CARRY | TOO_LARGE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+      CARRY | TOO_LARGE | TOO_LARGE_1000,
+      CARRY | TOO_LARGE | TOO_LARGE_1000);
+
+   const __m128i byte2high = _mm_setr_epi8(
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+         OVERLONG_4,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+      TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+   __m128i prev1, prev2, prev3, special, must23;
+
+   prev1 = _mm_alignr_epi8(input, prev, 15);
+   prev2 = _mm_alignr_epi8(input, prev, 14);
+   prev3 = _mm_alignr_epi8(input, prev, 13);
+
+   special = _mm_and_si128(_mm_and_si128(
+      _mm_shuffle_epi8(byte1high, HIGHNIBBLES(prev1)),
+      _mm_shuffle_epi8(byte1low, _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+      _mm_shuffle_epi8(byte2high, HIGHNIBBLES(input)));
+
+   /* the high bit is set where a byte must be the third or fourth of a
+      sequence, which is where the tables above see two continuations */
+   must23 = _mm_or_si128(
+      _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xe0 - 0x80))),
+      _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xf0 - 0x80))));
+
+   return _mm_xor_si128(special,
+      _mm_and_si128(must23, _mm_set1_epi8((char)0x80)));
+}
+
+/* ************************************************************************* */
+
+/* returns 1 if the first len bytes of s are valid UTF-8 and 0 if not, and
+   stores the number of code points in *count if they are */
+static int utf8check(const unsigned char *s, size_t len, size_t *count) {
+
+   /* the most each of the last three bytes of a block can be without
+      needing bytes from the next block */
+   const __m128i maxtail = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, (char)(0xf0 - 1), (char)(0xe0 - 1),
+      (char)(0xc0 - 1));
+
+   /* bytes greater than this (as signed chars) begin a code point */
+   const __m128i lastcont = _mm_set1_epi8((char)0xbf);
+
+   __m128i       input, prev = _mm_setzero_si128();
+   __m128i       error = _mm_setzero_si128(), incomplete = error;
+   unsigned char tail[16];
+   size_t        i, n = 0;
+   int           mask;
+
+   for (i = 0; i + 16 <= len; i += 16) {
+
+      input = _mm_loadu_si128((const __m128i *)(s + i));
+      mask = _mm_movemask_epi8(input);
+
+      /* ASCII can't be an error, unless the last block left a sequence
+         unfinished */
+      if (0 == mask) {
+         error = _mm_or_si128(error, incomplete);
+         incomplete = _mm_setzero_si128();
+         n += 16;
+      }
+
+      else {
+         error = _mm_or_si128(error, utf8block(input, prev));
+         incomplete = _mm_subs_epu8(input, maxtail);
+         n += __builtin_popcount(_mm_movemask_epi8(
+            _mm_cmpgt_epi8(input, lastcont)));
+      }
+
+      prev = input;
+   }
+
+   /* whatever's left is padded with zeros, which are ASCII and can't hide
+      an unfinished sequence */
+   if (i < len) {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, s + i, len - i);
+      input = _mm_loadu_si128((const __m128i *)tail);
+      error = _mm_or_si128(error, utf8block(input, prev));
+      n += __builtin_popcount(_mm_movemask_epi8(
+         _mm_cmpgt_epi8(input, lastcont)) & ((1 << (len - i)) - 1));
+      incomplete = _mm_setzero_si128();
+   }
+
+   error = _mm_or_si128(error, incomplete);
+
+   if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(error,
+   _mm_setzero_si128()))) {
+      return 0;
+   }
+
+   *count = n;
+   return 1;
+}
+
+#else
+
+/* ************************************************************************* */
+
+/* returns 1 if the first len bytes of s are valid UTF-8 and 0 if not, and
+   stores the number of code points in *count if they are; runs of ASCII
+   are skipped a block at a time, and everything else is checked one
+   sequence at a time */
+static int utf8check(const unsigned char *s, size_t len, size_t *count) {
+
+   size_t i = 0, end, n = 0, seq;
+
+   while (i < len) {
+
+#ifdef __SSE2__
+
+      while (i + 16 <= len && 0 == _mm_movemask_epi8(
+      _mm_loadu_si128((const __m128i *)(s + i)))) {
+         i += 16;
+         n += 16;
+      }
+
+      end = i + 16;
+
+#else
+
+      {
+         uint64_t w;
+
+         for (; i + 8 <= len; i += 8, n += 8) {
+            memcpy(&w, s + i, 8);
+            if (w & SWAR_HIGHS) {
+               break;
+            }
+         }
+      }
+
+      end = i + 8;
+
+#endif
+
+      /* the block that wasn't all ASCII (or the end of the string) */
+      if (end > len) {
+         end = len;
+      }
+
+      while (i < end) {
+         if (0 == (seq = utf8seq(s, i, len))) {
+            return 0;
+         }
+         i += seq;
+         n++;
+      }
+   }
+
+   *count = n;
+   return 1;
+}
+
+/* ************************************************************************* */
+
+/* returns the length of the well-formed UTF-8 sequence (RFC 3629) that
+   begins at s[i], or 0 if there isn't one */
+static size_t utf8seq(const unsigned char *s, size_t i, size_t len) {
+
+   unsigned char c = s[i], lo = 0x80, hi = 0xbf;
+   size_t        n, k;
+
+   if (c < 0x80) {
+      return 1;
+   } else if (c < 0xc2) {
+      return 0;                          /* continuation, or overlong */
+   } else if (c < 0xe0) {
+      n = 2;
+   } else if (c < 0xf0) {
+      n = 3;
+      if (0xe0 == c) {
+         lo = 0xa0;                      /* overlong */
+      } else if (0xed == c) {
+         hi = 0x9f;                      /* surrogate */
+      }
+   } else if (c < 0xf5) {
+      n = 4;
+      if (0xf0 == c) {
+         lo = 0x90;                      /* overlong */
+      } else if (0xf4 == c) {
+         hi = 0x8f;                      /* beyond U+10FFFF */
+      }
+   } else {
+      return 0;
+   }
+
+   if (len - i < n || s[i + 1] < lo || s[i + 1] > hi) {
+      return 0;
+   }
+
+   for (k = 2; k < n; k++) {
+      if ((s[i + k] & 0xc0) != 0x80) {
+         return 0;
+      }
+   }
+
+   return n;
+}
+
+#endif
@@ -72,6 +72,10 @@ int dstrtrunc(dstring_t str, size_t size) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
    /* get the length of the string */
    length = dstrlen(str);
 
@@ -110,6 +114,10 @@ int dstrtruncleft(dstring_t str, size_t n) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
    /* get the length of the string */
    length = dstrlen(str);
 
@@ -152,6 +160,10 @@ int dstrdel(dstring_t str, size_t index) {
       return -1;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return -1;
+   }
+
    /* check to see if the index is out of bounds */
    if (index >= dstrlen(str)) {
       _setdstrerrno(DSTR_OUT_OF_BOUNDS);
@@ -183,6 +195,10 @@ int dstrndel(dstring_t str, size_t index, size_t n) {
       return dstrlen(str);
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return strlen(DSTRBUF(str));
+   }
+
    /* check to see if the index is out of bounds */
    if (index >= dstrlen(str)) {
       _setdstrerrno(DSTR_OUT_OF_BOUNDS);
@@ -229,6 +245,10 @@ int dstrinsertc(dstring_t dest, size_t index, char c) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return DSTR_READONLY;
+   }
+
    /* check to see if the index is out of bounds */
    if (index > dstrlen(dest)) {
       _setdstrerrno(DSTR_OUT_OF_BOUNDS);
@@ -281,6 +301,10 @@ int dstrinsertcs(dstring_t dest, const char *src, size_t index) {
       return dstrlen(dest);
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return strlen(DSTRBUF(dest));
+   }
+
    /* make sure src is not a NULL pointer */
    if (NULL == src) {
       _setdstrerrno(DSTR_NULL_CPTR);
@@ -350,6 +374,10 @@ int dstrninsertcs(dstring_t dest, const char *src, size_t index, size_t n) {
       return dstrlen(dest);
    }
 
+   if (!DSTRWRITABLE(dest)) {
+      return strlen(DSTRBUF(dest));
+   }
+
    /* make sure src is not a NULL pointer */
    if (NULL == src) {
       _setdstrerrno(DSTR_NULL_CPTR);
@@ -427,6 +455,10 @@ int dstrxchg(dstring_t str, size_t index, char c) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    /* check to see if the index is out of bounds */
    if (index >= dstrlen(str)) {
       _setdstrerrno(DSTR_OUT_OF_BOUNDS);
@@ -479,6 +511,10 @@ char dstrpopc(dstring_t str) {
       return '\0';
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return '\0';
+   }
+
    /* make sure the string isn't empty */
    if (0 == dstrlen(str)) {
       _setdstrerrno(DSTR_EMPTY_STRING);
@@ -503,6 +539,10 @@ char dstrdequeuec(dstring_t str) {
       return '\0';
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return '\0';
+   }
+
    /* make sure the string isn't empty */
    if (0 == dstrlen(str)) {
       _setdstrerrno(DSTR_EMPTY_STRING);
@@ -528,6 +568,10 @@ int dstreplacec(dstring_t str, char oldc, char newc) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
    /* make sure we're not trying to remove or insert \0's */
    if ('\0' == oldc || '\0' == newc) {
       _setdstrerrno(DSTR_INVALID_ARGUMENT);
@@ -561,6 +605,10 @@ int dstreplaces(dstring_t str, const char *olds, const char *news) {
       return 0;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return 0;
+   }
+
    /* make sure olds points to something */
    if (NULL == olds) {
       _setdstrerrno(DSTR_NULL_CPTR);
@@ -618,6 +666,10 @@ int dstrltrim(dstring_t str) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    for (p = DSTRBUF(str); *p != '\0' && isspace(*p); p++);
    memmove(DSTRBUF(str), p, strlen(p) + 1);
 
@@ -637,6 +689,10 @@ int dstrrtrim(dstring_t str) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    for (p = DSTRBUF(str) + strlen(DSTRBUF(str)) - 1;
       p >= DSTRBUF(str) && isspace(*p); p--);
 
@@ -657,6 +713,10 @@ int dstrtrim(dstring_t str) {
       return DSTR_UNINITIALIZED;
    }
 
+   if (!DSTRWRITABLE(str)) {
+      return DSTR_READONLY;
+   }
+
    dstrltrim(str);
    dstrrtrim(str);
 